@@ -0,0 +1,277 @@
+// =============================================================================
+// DownloaderBench.cpp
+// Downloader のマイクロベンチマーク・負荷試験 (Google Benchmark)
+//
+// 設計原則:
+//  - 取得元は同じプロセスの LoopbackServer（ネットワークの揺らぎを含めない）
+//  - 出力は呼び出し側のメモリ領域にして、ディスクの速度を含めない
+//  - 受信速度は bytes_per_second、CPU 使用量はプロセス全体の CPU 時間を
+//    受信量で割った cpu_s_per_GB（転送・書き出しスレッドの分を含む）で示す
+//  - 遅延の分布は DownloadMetrics のヒストグラムで集計し、p50 / p99 を出す
+//
+// 実行例（結果を JSON で残して比較する）:
+//   DownloaderBench --benchmark_out=bench.json --benchmark_out_format=json
+//   DownloaderBench --benchmark_filter=Segmented
+// =============================================================================
+
+#include "DownloadManager.h"
+#include "DownloadMetrics.h"
+#include "Downloader.h"
+#include "LoopbackServer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Downloader;
+using Downloader::Bench::LoopbackServer;
+
+namespace {
+
+constexpr int64_t KiB = 1024;
+constexpr int64_t MiB = 1024 * KiB;
+
+// =============================================================================
+// 完了待ち
+// =============================================================================
+
+/// 終了通知（完了・エラー・キャンセル）を数えて待つオブザーバー
+class CompletionWaiter final : public IDownloaderObserver {
+public:
+    void onProgress(int64_t, int64_t, double) override {}
+    void onCompleted() override { finish({}); }
+    void onError(const std::string& message) override { finish(message.empty() ? "error" : message); }
+    void onPaused() override {}
+    void onResumed() override {}
+    void onCancelled() override { finish("cancelled"); }
+
+    /// @brief count 件の終了通知まで待つ
+    /// @return 最初のエラーメッセージ（すべて完了すれば空）
+    std::string wait(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, count]() { return finished_ >= count; });
+        finished_ = 0;
+        return std::exchange(error_, {});
+    }
+
+private:
+    void finish(const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_.empty()) {
+            error_ = error;
+        }
+        ++finished_;
+        cv_.notify_all();
+    }
+
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    size_t                  finished_ = 0;
+    std::string             error_;
+};
+
+/// プロセス全体の CPU 時間 (秒)
+double processCpuSeconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+/// 受信した内容の先頭と末尾が合成データと一致するか
+bool verifyPayload(const std::vector<char>& buffer, int64_t size) {
+    for (const int64_t offset : {int64_t{0}, size / 2, size - 1}) {
+        if (buffer[static_cast<size_t>(offset)] != LoopbackServer::payloadByte(offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// ループ全体の受信量・CPU 時間から共通のカウンターを設定する
+void reportThroughput(benchmark::State& state, int64_t bytesPerIteration, double cpuSeconds) {
+    const int64_t bytes = bytesPerIteration * static_cast<int64_t>(state.iterations());
+    state.SetBytesProcessed(bytes);
+    if (bytes > 0) {
+        state.counters["cpu_s_per_GB"] = cpuSeconds / (static_cast<double>(bytes) / 1e9);
+    }
+}
+
+/// 1 件のダウンロードを実行して完了まで待つ
+/// @return エラーメッセージ（成功すれば空）
+std::string downloadOnce(Downloader::Downloader& downloader, CompletionWaiter& waiter,
+                         const std::string& url, std::vector<char>& buffer) {
+    if (!downloader.startDownload(url, std::span<char>(buffer))) {
+        return "startDownload failed";
+    }
+    return waiter.wait(1);
+}
+
+// =============================================================================
+// シナリオ
+// =============================================================================
+
+/// 大きなファイル 1 本を単一ストリームで取得する（引数: サイズ MiB）
+void BM_SingleLargeFile(benchmark::State& state) {
+    const int64_t    size = state.range(0) * MiB;
+    LoopbackServer   server;
+    std::vector<char> buffer(static_cast<size_t>(size));
+
+    DownloaderConfig config;
+    config.chunkSize = 256 * 1024;
+    Downloader::Downloader downloader(config);
+    CompletionWaiter       waiter;
+    downloader.addObserver(&waiter);
+
+    const double cpuBegin = processCpuSeconds();
+    for (auto _ : state) {
+        const std::string error = downloadOnce(downloader, waiter, server.url(size), buffer);
+        if (!error.empty()) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+    }
+    reportThroughput(state, size, processCpuSeconds() - cpuBegin);
+    if (!verifyPayload(buffer, size)) {
+        state.SkipWithError("payload mismatch");
+    }
+}
+BENCHMARK(BM_SingleLargeFile)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// 接続あたりの速度を絞ったサーバから、セグメント分割して取得する（引数: セグメント数）
+void BM_Segmented(benchmark::State& state) {
+    const int64_t  size = 64 * MiB;
+    LoopbackServer server({.bytesPerSec = 128 * MiB});
+    std::vector<char> buffer(static_cast<size_t>(size));
+
+    DownloaderConfig config;
+    config.chunkSize      = 256 * 1024;
+    config.segmentCount   = static_cast<size_t>(state.range(0));
+    config.minSegmentSize = 1 * MiB;
+    Downloader::Downloader downloader(config);
+    CompletionWaiter       waiter;
+    downloader.addObserver(&waiter);
+
+    const double cpuBegin = processCpuSeconds();
+    for (auto _ : state) {
+        const std::string error = downloadOnce(downloader, waiter, server.url(size), buffer);
+        if (!error.empty()) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+    }
+    reportThroughput(state, size, processCpuSeconds() - cpuBegin);
+    if (!verifyPayload(buffer, size)) {
+        state.SkipWithError("payload mismatch");
+    }
+}
+BENCHMARK(BM_Segmented)->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/// 小さなファイルを多数、DownloadManager のイベントループで同時に取得する
+/// （引数: ファイル数, 1 ファイルのサイズ KiB, サーバの応答遅延 ms）
+void BM_ManySmallFiles(benchmark::State& state) {
+    const auto    count   = static_cast<size_t>(state.range(0));
+    const int64_t size    = state.range(1) * KiB;
+    LoopbackServer server({.latency = std::chrono::milliseconds(state.range(2))});
+    DownloadManager manager(2);
+    DownloadMetrics metrics;
+
+    DownloaderConfig config;
+    config.metrics = &metrics;
+    CompletionWaiter waiter;
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    std::vector<std::vector<char>> buffers(count, std::vector<char>(static_cast<size_t>(size)));
+    for (size_t i = 0; i < count; ++i) {
+        downloaders.push_back(std::make_unique<Downloader::Downloader>(config, manager));
+        downloaders.back()->addObserver(&waiter);
+    }
+    const std::string url = server.url(size);
+
+    MetricHistogram latencyUs;
+    const double    cpuBegin = processCpuSeconds();
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            downloaders[i]->startDownload(url, std::span<char>(buffers[i]));
+        }
+        const std::string error = waiter.wait(count);
+        if (!error.empty()) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+        // 一括で開始したので、開始から各ジョブの最初の応答バイトまでの時間で分布を見る
+        for (const auto& downloader : downloaders) {
+            const int64_t firstByte = downloader->getStats().timings.firstByteUs;
+            latencyUs.record(static_cast<uint64_t>(std::max<int64_t>(firstByte, 0)));
+        }
+    }
+    reportThroughput(state, size * static_cast<int64_t>(count), processCpuSeconds() - cpuBegin);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+
+    const auto latency = latencyUs.snapshot();
+    state.counters["first_byte_p50_us"] = static_cast<double>(latency.percentile(0.50));
+    state.counters["first_byte_p99_us"] = static_cast<double>(latency.percentile(0.99));
+    const auto callbacks = metrics.writeCallbackUs.snapshot();
+    state.counters["write_cb_p99_us"] = static_cast<double>(callbacks.percentile(0.99));
+    state.counters["connections"] = static_cast<double>(server.connectionCount());
+}
+BENCHMARK(BM_ManySmallFiles)
+    ->Args({256, 16, 0})
+    ->Args({256, 16, 5})
+    ->Args({1024, 4, 0})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/// 受信中に pause() / resume() を繰り返す（引数: 一時停止の間隔 ms）
+void BM_PauseResumeChurn(benchmark::State& state) {
+    const int64_t  size = 8 * MiB;
+    LoopbackServer server({.bytesPerSec = 256 * MiB});
+    std::vector<char> buffer(static_cast<size_t>(size));
+    const auto     interval = std::chrono::milliseconds(state.range(0));
+
+    DownloadMetrics  metrics;
+    DownloaderConfig config;
+    config.metrics = &metrics;
+    Downloader::Downloader downloader(config);
+    CompletionWaiter       waiter;
+    downloader.addObserver(&waiter);
+
+    int64_t      pauses   = 0;
+    const double cpuBegin = processCpuSeconds();
+    for (auto _ : state) {
+        if (!downloader.startDownload(server.url(size), std::span<char>(buffer))) {
+            state.SkipWithError("startDownload failed");
+            return;
+        }
+        while (downloader.getState() == DownloadState::DOWNLOADING) {
+            std::this_thread::sleep_for(interval);
+            downloader.pause();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            downloader.resume();
+            ++pauses;
+        }
+        const std::string error = waiter.wait(1);
+        if (!error.empty()) {
+            state.SkipWithError(error.c_str());
+            return;
+        }
+    }
+    reportThroughput(state, size, processCpuSeconds() - cpuBegin);
+    state.counters["pauses"] = benchmark::Counter(static_cast<double>(pauses),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["paused_ms"] = benchmark::Counter(static_cast<double>(metrics.pausedUs.value()) / 1000,
+                                                     benchmark::Counter::kAvgIterations);
+    if (!verifyPayload(buffer, size)) {
+        state.SkipWithError("payload mismatch");
+    }
+}
+BENCHMARK(BM_PauseResumeChurn)->Arg(2)->Arg(10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
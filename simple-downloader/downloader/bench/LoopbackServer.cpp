@@ -0,0 +1,368 @@
+// =============================================================================
+// LoopbackServer.cpp
+// ベンチマーク用 HTTP/1.1 サーバの実装（POSIX ソケット / Winsock）
+// =============================================================================
+
+#include "LoopbackServer.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+namespace Downloader {
+namespace Bench {
+
+namespace {
+
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+constexpr int SEND_FLAGS = 0;
+
+void closeSocket(NativeSocket socket) { ::closesocket(socket); }
+
+/// Winsock の初期化（プロセスで一度だけ）
+void initSockets() {
+    static const bool initialized = []() {
+        WSADATA data;
+        return ::WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!initialized) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+}
+#else
+using NativeSocket = int;
+#  ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL; // 切断された接続への送信で SIGPIPE を出さない
+#  else
+constexpr int SEND_FLAGS = 0;
+#  endif
+
+void closeSocket(NativeSocket socket) { ::close(socket); }
+
+void initSockets() {}
+#endif
+
+NativeSocket native(intptr_t socket) { return static_cast<NativeSocket>(socket); }
+
+/// 合成データの周期（この大きさのブロックを繰り返し送る）
+constexpr size_t PATTERN_SIZE = 64 * 1024;
+
+/// 周期分の合成データ
+const std::array<char, PATTERN_SIZE>& patternBlock() {
+    static const auto block = []() {
+        std::array<char, PATTERN_SIZE> result{};
+        for (size_t i = 0; i < PATTERN_SIZE; ++i) {
+            result[i] = LoopbackServer::payloadByte(static_cast<int64_t>(i));
+        }
+        return result;
+    }();
+    return block;
+}
+
+/// すべて送る
+bool sendAll(intptr_t socket, const char* data, size_t size) {
+    while (size > 0) {
+        const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+        const auto sent = ::send(native(socket), data, chunk, SEND_FLAGS);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+/// ASCII の大文字小文字を無視して前方一致を調べる
+bool startsWithIgnoreCase(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) !=
+            std::tolower(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// 要求からヘッダーの値を探す（なければ空）
+std::string_view headerValue(std::string_view request, std::string_view name) {
+    size_t line = request.find("\r\n");
+    while (line != std::string_view::npos && line + 2 < request.size()) {
+        const size_t begin = line + 2;
+        const size_t end   = request.find("\r\n", begin);
+        const std::string_view header =
+            request.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+        if (startsWithIgnoreCase(header, name) && header.size() > name.size() &&
+            header[name.size()] == ':') {
+            std::string_view value = header.substr(name.size() + 1);
+            while (!value.empty() && value.front() == ' ') {
+                value.remove_prefix(1);
+            }
+            return value;
+        }
+        line = end;
+    }
+    return {};
+}
+
+} // namespace
+
+// =============================================================================
+// 待ち受け
+// =============================================================================
+
+LoopbackServer::LoopbackServer(Options options)
+    : options_(options) {
+    initSockets();
+    const NativeSocket listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#ifdef _WIN32
+    if (listener == INVALID_SOCKET) {
+#else
+    if (listener < 0) {
+#endif
+        throw std::runtime_error("Failed to create listening socket");
+    }
+
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = 0; // 空いているポートを OS に選ばせる
+    socklen_t length        = sizeof(address);
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        closeSocket(listener);
+        throw std::runtime_error("Failed to listen on the loopback interface");
+    }
+    listener_ = static_cast<Socket>(listener);
+    port_     = ntohs(address.sin_port);
+
+    acceptThread_ = std::thread(&LoopbackServer::acceptLoop, this);
+}
+
+LoopbackServer::~LoopbackServer() {
+    stopping_.store(true, std::memory_order_release);
+    // accept と recv で止まっているスレッドを shutdown で起こす
+    ::shutdown(native(listener_), 2);
+    closeSocket(native(listener_));
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    for (const auto& connection : connections_) {
+        ::shutdown(native(connection->socket), 2);
+    }
+    for (const auto& connection : connections_) {
+        connection->thread.join();
+        closeSocket(native(connection->socket));
+    }
+    connections_.clear();
+}
+
+std::string LoopbackServer::url(int64_t size) const {
+    return "http://127.0.0.1:" + std::to_string(port_) + "/bytes/" + std::to_string(size);
+}
+
+char LoopbackServer::payloadByte(int64_t offset) {
+    // 64KiB 周期で、隣り合うバイトが同じ値にならないパターン
+    const auto value = static_cast<uint64_t>(offset) % PATTERN_SIZE;
+    return static_cast<char>((value ^ (value >> 8) ^ 0x5A) & 0xFF);
+}
+
+void LoopbackServer::acceptLoop() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const NativeSocket client = ::accept(native(listener_), nullptr, nullptr);
+#ifdef _WIN32
+        if (client == INVALID_SOCKET) {
+#else
+        if (client < 0) {
+#endif
+            if (stopping_.load(std::memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+        const int noDelay = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY,
+                     reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        accepted_.fetch_add(1, std::memory_order_relaxed);
+
+        reapConnections();
+        auto connection    = std::make_unique<Connection>();
+        connection->socket = static_cast<Socket>(client);
+        Connection* raw    = connection.get();
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        if (stopping_.load(std::memory_order_acquire)) {
+            closeSocket(client);
+            return;
+        }
+        connection->thread = std::thread([this, raw]() {
+            serve(*raw);
+            raw->done.store(true, std::memory_order_release);
+        });
+        connections_.push_back(std::move(connection));
+    }
+}
+
+void LoopbackServer::reapConnections() {
+    std::vector<std::unique_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        const auto split = std::partition(connections_.begin(), connections_.end(),
+                                          [](const std::unique_ptr<Connection>& connection) {
+                                              return !connection->done.load(std::memory_order_acquire);
+                                          });
+        std::move(split, connections_.end(), std::back_inserter(finished));
+        connections_.erase(split, connections_.end());
+    }
+    for (const auto& connection : finished) {
+        connection->thread.join();
+        closeSocket(native(connection->socket));
+    }
+}
+
+// =============================================================================
+// 要求の処理
+// =============================================================================
+
+void LoopbackServer::serve(Connection& connection) {
+    std::string buffer;
+    std::array<char, 4096> chunk{};
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const size_t end = buffer.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            const auto got = ::recv(native(connection.socket), chunk.data(),
+                                    static_cast<int>(chunk.size()), 0);
+            if (got <= 0) {
+                return; // 相手が閉じた・サーバの停止
+            }
+            buffer.append(chunk.data(), static_cast<size_t>(got));
+            continue;
+        }
+        // 要求はボディを持たない (GET / HEAD) ため、空行までが 1 つの要求
+        const std::string request = buffer.substr(0, end + 2);
+        buffer.erase(0, end + 4);
+        if (!respond(connection.socket, request)) {
+            return;
+        }
+    }
+}
+
+bool LoopbackServer::respond(Socket socket, const std::string& request) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    // 要求行: "METHOD /bytes/<size> HTTP/1.1"
+    const std::string_view line = std::string_view(request).substr(0, request.find("\r\n"));
+    const size_t methodEnd = line.find(' ');
+    const size_t pathEnd   = line.find(' ', methodEnd + 1);
+    const std::string_view method = line.substr(0, methodEnd);
+    const std::string_view path   = methodEnd == std::string_view::npos
+                                        ? std::string_view()
+                                        : line.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    const bool keepAlive = !startsWithIgnoreCase(headerValue(request, "Connection"), "close");
+
+    if (options_.latency.count() > 0) {
+        std::this_thread::sleep_for(options_.latency);
+    }
+
+    constexpr std::string_view prefix = "/bytes/";
+    if ((method != "GET" && method != "HEAD") || path.substr(0, prefix.size()) != prefix) {
+        static constexpr std::string_view notFound =
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        return sendAll(socket, notFound.data(), notFound.size()) && keepAlive;
+    }
+    const int64_t size = std::strtoll(std::string(path.substr(prefix.size())).c_str(), nullptr, 10);
+
+    // Range: bytes=first-last / bytes=first-（複数区間は扱わず全体を返す）
+    int64_t first = 0;
+    int64_t last  = size - 1;
+    bool    partial = false;
+    const std::string_view range = headerValue(request, "Range");
+    if (options_.rangeSupport && range.substr(0, 6) == "bytes=" &&
+        range.find(',') == std::string_view::npos) {
+        const std::string spec(range.substr(6));
+        const size_t dash = spec.find('-');
+        if (dash != std::string::npos && dash > 0) {
+            first   = std::strtoll(spec.substr(0, dash).c_str(), nullptr, 10);
+            last    = dash + 1 < spec.size() ? std::min<int64_t>(std::strtoll(spec.c_str() + dash + 1, nullptr, 10), size - 1)
+                                             : size - 1;
+            partial = true;
+        }
+    }
+    if (partial && (first >= size || first > last)) {
+        const std::string header = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" +
+                                   std::to_string(size) + "\r\nContent-Length: 0\r\n\r\n";
+        return sendAll(socket, header.data(), header.size()) && keepAlive;
+    }
+
+    std::string header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    header += "Content-Length: " + std::to_string(last - first + 1) + "\r\n";
+    if (partial) {
+        header += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                  "/" + std::to_string(size) + "\r\n";
+    }
+    if (options_.rangeSupport) {
+        header += "Accept-Ranges: bytes\r\n";
+    }
+    header += "Content-Type: application/octet-stream\r\n";
+    header += keepAlive ? "\r\n" : "Connection: close\r\n\r\n";
+    if (!sendAll(socket, header.data(), header.size())) {
+        return false;
+    }
+    if (method == "HEAD" || size <= 0) {
+        return keepAlive;
+    }
+    return sendPayload(socket, first, last) && keepAlive;
+}
+
+bool LoopbackServer::sendPayload(Socket socket, int64_t first, int64_t last) {
+    const auto& block = patternBlock();
+    const auto  begin = std::chrono::steady_clock::now();
+    // 速度を制限する場合は 1 回の送信を小さくして、ばらつきを抑える
+    const size_t  step     = options_.bytesPerSec > 0 ? 16 * 1024 : PATTERN_SIZE;
+    int64_t       position = first;
+    while (position <= last) {
+        if (stopping_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        const size_t offset = static_cast<size_t>(position % static_cast<int64_t>(PATTERN_SIZE));
+        const size_t take   = static_cast<size_t>(std::min<int64_t>(
+            static_cast<int64_t>(std::min(step, PATTERN_SIZE - offset)), last - position + 1));
+        if (!sendAll(socket, block.data() + offset, take)) {
+            return false;
+        }
+        position += static_cast<int64_t>(take);
+
+        if (options_.bytesPerSec > 0) {
+            // 送った量に見合う時刻まで待つ
+            const auto due = begin + std::chrono::nanoseconds(
+                (position - first) * 1000000000LL / options_.bytesPerSec);
+            std::this_thread::sleep_until(due);
+        }
+    }
+    return true;
+}
+
+} // namespace Bench
+} // namespace Downloader
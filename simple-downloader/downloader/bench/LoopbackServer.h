@@ -0,0 +1,101 @@
+#pragma once
+// =============================================================================
+// LoopbackServer.h
+// ベンチマーク用の HTTP/1.1 サーバ（127.0.0.1 で待ち受け、合成データを返す）
+//
+// 仕組み:
+//   - "/bytes/<size>" に対して size バイトの合成データを返す（内容は位置だけで決まる）
+//   - GET / HEAD、Range: bytes=first-last / first-、持続接続 (keep-alive) に対応する
+//   - 応答の遅延・接続あたりの送信速度・Range 対応の有無を Options で変えられる
+//   - 接続ごとにスレッドを 1 本使う（終わった接続のスレッドは次の accept で回収する）
+//   - Upgrade: h2c は無視して HTTP/1.1 で応答する（RFC 9113 では HTTP/2 を使わない扱い）
+//
+// 使い方:
+//   LoopbackServer server({.latency = std::chrono::milliseconds(5)});
+//   downloader.startDownload(server.url(64 << 20), destination);
+// =============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Downloader {
+namespace Bench {
+
+class LoopbackServer {
+public:
+    /// @brief サーバの動作設定
+    struct Options {
+        std::chrono::milliseconds latency{0}; ///< 要求を受けてから応答ヘッダーを返すまでの遅延
+        int64_t bytesPerSec  = 0;             ///< 1 接続あたりの送信速度 (bytes/sec)、0 で無制限
+        bool    rangeSupport = true;          ///< false: Range を無視して 200 で全体を返し、Accept-Ranges を付けない
+    };
+
+    /// @brief 空いているポートで待ち受けを始める
+    /// @throws std::runtime_error 待ち受けられなかった場合
+    LoopbackServer() : LoopbackServer(Options{}) {}
+    explicit LoopbackServer(Options options);
+
+    /// @brief デストラクタ - 待ち受けとすべての接続を閉じてスレッドを join する
+    ~LoopbackServer();
+
+    LoopbackServer(const LoopbackServer&)            = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    /// @brief 待ち受けているポート
+    uint16_t port() const { return port_; }
+
+    /// @brief size バイトの合成データを返す URL
+    std::string url(int64_t size) const;
+
+    /// @brief これまでに応答した要求の数
+    uint64_t requestCount() const { return requests_.load(std::memory_order_relaxed); }
+
+    /// @brief これまでに受け付けた接続の数
+    uint64_t connectionCount() const { return accepted_.load(std::memory_order_relaxed); }
+
+    /// @brief 合成データの offset バイト目の値
+    static char payloadByte(int64_t offset);
+
+private:
+    using Socket = intptr_t;
+
+    struct Connection {
+        Socket            socket = -1;
+        std::thread       thread;
+        std::atomic<bool> done{false};
+    };
+
+    void acceptLoop();
+
+    /// 1 本の接続の要求を閉じられるまで順に処理する
+    void serve(Connection& connection);
+
+    /// 1 つの要求に応答する
+    /// @return false: 接続を閉じる
+    bool respond(Socket socket, const std::string& request);
+
+    /// 合成データの [first, last] を送信速度を守って送る
+    bool sendPayload(Socket socket, int64_t first, int64_t last);
+
+    /// 終わった接続のスレッドを join して取り除く
+    void reapConnections();
+
+    Options                  options_;
+    Socket                   listener_ = -1;
+    uint16_t                 port_     = 0;
+    std::atomic<bool>        stopping_{false};
+    std::atomic<uint64_t>    requests_{0};
+    std::atomic<uint64_t>    accepted_{0};
+    std::thread              acceptThread_;
+    std::mutex               connectionsMutex_;
+    std::vector<std::unique_ptr<Connection>> connections_; ///< connectionsMutex_ で保護
+};
+
+} // namespace Bench
+} // namespace Downloader
@@ -0,0 +1,185 @@
+#pragma once
+// =============================================================================
+// BandwidthScheduler.h
+// トークンバケットによる受信帯域の制限（ダウンロード単位・ホスト単位・プロセス全体）
+//
+// 仕組み:
+//   - Downloader ごとの Channel・ホストごと・全体の 3 段のトークンバケットを持ち、
+//     受信データは関係するすべてのバケットに残量があるときだけ受け入れる
+//     （残量が正なら受信サイズ全体を差し引く。バケットは負になってもよい）
+//   - 受け入れられない転送は待ち行列に並び、スケジューラースレッドが補充の
+//     タイミングで優先度の高い順（同じ優先度では到着順）に割り当てる。
+//     割り当て済みのバイト数は Channel に貯め、再送されたデータに充てる
+//   - 割り当て待ちがある間は、それより優先度の低い転送は即座には受け入れない
+//     （バックグラウンドの先読みが優先度の高い取得の帯域を奪わない）
+//   - 制限はいつでも変更でき、実行中の転送にもすぐに反映される
+//
+// 使い方:
+//   auto& scheduler = BandwidthScheduler::shared();
+//   scheduler.setGlobalLimit(10 * 1024 * 1024);          // プロセス全体で 10 MiB/s
+//   scheduler.setHostLimit("example.com", 2 * 1024 * 1024);
+//   auto channel = scheduler.openChannel(TransferPriority::BACKGROUND);
+//   channel->setHost("example.com");
+//   if (!channel->tryAcquire(size)) channel->notifyWhenAvailable(size, resume);
+// =============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Downloader {
+
+/// 帯域が足りないときに割り当てる順序
+enum class TransferPriority {
+    HIGH,       ///< 応答時間が重要な取得
+    NORMAL,     ///< 通常
+    BACKGROUND  ///< 先読みなど（他の転送が使わない帯域だけを使う）
+};
+
+/// @brief URL からホスト名（小文字）を取り出す。取り出せない場合は空文字列
+std::string hostFromUrl(const std::string& url);
+
+class BandwidthScheduler {
+    struct Bucket;
+
+public:
+    /// @brief 1 つのダウンロードの受信枠
+    class Channel {
+    public:
+        /// @brief 待ち行列から外して破棄する（割り当て待ちのコールバックは呼ばれない）
+        ~Channel();
+
+        Channel(const Channel&)            = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        /// @brief このダウンロードの上限を変更する (bytes/sec、0 で無制限)
+        void setLimit(int64_t bytesPerSec);
+
+        /// @brief 優先度を変更する（割り当て待ちの順序は次回の待機から反映される）
+        void setPriority(TransferPriority priority);
+
+        /// @brief ホスト単位の制限に使うホスト名を設定する
+        void setHost(const std::string& host);
+
+        /// @brief 今すぐ size バイトを受け入れられれば差し引いて true を返す
+        bool tryAcquire(size_t size);
+
+        /// @brief size バイトが割り当てられるまで待って差し引く
+        /// @param abort 定期的に呼ばれ、true を返すと待機をやめる
+        /// @return false: abort により待機をやめた
+        bool acquire(size_t size, const std::function<bool()>& abort);
+
+        /// @brief size バイトを割り当てたらスケジューラースレッドから callback を呼ぶ
+        /// 割り当て分は次の tryAcquire() に充てられる
+        void notifyWhenAvailable(size_t size, std::function<void()> callback);
+
+    private:
+        friend class BandwidthScheduler;
+        Channel(BandwidthScheduler& scheduler, TransferPriority priority);
+
+        BandwidthScheduler&     scheduler_;
+        std::unique_ptr<Bucket> bucket_;   ///< scheduler_.mutex_ で保護
+        TransferPriority        priority_; ///< scheduler_.mutex_ で保護
+        std::string             host_;     ///< scheduler_.mutex_ で保護
+        int64_t                 credit_{0}; ///< 割り当て済みで未使用のバイト数（scheduler_.mutex_ で保護）
+    };
+
+    /// @brief コンストラクタ - スケジューラースレッドを起動する
+    BandwidthScheduler();
+
+    /// @brief デストラクタ - スレッドを終了する（Channel はすべて破棄しておくこと）
+    ~BandwidthScheduler();
+
+    BandwidthScheduler(const BandwidthScheduler&)            = delete;
+    BandwidthScheduler& operator=(const BandwidthScheduler&) = delete;
+
+    /// @brief プロセス全体で共有するスケジューラーを取得する
+    static BandwidthScheduler& shared();
+
+    /// @brief ダウンロード用の受信枠を作る（スレッドセーフ）
+    std::unique_ptr<Channel> openChannel(TransferPriority priority = TransferPriority::NORMAL);
+
+    /// @brief 全体の上限を設定する (bytes/sec、0 で無制限)
+    void setGlobalLimit(int64_t bytesPerSec);
+
+    /// @brief ホストごとの上限を設定する (bytes/sec、0 で解除)
+    /// @param host ホスト名（URL を渡してもよい。ポートは区別しない）
+    void setHostLimit(const std::string& host, int64_t bytesPerSec);
+
+    /// @brief 全体の上限を取得する (0 は無制限)
+    int64_t getGlobalLimit() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// トークンバケット（mutex_ で保護）
+    struct Bucket {
+        int64_t           rate  = 0;  ///< 補充速度 (bytes/sec)、0 で無制限
+        double            level = 0;  ///< 残量 (bytes)
+        Clock::time_point updated;
+
+        void   setRate(int64_t bytesPerSec, Clock::time_point now);
+        void   refill(Clock::time_point now);
+        bool   available() const { return rate == 0 || level > 0; }
+        void   consume(size_t size) { if (rate != 0) level -= static_cast<double>(size); }
+        /// 残量が正になるまでの時間
+        Clock::duration untilAvailable() const;
+    };
+
+    /// 割り当て待ちの 1 件
+    struct Waiter {
+        uint64_t              id;
+        Channel*              channel;
+        size_t                size;
+        bool                  toCredit; ///< 割り当て分を Channel に貯める（notifyWhenAvailable）
+        std::function<void()> onGranted;
+    };
+
+    /// 割り当て待ちに並べる（mutex_ 保持中に呼ぶ）
+    uint64_t enqueueLocked(Channel& channel, size_t size, bool toCredit,
+                           std::function<void()> onGranted);
+
+    /// id の割り当て待ちを取り除く（mutex_ 保持中に呼ぶ）
+    /// @return false: すでに割り当て済み
+    bool removeWaiterLocked(uint64_t id);
+
+    /// 関係するバケットを補充し、すべてに残量があれば差し引く（mutex_ 保持中に呼ぶ）
+    bool consumeLocked(Channel& channel, size_t size, Clock::time_point now);
+
+    /// channel と同じバケットを使う、同じ優先度以上の割り当て待ちがあるか
+    /// （mutex_ 保持中に呼ぶ）
+    bool hasCompetingWaitersLocked(const Channel& channel) const;
+
+    /// channel の割り当て待ちをすべて取り除く（mutex_ 保持中に呼ぶ）
+    void removeWaitersLocked(const Channel& channel);
+
+    /// バケットの上限を変更し、制限数を更新する（mutex_ 保持中に呼ぶ）
+    void setRateLocked(Bucket& bucket, int64_t bytesPerSec);
+
+    /// スケジューラースレッドのエントリポイント
+    void schedulerThread();
+
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    mutable std::mutex            mutex_;
+    std::condition_variable       workCv_;    ///< スケジューラースレッドを起こす
+    Bucket                        global_;                  ///< mutex_ で保護
+    std::map<std::string, Bucket> hosts_;                   ///< mutex_ で保護
+    std::deque<Waiter>            waiters_[PRIORITY_COUNT]; ///< 優先度ごと（mutex_ で保護）
+    uint64_t                      nextWaiterId_{1};         ///< mutex_ で保護
+    /// 上限が設定されたバケットの数（0 の間はロックを取らずに受け入れる）
+    std::atomic<size_t>           limitedBuckets_{0};
+    bool                          stopRequested_{false};    ///< mutex_ で保護
+    std::thread                   thread_;
+};
+
+} // namespace Downloader
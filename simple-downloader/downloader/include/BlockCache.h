@@ -0,0 +1,98 @@
+#pragma once
+// =============================================================================
+// BlockCache.h
+// 区間の読み出し (RangeReader) が取得した内容を固定長のブロック単位で保持するメモリ上のキャッシュ
+//
+// 仕組み:
+//   - (URL, ブロック番号) ごとに blockSize バイトの内容を 1 つ持つ（末尾のブロックは短いことがある）
+//   - 合計サイズが maxBytes を超えると、最も長く使われていないブロックから捨てる
+//   - 取り出したブロックは共有所有で返すため、捨てられた後も使い終わるまで有効
+//
+// 使い方:
+//   BlockCache cache({.maxBytes = 256 << 20, .blockSize = 64 * 1024});
+//   RangeReader reader(downloader, &cache);   // 同じ区間の読み出しを繰り返してもリクエストしない
+//
+// 注意:
+//   - 内容が変わらないオブジェクト向け。変わりうる URL は変更後に invalidate() すること
+// =============================================================================
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Downloader {
+
+class BlockCache {
+public:
+    /// @brief キャッシュの設定
+    struct Options {
+        uint64_t maxBytes  = 64 * 1024 * 1024; ///< 保持する内容の合計の上限 (bytes)
+        int64_t  blockSize = 64 * 1024;        ///< 1 ブロックのサイズ (bytes)、1 未満は 1 として扱う
+    };
+
+    using Block = std::shared_ptr<const std::vector<char>>;
+
+    explicit BlockCache(Options options);
+    BlockCache() : BlockCache(Options{}) {}
+
+    BlockCache(const BlockCache&)            = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    /// @brief 1 ブロックのサイズ
+    int64_t blockSize() const { return blockSize_; }
+
+    /// @brief url の index 番目のブロック（スレッドセーフ。なければ nullptr）
+    Block get(const std::string& url, int64_t index);
+
+    /// @brief url の index 番目のブロックを記録する（スレッドセーフ。あれば置き換える）
+    /// @return 記録したブロック（上限を超えてすぐに捨てられた場合も有効）
+    Block put(const std::string& url, int64_t index, std::vector<char> data);
+
+    /// @brief url のブロックをすべて捨てる（スレッドセーフ）
+    void invalidate(const std::string& url);
+
+    /// @brief 保持している内容の合計 (bytes)
+    uint64_t sizeBytes() const;
+
+    /// @brief get() で見つかった回数・見つからなかった回数
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct Key {
+        std::string url;
+        int64_t     index = 0;
+
+        bool operator==(const Key& other) const { return index == other.index && url == other.url; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<std::string>()(key.url) ^ (std::hash<int64_t>()(key.index) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    struct Slot {
+        Block                     block;
+        std::list<Key>::iterator  lru; ///< lru_ の中の位置
+    };
+
+    /// 上限を超えている間、最も長く使われていないブロックを捨てる（mutex_ 保持中に呼ぶ）
+    void evictLocked();
+
+    const uint64_t maxBytes_;
+    const int64_t  blockSize_;
+
+    mutable std::mutex                      mutex_;
+    std::unordered_map<Key, Slot, KeyHash>  blocks_; ///< mutex_ で保護
+    std::list<Key>                          lru_;    ///< 先頭ほど最近使った（mutex_ で保護）
+    uint64_t                                bytes_  = 0; ///< mutex_ で保護
+    uint64_t                                hits_   = 0; ///< mutex_ で保護
+    uint64_t                                misses_ = 0; ///< mutex_ で保護
+};
+
+} // namespace Downloader
@@ -0,0 +1,161 @@
+#pragma once
+// =============================================================================
+// BufferPool.h
+// 書き込みバッファ・非同期書き込み・メモリ出力が共有する固定サイズのバッファのプール
+//
+// 仕組み:
+//   - バッファ（スラブ）はすべて同じ大きさで、ページ境界に揃えて確保する
+//   - 返されたスラブは解放せずに保持し、次の貸し出しに使う（定常状態ではヒープ確保をしない）
+//   - 保持するスラブはスレッドごとの区画に分け、借りるスレッドの区画から先に探す。
+//     区画どうしはロックを共有しないため、多数の転送スレッドから借りても競合しにくい
+//   - スラブは最初に書き込んだスレッドの NUMA ノードのメモリに置かれる (first touch)。
+//     同じスレッドが借りて返すスラブはそのスレッドの区画で回るため、ノードをまたいだアクセスが減る
+//     （自分の区画が空の場合だけ、新しく確保する前にほかの区画から借りる）
+//   - 確保した合計（貸し出し中 + 保持中）は maxBytes を超えない。超える場合は
+//     tryAcquire() が空のバッファを返し、呼び出し側は受信を止めて notifyWhenAvailable() で待つ
+//
+// 使い方:
+//   BufferPool pool({.slabSize = 1 << 20, .maxBytes = 64 << 20});
+//   DownloaderConfig config;
+//   config.bufferPool = &pool;             // まとめ書き・非同期書き込みがこのプールから借りる
+//   // プロセス全体で共有する場合は BufferPool::shared() を使う
+//
+// 注意:
+//   - プールは貸し出したすべてのバッファより長く生存させること
+// =============================================================================
+
+#include "CacheLine.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Downloader {
+
+class BufferPool {
+public:
+    /// @brief プールの設定
+    struct Options {
+        size_t slabSize = 1024 * 1024; ///< 1 スラブの大きさ (bytes)
+        size_t maxBytes = 0;           ///< 確保する合計の上限 (bytes)、0 で無制限
+    };
+
+    /// @brief 借りたスラブ（破棄するとプールへ返す。ムーブのみ可能）
+    class Buffer {
+    public:
+        Buffer() = default;
+        ~Buffer() { reset(); }
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        Buffer(const Buffer&)            = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        /// @brief プールを使わずに capacity バイトを確保する（破棄すると解放する）
+        static Buffer allocate(size_t capacity);
+
+        char*  data() const { return data_; }
+        size_t capacity() const { return capacity_; }
+        explicit operator bool() const { return data_ != nullptr; }
+
+        /// @brief すぐにプールへ返す（空のバッファになる）
+        void reset();
+
+    private:
+        friend class BufferPool;
+        Buffer(BufferPool* pool, char* data, size_t capacity)
+            : pool_(pool), data_(data), capacity_(capacity) {}
+
+        BufferPool* pool_     = nullptr; ///< nullptr: allocate() で確保した
+        char*       data_     = nullptr;
+        size_t      capacity_ = 0;
+    };
+
+    /// @brief コンストラクタ（スラブは借りられたときに確保する）
+    explicit BufferPool(Options options);
+    BufferPool() : BufferPool(Options{}) {}
+
+    /// @brief デストラクタ - 保持しているスラブを解放する
+    ~BufferPool();
+
+    // コピー・ムーブ不可
+    BufferPool(const BufferPool&)            = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// @brief プロセス全体で共有するプールを取得する（1 MiB のスラブ、上限なし）
+    static BufferPool& shared();
+
+    /// @brief スラブを借りる（スレッドセーフ）
+    /// @return 上限に達していて保持中のスラブもない場合は空のバッファ
+    Buffer tryAcquire();
+
+    /// @brief スラブを借りられるまで呼び出しスレッドを待機させる（スレッドセーフ）
+    /// ほかの利用者が返すまで戻らないため、イベントループのスレッドからは呼ばないこと
+    Buffer acquire();
+
+    /// @brief 今 tryAcquire() すれば借りられるか（スレッドセーフ）
+    bool available() const;
+
+    /// @brief 借りられるようになったときに callback を一度だけ呼ぶ（スレッドセーフ）
+    /// すでに借りられればこの場で呼ぶ。それ以外はスラブを返したスレッドから呼ばれる
+    void notifyWhenAvailable(std::function<void()> callback);
+
+    /// @brief 確保する合計の上限を変更する（スレッドセーフ。0 で無制限）
+    /// 下げた場合、超えている分は返されたときに解放する
+    void setMaxBytes(size_t maxBytes);
+
+    /// @brief 保持している未使用のスラブをすべて解放する（スレッドセーフ）
+    void trim();
+
+    size_t slabSize() const { return slabSize_; }
+    size_t maxBytes() const { return maxBytes_.load(std::memory_order_relaxed); }
+
+    /// @brief 確保している合計 (bytes、貸し出し中 + 保持中)
+    size_t allocatedBytes() const { return allocated_.load(std::memory_order_relaxed) * slabSize_; }
+
+    /// @brief 貸し出し中の合計 (bytes)
+    size_t inUseBytes() const { return inUse_.load(std::memory_order_relaxed) * slabSize_; }
+
+private:
+    static constexpr size_t SHARDS = 16;
+
+    /// スレッドごとの区画（隣の区画と同じキャッシュラインに載らないよう揃える）
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::mutex         mutex;
+        std::vector<char*> slabs; ///< 保持中のスラブ（mutex で保護）
+    };
+
+    /// 区画から 1 つ取り出す
+    char* popFrom(Shard& shard);
+
+    /// スラブを返す（Buffer のデストラクタから呼ぶ）
+    void release(char* data);
+
+    /// 上限の範囲で新しいスラブの確保を予約する
+    bool reserveSlab();
+
+    char* allocateSlab();
+    void  freeSlab(char* data);
+
+    /// 返されるのを待っている呼び出し側を起こす
+    void wakeWaiters();
+
+    const size_t              slabSize_;
+    std::atomic<size_t>       maxBytes_;
+    std::atomic<size_t>       allocated_{0}; ///< 確保しているスラブの数
+    std::atomic<size_t>       inUse_{0};     ///< 貸し出し中のスラブの数
+    std::atomic<size_t>       idle_{0};      ///< 区画に保持しているスラブの数
+    std::array<Shard, SHARDS> shards_;
+
+    // 返されるのを待つ呼び出し側
+    std::mutex                         waitMutex_;
+    std::condition_variable            waitCv_;
+    std::vector<std::function<void()>> callbacks_; ///< waitMutex_ で保護
+    std::atomic<size_t>                waiters_{0}; ///< 待っている呼び出し側の数（返すときに起こすかの判定用）
+};
+
+} // namespace Downloader
@@ -0,0 +1,106 @@
+#pragma once
+// =============================================================================
+// BufferedWriter.h
+// curl の書き込みコールバックごとの小さなデータをまとめて書き出すバッファ
+//
+// 仕組み:
+//   - 事前確保したバッファにコールバックのデータを貯め、満杯になったら
+//     Sink を 1 回呼んで大きな単位で書き出す（システムコール回数を減らす）
+//   - バッファより大きなデータはコピーせずに直接 Sink に渡す
+//   - doubleBuffer = true の場合は 2 面のバッファを使い、片方を書き出しスレッドが
+//     書いている間にもう片方へ受信を続ける
+//   - BufferPool を渡すとバッファをプールのスラブから借りる（1 面の大きさはスラブの大きさ）。
+//     プールが上限に達して借りられない間は、貯めずに Sink へ直接渡す（メモリを増やさない）
+//     借りたスラブは flush() でプールへ返す
+//
+// スレッドモデル:
+//   - write() / flush() は 1 つのスレッド（転送スレッド）から呼ぶこと
+//   - doubleBuffer 時の Sink は書き出しスレッドから呼ばれる
+//     （呼び出しは常に 1 つずつ、書き込み順どおりに行われる）
+// =============================================================================
+
+#include "BufferPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Downloader {
+
+class BufferedWriter {
+public:
+    /// @brief 書き出し先（true: 成功 / false: 書き込み失敗）
+    using Sink = std::function<bool(const char* data, size_t size)>;
+
+    /// @brief コンストラクタ - バッファを事前確保する
+    /// @param capacity     1 面あたりのバッファサイズ（0 の場合はバッファせず Sink に直接渡す）
+    /// @param sink         書き出し先
+    /// @param doubleBuffer true: 書き出しスレッドを使って 2 面バッファで書き出す
+    /// @param pool         バッファを借りるプール（nullptr の場合は自前で確保する）
+    BufferedWriter(size_t capacity, Sink sink, bool doubleBuffer = false,
+                   BufferPool* pool = nullptr);
+
+    /// @brief デストラクタ - 残りのデータを書き出してからスレッドを終了する (RAII)
+    ~BufferedWriter();
+
+    // コピー・ムーブ不可（スレッドとバッファを持つため）
+    BufferedWriter(const BufferedWriter&)            = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    /// @brief データを追加する（必要に応じて書き出す）
+    /// @return false: これまでの書き出しが失敗している
+    bool write(const char* data, size_t size);
+
+    /// @brief バッファ内のデータをすべて書き出し、完了を待つ
+    /// @return false: これまでの書き出しが失敗している
+    bool flush();
+
+    /// @brief 書き出しが一度でも失敗したか
+    bool hasFailed() const { return failed_.load(std::memory_order_acquire); }
+
+    /// @brief 1 面あたりのバッファサイズを取得する
+    size_t getCapacity() const { return capacity_; }
+
+    /// @brief まだ書き出していないバイト数を取得する
+    size_t getBufferedBytes() const { return activeSize_; }
+
+private:
+    /// 書き込み面のバッファを用意する（プールから借りられなければ false）
+    bool ensureActive();
+
+    /// 書き込み面を書き出す（doubleBuffer 時は書き出しスレッドに渡す）
+    void flushActive();
+
+    /// Sink を呼び、失敗を記録する
+    void writeThrough(const char* data, size_t size);
+
+    /// 書き出しスレッドが前回分を書き終えるまで待つ
+    void waitForFlusher();
+
+    /// 書き出しスレッドのエントリポイント
+    void flusherThread();
+
+    const size_t         capacity_;
+    Sink                 sink_;
+    BufferPool*          pool_;
+    std::atomic<bool>    failed_{false};
+
+    // 書き込み面（転送スレッドのみがアクセスする）
+    BufferPool::Buffer   active_;
+    size_t               activeSize_{0};
+
+    // 2 面バッファ: 書き出し中の面と書き出しスレッド
+    bool                 doubleBuffer_{false};
+    std::mutex           flushMutex_;
+    std::condition_variable flushCv_;
+    BufferPool::Buffer   pending_;              ///< flushMutex_ で保護
+    size_t               pendingSize_{0};       ///< flushMutex_ で保護
+    bool                 pendingReady_{false};  ///< flushMutex_ で保護
+    bool                 stopRequested_{false}; ///< flushMutex_ で保護
+    std::thread          flusher_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,24 @@
+#pragma once
+// =============================================================================
+// CacheLine.h
+// 偽共有を避けるための境界（キャッシュラインの大きさ）
+//
+// 使い方:
+//   struct alignas(CACHE_LINE_SIZE) Shard { std::atomic<uint64_t> value{0}; };
+// =============================================================================
+
+#include <cstddef>
+#include <new>
+
+namespace Downloader {
+
+/// 偽共有を避けるための境界（キャッシュラインの大きさ）
+/// GCC は std::hardware_destructive_interference_size をヘッダーで使うと
+/// ABI が変わりうるという警告を出すため、標準の値は MSVC でだけ使う
+#if defined(_MSC_VER) && defined(__cpp_lib_hardware_interference_size)
+inline constexpr size_t CACHE_LINE_SIZE = std::hardware_destructive_interference_size;
+#else
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+#endif
+
+} // namespace Downloader
@@ -0,0 +1,114 @@
+#pragma once
+// =============================================================================
+// Checksum.h
+// 受信データのチェックサム・ダイジェスト（CRC-32 / CRC-32C / SHA-256）
+//
+// 仕組み:
+//   - いずれもデータを分割して渡してよく、書き込みコールバックの中で受信と同時に
+//     計算できる（ダウンロード後にファイルを読み直さない）
+//   - CRC-32C は SSE4.2 / ARMv8 の CRC 命令、SHA-256 は x86 の SHA 拡張 (SHA-NI) を
+//     実行時に検出して使い、ない場合は表引き・汎用の実装で計算する
+//   - CRC-32C は区間ごとの値を crc32cCombine() で連結できるため、セグメント分割
+//     ダウンロードでは各セグメントが並列に計算し、最後に順に結合する
+//
+// 使い方:
+//   StreamingChecksum checksum(ChecksumAlgorithm::SHA256);
+//   checksum.update(data, size);           // 受信ごとに呼ぶ
+//   std::string hex = checksum.hexDigest(); // 16 進の小文字
+// =============================================================================
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Downloader {
+
+/// @brief ダウンロードの検証に使うアルゴリズム
+enum class ChecksumAlgorithm {
+    NONE,   ///< 計算しない
+    CRC32C, ///< CRC-32C (Castagnoli)。セグメントごとに並列計算できる
+    SHA256, ///< SHA-256
+};
+
+/// @brief CRC-32 (IEEE 802.3) を更新する。初期値は 0
+uint32_t crc32Update(uint32_t crc, const char* data, size_t size);
+
+/// @brief CRC-32C (Castagnoli) を更新する。初期値は 0
+uint32_t crc32cUpdate(uint32_t crc, const char* data, size_t size);
+
+/// @brief 連続する 2 区間の CRC-32C を連結する
+/// @param crcA  前の区間の CRC-32C
+/// @param crcB  後の区間の CRC-32C
+/// @param sizeB 後の区間の長さ (bytes)
+/// @return 2 区間を続けて計算した場合と同じ値
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, int64_t sizeB);
+
+/// @brief CRC-32C・SHA-256 にハードウェア命令を使っているか
+bool crc32cAccelerated();
+bool sha256Accelerated();
+
+namespace detail {
+
+/// 命令セット拡張を使わない実装（テストで高速版と突き合わせる）
+uint32_t crc32cPortable(uint32_t crc, const char* data, size_t size);
+void     sha256CompressPortable(uint32_t state[8], const uint8_t* blocks, size_t count);
+
+} // namespace detail
+
+// =============================================================================
+// Sha256: SHA-256 の逐次計算
+// =============================================================================
+class Sha256 {
+public:
+    static constexpr size_t DIGEST_SIZE = 32;
+    using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+    Sha256() { reset(); }
+
+    /// @brief 計算を最初からやり直す
+    void reset();
+
+    /// @brief データを追加する
+    void update(const char* data, size_t size);
+
+    /// @brief ダイジェストを返す（以降は reset() するまで update() しないこと）
+    Digest finish();
+
+private:
+    std::array<uint32_t, 8> state_{};
+    std::array<uint8_t, 64> block_{}; ///< 64 バイトに満たない残り
+    size_t   blockSize_  = 0;
+    uint64_t totalBytes_ = 0;
+};
+
+// =============================================================================
+// StreamingChecksum: アルゴリズムを選んで逐次計算する
+// =============================================================================
+class StreamingChecksum {
+public:
+    explicit StreamingChecksum(ChecksumAlgorithm algorithm = ChecksumAlgorithm::NONE)
+        : algorithm_(algorithm) {}
+
+    ChecksumAlgorithm algorithm() const { return algorithm_; }
+
+    /// @brief データを追加する
+    void update(const char* data, size_t size);
+
+    /// @brief ここまでの CRC-32C（CRC32C の場合のみ有効）
+    uint32_t crc32c() const { return crc_; }
+
+    /// @brief ダイジェストを 16 進の小文字で返す（NONE の場合は空文字列）
+    /// SHA256 では計算を終えるため、以降は update() しないこと
+    std::string hexDigest();
+
+private:
+    ChecksumAlgorithm algorithm_;
+    uint32_t          crc_ = 0;
+    Sha256            sha_;
+};
+
+/// @brief CRC-32C の値を 16 進 8 桁の小文字にする（StreamingChecksum::hexDigest と同じ形式）
+std::string crc32cHex(uint32_t crc);
+
+} // namespace Downloader
@@ -0,0 +1,78 @@
+#pragma once
+// =============================================================================
+// ContentDecoder.h
+// Content-Encoding (gzip / deflate / br / zstd) の逐次展開
+//
+// 仕組み:
+//   - 受信した圧縮データを分割されたまま decode() に渡し、展開できた分から
+//     出力関数に渡す。入力の区切りと出力の区切りは一致しない
+//   - 展開に使うライブラリはビルド時に見つかったものだけが有効になる
+//     （supportedEncodings() が Accept-Encoding に送れる方式を返す）
+//   - スレッドセーフではない。1 つの展開器は 1 スレッドから使う
+//
+// 使い方:
+//   auto decoder = ContentDecoder::create("gzip", [&](const char* p, size_t n) {
+//       return writer.write(p, n);
+//   });
+//   decoder->decode(data, size);  // 受信ごとに呼ぶ
+//   decoder->finish();            // 入力が途中で切れていないかを確かめる
+// =============================================================================
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Downloader {
+
+class ContentDecoder {
+public:
+    /// @brief 展開したデータの受け取り先（true: 成功 / false: 展開を中断する）
+    using Output = std::function<bool(const char* data, size_t size)>;
+
+    /// @brief 展開できる方式を Accept-Encoding の形式で返す（例: "gzip, deflate, br"）
+    /// 1 つもない場合は空文字列
+    static std::string supportedEncodings();
+
+    /// @brief Content-Encoding の値が無圧縮（空・identity）か
+    static bool isIdentity(std::string_view contentEncoding);
+
+    /// @brief Content-Encoding に対応する展開器を作る
+    /// @return nullptr: 未対応の方式（複数の方式を重ねたものを含む）
+    static std::unique_ptr<ContentDecoder> create(std::string_view contentEncoding,
+                                                  Output output);
+
+    virtual ~ContentDecoder() = default;
+
+    ContentDecoder(const ContentDecoder&)            = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    /// @brief 圧縮データを展開して出力関数に渡す
+    /// @return false: 入力が壊れている・出力関数が失敗した
+    virtual bool decode(const char* data, size_t size) = 0;
+
+    /// @brief 入力の終わりを確かめる
+    /// @return false: 圧縮ストリームが途中で終わっている
+    virtual bool finish() = 0;
+
+    /// @brief 直前の失敗の理由
+    const std::string& getLastError() const { return lastError_; }
+
+protected:
+    explicit ContentDecoder(Output output)
+        : output_(std::move(output)), buffer_(64 * 1024) {}
+
+    /// 展開したデータを出力関数に渡す（失敗したら理由を記録する）
+    bool emit(const char* data, size_t size);
+
+    /// 失敗の理由を記録して false を返す
+    bool fail(std::string message);
+
+    Output            output_;
+    std::vector<char> buffer_; ///< 展開先の作業領域
+    std::string       lastError_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,44 @@
+#pragma once
+// =============================================================================
+// CurlGlobal.h
+// libcurl のグローバル初期化 (curl_global_init) を最初に使うときに一度だけ行う
+//
+// 仕組み:
+//   - CurlHandle・CurlHandlePool・DownloadManager が curl のオブジェクトを作る前に
+//     ensureInitialized() を呼ぶ。ダウンロードしないプロセスは curl を初期化しない
+//   - 初期化は関数内の static で一度だけ行い（スレッドセーフ）、
+//     後始末 (curl_global_cleanup) はプロセス終了時に行う
+//   - 初期化より前に configure(Features::NO_SSL) を呼ぶと、SSL を初期化しない
+//     （http:// だけを使う環境向け）。libcurl 7.57 以降は SSL を使うときに自身で
+//     初期化するため、違いは古い libcurl でだけ現れる
+//
+// 使い方:
+//   CurlGlobal::configure(CurlGlobal::Features::NO_SSL); // 任意、最初のダウンロードより前に
+//   Downloader::Downloader d;                             // 初期化は最初のハンドル生成時
+// =============================================================================
+
+namespace Downloader {
+
+class CurlGlobal {
+public:
+    /// @brief 初期化する機能
+    enum class Features {
+        ALL,    ///< CURL_GLOBAL_DEFAULT（SSL を含む）
+        NO_SSL, ///< SSL を初期化しない
+    };
+
+    /// @brief 初期化する機能を指定する（最初の ensureInitialized() より前に呼ぶこと）
+    /// @return false: 既に初期化していて変更できない
+    static bool configure(Features features);
+
+    /// @brief まだなら curl_global_init を呼ぶ（スレッドセーフ、2 回目以降はほぼコストがない）
+    /// @return false: curl_global_init に失敗した
+    static bool ensureInitialized();
+
+    /// @brief 初期化済みか（ensureInitialized() を一度でも呼んだか）
+    static bool isInitialized();
+
+    CurlGlobal() = delete;
+};
+
+} // namespace Downloader
@@ -7,6 +7,7 @@
 #include "ICurlHandle.h"
 
 #include <curl/curl.h>
+#include <functional>
 #include <string>
 
 namespace Downloader {
@@ -15,11 +16,23 @@ namespace Downloader {
 /// ICurlHandle インターフェースを実装し、curl_easy_* API を安全に使用する
 class CurlHandle final : public ICurlHandle {
 public:
-    /// @brief コンストラクタ - curl_easy_init() を呼び出す
+    /// @brief コンストラクタ - curl_easy_init() を呼び出す（未初期化なら先に CurlGlobal を初期化する）
     /// @throws std::runtime_error curl 初期化に失敗した場合
     CurlHandle();
 
-    /// @brief デストラクタ - curl_easy_cleanup() を呼び出す (RAII)
+    /// @brief 破棄時に CURL* を受け取る関数（CurlHandlePool への返却に使う）
+    using Releaser = std::function<void(CURL* handle)>;
+
+    /// @brief 既存の CURL* を引き取るコンストラクタ（CurlHandlePool が使用）
+    /// @param handle   applyCommonOptions() 済みの CURL*（nullptr 不可）
+    /// @param releaser 破棄時に curl_easy_cleanup() の代わりに呼ばれる
+    CurlHandle(CURL* handle, Releaser releaser);
+
+    /// @brief ハンドルごとに変わらない既定の設定を行う
+    /// CurlHandlePool はテンプレートのハンドルに一度だけ設定し、curl_easy_duphandle で複製する
+    static void applyCommonOptions(CURL* handle);
+
+    /// @brief デストラクタ - curl_easy_cleanup() または Releaser を呼び出す (RAII)
     ~CurlHandle() override;
 
     // コピー不可
@@ -29,17 +42,57 @@ public:
     // ICurlHandle インターフェース実装
     void setUrl(const std::string& url) override;
     void setResumeFrom(int64_t startByte) override;
+    void setRange(int64_t first, int64_t last) override;
+    void setRequestHeaders(const std::vector<std::string>& headers) override;
+    void setAcceptEncoding(const std::string& encodings, bool decode) override;
+    void setNoBody(bool noBody) override;
+    void setBufferSize(size_t bytes) override;
+    void setTcpNoDelay(bool enable) override;
+    void setTcpKeepAlive(bool enable, long idleSec, long intervalSec) override;
+    void setReceiveBufferSize(int bytes) override;
     void enableHttp2() override;
+    bool enableHttp3() override;
+    void setMultiplexing(bool enable) override;
+    void setResolveOverrides(const std::vector<std::string>& entries) override;
+    void setHappyEyeballsTimeout(long ms) override;
+    void setTcpFastOpen(bool enable) override;
+    void setTlsEarlyData(bool enable) override;
     void setWriteCallback(WriteCallback cb) override;
     void setProgressCallback(ProgressCallback cb) override;
+    void setHeaderCallback(HeaderCallback cb) override;
+    void setReceiver(Receiver* receiver) override;
     void setConnectTimeout(long seconds) override;
     void setUserAgent(const std::string& ua) override;
     void setFollowLocation(bool follow) override;
     void setSslVerify(bool verify) override;
     CurlResult perform() override;
+    void unpause() override;
     long getHttpResponseCode() const override;
+    int64_t getContentLength() const override;
+    int64_t getRoundTripTimeUs() const override;
+    PhaseTimings getTimings() const override;
     std::string getLastError() const override;
 
+    // -------------------------------------------------------------------------
+    // DownloadManager (curl_multi) から駆動するための API
+    // perform() は beginTransfer → curl_easy_perform → finishTransfer と等価
+    // -------------------------------------------------------------------------
+
+    /// @brief ネイティブの CURL* ハンドルを取得する
+    CURL* native() const { return handle_; }
+
+    /// @brief setUrl() で設定した URL
+    const std::string& url() const { return url_; }
+
+    /// @brief setMultiplexing(true) を設定した（同じ接続元の転送を同じループで駆動する）
+    bool multiplexing() const { return multiplexing_; }
+
+    /// @brief 転送開始前の準備（エラーバッファのクリア）
+    void beginTransfer();
+
+    /// @brief 転送完了時の CURLcode を CurlResult に変換する
+    CurlResult finishTransfer(CURLcode code) const;
+
 private:
     /// curl 書き込みコールバックの静的ブリッジ関数
     static size_t curlWriteCallback(char* ptr, size_t size,
@@ -50,12 +103,32 @@ private:
                                     curl_off_t dltotal, curl_off_t dlnow,
                                     curl_off_t ultotal, curl_off_t ulnow);
 
+    /// curl ヘッダーコールバックの静的ブリッジ関数
+    static size_t curlHeaderCallback(char* buffer, size_t size,
+                                     size_t nitems, void* userdata);
+
+    /// curl ソケットオプションコールバックの静的ブリッジ関数（ソケットを覚え、接続前に SO_RCVBUF を設定する）
+    static int curlSockoptCallback(void* clientp, curl_socket_t fd, curlsocktype purpose);
+
     /// CURLcode を CurlResult に変換するヘルパー
     CurlResult toCurlResult(CURLcode code) const;
 
+    /// コンストラクタ共通の、このインスタンスを指す設定（エラーバッファ・コールバックの引数）
+    void applyDefaults();
+
     CURL*          handle_{nullptr};     ///< libcurl ハンドル
+    Releaser       releaser_;            ///< 設定時は cleanup の代わりに呼ぶ
+    std::string    url_;                 ///< setUrl() で設定した URL
+    bool           multiplexing_{false}; ///< setMultiplexing() で設定した値
     WriteCallback  writeCallback_;       ///< ユーザー指定の書き込み CB
     ProgressCallback progressCallback_;  ///< ユーザー指定の進捗 CB
+    HeaderCallback headerCallback_;      ///< ユーザー指定のヘッダー CB
+    Receiver*      receiver_{nullptr};   ///< 設定時は上の 3 つより優先する
+    curl_slist*    requestHeaders_{nullptr}; ///< CURLOPT_HTTPHEADER に渡したリスト（転送中は保持する）
+    curl_slist*    resolveOverrides_{nullptr}; ///< CURLOPT_RESOLVE に渡したリスト（同上）
+    int            receiveBufferSize_{0};    ///< 新しい接続に設定する SO_RCVBUF（0: OS の既定）
+    bool           inCallback_{false};       ///< 書き込み・進捗コールバックを実行中（転送中の接続がある）
+    curl_socket_t  socket_{CURL_SOCKET_BAD}; ///< このハンドルが最後に張った接続のソケット（inCallback_ の間だけ使う）
     char           errorBuffer_[CURL_ERROR_SIZE]{'\0'}; ///< エラー詳細バッファ
 };
 
@@ -0,0 +1,80 @@
+#pragma once
+// =============================================================================
+// CurlHandlePool.h
+// CurlHandle を貸し出し・回収して接続と TLS セッションを再利用するプール
+//
+// 仕組み:
+//   - 返却された CURL* は curl_easy_reset で設定だけを初期化し、共通の設定
+//     (CURLSH・CurlHandle::applyCommonOptions) をし直して保持する
+//     （リセット後もライブ接続・DNS キャッシュ・TLS セッションは残る）
+//   - 未使用ハンドルがなければ、共通の設定を済ませたテンプレートを curl_easy_duphandle で
+//     複製する（curl_easy_init と setopt の繰り返しより速い）。warmUp() で前もって作っておける
+//   - プール内の全ハンドルは 1 つの CURLSH を共有し、DNS キャッシュ・
+//     TLS セッション・接続キャッシュをハンドル間で使い回す
+//
+// 使い方:
+//   CurlHandlePool pool;
+//   Downloader::Downloader d(config, pool.makeFactory());
+//   // Downloader のデフォルトコンストラクタは CurlHandlePool::shared() を使う
+//
+// 注意:
+//   - 貸し出した CurlHandle とファクトリはプール本体より長く生存してもよい
+//     （内部状態は共有所有され、最後のハンドルと共に解放される）
+// =============================================================================
+
+#include "ICurlHandle.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace Downloader {
+
+class CurlHandlePool {
+public:
+    /// @brief CurlFactory と互換のファクトリ型
+    using Factory = std::function<std::unique_ptr<ICurlHandle>()>;
+
+    /// @brief コンストラクタ - CURLSH とテンプレートのハンドルを生成する（未初期化なら CurlGlobal も初期化する）
+    /// @param maxIdle 保持する未使用ハンドルの上限（超えた分は破棄する）
+    /// @throws std::runtime_error curl の初期化・curl_share_init() に失敗した場合
+    explicit CurlHandlePool(size_t maxIdle = 16);
+
+    /// @brief デストラクタ - 未使用ハンドルを解放する
+    /// 貸し出し中のハンドルがあれば、共有状態はそれらの返却後に解放される
+    ~CurlHandlePool();
+
+    // コピー・ムーブ不可
+    CurlHandlePool(const CurlHandlePool&)            = delete;
+    CurlHandlePool& operator=(const CurlHandlePool&) = delete;
+
+    /// @brief プロセス全体で共有するプールを取得する
+    static CurlHandlePool& shared();
+
+    /// @brief ハンドルを借りる（スレッドセーフ）
+    /// 破棄すると自動的にプールへ返却される
+    /// @throws std::runtime_error curl_easy_duphandle() に失敗した場合
+    std::unique_ptr<ICurlHandle> acquire();
+
+    /// @brief acquire() 相当のファクトリを生成する（Downloader に注入する）
+    /// ファクトリはプール本体より長く生存してもよい
+    Factory makeFactory();
+
+    /// @brief 未使用ハンドルが count 本（maxIdle まで）になるよう前もって複製しておく（スレッドセーフ）
+    /// 多数の区間を同時に始める前に呼ぶと、開始時にハンドルを作らずに済む
+    /// @return 未使用ハンドル数
+    /// @throws std::runtime_error curl_easy_duphandle() に失敗した場合
+    size_t warmUp(size_t count);
+
+    /// @brief プール内の未使用ハンドル数を取得する
+    size_t getIdleCount() const;
+
+private:
+    struct State;
+
+    static std::unique_ptr<ICurlHandle> acquireFrom(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,134 @@
+#pragma once
+// =============================================================================
+// DiskWriteQueue.h
+// ネットワーク受信とディスク書き込みを切り離す非同期書き込みキュー
+//
+// 仕組み:
+//   - 転送スレッドはデータをキューに積むだけで戻り、専用の書き出しスレッドが
+//     積まれた順にファイルへ書き込む
+//   - キューに積めるのは maxQueuedBytes まで。isFull() になったら呼び出し側は
+//     転送を一時停止し、notifyWhenSpace() / waitForSpace() で空きを待つ
+//   - 空きの通知は上限の半分まで減ったときに行う（停止と再開の繰り返しを防ぐ）
+//   - 書き込み済みのブロックは再利用し、定常状態ではヒープ確保をしない
+//   - BufferPool を渡すとブロックをプールのスラブから借りる。プールが上限に達していれば
+//     キューに積んだスラブが書き込まれて返るまで isFull() になる（プールの上限で受信を止める）。
+//     キューがスラブを 1 つも持っていない場合は、空きを待つ相手がいないためヒープに確保する
+//
+// 使い方:
+//   DiskWriteQueue queue(16 * 1024 * 1024);
+//   auto stream = queue.open([&](const char* p, size_t n) { ...; return ok; });
+//   stream->write(data, size);   // 出力先ごとに書き込み順を保つ
+//   stream->drain();             // 書き込み完了を待つ（ファイルを閉じる前に呼ぶ）
+// =============================================================================
+
+#include "BufferPool.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Downloader {
+
+class DiskWriteQueue {
+public:
+    /// @brief 書き出し先（true: 成功 / false: 書き込み失敗）
+    using Sink = std::function<bool(const char* data, size_t size)>;
+
+    /// @brief 1 つの出力先への書き込み口
+    class Stream : public std::enable_shared_from_this<Stream> {
+    public:
+        /// @brief データをコピーしてキューに積む（上限を超えていても積む）
+        /// @return false: これまでの書き込みが失敗している
+        bool write(const char* data, size_t size);
+
+        /// @brief この Stream に積んだデータがすべて書き込まれるまで待つ
+        /// @return false: 書き込みが一度でも失敗した
+        bool drain();
+
+        /// @brief 書き込みが一度でも失敗したか
+        bool hasFailed() const;
+
+    private:
+        friend class DiskWriteQueue;
+        Stream(DiskWriteQueue& queue, Sink sink)
+            : queue_(queue), sink_(std::move(sink)) {}
+
+        DiskWriteQueue& queue_;
+        Sink            sink_;
+        size_t          pending_{0};   ///< 未書き込みのブロック数（queue_.mutex_ で保護）
+        bool            failed_{false}; ///< queue_.mutex_ で保護
+    };
+
+    /// @brief コンストラクタ - 書き出しスレッドを起動する
+    /// @param maxQueuedBytes 書き込み待ちデータの上限 (bytes)
+    /// @param pool           ブロックを借りるプール（nullptr の場合はヒープに確保する）
+    explicit DiskWriteQueue(size_t maxQueuedBytes, BufferPool* pool = nullptr);
+
+    /// @brief デストラクタ - 積まれたデータをすべて書き込んでからスレッドを終了する (RAII)
+    ~DiskWriteQueue();
+
+    // コピー・ムーブ不可（スレッドリソースを持つため）
+    DiskWriteQueue(const DiskWriteQueue&)            = delete;
+    DiskWriteQueue& operator=(const DiskWriteQueue&) = delete;
+
+    /// @brief 出力先を登録する（スレッドセーフ）
+    /// Stream は積んだデータの書き込みが終わるまでキューからも参照される
+    std::shared_ptr<Stream> open(Sink sink);
+
+    /// @brief 書き込み待ちが上限に達しているか（スレッドセーフ）
+    bool isFull() const;
+
+    /// @brief 空きができるまで呼び出しスレッドを待機させる（スレッドセーフ）
+    void waitForSpace();
+
+    /// @brief 空きができたときに callback を一度だけ呼ぶ（スレッドセーフ）
+    /// すでに空きがあればこの場で呼ぶ。それ以外は書き出しスレッドから呼ばれる
+    void notifyWhenSpace(std::function<void()> callback);
+
+    /// @brief 書き込み待ちのバイト数を取得する
+    size_t getQueuedBytes() const;
+
+    /// @brief 書き込み待ちデータの上限を取得する
+    size_t getMaxQueuedBytes() const { return maxQueuedBytes_; }
+
+private:
+    /// 書き込み待ちの 1 ブロック
+    struct Block {
+        std::shared_ptr<Stream> stream;
+        std::vector<char>       data; ///< slab を借りられなかった場合に使う
+        BufferPool::Buffer      slab;
+        size_t                  size = 0;
+
+        const char* bytes() const { return slab ? slab.data() : data.data(); }
+    };
+
+    /// 空きの通知を出す水位（mutex_ 保持中に呼ぶ）
+    bool hasSpaceLocked() const;
+
+    /// プールの上限のために待つ必要があるか（mutex_ 保持中に呼ぶ）
+    bool waitingForPoolLocked() const;
+
+    /// 書き出しスレッドのエントリポイント
+    void writerThread();
+
+    const size_t                       maxQueuedBytes_;
+    BufferPool* const                  pool_;
+
+    mutable std::mutex                 mutex_;
+    std::condition_variable            workCv_;   ///< 書き出しスレッドを起こす
+    std::condition_variable            spaceCv_;  ///< 空き・drain 待ちを起こす
+    std::deque<Block>                  blocks_;         ///< mutex_ で保護
+    std::vector<std::vector<char>>     freeBuffers_;    ///< 再利用するバッファ（mutex_ で保護）
+    std::vector<std::function<void()>> spaceCallbacks_; ///< mutex_ で保護
+    size_t                             queuedBytes_{0}; ///< mutex_ で保護
+    size_t                             queuedSlabs_{0}; ///< 積んでいるスラブの数（mutex_ で保護）
+    bool                               stopRequested_{false}; ///< mutex_ で保護
+    std::thread                        writer_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,143 @@
+#pragma once
+// =============================================================================
+// DownloadCache.h
+// ダウンロード結果を再利用するディスク上のキャッシュ（条件付きリクエストで再検証する）
+//
+// 仕組み:
+//   - 内容は "<directory>/objects/" に 1 ファイルずつ置く。SHA-256 が分かる内容は
+//     "sha256-<ダイジェスト>" の名前で置き、別の URL でも同じ内容は 1 つを共有する
+//     （分からない内容は URL から決めた名前で置く）
+//   - URL ごとに内容・ETag・Last-Modified・サイズを索引に記録する。Downloader は索引に
+//     ある URL を If-None-Match / If-Modified-Since 付きで要求し、304 が返れば内容を
+//     出力先へ複製して完了する（ボディは受信しない）
+//   - 出力先への複製は、ファイルシステムが対応していれば reflink（コピーオンライト）、
+//     HARD_LINK ではハードリンクを優先し、どちらもできなければコピーする
+//   - 合計サイズが maxBytes を超えると、最も長く使われていない URL から削除する
+//   - 索引は 1 つのバイナリファイルで、起動時に一度に読み込む。変更は flush()・
+//     store()・デストラクタで一時ファイルに書いてから rename する
+//
+// 使い方:
+//   DownloadCache cache({.directory = "/var/cache/downloader", .maxBytes = 20ull << 30});
+//   DownloaderConfig config;
+//   config.cache = &cache;                // ファイルへのダウンロードがキャッシュを使う
+//   config.checksumAlgorithm = ChecksumAlgorithm::SHA256;   // 内容で共有する場合
+//
+// 注意:
+//   - 同じディレクトリを複数のプロセスで同時に使わないこと（索引は最後に書いた内容になる）
+//   - HARD_LINK では出力ファイルとキャッシュが同じ実体になる。出力を書き換えない場合にだけ使う
+//     （Downloader は次のダウンロードの前にリンクを外してから書き込む）
+// =============================================================================
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Downloader {
+
+class DownloadCache {
+public:
+    /// @brief 出力先への複製の方法
+    enum class LinkMode {
+        CLONE,     ///< reflink、できなければコピー（出力を書き換えてもキャッシュは壊れない）
+        HARD_LINK, ///< ハードリンク、できなければ CLONE と同じ（出力は読み取り専用として扱う）
+    };
+
+    /// @brief キャッシュの設定
+    struct Options {
+        std::string directory;                  ///< 置き場所（なければ作る）
+        uint64_t    maxBytes = 0;               ///< 内容の合計の上限 (bytes)、0 で無制限
+        LinkMode    linkMode = LinkMode::CLONE;
+    };
+
+    /// @brief 索引の 1 件
+    struct Entry {
+        std::string url;
+        std::string object;       ///< objects/ の中のファイル名
+        std::string etag;
+        std::string lastModified;
+        int64_t     size = 0;
+
+        /// 再検証のリクエストヘッダー（If-None-Match / If-Modified-Since）
+        std::vector<std::string> conditionalHeaders() const;
+    };
+
+    /// @brief コンストラクタ - 索引を読み込む（壊れていれば空から始める）
+    explicit DownloadCache(Options options);
+
+    /// @brief デストラクタ - 変更された索引を書き出す
+    ~DownloadCache();
+
+    DownloadCache(const DownloadCache&)            = delete;
+    DownloadCache& operator=(const DownloadCache&) = delete;
+
+    /// @brief URL の記録を探し、最近使ったものとして扱う（スレッドセーフ）
+    std::optional<Entry> lookup(const std::string& url);
+
+    /// @brief SHA-256 が一致する内容を探す（スレッドセーフ）
+    /// @param sha256 16 進のダイジェスト（大文字小文字は問わない）
+    std::optional<Entry> lookupDigest(const std::string& sha256);
+
+    /// @brief 内容を outputPath へ複製する（既存のファイルは置き換える。スレッドセーフ）
+    /// @return false: 内容が消えている（記録は削除する）・書き込めない
+    bool materialize(const Entry& entry, const std::string& outputPath);
+
+    /// @brief ダウンロードしたファイルを url の内容として記録する（スレッドセーフ）
+    /// @param sha256 内容の SHA-256（分かれば。同じ内容の記録と共有する）
+    /// @return false: 記録できない（上限より大きい・コピーに失敗した）
+    bool store(const std::string& url, const std::string& path,
+               const std::string& etag, const std::string& lastModified,
+               const std::string& sha256 = {});
+
+    /// @brief URL の記録を削除する（スレッドセーフ）
+    void remove(const std::string& url);
+
+    /// @brief 変更された索引を書き出す（スレッドセーフ）
+    bool flush();
+
+    /// @brief path がキャッシュの内容とハードリンクを共有していれば、リンクを外す
+    /// 上書きする前に呼び、キャッシュの内容を書き換えないようにする
+    static void detach(const std::string& path);
+
+    size_t   size() const;       ///< 記録している URL の数
+    uint64_t totalBytes() const; ///< 内容の合計 (bytes、共有している内容は 1 回だけ数える)
+
+private:
+    struct Record {
+        Entry    entry;
+        uint64_t lastUse = 0; ///< 使った順番（大きいほど新しい）
+    };
+
+    std::string objectPath(const std::string& object) const;
+    std::string indexPath() const;
+
+    /// 索引を読み込む（コンストラクタから呼ぶ）
+    bool load();
+
+    /// 索引を書き出す（mutex_ 保持中に呼ぶ）
+    bool saveLocked();
+
+    /// 記録を削除し、どこからも参照されなくなった内容を削除する（mutex_ 保持中に呼ぶ）
+    void eraseLocked(const std::string& url);
+
+    /// どこからも参照されなくなった内容を削除する（mutex_ 保持中に呼ぶ）
+    void releaseObjectLocked(const std::string& object);
+
+    /// 上限を超えている間、最も長く使われていない記録を削除する（mutex_ 保持中に呼ぶ）
+    void evictLocked(const std::string& keep);
+
+    /// 内容を参照している記録の数（mutex_ 保持中に呼ぶ）
+    size_t referencesLocked(const std::string& object) const;
+
+    const Options                           options_;
+    mutable std::mutex                      mutex_;
+    std::unordered_map<std::string, Record> records_;       ///< URL → 記録（mutex_ で保護）
+    std::unordered_map<std::string, int64_t> objects_;      ///< 内容 → サイズ（mutex_ で保護）
+    uint64_t                                totalBytes_ = 0; ///< mutex_ で保護
+    uint64_t                                useCounter_ = 0; ///< mutex_ で保護
+    bool                                    dirty_      = false; ///< mutex_ で保護
+};
+
+} // namespace Downloader
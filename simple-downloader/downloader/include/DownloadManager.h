@@ -0,0 +1,113 @@
+#pragma once
+// =============================================================================
+// DownloadManager.h
+// curl_multi によるイベントループで多数の転送を少数のスレッドで駆動する
+//
+// スレッドモデル:
+//   - イベントループスレッド (固定数) : curl_multi_perform / curl_multi_poll を回し、
+//     curl コールバックと完了通知をこのスレッド上で呼び出す
+//   - 呼び出し側スレッド : submit / unpause を呼び出す（コマンドはキュー経由で
+//     ループスレッドに渡され、curl_multi_wakeup でループを起こす）
+//
+// 使い方:
+//   DownloadManager manager(2);           // ループスレッド 2 本
+//   Downloader::Downloader d1(config, manager);
+//   Downloader::Downloader d2(config, manager);
+//   d1.startDownload(...); d2.startDownload(...);
+//
+// 注意:
+//   - DownloadManager は利用するすべての Downloader より長く生存させること
+//   - CurlHandle 以外の ICurlHandle（テスト用モックなど）は curl_multi で駆動
+//     できないため、ループスレッド上で perform() を同期実行する
+//   - HTTP/2・HTTP/3 の接続は 1 つのループの中でしか多重化できないため、
+//     多重化する転送 (ICurlHandle::setMultiplexing) は同じホストへの転送が
+//     実行中のループに割り当てる
+// =============================================================================
+
+#include "ICurlHandle.h"
+#include "ProgressTable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Downloader {
+
+/// @brief イベントループごとの接続数の上限（curl_multi の設定）
+struct ConnectionLimits {
+    long maxStreamsPerConnection = 100; ///< 1 本の HTTP/2・HTTP/3 接続で同時に流すストリーム数 (CURLMOPT_MAX_CONCURRENT_STREAMS)
+    long maxConnectionsPerHost   = 0;   ///< 1 つのホストへの同時接続数、0 で無制限 (CURLMOPT_MAX_HOST_CONNECTIONS)
+    long maxTotalConnections     = 0;   ///< 同時接続数の合計、0 で無制限 (CURLMOPT_MAX_TOTAL_CONNECTIONS)
+};
+
+class DownloadManager {
+public:
+    /// @brief 転送完了時に呼ばれるハンドラ（ループスレッドから呼ばれる）
+    /// ハンドラ内で ICurlHandle を破棄してもよい
+    using CompletionHandler = std::function<void(CurlResult result)>;
+
+    /// @brief コンストラクタ - イベントループスレッドを起動する
+    /// @param threadCount ループスレッド数（0 の場合は 1 として扱う）
+    /// @param limits      各ループの接続数の上限（上限を超える転送は接続が空くまで待つ）
+    /// @throws std::runtime_error curl_multi_init() に失敗した場合
+    explicit DownloadManager(size_t threadCount = 1, ConnectionLimits limits = {});
+
+    /// @brief デストラクタ - 未完了の転送を中断してスレッドを join する (RAII)
+    /// 未完了の転送には ABORTED_BY_CALLBACK で完了通知する
+    ~DownloadManager();
+
+    // コピー・ムーブ不可（スレッドリソースを持つため）
+    DownloadManager(const DownloadManager&)            = delete;
+    DownloadManager& operator=(const DownloadManager&) = delete;
+    DownloadManager(DownloadManager&&)                 = delete;
+    DownloadManager& operator=(DownloadManager&&)      = delete;
+
+    /// @brief 転送を登録する（スレッドセーフ、ループスレッドからも呼び出し可）
+    /// @param handle 設定済みの curl ハンドル。完了通知まで呼び出し側が生存を保証する
+    /// @param onDone 完了時のハンドラ
+    /// @param delay  転送を開始するまでの待ち時間（待つ間もループスレッドは塞がない）
+    void submit(ICurlHandle& handle, CompletionHandler onDone,
+                std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+
+    /// @brief WRITE_PAUSE で一時停止した転送を再開する（スレッドセーフ）
+    /// 開始を待っている転送はすぐに開始する。
+    /// すでに完了した転送に対して呼んでも安全（呼び出し後すぐにハンドルを破棄してもよい）
+    void unpause(ICurlHandle& handle);
+
+    /// @brief 実行中（登録済みで未完了）の転送数を取得する
+    size_t getActiveTransferCount() const;
+
+    /// @brief イベントループスレッド数を取得する
+    size_t getThreadCount() const { return loops_.size(); }
+
+    /// @brief このマネージャーを使うダウンローダーの進捗の表
+    /// 各ダウンローダーはオブザーバーへの進捗通知と状態の変化のときに自分の行を更新する
+    ProgressTable& progressTable() { return progressTable_; }
+    const ProgressTable& progressTable() const { return progressTable_; }
+
+private:
+    class EventLoop;
+
+    /// 実行中の転送が最も少ないループ
+    size_t leastLoadedLoop() const;
+
+    /// 多重化する転送のホストごとの割り当て（ループより後に破棄する）
+    struct Affinity {
+        size_t loop   = 0;
+        size_t active = 0; ///< このホストの実行中の転送数（0 になったら割り当てを解く）
+    };
+    std::mutex                                affinityMutex_;
+    std::unordered_map<std::string, Affinity> affinity_;
+
+    ProgressTable progressTable_; ///< ループより先に作り、後に破棄する
+
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,179 @@
+#pragma once
+// =============================================================================
+// DownloadMetrics.h
+// ダウンロードの計測値（カウンター・ヒストグラム）の記録と Prometheus / OpenTelemetry 形式での出力
+//
+// 仕組み:
+//   - カウンターとヒストグラムは固定数の区画 (shard) に分け、スレッドごとに決まった
+//     区画の atomic に relaxed で加算する。記録はロックを取らず、別のスレッドの記録と
+//     同じキャッシュラインを奪い合わない
+//   - 読み出し (value / snapshot) は全区画を足し合わせる（記録と並行してよい）
+//   - ヒストグラムの区間の上限は 2 のべき乗（0-1, 2, 4, ... 2^38, +Inf）で、値の大きさに
+//     よらず一定の相対精度になる
+//   - 時間はマイクロ秒で記録し、出力時に秒に換算する
+//
+// 使い方:
+//   DownloadMetrics metrics;                    // 複数の Downloader で共有してよい
+//   DownloaderConfig config;
+//   config.metrics = &metrics;
+//   ...
+//   httpResponse(metrics.toPrometheus());       // /metrics の応答
+// =============================================================================
+
+#include "CacheLine.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Downloader {
+
+namespace Metrics {
+
+/// 記録に使う区画数（同時に記録するスレッドがこれより多ければ区画を共有する）
+inline constexpr size_t SHARDS = 16;
+
+/// 呼び出したスレッドの区画番号
+size_t shardIndex();
+
+} // namespace Metrics
+
+// =============================================================================
+// MetricCounter: 単調増加するカウンター
+// =============================================================================
+class MetricCounter {
+public:
+    void add(uint64_t value) {
+        shards_[Metrics::shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, Metrics::SHARDS> shards_;
+};
+
+// =============================================================================
+// MetricHistogram: 区間の上限が 2 のべき乗のヒストグラム
+// =============================================================================
+class MetricHistogram {
+public:
+    /// 区間の数（最後の区間は上限なし）
+    static constexpr size_t BUCKETS = 40;
+
+    /// @brief 区間の上限（この値を含む）。最後の区間は UINT64_MAX
+    static uint64_t upperBound(size_t bucket);
+
+    /// @brief 値を記録する
+    void record(uint64_t value);
+
+    /// @brief 記録した値の集計
+    struct Snapshot {
+        std::array<uint64_t, BUCKETS> counts{}; ///< 区間ごとの件数（累積でない）
+        uint64_t count = 0;
+        uint64_t sum   = 0;
+
+        /// @brief 分位点の近似値（該当する区間の上限）。記録がなければ 0
+        /// @param quantile 0.0 - 1.0
+        uint64_t percentile(double quantile) const;
+    };
+
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::array<Shard, Metrics::SHARDS> shards_;
+};
+
+/// @brief スコープの経過時間 (µs) をヒストグラムに記録する（histogram が nullptr なら何もしない）
+class ScopedLatency {
+public:
+    explicit ScopedLatency(MetricHistogram* histogram)
+        : histogram_(histogram) {
+        if (histogram_) {
+            begin_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedLatency() {
+        if (histogram_) {
+            histogram_->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin_).count()));
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&)            = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    MetricHistogram*                      histogram_;
+    std::chrono::steady_clock::time_point begin_{};
+};
+
+// =============================================================================
+// DownloadMetrics: Downloader が記録する計測値
+// =============================================================================
+class DownloadMetrics {
+public:
+    DownloadMetrics();
+
+    // コピー・ムーブ不可（Downloader がポインタで保持するため）
+    DownloadMetrics(const DownloadMetrics&)            = delete;
+    DownloadMetrics& operator=(const DownloadMetrics&) = delete;
+
+    // -------------------------------------------------------------------------
+    // カウンター
+    // -------------------------------------------------------------------------
+    MetricCounter downloadsStarted;
+    MetricCounter downloadsCompleted;
+    MetricCounter downloadsFailed;
+    MetricCounter downloadsCancelled;
+    MetricCounter transfers;       ///< 実行した curl の転送（HEAD・セグメント・取り直しを含む）
+    MetricCounter retries;         ///< 一時的な失敗による再試行
+    MetricCounter cacheHits;       ///< DownloadCache の内容から完了したダウンロード
+    MetricCounter peerBytes;       ///< ピアから受信したボディ（終わった区間の分）
+    MetricCounter bytesReceived;   ///< 受信したボディ（圧縮転送では展開前）
+    MetricCounter bytesWritten;    ///< 出力先に書き込んだバイト数
+    MetricCounter pausedUs;        ///< pause() から resume() / cancel() までの時間 (µs)
+    MetricCounter backpressureUs;  ///< 書き込み待ち・帯域制限で受信を止めていた時間 (µs、転送ごとの合計)
+
+    // -------------------------------------------------------------------------
+    // ヒストグラム
+    // -------------------------------------------------------------------------
+    MetricHistogram writeCallbackUs;    ///< curl の書き込みコールバック 1 回の処理時間
+    MetricHistogram diskWriteUs;        ///< ファイルへの書き出し 1 回の時間
+    MetricHistogram observerCallbackUs; ///< オブザーバーへの通知 1 回の時間（全オブザーバー分）
+    MetricHistogram dnsUs;              ///< 転送ごとの時間の内訳 (PhaseTimings)
+    MetricHistogram connectUs;
+    MetricHistogram tlsUs;
+    MetricHistogram firstByteUs;
+    MetricHistogram transferUs;
+    MetricHistogram throughputBytesPerSec; ///< 完了したダウンロードの平均受信速度
+
+    // -------------------------------------------------------------------------
+    // 出力
+    // -------------------------------------------------------------------------
+
+    /// @brief Prometheus のテキスト形式 (text/plain; version=0.0.4) で出力する
+    /// @param prefix 計測値の名前の接頭辞（"downloader" なら downloader_bytes_received_total など）
+    std::string toPrometheus(const std::string& prefix = "downloader") const;
+
+    /// @brief OpenTelemetry の OTLP/JSON (ExportMetricsServiceRequest) で出力する
+    /// カウンターは累積の単調な Sum、ヒストグラムは explicitBounds 付きの Histogram になる
+    /// @param scope 計装スコープの名前（計測値の名前の接頭辞にも使う）
+    std::string toOpenTelemetryJson(const std::string& scope = "downloader") const;
+
+private:
+    int64_t startTimeNs_; ///< 記録を始めた時刻（UNIX 時刻、OTLP の startTimeUnixNano）
+};
+
+} // namespace Downloader
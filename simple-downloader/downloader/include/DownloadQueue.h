@@ -0,0 +1,214 @@
+#pragma once
+// =============================================================================
+// DownloadQueue.h
+// 多数のダウンロードを同時実行数を抑えて順に実行するジョブキュー
+//
+// 仕組み:
+//   - ワーカースレッド (maxConcurrent 本) がそれぞれ 1 つの Downloader を持ち、
+//     ジョブごとに startDownload() し直して使い回す（ジョブ数だけオブジェクトを作らない）
+//   - 登録したジョブはワーカーごとのキューに振り分ける。ワーカーは自分のキューから
+//     優先度の高い順に取り出し、空なら他のワーカーのキューの末尾から奪う (work-stealing)
+//   - 同じホストへ同時に実行するジョブ数は maxPerHost までに抑える
+//   - 各ジョブの状態遷移・通知は Downloader の DownloadState / IDownloaderObserver をそのまま使う
+//
+// 使い方:
+//   DownloadQueueConfig config;
+//   config.maxConcurrent = 8;
+//   config.maxPerHost    = 2;
+//   DownloadQueue queue(config);
+//   queue.enqueue({"https://example.com/a.bin", "a.bin"});
+//   queue.enqueue({"https://example.com/b.bin", "b.bin", nullptr, TransferPriority::HIGH});
+//   queue.waitForIdle();
+//
+// 注意:
+//   - ジョブの sink / observer はジョブの終了（onJobFinished の呼び出し）まで
+//     呼び出し側が生存を保証すること
+//   - cancel() / cancelAll() はジョブの observer のコールバック内から呼ばないこと
+//     （onJobFinished からは呼んでよい）
+// =============================================================================
+
+#include "Downloader.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Downloader {
+
+/// ジョブの識別子（enqueue() の戻り値。0 は無効）
+using JobId = uint64_t;
+
+/// @brief キューに登録する 1 件のダウンロード
+struct DownloadJob {
+    std::string          url;
+    std::string          outputPath;          ///< sink を指定しない場合の出力ファイル
+    IDownloadSink*       sink     = nullptr;  ///< 指定した場合はファイルの代わりに書き込む
+    TransferPriority     priority = TransferPriority::NORMAL; ///< 実行順・帯域の優先度
+    IDownloaderObserver* observer = nullptr;  ///< このジョブの通知を受け取る（任意）
+};
+
+/// @brief 終了したジョブの結果
+struct DownloadJobResult {
+    JobId         id    = 0;
+    std::string   url;
+    DownloadState state = DownloadState::IDLE; ///< COMPLETED / ERROR / CANCELLED
+    std::string   error;                       ///< state が ERROR の場合の理由
+    int64_t       downloadedBytes = 0;
+};
+
+/// @brief キュー全体の統計
+struct DownloadQueueStats {
+    size_t  queued    = 0; ///< 実行待ち
+    size_t  running   = 0; ///< 実行中
+    size_t  completed = 0;
+    size_t  failed    = 0;
+    size_t  cancelled = 0;
+    int64_t downloadedBytes = 0; ///< 終了したジョブと実行中のジョブの受信量の合計
+};
+
+// =============================================================================
+// DownloadQueueConfig: キューの動作パラメータ
+// =============================================================================
+struct DownloadQueueConfig {
+    size_t maxConcurrent = 4; ///< 同時に実行するジョブ数（ワーカースレッド数、0 は 1 として扱う）
+    size_t maxPerHost    = 0; ///< 同じホストへ同時に実行するジョブ数、0 で制限しない
+
+    DownloaderConfig downloader;       ///< 各ワーカーの Downloader の設定
+    DownloadManager* manager = nullptr; ///< 指定した場合は転送をそのイベントループで駆動する
+    Downloader::CurlFactory curlFactory; ///< 空なら Downloader の既定（CurlHandlePool::shared()）
+
+    /// ジョブの終了時にワーカースレッドから呼ばれる（任意）
+    std::function<void(const DownloadJobResult&)> onJobFinished;
+};
+
+// =============================================================================
+// DownloadQueue クラス
+// =============================================================================
+class DownloadQueue {
+public:
+    /// @brief コンストラクタ - ワーカースレッドを起動する
+    explicit DownloadQueue(DownloadQueueConfig config = {});
+
+    /// @brief デストラクタ - 実行待ちのジョブを取り消し、実行中のジョブをキャンセルして
+    /// ワーカースレッドを join する (RAII)
+    ~DownloadQueue();
+
+    // コピー・ムーブ不可（スレッドリソースを持つため）
+    DownloadQueue(const DownloadQueue&)            = delete;
+    DownloadQueue& operator=(const DownloadQueue&) = delete;
+
+    /// @brief ジョブを登録する（スレッドセーフ）
+    JobId enqueue(DownloadJob job);
+
+    /// @brief 複数のジョブを登録する（スレッドセーフ）
+    std::vector<JobId> enqueue(std::vector<DownloadJob> jobs);
+
+    /// @brief ジョブを取り消す（実行待ちなら取り除き、実行中ならキャンセルする）
+    /// @return false: 該当するジョブがない（終了済みなど）
+    bool cancel(JobId id);
+
+    /// @brief すべてのジョブを取り消す
+    void cancelAll();
+
+    /// @brief 実行待ち・実行中のジョブがなくなるまで待つ
+    /// @return false: タイムアウトした
+    bool waitForIdle(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+    /// @brief 統計のスナップショットを取得する（スレッドセーフ）
+    DownloadQueueStats getStats() const;
+
+private:
+    /// キューに入っている 1 件
+    struct Entry {
+        JobId       id = 0;
+        DownloadJob job;
+        std::string host;
+    };
+
+    class JobObserver;
+
+    /// ワーカー 1 本分の状態
+    struct Worker {
+        std::mutex        mutex;
+        std::deque<Entry> queues[3];    ///< 優先度ごとの実行待ち（mutex で保護）
+        JobId             runningId{0}; ///< 実行中のジョブ（mutex で保護）
+        bool              started{false};         ///< runningId の startDownload() 済み（mutex で保護）
+        bool              cancelRequested{false}; ///< 開始前に取り消された（mutex で保護）
+        std::unique_ptr<JobObserver>         observer;
+        std::unique_ptr<Downloader>          downloader;
+        std::thread                          thread;
+    };
+
+    /// 次に実行するジョブを取り出す（自分のキュー → 他のワーカーのキューの順）
+    std::optional<Entry> takeJob(size_t self);
+
+    /// worker のキューから、ホストの同時実行数に空きがある最初のジョブを取り出す
+    /// @param fromBack true: 末尾から探す（他のワーカーから奪う場合）
+    std::optional<Entry> popRunnable(Worker& worker, size_t priority, bool fromBack);
+
+    /// ホストの同時実行枠を 1 つ確保する
+    bool reserveHost(const std::string& host);
+
+    /// ホストの同時実行枠を返す
+    void releaseHost(const std::string& host);
+
+    /// ジョブを実行して結果を返す
+    DownloadJobResult runJob(Worker& worker, Entry& entry);
+
+    /// 実行中のジョブをキャンセルする（worker.mutex 保持中に呼ぶ）
+    void cancelRunningLocked(Worker& worker);
+
+    /// 実行されずに取り消されたジョブを終了させる
+    void finishCancelled(const Entry& entry);
+
+    /// 終了したジョブを集計して通知する
+    void finishJob(const DownloadJobResult& result, IDownloaderObserver* observer);
+
+    /// 待機中のワーカーと waitForIdle() を起こす
+    void wakeAll();
+
+    /// ワーカースレッドのエントリポイント
+    void workerThread(size_t self);
+
+    DownloadQueueConfig                  config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::atomic<JobId>    nextId_{1};
+    std::atomic<size_t>   nextWorker_{0};   ///< 登録先ワーカー（ラウンドロビン）
+
+    /// 取り出しから runningId の設定までを共有ロック、取り消しを排他ロックで行い、
+    /// どちらにも見つからない瞬間を作らない
+    std::shared_mutex takeMutex_;
+
+    // 同時実行数の管理
+    std::mutex                    hostMutex_;
+    std::map<std::string, size_t> runningPerHost_; ///< hostMutex_ で保護
+
+    // 待機・停止（generation_ はジョブの追加・枠の解放のたびに進める）
+    mutable std::mutex      wakeMutex_;
+    std::condition_variable wakeCv_;
+    uint64_t                generation_{0};     ///< wakeMutex_ で保護
+    bool                    stopRequested_{false}; ///< wakeMutex_ で保護
+
+    // 統計
+    std::atomic<size_t>   queued_{0};
+    std::atomic<size_t>   running_{0};
+    std::atomic<size_t>   completed_{0};
+    std::atomic<size_t>   failed_{0};
+    std::atomic<size_t>   cancelled_{0};
+    std::atomic<int64_t>  finishedBytes_{0};
+};
+
+} // namespace Downloader
@@ -0,0 +1,131 @@
+#pragma once
+// =============================================================================
+// DownloadSinks.h
+// IDownloadSink の標準実装
+//
+//   MemorySink   : 伸長可能なメモリバッファへ書き込む（セグメント分割にも対応）
+//   PooledMemorySink : BufferPool のスラブを並べて書き込む（再確保・コピーをせず、プールの上限に従う）
+//   CallbackSink : 受信したデータをその場で呼び出し側へ渡す（パースと受信を重ねる）
+//   StreamSink   : std::ostream へ順に書き込む
+//
+// ファイルへの出力は startDownload(url, outputPath) を使う
+// （レジューム・mmap 出力・非同期書き込みに対応する）
+// =============================================================================
+
+#include "BufferPool.h"
+#include "IDownloadSink.h"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Downloader {
+
+// =============================================================================
+// MemorySink: メモリバッファへの書き込み
+// =============================================================================
+class MemorySink final : public IDownloadSink {
+public:
+    /// @brief コンストラクタ
+    /// @param buffer 再利用するバッファ（内容は破棄し、容量だけを引き継ぐ）
+    explicit MemorySink(std::vector<char> buffer = {});
+
+    /// サイズが分かっていれば一度に確保する（セグメントはその範囲内に書き込む）
+    bool open(int64_t expectedSize) override;
+    bool write(int64_t offset, std::span<const char> data) override;
+    bool supportsRandomAccess() const override { return true; }
+
+    /// @brief 受信したデータ（ダウンロードの終了後に参照すること）
+    std::span<const char> data() const { return buffer_; }
+
+    /// @brief 受信したデータを取り出す（シンクは空になる）
+    std::vector<char> take();
+
+    /// @brief 使い終わったバッファを返し、次のダウンロードで再利用させる
+    void recycle(std::vector<char> buffer);
+
+private:
+    std::vector<char> buffer_;
+};
+
+// =============================================================================
+// PooledMemorySink: プールのスラブへの書き込み
+// =============================================================================
+class PooledMemorySink final : public IDownloadSink {
+public:
+    /// @param pool スラブを借りるプール（シンクより長く生存すること）
+    explicit PooledMemorySink(BufferPool& pool) : pool_(pool) {}
+
+    /// 前回の内容を破棄してスラブを返す（スラブは書き込んだときに借りる）
+    bool open(int64_t expectedSize) override;
+
+    /// スラブを借りられない（プールが上限に達している）場合は false。
+    /// 受信済みのデータは完了まで保持する必要があり、待っても空かないためエラーにする
+    bool write(int64_t offset, std::span<const char> data) override;
+    bool supportsRandomAccess() const override { return true; }
+
+    /// @brief 受信したバイト数（書き込まれた最も後ろの位置）
+    size_t size() const;
+
+    /// @brief 受信したデータをスラブごとの区間で返す（ダウンロードの終了後に参照すること）
+    std::vector<std::span<const char>> chunks() const;
+
+    /// @brief 受信したデータを out の先頭にコピーする
+    /// @return コピーしたバイト数（out と size() の小さい方）
+    size_t copyTo(std::span<char> out) const;
+
+    /// @brief スラブをすべてプールへ返す
+    void clear();
+
+private:
+    BufferPool&                     pool_;
+    mutable std::mutex              mutex_;
+    std::vector<BufferPool::Buffer> slabs_; ///< offset / slabSize 番目のスラブ（mutex_ で保護）
+    size_t                          size_ = 0; ///< mutex_ で保護
+};
+
+// =============================================================================
+// CallbackSink: 受信データを順に呼び出し側へ渡す
+// =============================================================================
+class CallbackSink final : public IDownloadSink {
+public:
+    /// @brief 受信データを受け取るコールバック（false を返すとダウンロードを中断する）
+    /// data は呼び出しの間だけ有効。コピーせずにその場でパースすること
+    using Callback = std::function<bool(std::span<const char> data)>;
+
+    /// @brief データ受け取り前に全体サイズ（不明な場合は -1）を受け取るコールバック
+    using OpenCallback = std::function<bool(int64_t expectedSize)>;
+
+    explicit CallbackSink(Callback onData, OpenCallback onOpen = nullptr,
+                          std::function<bool()> onClose = nullptr);
+
+    bool open(int64_t expectedSize) override;
+    bool write(int64_t offset, std::span<const char> data) override;
+    bool close() override;
+
+private:
+    Callback              onData_;
+    OpenCallback          onOpen_;
+    std::function<bool()> onClose_;
+};
+
+// =============================================================================
+// StreamSink: std::ostream への書き込み
+// =============================================================================
+class StreamSink final : public IDownloadSink {
+public:
+    /// @param out 書き込み先（ダウンロードの終了まで呼び出し側が生存を保証する）
+    explicit StreamSink(std::ostream& out) : out_(out) {}
+
+    bool open(int64_t /*expectedSize*/) override { return out_.good(); }
+    bool write(int64_t offset, std::span<const char> data) override;
+    bool close() override;
+
+private:
+    std::ostream& out_;
+};
+
+} // namespace Downloader
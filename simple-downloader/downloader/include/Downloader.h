@@ -6,6 +6,10 @@
 // スレッドモデル:
 //   - 呼び出し側スレッド : start/pause/resume/cancel を呼び出す
 //   - ワーカースレッド   : 実際のダウンロードを実行し、オブザーバーを呼び出す
+//   - DownloadManager を指定した場合はワーカースレッドを持たず、
+//     マネージャーのイベントループスレッドが転送とオブザーバー通知を行う
+//   - asyncObserverDispatch を有効にすると、オブザーバーは転送スレッドではなく
+//     専用のディスパッチスレッドから呼ばれる
 //
 // ライフサイクル:
 //   Downloader obj 生成
@@ -17,45 +21,316 @@
 //
 // RAII:
 //   デストラクタで cancel + スレッドjoin を保証する
+//   （DownloadManager 駆動時はイベントループ上の完了処理の終了を待つ）
+//
+// 非同期 API:
+//   オブザーバーやポーリングの代わりに、終了を結果 (DownloadResult) として受け取れる
+//     DownloadResult r = co_await downloader.fetch(url, sink);     // コルーチン
+//     std::future<DownloadResult> f = downloader.fetchAsync(url, path);
+//   DownloadManager 駆動ではイベントループ上で再開・完了するため、待つためのスレッドは要らない
 // =============================================================================
 
+#include "BandwidthScheduler.h"
+#include "CacheLine.h"
+#include "Checksum.h"
+#include "DownloadCache.h"
+#include "FileWriter.h"
 #include "ICurlHandle.h"
+#include "IDownloadSink.h"
 #include "IDownloaderObserver.h"
+#include "ProgressTable.h"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace Downloader {
 
+class BufferPool;
+class DiskWriteQueue;
+class DownloadManager;
+class DownloadMetrics;
+class IPeerTracker;
+class MappedFile;
+class ObserverDispatcher;
+class PeerServer;
+class ResumeJournal;
+
+/// @brief 圧縮された応答 (Content-Encoding) の扱い
+enum class ContentDecoding {
+    NONE,      ///< 圧縮を求めない（Accept-Encoding を送らない）
+    INLINE,    ///< curl が受信スレッドで展開してから書き込みコールバックに渡す
+    PIPELINED, ///< 圧縮されたまま受信し、展開用のスレッドで展開してから書き込む
+};
+
+/// @brief ファイル出力の内容をディスクへ書き出す (fdatasync) 時期
+enum class FileSyncPolicy {
+    NONE,     ///< OS に任せる
+    AT_END,   ///< 完了時に 1 回書き出す
+    PERIODIC, ///< fileSyncInterval バイト書き込むごとと完了時に書き出す（mmap 出力は完了時だけ）
+};
+
+/// @brief 同じ接続元への同時の転送に接続をどう割り当てるか
+enum class ConnectionSharing {
+    MULTIPLEX, ///< 1 本の HTTP/2・HTTP/3 接続のストリームにまとめる（接続数より接続あたりのストリーム数を増やす）
+    SEPARATE,  ///< HTTP/1.1 で転送ごとに接続を張る（1 本の接続の損失で全ストリームが止まらないよう接続数を増やす）
+};
+
 // =============================================================================
 // DownloaderConfig: ダウンローダーの動作パラメータ
 // =============================================================================
 struct DownloaderConfig {
-    size_t chunkSize         = 1024;   ///< 読み取りチャンクサイズ (bytes)
+    size_t chunkSize         = 16 * 1024; ///< curl の受信バッファ (CURLOPT_BUFFERSIZE, bytes)、0 で curl の既定
     long   connectTimeoutSec = 30;     ///< 接続タイムアウト (秒)
     bool   useHttp2          = true;   ///< HTTP/2 を有効にするか
+    bool   useHttp3          = false;  ///< HTTP/3 (QUIC) を優先するか（curl が対応していなければ useHttp2 に従う）
     bool   sslVerify         = true;   ///< SSL 証明書を検証するか
     bool   followRedirects   = true;   ///< リダイレクトを追跡するか
     std::string userAgent    = "CppDownloader/1.0";
+
+    // 書き込みバッファ（コールバックごとの小さな書き込みをまとめてファイルに書き出す）
+    size_t  writeBufferSize    = 1024 * 1024; ///< まとめ書きのバッファサイズ (bytes)、0 でまとめない
+    bool    doubleBufferWrites = false;       ///< 2 面バッファで書き出し中も受信を続けるか
+
+    // 非同期書き込み（ファイルへの書き込みを専用スレッドに任せ、受信と並行させる）
+    bool    asyncDiskWrites    = false;            ///< 書き出しスレッド経由でファイルに書き込むか
+    size_t  diskQueueLimit     = 16 * 1024 * 1024; ///< 書き込み待ちの上限 (bytes)、超えると受信を一時停止する
+
+    // バッファのプール（まとめ書き・非同期書き込み・展開待ちのバッファをプールのスラブから借りる。
+    // プールが上限に達すると、非同期書き込みはスラブが返るまで受信を一時停止し、まとめ書きは直接書き出す）
+    BufferPool* bufferPool = nullptr; ///< 借りるプール（Downloader より長く生存すること）、nullptr で使わない
+
+    // キャッシュ（ファイルへのダウンロードは、キャッシュにある URL を If-None-Match / If-Modified-Since 付きで
+    // 要求し、304 ならキャッシュの内容を出力先へ複製して完了する。受信した内容は完了時にキャッシュへ記録する。
+    // expectedChecksum が SHA-256 なら、同じ内容がキャッシュにあればリクエストせずに複製する。複数ミラーでは使わない）
+    DownloadCache* cache = nullptr; ///< 使うキャッシュ（Downloader より長く生存すること）、nullptr で使わない
+
+    // ピア配布（多数のノードが同じファイルを同時に取得する場合に配布元 (origin) の負荷を下げる。
+    // peerTracker から得たピアを配布元の後ろのミラーとして加え、区間を振り分ける。ピアにまだない区間は 404 になり、
+    // 配布元や別のピアから取り直す。ピアの内容は信頼できないため expectedChecksum がある場合だけピアを使い、
+    // 一致しなければピアを外して配布元から一度だけ取り直す。
+    // peerServer を指定したファイルへのダウンロードは、書き終えた区間から配布し（ピアから受信した区間は
+    // 照合が済んでから）、完了後は同じ Downloader で次のダウンロードを始めるまで配布を続ける。
+    // 失敗・キャンセルしたら配布をやめる）
+    IPeerTracker* peerTracker = nullptr; ///< ピアを探す先（Downloader より長く生存すること）、nullptr で使わない
+    size_t        maxPeers    = 4;       ///< 1 つのダウンロードで取得元に加えるピアの上限
+    PeerServer*   peerServer  = nullptr; ///< 受信した区間を配布するサーバ、nullptr で配布しない
+
+    // ゼロコピー出力（サイズが分かる新規ダウンロードは出力ファイルを mmap して直接コピーする）
+    bool    memoryMappedOutput = false; ///< サイズが分かる場合に mmap したファイルへ書き込むか
+
+    // ファイル出力（mmap しない書き込みの方法と、完了時の扱い。FileWriter を参照）
+    bool           preallocateOutput = true;  ///< サイズが分かればディスク領域を先に確保するか（断片化を防ぐ）
+    bool           directIo          = false; ///< ページキャッシュを経由せずに書くか (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+    bool           dropWrittenPages  = false; ///< 書き込んだ区間をページキャッシュから捨てるか (posix_fadvise DONTNEED)
+    FileSyncPolicy fileSync          = FileSyncPolicy::NONE;  ///< ディスクへ書き出す時期
+    int64_t        fileSyncInterval  = 64 * 1024 * 1024;      ///< PERIODIC: 書き出す間隔 (bytes、転送ごと)
+    bool           atomicOutput      = false; ///< "<出力>.part" に書き込み、完了時に出力へ置き換えるか (rename)
+
+    // セグメント分割ダウンロード（サーバが Accept-Ranges: bytes を返す場合のみ有効）
+    size_t  segmentCount     = 1;               ///< 並列セグメント数 (1 で分割しない)
+    int64_t minSegmentSize   = 4 * 1024 * 1024; ///< 1 セグメントの最小サイズ (bytes)
+
+    // 区間の読み出し（startRangeDownload。segmentCount 本までの転送で並列に取得する）
+    int64_t rangeCoalesceGap = 64 * 1024; ///< 隙間がこれ以下の区間はまとめて 1 回で取得する (bytes)
+
+    // 再試行（接続の切断・タイムアウト・一時的なエラー応答は、待ってから受信済みの位置の続きを取り直す。
+    // 待ち時間は retryBaseDelayMs から失敗のたびに倍にし（上限 retryMaxDelayMs）、同時に失敗した転送が
+    // 揃って再接続しないよう後半の半分をランダムにずらす。Retry-After が返されればその時間を待つ）
+    int     maxRetries       = 0;         ///< 1 つの転送で続けて再試行する回数、0 で再試行しない（受信が進めば数え直す）
+    long    retryBaseDelayMs = 500;       ///< 最初の再試行までの待ち時間 (ms)
+    long    retryMaxDelayMs  = 30 * 1000; ///< 待ち時間の上限 (ms)。Retry-After もこれで打ち切る
+    std::vector<long> retryHttpStatus = {408, 429, 500, 502, 503, 504}; ///< 再試行するステータスコード
+
+    // 複数ミラー（同じ内容を持つ URL の一覧を startDownload に渡した場合。
+    // セグメント数はミラー数以上にし、先に終わった転送は残りの多い区間の後半を受信速度の比で引き取る。
+    // 失敗した区間は失敗したミラーを外し、最も速いミラーで続きから取り直す）
+    int64_t minStealSize     = 1024 * 1024;     ///< 引き取る区間の最小サイズ (bytes)
+
+    // 再開用ジャーナル（ファイル出力の受信済み区間とチェックサムを "<出力>.meta" に記録し、
+    // 再開時は欠けた・壊れた区間だけを If-Range 付きで取り直す。ETag / Last-Modified がない応答は記録しない）
+    bool    resumeJournal    = false;           ///< ジャーナルを使うか（false: 既存ファイルの末尾から再開する）
+    int64_t journalChunkSize = 4 * 1024 * 1024; ///< チェックサムを記録する区間の大きさ (bytes)
+
+    // 受信データの検証（書き込みと同時にダイジェストを計算し、完了時に照合する。不一致は onError）
+    ChecksumAlgorithm checksumAlgorithm = ChecksumAlgorithm::NONE; ///< 計算するダイジェスト
+    std::string       expectedChecksum; ///< 期待値（16 進、大文字小文字は問わない）。空なら計算だけ行う
+
+    // 圧縮転送（Accept-Encoding で圧縮を求め、展開した内容を出力先に書き込む。
+    // 展開した位置からは続きを取れないため、分割・レジューム・ジャーナルは使わず、一時停止しても接続を切断しない）
+    ContentDecoding contentDecoding = ContentDecoding::NONE; ///< PIPELINED の展開待ちの上限は diskQueueLimit
+
+    // 接続のチューニング
+    bool    tcpNoDelay         = true;  ///< TCP_NODELAY を設定するか
+    bool    tcpKeepAlive       = true;  ///< TCP キープアライブを使うか（長い一時停止中の切断を検出する）
+    long    tcpKeepIdleSec     = 60;    ///< キープアライブの最初のプローブまでの無通信時間 (秒)
+    long    tcpKeepIntervalSec = 15;    ///< キープアライブのプローブ間隔 (秒)
+    int     socketReceiveBuffer = 0;    ///< 接続前に設定する SO_RCVBUF (bytes)、0 で OS の既定（自動調整）
+
+    // 接続の多重化（DownloadManager 駆動では、MULTIPLEX の転送は同じホストどうしを同じイベントループで駆動し、
+    // 確立中の接続を待って相乗りする。接続あたりのストリーム数・接続数の上限は DownloadManager に設定する。
+    // ワーカースレッド駆動では転送ごとにスレッドが違うため、同時の転送は多重化されない）
+    ConnectionSharing connectionSharing = ConnectionSharing::MULTIPLEX;
+
+    // 最初のバイトまでの時間（接続の確立を短くする。warmUp() で接続を事前に用意することもできる）
+    long    happyEyeballsTimeoutMs = 0;     ///< IPv6 だけを試す時間 (ms)、0 で curl の既定 (200ms)
+    bool    tcpFastOpen            = false; ///< TCP Fast Open を使うか（OS とサーバの対応が必要）
+    bool    tlsEarlyData           = false; ///< TLS 1.3 の 0-RTT を使うか（curl 8.11 以降の対応する TLS ライブラリのみ）
+    std::vector<std::string> resolveOverrides; ///< 名前解決の上書き ("host:port:address"、CURLOPT_RESOLVE)
+
+    // 受信バッファの自動調整（受信速度と RTT から帯域遅延積を測り、転送中の接続の SO_RCVBUF を広げる。
+    // curl の受信バッファは転送中に変えられないため、広げた値は次の接続（セグメント・再接続・次のジョブ）から使う）
+    bool    adaptiveReceiveBuffer  = false;            ///< 自動調整するか（chunkSize・socketReceiveBuffer が初期値）
+    size_t  maxChunkSize           = 1024 * 1024;      ///< 自動調整する curl の受信バッファの上限 (bytes)
+    int     maxSocketReceiveBuffer = 16 * 1024 * 1024; ///< 自動調整する SO_RCVBUF の上限 (bytes)
+
+    // 一時停止（CURL_WRITEFUNC_PAUSE で転送を止め、長く続いたら接続を切断する）
+    long    pauseReleaseMs   = 30 * 1000; ///< 接続を切断するまでの一時停止時間 (ms)、負値で切断しない
+
+    // 進捗通知の間引き（受信量が変わらない通知は常に省く。両方を満たしたときに通知する）
+    long    progressIntervalMs = 0; ///< 進捗通知の最小間隔 (ms)、0 で間引かない
+    int64_t progressMinBytes   = 0; ///< 前回の通知からの最小増分 (bytes)、0 で間引かない
+
+    // オブザーバー通知（true: 専用スレッドから通知し、転送スレッドでユーザーコードを実行しない）
+    bool    asyncObserverDispatch = false; ///< 未配信の進捗通知は最新の 1 件にまとめる
+
+    // 帯域制限（全体・ホスト単位の上限は bandwidthScheduler に設定する）
+    int64_t          maxBytesPerSec = 0; ///< このダウンロードの受信上限 (bytes/sec)、0 で無制限
+    TransferPriority priority = TransferPriority::NORMAL; ///< 帯域が足りないときの優先度
+    /// 上限を共有するスケジューラー（nullptr なら BandwidthScheduler::shared()）
+    BandwidthScheduler* bandwidthScheduler = nullptr;
+
+    // 計測（受信量・再試行・停止時間などのカウンターと、コールバック・書き出し・接続の各段階の
+    // 時間のヒストグラムを記録する。複数の Downloader で共有してよい）
+    DownloadMetrics* metrics = nullptr; ///< 記録先（Downloader より長く生存すること）、nullptr で記録しない
+};
+
+// =============================================================================
+// SegmentRange: セグメント分割ダウンロードの 1 区間
+// =============================================================================
+struct SegmentRange {
+    int64_t first = 0; ///< 先頭バイト位置
+    int64_t last  = 0; ///< 末尾バイト位置（この位置を含む）
+
+    int64_t size() const { return last - first + 1; }
+    bool    operator==(const SegmentRange&) const = default;
+};
+
+/// @brief ファイル全体を並列取得用のセグメントに分割する
+/// @param contentLength  ファイルサイズ (bytes)
+/// @param segmentCount   最大セグメント数
+/// @param minSegmentSize セグメント 1 つあたりの最小サイズ
+/// @return 先頭から順に並んだ区間リスト。分割不要な場合は要素数 1 以下
+std::vector<SegmentRange> planSegments(int64_t contentLength,
+                                       size_t  segmentCount,
+                                       int64_t minSegmentSize);
+
+/// @brief 読み出す区間を並べ替え、重なる区間と隙間が maxGap 以下の区間を 1 つにまとめる
+/// 隙間の分は余分に受信するが、要求の回数（往復）を減らせる
+/// @param maxGap まとめる隙間の最大サイズ (bytes)。0 なら重なる区間と隣接する区間だけ
+/// @return 先頭から順に並んだ重ならない区間（first < 0 や last < first の区間は除く）
+std::vector<SegmentRange> coalesceRanges(std::vector<SegmentRange> ranges, int64_t maxGap);
+
+// =============================================================================
+// MirrorStats: ミラーごとの統計情報
+// =============================================================================
+struct MirrorStats {
+    std::string url;
+    int64_t     downloadedBytes = 0;     ///< 終わった区間（取り直す前の分を含む）で受信したバイト数
+    int64_t     bytesPerSec     = 0;     ///< 1 接続あたりの受信速度（区間ごとの測定値の移動平均）
+    bool        failed          = false; ///< 失敗したためこのジョブでは使わない
+    bool        peer            = false; ///< peerTracker から得たピア
 };
 
 // =============================================================================
 // DownloadStats: スナップショット取得用の統計情報
 // =============================================================================
 struct DownloadStats {
-    int64_t       downloadedBytes = 0;
-    int64_t       totalBytes      = 0; ///< 不明な場合は 0
-    double        percent         = -1.0;
+    int64_t       downloadedBytes = 0; ///< 出力先に書き込んだバイト数（圧縮転送では展開後）
+    int64_t       totalBytes      = 0; ///< 不明な場合は 0（圧縮転送では展開後のサイズが分からないため 0）
+    int64_t       wireBytes       = 0; ///< このジョブで受信したボディのバイト数（圧縮転送では展開前）
+    double        percent         = -1.0; ///< 圧縮転送では受信したボディの割合
     DownloadState state           = DownloadState::IDLE;
     std::string   url;
     std::string   outputPath;
+    std::string   checksum; ///< 完了時に計算したダイジェスト（16 進の小文字。計算していなければ空）
+    std::vector<MirrorStats> mirrors; ///< 複数ミラーを渡した場合のみ（startDownload に渡した順）
+    int           retryCount      = 0; ///< このジョブで再試行した回数（別のミラーへの切り替えは含まない）
+    PhaseTimings  timings;             ///< このジョブで最初に応答を受けた転送（HEAD を含む）の時間の内訳
+};
+
+// =============================================================================
+// DownloadProgress: ロックを取らずに取得できる数値だけのスナップショット
+// 高頻度のポーリング（ダッシュボードなど）向け。文字列・配列を含まないため
+// 取得時にヒープ確保をしない。各値は個別に読むため、値どうしは同じ瞬間のものとは限らない
+// =============================================================================
+struct DownloadProgress {
+    int64_t       downloadedBytes = 0;    ///< DownloadStats::downloadedBytes と同じ
+    int64_t       totalBytes      = 0;    ///< DownloadStats::totalBytes と同じ
+    int64_t       wireBytes       = 0;    ///< DownloadStats::wireBytes と同じ
+    double        percent         = -1.0; ///< DownloadStats::percent と同じ
+    DownloadState state           = DownloadState::IDLE;
+    int           retryCount      = 0;    ///< DownloadStats::retryCount と同じ
+};
+static_assert(std::is_trivially_copyable_v<DownloadProgress>);
+
+// =============================================================================
+// DownloadResult: 終了したダウンロードの結果（fetch / fetchAsync / startDownload の onDone に渡す）
+// =============================================================================
+struct DownloadResult {
+    DownloadState state = DownloadState::IDLE; ///< COMPLETED / ERROR / CANCELLED（開始できなかった場合は IDLE）
+    std::string   error;                       ///< ERROR の場合の理由（開始できなかった場合も設定する）
+    DownloadStats stats;                       ///< 終了時の getStats()
+
+    bool ok() const { return state == DownloadState::COMPLETED; }
+
+    /// 開始できなかった（すでに実行中など）ことを表す結果
+    static DownloadResult rejected() {
+        DownloadResult result;
+        result.error = "Download could not be started";
+        return result;
+    }
+};
+
+// =============================================================================
+// DownloadAwaiter: co_await で 1 つのダウンロードの終了を待つ（Downloader::fetch の戻り値）
+//
+// co_await した時点で開始し、終了を通知したスレッド（ワーカースレッド、または
+// DownloadManager のイベントループ）でコルーチンを再開する。重い処理を続ける場合は
+// 呼び出し側の executor へ移すこと。開始前に終了した場合は中断せずにそのまま続ける
+// =============================================================================
+class DownloadAwaiter {
+public:
+    /// onDone を渡してダウンロードを開始する関数（false: 開始できなかった）
+    using Starter = std::function<bool(std::function<void(DownloadResult)> onDone)>;
+
+    explicit DownloadAwaiter(Starter start) : start_(std::move(start)) {}
+
+    DownloadAwaiter(const DownloadAwaiter&)            = delete;
+    DownloadAwaiter& operator=(const DownloadAwaiter&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> caller);
+    DownloadResult await_resume() { return std::move(result_); }
+
+private:
+    Starter                 start_;
+    DownloadResult          result_;
+    std::coroutine_handle<> caller_;
+    std::atomic<bool>       finished_{false}; ///< 終了と中断のうち後に来た側が続きを進める
 };
 
 // =============================================================================
@@ -67,15 +342,24 @@ public:
     // ファクトリ関数 / コンストラクタ
     // -------------------------------------------------------------------------
 
-    /// @brief デフォルトコンストラクタ（本番用 CurlHandle を使用）
+    /// @brief デフォルトコンストラクタ（CurlHandlePool::shared() の CurlHandle を使用）
     explicit Downloader(DownloaderConfig config = {});
 
     /// @brief テスト用コンストラクタ（curl ハンドルファクトリを外部注入）
     /// @param curlFactory  ICurlHandle を生成するファクトリ関数
-    ///                     再開時に呼ばれることがあるため、毎回新規生成すること
+    ///                     再開時に呼ばれることがあるため、呼び出しごとに未使用の
+    ///                     ハンドルを返すこと（CurlHandlePool::makeFactory() も可）
     using CurlFactory = std::function<std::unique_ptr<ICurlHandle>()>;
     Downloader(DownloaderConfig config, CurlFactory curlFactory);
 
+    /// @brief イベントループ駆動用コンストラクタ（ワーカースレッドを持たない）
+    /// @param manager 転送を駆動する DownloadManager（本オブジェクトより長く生存すること）
+    Downloader(DownloaderConfig config, DownloadManager& manager);
+
+    /// @brief イベントループ駆動 + curl ハンドルファクトリ注入
+    Downloader(DownloaderConfig config, DownloadManager& manager,
+               CurlFactory curlFactory);
+
     /// @brief デストラクタ - cancel() + スレッド join を保証 (RAII)
     ~Downloader();
 
@@ -96,31 +380,143 @@ public:
     void addObserver(IDownloaderObserver* observer);
 
     /// @brief オブザーバーを解除する（スレッドセーフ）
+    /// 解除前のリストで通知中のものがあれば、その完了を待ってから戻る
+    /// （オブザーバーのコールバック内から呼んだ場合は待たない）
     void removeObserver(IDownloaderObserver* observer);
 
     // -------------------------------------------------------------------------
     // ダウンロード制御
     // -------------------------------------------------------------------------
 
+    /// 終了時に一度だけ呼ばれる関数（startDownload の onDone）
+    /// オブザーバーへの終了通知の後、ジョブの終了を記録してから呼ばれる。このため
+    /// onDone の中で本オブジェクトを破棄したり、次の startDownload() を呼んだりしてよい。
+    /// 呼ばれるのはワーカースレッド（DownloadManager 駆動ではイベントループ）で、
+    /// 開始処理の中で終了した場合は startDownload() から戻る前に呼ばれる。
+    /// 開始できなかった（startDownload() が false を返した）場合は呼ばれない
+    using CompletionHandler = std::function<void(DownloadResult result)>;
+
     /// @brief ダウンロードを開始する
     /// @param url        ダウンロード元 URL
     /// @param outputPath 保存先パス
+    /// @param onDone     終了時に一度だけ呼ぶ（任意、CompletionHandler を参照）
     /// @return true: 開始成功 / false: すでに実行中など
     bool startDownload(const std::string& url,
-                       const std::string& outputPath);
+                       const std::string& outputPath,
+                       CompletionHandler onDone = {});
+
+    /// @brief 呼び出し側のメモリ領域へダウンロードする（ファイルには書かない）
+    /// 受信データは destination の先頭から直接コピーされる。受け取ったバイト数は
+    /// getStats().downloadedBytes で取得し、領域が足りない場合はエラーになる
+    /// @param destination 書き込み先。ダウンロードの終了まで呼び出し側が生存を保証する
+    /// @return true: 開始成功 / false: すでに実行中など
+    bool startDownload(const std::string& url, std::span<char> destination,
+                       CompletionHandler onDone = {});
+
+    /// @brief 任意の書き込み先 (IDownloadSink) へダウンロードする
+    /// sink が任意位置への書き込みに対応していればセグメント分割も行う
+    /// @param sink 書き込み先。ダウンロードの終了まで呼び出し側が生存を保証する
+    /// @return true: 開始成功 / false: すでに実行中など
+    bool startDownload(const std::string& url, IDownloadSink& sink,
+                       CompletionHandler onDone = {});
+
+    /// @brief 同じ内容を持つ複数のミラーからダウンロードする
+    /// Range に対応していれば区間をミラーに振り分けて並列に取得し、遅いミラーの
+    /// 残りを速いミラーが引き取る。失敗したミラーの区間は別のミラーで取り直し、
+    /// すべてのミラーが失敗した場合だけ onError を通知する。サイズと Range 対応は
+    /// 最初に応答したミラーの HEAD で調べる
+    /// @param mirrors 候補の URL（先頭ほど優先する）。空なら開始しない
+    bool startDownload(const std::vector<std::string>& mirrors,
+                       const std::string& outputPath,
+                       CompletionHandler onDone = {});
+
+    /// @brief 複数のミラーから呼び出し側のメモリ領域へダウンロードする
+    bool startDownload(const std::vector<std::string>& mirrors, std::span<char> destination,
+                       CompletionHandler onDone = {});
+
+    /// @brief 複数のミラーから任意の書き込み先へダウンロードする
+    bool startDownload(const std::vector<std::string>& mirrors, IDownloadSink& sink,
+                       CompletionHandler onDone = {});
+
+    /// @brief オブジェクトの一部の区間だけを取得する（疎な読み出し）
+    /// ranges は coalesceRanges() で rangeCoalesceGap 以下の隙間ごとまとめ、区間ごとの
+    /// Range リクエストを segmentCount 本までの転送で並列に送る（転送は終えると次の区間を
+    /// 引き取る）。内容はオブジェクト内の位置のまま書き込み、取得しない部分には触れない。
+    /// 末尾を越える区間は応答の全体サイズ (Content-Range) までに縮める。
+    /// 進捗の totalBytes は取得する区間の合計で、キャッシュ・ジャーナル・ピア・
+    /// ダイジェストの検証は使わない
+    /// @param outputPath 最後の区間の末尾までの大きさの疎なファイルにする（取得しない部分は穴になる）
+    /// @return false: すでに実行中、有効な区間がない、圧縮転送 (contentDecoding) が有効など
+    bool startRangeDownload(const std::string& url, const std::vector<SegmentRange>& ranges,
+                            const std::string& outputPath, CompletionHandler onDone = {});
+
+    /// @brief 区間だけを任意の書き込み先へ取得する
+    /// @param sink supportsRandomAccess() が true であること。open() には最後の区間の末尾を渡す
+    bool startRangeDownload(const std::string& url, const std::vector<SegmentRange>& ranges,
+                            IDownloadSink& sink, CompletionHandler onDone = {});
+
+    /// @brief co_await でダウンロードの終了を待つ（引数は startDownload と同じ）
+    ///   DownloadResult result = co_await downloader.fetch(url, sink);
+    /// co_await した時点で開始する（開始できなければ rejected() の結果をすぐに返す）。
+    /// 参照で渡した引数は co_await が終わるまで生存させること
+    template <typename... Args>
+    DownloadAwaiter fetch(Args&&... args) {
+        return DownloadAwaiter(
+            [this, args = std::tuple<Args...>(std::forward<Args>(args)...)](CompletionHandler onDone) {
+                return std::apply(
+                    [&](auto&... startArgs) { return startDownload(startArgs..., std::move(onDone)); },
+                    args);
+            });
+    }
+
+    /// @brief ダウンロードを開始し、結果を std::future で受け取る（引数は startDownload と同じ）
+    /// 開始できなかった場合は rejected() の結果がすぐに設定される
+    template <typename... Args>
+    std::future<DownloadResult> fetchAsync(Args&&... args) {
+        auto promise = std::make_shared<std::promise<DownloadResult>>();
+        auto future  = promise->get_future();
+        const bool started = startDownload(std::forward<Args>(args)...,
+                                           [promise](DownloadResult result) {
+                                               promise->set_value(std::move(result));
+                                           });
+        if (!started) {
+            promise->set_value(DownloadResult::rejected());
+        }
+        return future;
+    }
+
+    /// @brief 接続を事前に確立し、名前解決・TLS セッション・接続をキャッシュに残す
+    /// 各 URL の接続元（スキーム・ホスト・ポート）ごとに 1 本ずつ HEAD を並列に送り、
+    /// 完了まで戻らない。キャッシュは curl ハンドルの共有範囲（既定では
+    /// CurlHandlePool::shared()）に残るため、続く startDownload() の最初の転送は
+    /// 接続済みの状態から始まる。ダウンロード中に呼んでもよい（スレッドセーフ）
+    /// @return 接続できた接続元の数
+    size_t warmUp(const std::vector<std::string>& urls);
 
     /// @brief ダウンロードを一時停止する（スレッドセーフ）
-    /// ワーカーが現在のチャンクを完了後に停止する
+    /// 次の書き込みコールバックで WRITE_PAUSE を返して転送を止める。
+    /// pauseReleaseMs を超えて停止が続くと接続を切断する
     void pause();
 
     /// @brief 一時停止を再開する（スレッドセーフ）
-    /// Range リクエストで続きから再開する
+    /// 接続を切断済みの転送は Range リクエストで続きから再開する
     void resume();
 
     /// @brief ダウンロードをキャンセルする（スレッドセーフ）
     /// 呼び出し後、ワーカースレッドの終了を待たずにリターンする
     void cancel();
 
+    // -------------------------------------------------------------------------
+    // 帯域制限
+    // -------------------------------------------------------------------------
+
+    /// @brief 受信上限を変更する（スレッドセーフ、実行中の転送にもすぐに反映される）
+    /// @param bytesPerSec 上限 (bytes/sec)、0 で無制限
+    void setMaxBytesPerSec(int64_t bytesPerSec);
+
+    /// @brief 帯域が足りないときの優先度を変更する（スレッドセーフ）
+    void setPriority(TransferPriority priority);
+
     // -------------------------------------------------------------------------
     // 状態取得
     // -------------------------------------------------------------------------
@@ -128,28 +524,374 @@ public:
     /// @brief 現在の状態スナップショットを取得する（スレッドセーフ）
     DownloadStats getStats() const;
 
+    /// @brief 数値だけのスナップショットをロックを取らずに取得する（スレッドセーフ）
+    /// URL・ミラー・時間の内訳などが要る場合は getStats() を使う
+    DownloadProgress getProgress() const noexcept;
+
     /// @brief 現在のダウンロード状態を取得する（スレッドセーフ）
     DownloadState getState() const;
 
 private:
     // -------------------------------------------------------------------------
     // 内部実装
+    //
+    // ダウンロードは「転送 (Transfer)」の連鎖として組み立てる。
+    //   HEAD → セグメント群 / 単一ストリーム → 完了処理
+    // 各段は runTransfers() で転送を実行し、完了時に次の段を呼ぶ。
+    // ワーカースレッド駆動では同期的に、DownloadManager 駆動では
+    // イベントループ上の完了通知として次の段が呼ばれる。
     // -------------------------------------------------------------------------
 
+    /// 1 本の curl 転送の状態（定義は Downloader.cpp）
+    struct Transfer;
+    using TransferPtr = std::shared_ptr<Transfer>;
+
+    /// ダウンロードの出力先（startDownload の引数のいずれか 1 つ）
+    struct OutputTarget {
+        std::string     path;               ///< 出力ファイルのパス（atomicOutput では書き込み中の一時ファイル）
+        std::string     finalPath;          ///< atomicOutput: 完了時に path から置き換える先（空なら path に直接書く）
+        bool            toMemory = false;   ///< destination へ書き込む
+        std::span<char> destination;        ///< 呼び出し側のメモリ領域
+        IDownloadSink*  sink     = nullptr; ///< 書き込み先のシンク
+    };
+
+    /// ダウンロードを開始する（startDownload の共通処理）
+    /// @param ranges 空でなければこの区間だけを取得する（startRangeDownload。まとめ済み）
+    bool start(const std::vector<std::string>& urls, OutputTarget output,
+               CompletionHandler onDone, std::vector<SegmentRange> ranges = {});
+
+    /// 区間の読み出しを始める（最初の区間を segmentCount 本までの転送に割り当てる）
+    void startRanges();
+
+    /// 次に取得する区間を転送に割り当てる
+    /// @return false: 残っている区間がない
+    bool takePendingRange(Transfer& transfer);
+
+    /// 終えた区間を確定し、同じ転送で range の取得に移る（区間の引き取り・次の区間の割り当て）
+    bool rearmSegment(Transfer& transfer, const SegmentRange& range);
+
+    /// ミラーの状態（statsMutex_ で保護）
+    struct Mirror {
+        std::string url;
+        int64_t     bytes  = 0;     ///< 終わった区間で受信したバイト数
+        int64_t     rate   = 0;     ///< 1 接続あたりの受信速度 (bytes/sec)、0 は未測定
+        bool        failed = false;
+        bool        peer   = false; ///< peerTracker から得たピア
+    };
+
+    /// ミラーの URL を取得する
+    std::string mirrorUrl(size_t mirror) const;
+
+    /// 失敗していないミラーのうち最も速いもの（測定済みのミラーがなければ先頭のもの）
+    /// @return 使えるミラーがなければ SIZE_MAX
+    size_t pickMirror() const;
+
+    /// 転送が現在のミラーで受信した分をミラーの統計に加える
+    /// @param failed true ならミラーを失敗扱いにする
+    void creditMirror(Transfer& transfer, bool failed);
+
+    /// 出力先のスナップショットを取得する
+    OutputTarget getOutput() const;
+
     /// ワーカースレッドのエントリポイント
     void workerThread();
 
-    /// 実際のダウンロード処理（ワーカースレッド内で実行）
-    void doDownload();
+    /// 前回のワーカースレッドの終了を待つ（そのスレッドの onDone から呼ばれた場合は切り離す）
+    void joinWorker();
+
+    /// ダウンロードを開始する（例外は onError に変換する）
+    void runDownload();
+
+    /// レジューム位置を決めて最初の転送を開始する
+    void beginDownload();
+
+    /// 単一ストリームでのダウンロードを開始する
+    /// @param mirror 取得元のミラー
+    void startSingleStream(int64_t resumeFrom, size_t mirror = 0);
+
+    /// HEAD リクエストでサーバの Range 対応とファイルサイズを調べる
+    /// @param mirror 問い合わせるミラー（失敗したら次に使えるミラーで調べ直す）
+    void startProbe(size_t mirror = 0);
+
+    /// HEAD の結果からセグメント分割するかを決める
+    void onProbeFinished(const Transfer& probe);
+
+    /// セグメントが書き込む出力ファイルを contentLength バイトにする（preallocateOutput なら領域も確保する）
+    /// @return false: 失敗した（failDownload 済み）
+    bool sizeOutputFile(const std::string& path, int64_t contentLength, FileWriter::Mode mode);
+
+    /// セグメント分割ダウンロードを開始する
+    /// @param ifRange 空でなければジャーナルからの再開。既存のファイルに書き足し、
+    ///                各区間を If-Range 付きで要求する
+    void startSegments(int64_t contentLength,
+                       const std::vector<SegmentRange>& segments,
+                       const std::string& ifRange = {});
+
+    /// ジャーナルを検証し、欠けた区間だけを取り直す
+    /// @return true: 再開した（または完了済みだった） / false: 再開できるジャーナルがない
+    bool resumeFromJournal(const std::string& outputPath);
+
+    /// キャッシュの内容を出力先へ複製して完了する
+    /// @return false: 複製できなかった（記録は使わずにダウンロードする）
+    bool completeFromCache(const DownloadCache::Entry& entry, const std::string& digest = {});
+
+    /// 再検証の 304 に応じてキャッシュから完了する。複製できなければ条件なしで取り直す
+    void completeRevalidated(size_t mirror);
+
+    /// 受信した出力ファイルをキャッシュに記録する（completeDownload から呼ぶ）
+    void storeInCache();
+
+    /// 前回から内容が変わっていた（If-Range が一致しなかった）場合に、
+    /// 受信済みのデータとジャーナルを捨てて最初から取り直す
+    void restartWithoutJournal();
+
+    /// ピアから受信した内容でダイジェストが一致しなかった場合に、ピアを使わずに最初から取り直す
+    void restartFromOrigin();
+
+    /// 新しいダウンロードのジャーナルを作り、受信済み区間を記録できるようにする
+    /// @return false: 検証値がない・作れなかった（記録せずにダウンロードを続ける）
+    bool openJournal(int64_t contentLength, const std::string& etag,
+                     const std::string& lastModified);
+
+    /// 書き込んだデータを転送の未記録区間のチェックサムに加え、
+    /// journalChunkSize に達したらジャーナルに記録する
+    void recordJournal(Transfer& transfer, const char* data, size_t size);
+
+    /// 転送の未記録区間をジャーナルに記録する（転送の終了時）
+    void commitJournal(Transfer& transfer);
+
+    /// curl ハンドルを生成してミラーの URL と共通オプションを設定する
+    /// @return 生成に失敗した場合は nullptr
+    std::unique_ptr<ICurlHandle> createHandle(size_t mirror = 0);
 
-    /// 一時停止ポイント - PAUSED 状態の間ブロックする
+    /// curl ハンドルを生成して url と共通オプションを設定する
+    std::unique_ptr<ICurlHandle> createHandleFor(const std::string& url);
+
+    /// 転送の時間の内訳をジョブの統計に記録する（ジョブで最初に応答を受けた転送だけ。
+    /// 計測値には毎回記録する）
+    void recordTimings(const Transfer& transfer);
+
+    /// 転送を生成する（createHandle() のハンドルを持つ）
+    /// @return 生成に失敗した場合は nullptr
+    TransferPtr createTransfer(size_t mirror = 0);
+
+    /// セグメント転送の出力先を区間の先頭に合わせて用意する
+    /// @param base 直接コピーする出力先の全体（空ならファイル・シンクに書く）
+    /// @return false: 開けなかった
+    bool openSegmentOutput(Transfer& transfer, std::span<char> base,
+                           std::shared_ptr<MappedFile> mapped);
+
+    /// 終わった転送に次の仕事を割り当てる（複数ミラー・再試行の場合）
+    /// 失敗した転送は別のミラーで（なければ待ってから同じ取得元で）続きから、
+    /// 区間を終えた転送は他の区間の残りを引き取って続ける
+    /// @return true: 転送を作り直したので、もう一度実行する
+    bool reassignTransfer(Transfer& transfer);
+
+    /// 失敗した転送を別のミラーで続きから取り直す準備をする
+    bool failoverTransfer(Transfer& transfer);
+
+    /// 一時的な失敗で終わった転送を、待ってから同じ取得元で続きから取り直す準備をする
+    /// （ワーカースレッド駆動ではここで待ち、イベントループ駆動では登録を遅らせる）
+    /// @return false: 再試行しない（再試行できない失敗・回数の上限・キャンセル）
+    bool retryTransfer(Transfer& transfer);
+
+    /// 転送の失敗が再試行の対象か
+    bool isRetryable(const Transfer& transfer) const;
+
+    /// 次の再試行までの待ち時間（transfer.retries 回目）
+    std::chrono::milliseconds retryDelay(const Transfer& transfer) const;
+
+    /// 再試行の待ち時間が過ぎるか、キャンセル・他の転送の失敗まで待つ（ワーカースレッド駆動時）
+    /// @return false: 待機を中断した
+    bool waitForRetry(std::chrono::milliseconds delay);
+
+    /// 区間を終えた転送に、終わるまで最も長くかかりそうな区間の後半を引き取らせる
+    bool stealWork(Transfer& transfer);
+
+    /// セグメントの CRC-32C を記録する（区間の終了時）
+    void recordSegmentCrc(const Transfer& transfer);
+
+    /// 書き終えた区間をピアへ配布する（区間の終了時、出力を閉じて creditMirror した後に呼ぶ）
+    /// ピアから受信した区間は、ダイジェストを照合して完了するまで配布しない (markComplete で配布する)
+    void publishSegment(const Transfer& transfer);
+
+    /// 出力ファイルのピアへの配布を始める（受信済みの区間は空）
+    void shareWithPeers(int64_t contentLength);
+
+    /// ピアへの配布をやめる（配布していなければ何もしない）
+    void withdrawFromPeers();
+
+    /// 書き込み・進捗コールバックを転送に設定する
+    void attachCallbacks(Transfer& transfer);
+
+    /// 出力先を決めていない転送 の出力を開く（単一ストリームの最初の書き込み時）
+    /// シンクには Content-Length を渡して open する。mmap 出力はサイズが分かれば
+    /// mmap し、分からなければ通常のファイル書き込みにする
+    /// @return false: 開けなかった（transfer.error に記録する）
+    bool openPendingOutput(Transfer& transfer);
+
+    /// シンクを開く（ジョブにつき 1 回だけ）
+    bool openSink(IDownloadSink& sink, int64_t expectedSize);
+
+    /// 開いたシンクを閉じる（終了処理から呼ぶ。2 回目以降は何もしない）
+    /// @return false: シンクの close() が失敗した
+    bool closeSink();
+
+    /// 接続を切断した転送に新しいハンドルを用意し、続きの Range を設定する
+    /// （transfer.mirror を変えてから呼ぶと別のミラーから取り直す）
+    /// @return false: ハンドルの生成に失敗した（transfer.error に記録する）
+    bool restartTransfer(Transfer& transfer);
+
+    /// 転送群を実行する
+    /// @param onEach 各転送の完了時（実行したスレッドから呼ばれる）
+    /// @param onAll  すべての転送の完了後に 1 回だけ呼ばれる
+    void runTransfers(std::vector<TransferPtr> transfers,
+                      std::function<void(Transfer&)> onEach,
+                      std::function<void()> onAll);
+
+    /// DownloadManager に転送を登録する
+    /// @param delay 転送を開始するまでの待ち時間（再試行の待機）
+    void submitTransfer(const TransferPtr& transfer,
+                        std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+
+    /// DownloadManager 駆動時の転送完了処理を実行する
+    void finishManagedTransfer(const TransferPtr& transfer, CurlResult result);
+
+    /// 接続を切断した転送を resume() まで保留する（DownloadManager 駆動時）
+    /// @return true: 保留または再登録した / false: 通常どおり完了させる
+    bool parkTransfer(const TransferPtr& transfer);
+
+    /// 保留していた転送を続きから再登録する
+    /// @return false: 再開できなかった
+    bool resubmitTransfer(const TransferPtr& transfer);
+
+    /// 書き込みコールバック本体
+    size_t onTransferWrite(Transfer& transfer, const char* data, size_t size);
+
+    /// 進捗コールバック本体
+    int onTransferProgress(Transfer& transfer, int64_t dltotal, int64_t dlnow);
+
+    /// 受信速度を測り、転送中の接続の SO_RCVBUF と次の接続の設定を広げる
+    void tuneReceiveBuffer(Transfer& transfer, int64_t dlnow);
+
+    /// 書き込みデータを転送の出力先に書き、受信量とダイジェストに加える
+    /// （PIPELINED の展開中は展開用のスレッドから呼ばれる）
+    /// @param error 失敗した理由の書き込み先
+    bool writeOutput(Transfer& transfer, const char* data, size_t size, std::string& error);
+
+    /// 圧縮された応答を展開用のスレッドで展開する準備をする（PIPELINED の最初の書き込み時）
+    /// @return false: 展開できない方式だった（transfer.error に記録する）
+    bool openDecoder(Transfer& transfer);
+
+    /// 単一ストリームの結果処理
+    void finishSingleStream(Transfer& transfer);
+
+    /// セグメント転送の成否を判定する
+    /// @return 空文字列: 成功 / それ以外: エラーメッセージ
+    std::string checkSegment(const Transfer& transfer) const;
+
+    /// セグメント群の結果処理
+    void finishSegments();
+
+    /// 出力全体を読み直してダイジェストを計算する（転送中に計算できなかった場合）
+    /// @return 空文字列: 読めなかった
+    std::string digestOutput();
+
+    /// ダイジェストを期待値と照合してから完了させる（checksumAlgorithm が NONE ならそのまま完了）
+    /// @param digest 転送中に計算したダイジェスト。空なら digestOutput() で計算する
+    void verifyAndComplete(std::string digest);
+
+    /// 出力ファイルをディスクへ書き出し (fileSync)、atomicOutput なら出力へ置き換える
+    /// @param renamed 置き換えた場合に true（output_.path は置き換えた先になる）
+    /// @return false: 失敗した（error に理由を記録する）
+    bool finalizeOutputFile(bool& renamed, std::string& error);
+
+    /// 完了処理: 100% の進捗通知を出してから COMPLETED に遷移する
+    void completeDownload();
+
+    /// ERROR に遷移して onError を通知する
+    void failDownload(const std::string& message);
+
+    /// CANCELLED に遷移して onCancelled を通知する
+    void cancelDownload();
+
+    /// discardOutput_ なら途中まで書いた出力ファイルを消す（failDownload / cancelDownload から呼ぶ）
+    void discardPartialOutput();
+
+    /// ジョブの終了を記録する（デストラクタ・次回 startDownload の待機を解除）
+    /// onDone があれば結果を渡して呼ぶ（ワーカースレッド駆動では workerThread() の最後に回す）
+    /// @param error ERROR で終了した場合の理由
+    void endJob(const std::string& error = {});
+
+    /// CurlResult からエラーメッセージを組み立てる
+    static std::string describeFailure(CurlResult result,
+                                       const ICurlHandle& curl);
+
+    /// 一時停止ポイント - 転送を WRITE_PAUSE で停止させる
+    /// @return true: 一時停止した / false: 直前に resume された
+    bool enterPause(Transfer& transfer);
+
+    /// WRITE_PAUSE で停止中の転送を進捗コールバックから監視する
+    /// 再開されていれば転送スレッド上で unpause し、長時間なら切断を決める
+    /// @return true: 接続を切断する（コールバックから中断させる）
+    bool pollPausedTransfer(Transfer& transfer);
+
+    /// 一時停止したまま終わった転送を切断扱いにする
+    void suspendIfPaused(Transfer& transfer);
+
+    /// 書き込み待ち（展開待ち）が上限に達した転送を、queue が追いつくまで止める
+    /// @return true: WRITE_PAUSE で停止させる / false: 空きができたので続行する
+    bool throttleTransfer(Transfer& transfer, DiskWriteQueue& queue);
+
+    /// 帯域の割り当てが足りない転送を、割り当てられるまで止める
+    /// @return size: 割り当てられたので続行する / それ以外: 書き込みコールバックの戻り値
+    size_t waitForBandwidth(Transfer& transfer, size_t size);
+
+    /// 転送を WRITE_PAUSE で止めた印を付け、再開用のコールバックを返す（イベントループ駆動時）
+    std::function<void()> withholdTransfer(Transfer& transfer);
+
+    /// 書き込み待ち・帯域制限で停止したまま終わった転送を、空き（帯域の割り当て）を
+    /// 待って続きから取り直す
+    /// （WRITE_PAUSE に対応しない file:// などは停止できずにエラーで終わるため）
+    /// @return true: 取り直す / false: 通常どおり完了させる
+    bool restartWhenWritable(const TransferPtr& transfer);
+
+    /// 接続を切断したワーカースレッドを resume() まで待機させる
     /// @return true: 再開 / false: キャンセル
-    bool waitIfPaused();
+    bool waitForResume();
+
+    /// WRITE_PAUSE で停止中の転送をすべて再開する（pauseMutex_ 保持中に呼ぶ）
+    void unpauseTransfersLocked();
+
+    /// pause() からの停止時間を計測値に加える（resume() / cancel() から呼ぶ）
+    void recordPauseEnd();
 
     // -------------------------------------------------------------------------
     // Observer 通知ヘルパー（ワーカースレッドから呼ぶ）
     // -------------------------------------------------------------------------
+
+    /// 登録中の各オブザーバーに deliver を適用する（ディスパッチャーがあれば積むだけ）
+    /// @param coalesce true: 未配信の同種イベントを置き換える（進捗通知）
+    template <typename Deliver>
+    void dispatchToObservers(Deliver deliver, bool coalesce = false);
+
+    /// 進捗通知の間引き条件を満たしていれば通知権を取得する（複数の転送スレッドから呼ぶ）
+    bool claimProgressNotification(int64_t downloaded);
+
+    /// 進捗の割合を計算する（不明な場合は -1。圧縮転送では受信したボディの割合）
+    double progressPercent(int64_t downloaded, int64_t total) const;
+
     void notifyProgress(int64_t downloaded, int64_t total, double percent);
+
+    /// 最新の進捗を登録中のオブザーバーに配信する（ディスパッチスレッドから呼ぶ）
+    void deliverPendingProgress();
+
+    /// 現在の状態と受信量を manager_ の進捗の表に書く（DownloadManager 駆動時のみ）
+    void publishProgress();
+
+    /// 登録中の各オブザーバーに deliver をこのスレッドで適用する
+    template <typename Deliver>
+    void deliverToObservers(const Deliver& deliver);
     void notifyCompleted();
     void notifyError(const std::string& message);
     void notifyPaused();
@@ -162,33 +904,120 @@ private:
 
     DownloaderConfig              config_;
     CurlFactory                   curlFactory_;
-
-    // Observer リスト
-    mutable std::mutex            observerMutex_;
-    std::vector<IDownloaderObserver*> observers_;
-
-    // ダウンロード情報（スレッド間共有）
-    mutable std::mutex            statsMutex_;
-    std::string                   url_;
-    std::string                   outputPath_;
+    DownloadManager*              manager_{nullptr}; ///< nullptr ならワーカースレッド駆動
+    ProgressTable::Slot           progressSlot_;     ///< manager_ の進捗の表の自分の行（manager_ がなければ空）
+    std::unique_ptr<DiskWriteQueue> diskQueue_;      ///< asyncDiskWrites の場合のみ生成する
+    ContentDecoding               decoding_{ContentDecoding::NONE}; ///< 展開できる方式がなければ PIPELINED は INLINE にする
+    std::unique_ptr<DiskWriteQueue> decodeQueue_;    ///< PIPELINED の展開用スレッド（展開してから書き込む）
+    std::unique_ptr<BandwidthScheduler::Channel> bandwidth_; ///< このダウンロードの受信枠
+
+    // Observer リスト（コピーオンライト。通知側はロックを取らずにスナップショットを読む）
+    using ObserverList = std::vector<IDownloaderObserver*>;
+    std::mutex                    observerMutex_; ///< 追加・削除どうしを直列化する
+    std::atomic<std::shared_ptr<const ObserverList>> observers_;
+
+    // 転送スレッドが受信のたびに書くカウンター（キャッシュラインの境界から置き、
+    // 監視側が読む制御フラグとは別のラインにする）
+    alignas(CACHE_LINE_SIZE)
     std::atomic<int64_t>          downloadedBytes_{0};
     std::atomic<int64_t>          totalBytes_{0};
+    std::atomic<int64_t>          wireBytes_{0};      ///< 受信したボディ（展開前）
+    std::atomic<int64_t>          wireTotalBytes_{0}; ///< 圧縮転送の Content-Length（展開前）
+    std::atomic<int64_t>          lastProgressBytes_{-1}; ///< 前回通知した受信量（-1: 未通知）
+    std::atomic<int64_t>          lastProgressNs_{0};     ///< 前回の通知時刻 (steady_clock, ns)
 
-    // 状態管理
+    // 状態と制御フラグ（書き込みはまれで、転送スレッドは受信のたびに読む）
+    alignas(CACHE_LINE_SIZE)
     std::atomic<DownloadState>    state_{DownloadState::IDLE};
+    std::atomic<bool>             pauseRequested_{false};
+    std::atomic<bool>             cancelRequested_{false};
+    std::atomic<bool>             transferFailed_{false}; ///< 1 つでも失敗したら残りのセグメントを中断する
+
+    // ディスパッチスレッドへ渡す最新の進捗（配信イベントは this だけを捕捉し、値はここから読む）
+    // 制御フラグとラインを共有しないよう、これも境界から置く
+    struct PendingProgress {
+        int64_t downloaded = 0;
+        int64_t total      = 0;
+        double  percent    = -1.0;
+    };
+    alignas(CACHE_LINE_SIZE)
+    std::mutex                    progressMutex_;
+    PendingProgress               pendingProgress_; ///< progressMutex_ で保護
+
+    // ダウンロード情報（スレッド間共有）
+    mutable std::mutex            statsMutex_;
+    std::string                   url_;               ///< 先頭のミラー
+    std::vector<Mirror>           mirrors_;           ///< 単一の URL でも 1 要素
+    bool                          balancing_{false};  ///< 複数ミラー: 区間の引き取りと取り直しを行う（転送の開始前に設定する）
+    size_t                        segmentCount_{1};   ///< このジョブのセグメント数（複数ミラーではミラー数以上）
+    bool                          rangeRead_{false};  ///< startRangeDownload のジョブ（転送の開始前に設定する）
+    int64_t                       rangeExtent_{0};    ///< 取得する区間の末尾 + 1（転送の開始前に設定する）
+    int64_t                       rangeBytes_{0};     ///< 取得する区間の合計（転送の開始前に設定する）
+    OutputTarget                  output_;
+    bool                          sinkOpened_{false}; ///< output_.sink の open() を呼んだ
+    std::atomic<int>              retryCount_{0};     ///< このジョブで再試行した回数
+    PhaseTimings                  timings_;           ///< statsMutex_ で保護
+    std::chrono::steady_clock::time_point startedAt_{}; ///< このジョブの開始時刻（受信速度の計測用）
+    std::atomic<int64_t>          pausedSinceNs_{0};  ///< pause() した時刻 (steady_clock, ns)、0: 停止していない
+
+    // 受信バッファの自動調整の結果（ジョブをまたいで引き継ぎ、増えるだけで減らない）
+    std::atomic<size_t>           tunedChunkSize_{0};      ///< 次の接続の CURLOPT_BUFFERSIZE
+    std::atomic<int>              tunedReceiveBuffer_{0};  ///< 次の接続の SO_RCVBUF
 
     // 一時停止制御
     mutable std::mutex            pauseMutex_;
     std::condition_variable       pauseCv_;
-    std::atomic<bool>             pauseRequested_{false};
-    std::atomic<bool>             cancelRequested_{false};
+    bool                          pauseNotified_{false}; ///< pauseMutex_ で保護
+    std::vector<TransferPtr>      activeTransfers_;      ///< pauseMutex_ で保護
+    std::vector<TransferPtr>      suspendedTransfers_;   ///< 切断して保留中（pauseMutex_ で保護）
+
+    std::string                   transferError_;        ///< 失敗したセグメントの理由（jobMutex_ で保護）
+
+    // 再開用ジャーナル（journalEnabled_ / journalResume_ は転送の開始前に設定する）
+    std::unique_ptr<ResumeJournal> journal_;      ///< 記録中のジャーナル（区間の追記はスレッドセーフ）
+    bool                          journalEnabled_{false}; ///< このジョブでジャーナルを使う
+    bool                          journalResume_{false};  ///< ジャーナルから再開した転送を実行中
+    std::atomic<bool>             journalMismatch_{false}; ///< If-Range が一致しなかった
+    bool                          discardOutput_{false};   ///< 失敗・キャンセル時に出力ファイルを消す（ジャーナルなしのセグメント出力）
+
+    // キャッシュ（転送の開始前に設定し、以降はジョブを進めるスレッドだけが触れる）
+    struct CacheState {
+        bool                               enabled = false; ///< このジョブでキャッシュを使う
+        bool                               hit     = false; ///< キャッシュから完了した（記録し直さない）
+        std::optional<DownloadCache::Entry> entry;          ///< 再検証する記録
+        std::string                        etag;            ///< 記録する応答の検証値
+        std::string                        lastModified;
+    };
+    CacheState                    cache_;
+
+    // ピア配布（ジョブを進めるスレッドが区間の転送を始める前に設定する）
+    std::string                   peerShare_; ///< 配布している内容の URL（空: 配布していない）
+    std::atomic<int64_t>          peerBytes_{0};       ///< このジョブでピアから受信したバイト数
+    bool                          originRetry_{false}; ///< ダイジェストの不一致でピアを使わずに取り直している
+
+    // 受信データの検証（CRC-32C は区間ごとに計算し、完了時に先頭から順に連結する）
+    struct SegmentCrc {
+        int64_t  first = 0;
+        uint32_t crc   = 0;
+        int64_t  size  = 0;
+    };
+    std::vector<SegmentCrc>       segmentCrcs_; ///< 区間の終了時に追加する（jobMutex_ で保護）
+    size_t                        nextSegmentIndex_{0}; ///< 引き取った区間に振る番号（jobMutex_ で保護）
+    std::vector<SegmentRange>     pendingRanges_; ///< まだ割り当てていない区間（末尾から取り出す。jobMutex_ で保護）
+    std::string                   checksum_;    ///< statsMutex_ で保護
+
+    // ジョブ完了待ち（DownloadManager 駆動時はスレッド join の代わりに使う）
+    std::mutex                    jobMutex_;
+    std::condition_variable       jobCv_;
+    bool                          jobActive_{false};
+    CompletionHandler             completion_;          ///< このジョブの onDone（jobMutex_ で保護）
+    std::function<void()>         deferredCompletion_;  ///< ワーカースレッドの最後に呼ぶ onDone（ワーカースレッドだけが触れる）
 
     // ワーカースレッド
     std::thread                   workerThread_;
 
-    // curl 書き込みバッファ（低メモリ設計: チャンクサイズのみ使用）
-    // ワーカースレッドのみがアクセスするため mutex 不要
-    std::vector<char>             writeBuffer_;
+    // オブザーバー通知スレッド（asyncObserverDispatch の場合のみ生成する）
+    std::unique_ptr<ObserverDispatcher> dispatcher_;
 };
 
 } // namespace Downloader
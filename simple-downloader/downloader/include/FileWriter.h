@@ -0,0 +1,158 @@
+#pragma once
+// =============================================================================
+// FileWriter.h
+// 出力ファイルへの位置指定の書き込み（領域の事前確保・ページキャッシュを経由しない書き込み・
+// 定期的なディスクへの書き出し）
+//
+// 仕組み:
+//   - write() / writeAt() は pwrite / WriteFile(OVERLAPPED) で位置を指定して書く（追記モードは使わない）
+//   - allocate() はサイズを伸ばして領域も確保する（fallocate / posix_fallocate。未対応なら ftruncate）。
+//     reserve() はサイズを変えずに領域だけを確保する（途中で止まっても続きから再開できるように）
+//       Linux   : fallocate (FALLOC_FL_KEEP_SIZE)
+//       Windows : SetFileInformationByHandle (FileAllocationInfo)
+//   - directIo では O_DIRECT / FILE_FLAG_NO_BUFFERING で開いた 2 つ目のハンドルに、ALIGNMENT の境界に
+//     揃った部分だけを整列したバッファ経由で書く。境界に揃わない先頭と末尾は通常のハンドルで書く。
+//     O_DIRECT を開けないファイルシステム (tmpfs など) では通常の書き込みになる（macOS は F_NOCACHE）
+//   - dropCache では書き込んだ区間の書き出しを始め (sync_file_range)、1 つ前の区間の書き出しを
+//     待ってからページキャッシュから捨てる (posix_fadvise DONTNEED)。Windows では何もしない
+//   - syncInterval バイト書き込むごとに fdatasync / FlushFileBuffers する
+//
+// スレッドモデル:
+//   - 1 つの FileWriter は 1 つのスレッドから順に使うこと（スレッドをまたいで渡すのはよい）
+//   - 同じファイルの重ならない区間へは、別の FileWriter から同時に書き込んでよい
+// =============================================================================
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Downloader {
+
+class FileWriter {
+public:
+    /// @brief ファイルの開き方
+    enum class Mode {
+        TRUNCATE, ///< 作成する（既存の内容は破棄）
+        APPEND,   ///< 作成する（既存の内容は残し、末尾から書く）
+        UPDATE,   ///< 既存の内容を残す（書く位置は seek() / writeAt() で指定する）
+    };
+
+    /// @brief 書き込みの設定
+    struct Options {
+        bool    directIo     = false; ///< ページキャッシュを経由せずに書く（使えなければ通常の書き込み）
+        bool    dropCache    = false; ///< 書き込んだ区間をページキャッシュから捨てる
+        int64_t syncInterval = 0;     ///< このバイト数を書き込むごとにディスクへ書き出す、0 で書き出さない
+    };
+
+    /// directIo で境界を揃える単位 (bytes)
+    static constexpr int64_t ALIGNMENT = 4096;
+
+    FileWriter() = default;
+
+    /// @brief デストラクタ - ファイルを閉じる (RAII)
+    ~FileWriter();
+
+    // コピー・ムーブ不可（OS のハンドルを持つため）
+    FileWriter(const FileWriter&)            = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    /// @brief path を開く（開いていれば先に閉じる）
+    /// @return false: 失敗した（理由は getLastError() で取得する）
+    bool open(const std::string& path, Mode mode, Options options);
+    bool open(const std::string& path, Mode mode) { return open(path, mode, Options{}); }
+
+    /// @brief ファイルを size バイトに伸ばし、ディスク領域も確保する（短くはしない）
+    bool allocate(int64_t size);
+
+    /// @brief ファイルのサイズを size バイトにする（領域は確保しない）
+    bool truncate(int64_t size);
+
+    /// @brief サイズを変えずに size バイトまでの領域を確保する（ベストエフォート、失敗しても無視する）
+    void reserve(int64_t size);
+
+    /// @brief write() で書く位置を position にする
+    void seek(int64_t position) { position_ = position; }
+
+    /// @brief 現在位置に書き込んで位置を進める
+    bool write(const char* data, size_t size);
+
+    /// @brief offset に書き込む（現在位置は変えない）
+    bool writeAt(int64_t offset, const char* data, size_t size);
+
+    /// @brief 書き込んだ内容をディスクへ書き出す (fdatasync / FlushFileBuffers)
+    bool sync();
+
+    /// @brief ファイルを閉じる（dropCache では最後の区間もページキャッシュから捨てる）
+    /// @return false: 閉じる前の書き出しに失敗した（理由は getLastError() で取得する）
+    bool close();
+
+    /// @brief 開いているか
+    bool isOpen() const { return open_; }
+
+    /// @brief 次に write() で書く位置
+    int64_t position() const { return position_; }
+
+    /// @brief ページキャッシュを経由せずに書いているか（directIo を指定しても使えなければ false）
+    bool directIo() const { return direct_; }
+
+    /// @brief 直前のエラーメッセージを取得する
+    const std::string& getLastError() const { return lastError_; }
+
+    /// @brief path の内容をディスクへ書き出す（mmap や別の FileWriter で書いたファイル向け）
+    static bool syncFile(const std::string& path, std::string& error);
+
+    /// @brief from を to へ置き換える（rename。to が既にあれば置き換える）
+    /// @param durable 置き換えたことをディスクへ書き出す（POSIX ではディレクトリを fsync する）
+    static bool replace(const std::string& from, const std::string& to, bool durable, std::string& error);
+
+private:
+    /// 書き込んだ後の処理（dropCache・syncInterval）
+    bool afterWrite(int64_t offset, size_t size);
+
+    /// ALIGNMENT に揃った区間を direct ハンドルで書く（呼び出し側のバッファが揃っていなければ整列したバッファへ写す）
+    /// direct ハンドルで書けなければ、以降は通常のハンドルで書く
+    bool writeAligned(int64_t offset, const char* data, size_t size);
+
+    /// dropCache: まとめた区間の書き出しを始め、1 つ前の区間をページキャッシュから捨てる
+    void rotateDropWindow();
+
+    // ---- プラットフォームごとの実装 ----
+
+    /// 通常のハンドルで [offset, offset + size) に書く
+    bool writeBuffered(int64_t offset, const char* data, size_t size);
+
+    /// direct ハンドルで書く（offset・data・size は ALIGNMENT に揃っていること）
+    bool writeDirect(int64_t offset, const char* data, size_t size);
+
+    /// direct ハンドルを閉じる
+    void closeDirect();
+
+    /// [offset, offset + size) の書き出しを始める（完了は待たない）
+    void startWriteback(int64_t offset, int64_t size);
+
+    /// [offset, offset + size) の書き出しを待ってページキャッシュから捨てる
+    void dropPages(int64_t offset, int64_t size);
+
+    Options           options_;
+    bool              open_     = false;
+    bool              direct_   = false;
+    int64_t           position_ = 0;
+    int64_t           unsynced_ = 0;      ///< 前回ディスクへ書き出してから書き込んだバイト数
+    int64_t           pendingStart_  = 0; ///< dropCache: 書き出しを始めていない区間
+    int64_t           pendingSize_   = 0;
+    int64_t           flushingStart_ = 0; ///< dropCache: 書き出し中の区間
+    int64_t           flushingSize_  = 0;
+    std::vector<char> bounce_;            ///< directIo: 整列したバッファ（先頭は ALIGNMENT に揃えて使う）
+    std::string       lastError_;
+
+#ifdef _WIN32
+    void*       file_{nullptr};       ///< HANDLE（INVALID_HANDLE_VALUE は nullptr で表す）
+    void*       directFile_{nullptr}; ///< FILE_FLAG_NO_BUFFERING で開いた HANDLE
+#else
+    int         fd_{-1};
+    int         directFd_{-1};        ///< O_DIRECT（macOS では F_NOCACHE）で開いた fd
+#endif
+};
+
+} // namespace Downloader
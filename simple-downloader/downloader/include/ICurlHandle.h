@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace Downloader {
 
@@ -21,6 +22,16 @@ enum class CurlResult {
     OTHER_ERROR
 };
 
+/// @brief 1 回の転送にかかった時間の内訳（マイクロ秒。不明な値は -1）
+/// 再利用した接続では dnsUs / connectUs / tlsUs が 0 になる
+struct PhaseTimings {
+    int64_t dnsUs       = -1; ///< 名前解決
+    int64_t connectUs   = -1; ///< TCP 接続（名前解決の後から）
+    int64_t tlsUs       = -1; ///< TLS ハンドシェイク（HTTPS 以外は 0）
+    int64_t firstByteUs = -1; ///< 転送の開始から最初の応答バイトまで（上の 3 つを含む）
+    int64_t transferUs  = -1; ///< 最初の応答バイトから転送の終わりまで
+};
+
 /// @brief libcurl ハンドル操作を抽象化するインターフェース
 /// 本番実装は CurlHandle, テスト用はモッククラスを用意する
 class ICurlHandle {
@@ -28,14 +39,39 @@ public:
     virtual ~ICurlHandle() = default;
 
     /// @brief 書き込みコールバック型
-    /// @return 書き込んだバイト数。それ以外を返すと curl が中断する
+    /// @return 書き込んだバイト数。WRITE_PAUSE を返すと転送を一時停止し、
+    ///         それ以外の値を返すと curl が中断する
     using WriteCallback = std::function<size_t(const char* data, size_t size)>;
 
+    /// @brief 書き込みコールバックから返すと転送を一時停止する値
+    /// (CURL_WRITEFUNC_PAUSE と同値。受信済みデータは unpause() 後に再送される)
+    static constexpr size_t WRITE_PAUSE = 0x10000001;
+
     /// @brief 進捗コールバック型
     /// @return 0 継続, 非0 で curl が中断する
     using ProgressCallback =
         std::function<int(int64_t dltotal, int64_t dlnow)>;
 
+    /// @brief ヘッダーコールバック型（1 行ずつ、改行コードを含む生データ）
+    using HeaderCallback = std::function<void(const char* data, size_t size)>;
+
+    /// @brief 書き込み・進捗・ヘッダーをまとめて受け取るインターフェース
+    /// 個別のコールバック (std::function) を介さずに直接呼び出すため、受信ごとの
+    /// 間接呼び出しが 1 段減る。呼び出し側が所有し、転送が終わるまで生存させること
+    class Receiver {
+    public:
+        virtual ~Receiver() = default;
+
+        /// @brief WriteCallback と同じ
+        virtual size_t onWrite(const char* data, size_t size) = 0;
+
+        /// @brief ProgressCallback と同じ
+        virtual int onProgress(int64_t dltotal, int64_t dlnow) = 0;
+
+        /// @brief HeaderCallback と同じ
+        virtual void onHeader(const char* data, size_t size) = 0;
+    };
+
     /// @brief URL を設定する
     virtual void setUrl(const std::string& url) = 0;
 
@@ -43,15 +79,81 @@ public:
     /// @param startByte 再開開始バイト位置
     virtual void setResumeFrom(int64_t startByte) = 0;
 
+    /// @brief 取得するバイト範囲を設定する (Range: bytes=first-last)
+    /// @param first 先頭バイト位置
+    /// @param last  末尾バイト位置（この位置を含む）
+    virtual void setRange(int64_t first, int64_t last) = 0;
+
+    /// @brief 追加のリクエストヘッダーを設定する（"Name: value" 形式。空で解除）
+    virtual void setRequestHeaders(const std::vector<std::string>& headers) = 0;
+
+    /// @brief Accept-Encoding を送り、圧縮されたレスポンスを受け付ける
+    /// @param encodings 送る方式（"gzip, br" など）。空文字列は curl が展開できるすべて
+    /// @param decode    true: curl が展開してから書き込みコールバックに渡す
+    ///                  false: 受信したまま（圧縮されたまま）渡す
+    virtual void setAcceptEncoding(const std::string& encodings, bool decode) = 0;
+
+    /// @brief ボディを取得しない (HEAD 相当) リクエストにする
+    virtual void setNoBody(bool noBody) = 0;
+
+    /// @brief curl の受信バッファ (CURLOPT_BUFFERSIZE) の大きさを設定する（転送の開始前に呼ぶ）
+    /// 1 回の書き込みコールバックで渡されるデータの上限にもなる
+    virtual void setBufferSize(size_t bytes) = 0;
+
+    /// @brief TCP_NODELAY を設定する
+    virtual void setTcpNoDelay(bool enable) = 0;
+
+    /// @brief TCP キープアライブを設定する
+    /// @param idleSec     最初のプローブを送るまでの無通信時間 (秒)
+    /// @param intervalSec プローブの間隔 (秒)
+    virtual void setTcpKeepAlive(bool enable, long idleSec, long intervalSec) = 0;
+
+    /// @brief ソケットの受信バッファ (SO_RCVBUF) を広げる
+    /// 新しい接続には接続前に適用する。書き込み・進捗コールバックの中から呼ぶと
+    /// このハンドルが張った転送中の接続にも適用する。OS が自動調整した現在の値より小さい値では変更しない
+    virtual void setReceiveBufferSize(int bytes) = 0;
+
     /// @brief HTTP2 を有効化する
     virtual void enableHttp2() = 0;
 
+    /// @brief HTTP/3 (QUIC) を優先する（対応していないサーバには HTTP/2・HTTP/1.1 で接続する）
+    /// @return false: curl が HTTP/3 に対応していない（設定を変えない）
+    virtual bool enableHttp3() = 0;
+
+    /// @brief 同じ接続元への転送を 1 本の接続のストリームとして多重化するか
+    /// true: 多重化できる接続の確立を待ってから相乗りする (CURLOPT_PIPEWAIT)
+    /// false: HTTP/1.1 にして転送ごとに接続を使う（終わった接続の再利用はする）
+    virtual void setMultiplexing(bool enable) = 0;
+
+    /// @brief 名前解決の結果を上書きする (CURLOPT_RESOLVE)
+    /// @param entries "host:port:address[,address]..." 形式。空で解除
+    /// 上書きした結果は共有の DNS キャッシュにも入り、同じ共有を使うハンドルに効く
+    virtual void setResolveOverrides(const std::vector<std::string>& entries) = 0;
+
+    /// @brief IPv6 と IPv4 の両方に接続できる場合に、IPv6 だけを試す時間 (ms)
+    /// 0 で curl の既定 (200ms)
+    virtual void setHappyEyeballsTimeout(long ms) = 0;
+
+    /// @brief TCP Fast Open で SYN とともにリクエストを送る（対応する OS のみ）
+    virtual void setTcpFastOpen(bool enable) = 0;
+
+    /// @brief TLS 1.3 の 0-RTT (early data) でリクエストを送る
+    /// curl と TLS ライブラリが対応していない場合は何もしない
+    virtual void setTlsEarlyData(bool enable) = 0;
+
     /// @brief 書き込みコールバックを設定する
     virtual void setWriteCallback(WriteCallback cb) = 0;
 
     /// @brief 進捗コールバックを設定する
     virtual void setProgressCallback(ProgressCallback cb) = 0;
 
+    /// @brief ヘッダーコールバックを設定する
+    virtual void setHeaderCallback(HeaderCallback cb) = 0;
+
+    /// @brief 書き込み・進捗・ヘッダーの受け取り先を設定する（nullptr で解除）
+    /// 設定している間は個別のコールバックより優先する
+    virtual void setReceiver(Receiver* receiver) = 0;
+
     /// @brief タイムアウト設定 (秒)
     virtual void setConnectTimeout(long seconds) = 0;
 
@@ -68,9 +170,24 @@ public:
     /// @return 結果コード
     virtual CurlResult perform() = 0;
 
+    /// @brief WRITE_PAUSE で一時停止した転送を再開する
+    /// 本番実装では転送を駆動しているスレッドから呼ぶこと
+    virtual void unpause() = 0;
+
     /// @brief 最後の HTTP レスポンスコードを取得する
     virtual long getHttpResponseCode() const = 0;
 
+    /// @brief 直前のレスポンスの Content-Length を取得する
+    /// @return バイト数。不明な場合は -1
+    virtual int64_t getContentLength() const = 0;
+
+    /// @brief 現在の接続の往復遅延 (RTT) を取得する
+    /// @return マイクロ秒。不明な場合は -1
+    virtual int64_t getRoundTripTimeUs() const = 0;
+
+    /// @brief 直前の転送にかかった時間の内訳を取得する
+    virtual PhaseTimings getTimings() const = 0;
+
     /// @brief 直前のエラーメッセージを取得する
     virtual std::string getLastError() const = 0;
 };
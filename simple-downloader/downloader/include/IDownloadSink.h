@@ -0,0 +1,43 @@
+#pragma once
+// =============================================================================
+// IDownloadSink.h
+// ダウンロードしたデータの書き込み先を差し替えるためのインターフェース
+// ファイル以外（メモリ・パーサーへのストリーミングなど）へ直接データを渡す
+// =============================================================================
+
+#include <cstdint>
+#include <span>
+
+namespace Downloader {
+
+/// @brief ダウンロードデータの書き込み先
+/// 呼び出し順序: open() → write() × N → close()
+/// write() は転送スレッド（またはイベントループスレッド）から呼ばれる。
+/// supportsRandomAccess() が true の場合は、セグメントごとのスレッドから
+/// 重ならない区間へ同時に呼ばれることがある
+class IDownloadSink {
+public:
+    virtual ~IDownloadSink() = default;
+
+    /// @brief 最初のデータを受け取る前に 1 回呼ばれる
+    /// @param expectedSize 全体サイズ (bytes)。不明な場合は -1
+    /// @return false: 受け入れられない（ダウンロードはエラーになる）
+    virtual bool open(int64_t expectedSize) = 0;
+
+    /// @brief 受信データを書き込む
+    /// @param offset ダウンロード全体での data の先頭位置
+    /// @param data   受信データ（呼び出しの間だけ有効）
+    /// @return false: 書き込めない（ダウンロードはエラーになる）
+    virtual bool write(int64_t offset, std::span<const char> data) = 0;
+
+    /// @brief ダウンロードの終了時（完了・エラー・キャンセル）に 1 回呼ばれる
+    /// open() が呼ばれなかった場合は呼ばれない
+    /// @return false: 書き込みの後処理に失敗した（完了はエラーとして通知する）
+    virtual bool close() { return true; }
+
+    /// @brief 任意の位置への書き込みに対応するか
+    /// false の場合はセグメント分割せず、offset は常に先頭から連続する
+    virtual bool supportsRandomAccess() const { return false; }
+};
+
+} // namespace Downloader
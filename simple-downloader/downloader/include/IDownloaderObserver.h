@@ -22,6 +22,7 @@ enum class DownloadState {
 
 /// @brief ダウンローダーのイベントを受け取るオブザーバーインターフェース
 /// UI スレッドからの継承を想定。コールバックはワーカースレッドから発火されることに注意。
+/// （DownloaderConfig::asyncObserverDispatch では専用のディスパッチスレッドから発火される）
 class IDownloaderObserver {
 public:
     virtual ~IDownloaderObserver() = default;
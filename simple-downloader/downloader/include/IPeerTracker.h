@@ -0,0 +1,36 @@
+#pragma once
+// =============================================================================
+// IPeerTracker.h
+// ピア（同じ内容を配布しているほかのノード）を探す追跡サービスのインターフェース
+//
+// 実装例:
+//   - PeerTracker             : プロセス内で保持する（同じプロセスの複数ノード・テスト・
+//                               コーディネーターのサーバ側の実装に使う）
+//   - コーディネーターへの RPC・ゴシップ : クラスタの構成に合わせて利用者が実装する
+//
+// Downloader は DownloaderConfig::peerTracker から peersFor() でピアを得てミラーとして使い、
+// PeerServer は配布を始める・やめるときに announce() / withdraw() を呼ぶ
+// =============================================================================
+
+#include <string>
+#include <vector>
+
+namespace Downloader {
+
+class IPeerTracker {
+public:
+    virtual ~IPeerTracker() = default;
+
+    /// @brief url の内容を配布しているピアの URL を返す（スレッドセーフに実装すること）
+    /// 先頭ほど優先して使われる。呼び出し側ごとに順序を変えると負荷が偏らない
+    /// @param url 配布元 (origin) の URL
+    virtual std::vector<std::string> peersFor(const std::string& url) = 0;
+
+    /// @brief peerUrl が url の内容の配布を始めたことを登録する
+    virtual void announce(const std::string& url, const std::string& peerUrl) = 0;
+
+    /// @brief peerUrl が url の内容の配布をやめたことを登録する
+    virtual void withdraw(const std::string& url, const std::string& peerUrl) = 0;
+};
+
+} // namespace Downloader
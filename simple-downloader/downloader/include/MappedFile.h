@@ -0,0 +1,71 @@
+#pragma once
+// =============================================================================
+// MappedFile.h
+// 出力ファイルを最終サイズで確保してメモリにマップする（ゼロコピー出力用）
+//
+// 仕組み:
+//   - open() でファイルを作成し、最終サイズ分のディスク領域を確保してから
+//     書き込み可能なマッピングを作る
+//       POSIX   : posix_fallocate（未対応のファイルシステムでは ftruncate）+ mmap
+//       Windows : SetEndOfFile + CreateFileMapping / MapViewOfFile
+//   - 受信データは data() の各オフセットへ直接 memcpy する（1 回のコピーで済む）
+//   - 領域を先に確保するため、書き込み中の容量不足で SIGBUS になることを防ぐ
+//
+// スレッドモデル:
+//   - open() / close() は 1 つのスレッドから呼ぶこと
+//   - data() の重ならない区間へは複数スレッドから同時に書き込んでよい
+// =============================================================================
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Downloader {
+
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    /// @brief デストラクタ - マッピングを解除してファイルを閉じる (RAII)
+    ~MappedFile();
+
+    // コピー・ムーブ不可（OS のハンドルを持つため）
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief ファイルを size バイトで作成（既存の内容は破棄）してマップする
+    /// size が 0 の場合は空ファイルを作成するだけでマップしない
+    /// @return false: 失敗した（理由は getLastError() で取得する）
+    bool open(const std::string& path, int64_t size);
+
+    /// @brief マッピングを解除してファイルを閉じる
+    /// @return false: 解除に失敗した（理由は getLastError() で取得する）
+    bool close();
+
+    /// @brief マップした領域の先頭（未オープンの場合は nullptr）
+    char* data() const { return data_; }
+
+    /// @brief マップした領域のサイズ (bytes)
+    int64_t size() const { return size_; }
+
+    /// @brief マップ中か
+    bool isOpen() const { return open_; }
+
+    /// @brief 直前のエラーメッセージを取得する
+    const std::string& getLastError() const { return lastError_; }
+
+private:
+    char*       data_{nullptr};
+    int64_t     size_{0};
+    bool        open_{false};
+    std::string lastError_;
+
+#ifdef _WIN32
+    void*       file_{nullptr};    ///< HANDLE（INVALID_HANDLE_VALUE は nullptr で表す）
+    void*       mapping_{nullptr}; ///< ファイルマッピングの HANDLE
+#else
+    int         fd_{-1};
+#endif
+};
+
+} // namespace Downloader
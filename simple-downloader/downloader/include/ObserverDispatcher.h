@@ -0,0 +1,71 @@
+#pragma once
+// =============================================================================
+// ObserverDispatcher.h
+// オブザーバーへの通知を専用スレッドから行うためのイベントキュー
+//
+// 仕組み:
+//   - 転送スレッドは通知をキューに積むだけで戻り、ユーザーのコールバックは
+//     ディスパッチスレッドで積まれた順に実行される
+//   - postLatest() で積んだイベント（進捗通知）は、まだ実行されていなければ
+//     新しいもので置き換える。遅いオブザーバーがいてもキューが伸びない
+//
+// 使い方:
+//   ObserverDispatcher dispatcher;
+//   dispatcher.postLatest([=] { observer->onProgress(now, total, percent); });
+//   dispatcher.post([=] { observer->onCompleted(); });
+//   dispatcher.flush();   // 積んだイベントがすべて実行されるまで待つ
+// =============================================================================
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Downloader {
+
+class ObserverDispatcher {
+public:
+    using Event = std::function<void()>;
+
+    /// @brief コンストラクタ - ディスパッチスレッドを起動する
+    ObserverDispatcher();
+
+    /// @brief デストラクタ - 積まれたイベントをすべて実行してからスレッドを終了する (RAII)
+    /// イベントの中から所有者を破棄しないこと（自身のスレッドは join できない）
+    ~ObserverDispatcher();
+
+    // コピー・ムーブ不可（スレッドリソースを持つため）
+    ObserverDispatcher(const ObserverDispatcher&)            = delete;
+    ObserverDispatcher& operator=(const ObserverDispatcher&) = delete;
+
+    /// @brief イベントを積む（スレッドセーフ）
+    void post(Event event);
+
+    /// @brief 未実行のものがあれば置き換えてイベントを積む（スレッドセーフ）
+    /// 置き換えた場合も、実行順は最初に積んだ位置のまま
+    void postLatest(Event event);
+
+    /// @brief 呼び出し時点までに積まれたイベントがすべて実行されるまで待つ
+    /// ディスパッチスレッドから呼んだ場合は待たずに戻る
+    void flush();
+
+    /// @brief 呼び出し元がディスパッチスレッドか
+    bool isDispatchThread() const;
+
+private:
+    /// ディスパッチスレッドのエントリポイント
+    void dispatchThread();
+
+    mutable std::mutex      mutex_;
+    std::condition_variable workCv_;  ///< ディスパッチスレッドを起こす
+    std::condition_variable idleCv_;  ///< flush() 待ちを起こす
+    std::deque<Event>       events_;  ///< 空の Event は latest_ の実行位置（mutex_ で保護）
+    Event                   latest_;  ///< postLatest() の最新イベント（mutex_ で保護）
+    bool                    latestQueued_{false};  ///< mutex_ で保護
+    bool                    running_{false};       ///< イベント実行中（mutex_ で保護）
+    bool                    stopRequested_{false}; ///< mutex_ で保護
+    std::thread             thread_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,147 @@
+#pragma once
+// =============================================================================
+// PeerServer.h
+// 受信済みの区間をほかのノードへ HTTP Range で配布するサーバ（ピア配布）
+//
+// 仕組み:
+//   - share() したファイルを "http://<advertisedHost>:<port>/peer/<URL の SHA-256>" で配布する
+//   - 配布するのは markAvailable() / markComplete() で受信済みとした区間だけ。
+//     要求された区間がまだない場合は 404 を返し、要求側 (Downloader) はその区間を
+//     配布元 (origin) や別のピアから取り直す
+//   - GET / HEAD、Range: bytes=first-last / first-、持続接続 (keep-alive) に対応する。
+//     Range がない GET はファイル全体が揃っている場合だけ応答する
+//   - 送信は Linux では sendfile でページキャッシュから直接送る（ユーザー空間にコピーしない）
+//   - 接続ごとにスレッドを 1 本使い、maxConnections を超える接続には 503 を返して閉じる
+//   - tracker を指定すると、share() / unshare() で配布の開始・終了を登録する
+//
+// 使い方:
+//   PeerTracker tracker;                 // 実際のクラスタではコーディネーターへの RPC など
+//   PeerServer  server({.bindAddress = "0.0.0.0", .advertisedHost = "node-17.internal",
+//                       .tracker = &tracker});
+//   DownloaderConfig config;
+//   config.peerServer  = &server;        // 受信した区間を配布する
+//   config.peerTracker = &tracker;       // ほかのノードの区間を取得元に加える
+//
+// 注意:
+//   - 配布する内容は検証しない。受け取る側が expectedChecksum で照合すること
+//     （Downloader は expectedChecksum がないダウンロードではピアを使わない）
+//   - 配布中のファイルを削除・上書きする前に unshare() すること
+// =============================================================================
+
+#include "Downloader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Downloader {
+
+class IPeerTracker;
+
+class PeerServer {
+public:
+    /// @brief サーバの設定
+    struct Options {
+        std::string   bindAddress    = "127.0.0.1"; ///< 待ち受けるアドレス（IPv4）
+        uint16_t      port           = 0;           ///< 待ち受けるポート、0 で空いているポート
+        std::string   advertisedHost = {};          ///< 配布 URL のホスト名（空なら bindAddress）
+        size_t        maxConnections = 64;          ///< 同時に処理する接続の上限
+        IPeerTracker* tracker        = nullptr;     ///< 配布の開始・終了を登録する先
+    };
+
+    /// @brief 待ち受けを始める
+    /// @throws std::runtime_error 待ち受けられなかった場合
+    explicit PeerServer(Options options);
+    PeerServer() : PeerServer(Options{}) {}
+
+    /// @brief デストラクタ - すべての配布を終了し、接続を閉じてスレッドを join する
+    ~PeerServer();
+
+    PeerServer(const PeerServer&)            = delete;
+    PeerServer& operator=(const PeerServer&) = delete;
+
+    /// @brief 待ち受けているポート
+    uint16_t port() const { return port_; }
+
+    /// @brief url の内容を配布する URL
+    std::string peerUrl(const std::string& url) const;
+
+    /// @brief path を url の内容として配布を始める（スレッドセーフ）
+    /// すでに配布していれば受信済みの区間を空に戻す
+    /// @return 配布 URL
+    std::string share(const std::string& url, const std::string& path, int64_t contentLength);
+
+    /// @brief [first, last] を受信済みとして配布する（スレッドセーフ）
+    /// 内容がファイルに書き込まれてから呼ぶこと
+    void markAvailable(const std::string& url, int64_t first, int64_t last);
+
+    /// @brief ファイル全体を受信済みとして配布する（スレッドセーフ）
+    void markComplete(const std::string& url);
+
+    /// @brief 配布をやめる（スレッドセーフ。送信中の応答は最後まで送る）
+    void unshare(const std::string& url);
+
+    /// @brief 配布している受信済みの区間（先頭から順、隣接する区間はまとめる）
+    std::vector<SegmentRange> availableRanges(const std::string& url) const;
+
+    /// @brief これまでに送ったボディのバイト数
+    uint64_t servedBytes() const { return servedBytes_.load(std::memory_order_relaxed); }
+
+    /// @brief これまでに応答した要求の数
+    uint64_t requestCount() const { return requests_.load(std::memory_order_relaxed); }
+
+private:
+    using Socket = intptr_t;
+
+    struct Share {
+        std::string               url;
+        std::string               path;
+        int64_t                   contentLength = 0;
+        std::vector<SegmentRange> ranges; ///< 受信済みの区間（先頭から順、重ならない）
+    };
+
+    struct Connection {
+        Socket            socket = -1;
+        std::thread       thread;
+        std::atomic<bool> done{false};
+    };
+
+    void acceptLoop();
+
+    /// 1 本の接続の要求を閉じられるまで順に処理する
+    void serve(Connection& connection);
+
+    /// 1 つの要求に応答する
+    /// @return false: 接続を閉じる
+    bool respond(Socket socket, const std::string& request);
+
+    /// ファイルの [first, last] を送る
+    bool sendFile(Socket socket, const std::string& path, int64_t first, int64_t last);
+
+    /// 終わった接続のスレッドを join して取り除く
+    void reapConnections();
+
+    /// 配布 URL のパス部分 ("/peer/<URL の SHA-256>")
+    static std::string keyFor(const std::string& url);
+
+    const Options         options_;
+    Socket                listener_ = -1;
+    uint16_t              port_     = 0;
+    std::atomic<bool>     stopping_{false};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> servedBytes_{0};
+    std::thread           acceptThread_;
+
+    mutable std::mutex                     sharesMutex_;
+    std::unordered_map<std::string, Share> shares_; ///< パス → 配布中の内容（sharesMutex_ で保護）
+
+    std::mutex                               connectionsMutex_;
+    std::vector<std::unique_ptr<Connection>> connections_; ///< connectionsMutex_ で保護
+};
+
+} // namespace Downloader
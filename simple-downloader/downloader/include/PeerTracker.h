@@ -0,0 +1,50 @@
+#pragma once
+// =============================================================================
+// PeerTracker.h
+// プロセス内で保持する IPeerTracker の標準実装
+//
+// 仕組み:
+//   - 配布元の URL ごとに、announce() されたピアの URL を登録順に保持する
+//   - peersFor() は問い合わせのたびに先頭をずらして返す。多数のノードが同時に
+//     問い合わせても、最初に選ばれるピアが 1 つに集中しない
+//
+// 使い方:
+//   PeerTracker tracker;
+//   PeerServer  server({.tracker = &tracker});
+//   DownloaderConfig config;
+//   config.peerTracker = &tracker;
+//   config.peerServer  = &server;
+// =============================================================================
+
+#include "IPeerTracker.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Downloader {
+
+class PeerTracker final : public IPeerTracker {
+public:
+    PeerTracker() = default;
+    PeerTracker(const PeerTracker&)            = delete;
+    PeerTracker& operator=(const PeerTracker&) = delete;
+
+    // IPeerTracker（スレッドセーフ）
+    std::vector<std::string> peersFor(const std::string& url) override;
+    void announce(const std::string& url, const std::string& peerUrl) override;
+    void withdraw(const std::string& url, const std::string& peerUrl) override;
+
+private:
+    struct Swarm {
+        std::vector<std::string> peers; ///< 登録順
+        size_t                   next = 0; ///< 次の問い合わせで先頭にするピア
+    };
+
+    std::mutex                             mutex_;
+    std::unordered_map<std::string, Swarm> swarms_; ///< 配布元の URL → ピア（mutex_ で保護）
+};
+
+} // namespace Downloader
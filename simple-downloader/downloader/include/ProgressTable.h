@@ -0,0 +1,96 @@
+#pragma once
+// =============================================================================
+// ProgressTable.h
+// 多数のダウンロードの進捗を 1 か所にまとめ、1 本のスレッドからまとめて読む表
+//
+// 仕組み:
+//   - スロットは BLOCK_SIZE 個ずつのブロックで確保し、返されたスロットは再利用する
+//     （ブロックは解放しないため、スロットのアドレスは返すまで変わらない）
+//   - ブロックの中は項目ごとの配列 (structure of arrays)。全件の受信量を読むときは
+//     受信量の配列だけを順に読めばよく、1 キャッシュラインで 8 件分が読める
+//   - 書き込みは各ダウンローダーが自分のスロットにだけ行い、ロックを取らない
+//     （オブザーバーへの進捗通知と状態の変化のときだけ書くため、書き込みは間引かれる）
+//
+// 使い方:
+//   DownloadManager manager(2);
+//   std::vector<ProgressTable::Entry> entries;
+//   manager.progressTable().collect(entries);   // entries の領域は次の呼び出しで再利用される
+// =============================================================================
+
+#include "CacheLine.h"
+#include "IDownloaderObserver.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Downloader {
+
+class ProgressTable {
+public:
+    /// 1 ブロックのスロット数
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    /// @brief 1 件のスロット（acquire() で借り、release() で返す）
+    class Slot {
+    public:
+        Slot() = default;
+
+        /// @brief スロットを借りているか
+        explicit operator bool() const { return block_ != nullptr; }
+
+    private:
+        friend class ProgressTable;
+        Slot(void* block, size_t offset) : block_(block), offset_(offset) {}
+
+        void*  block_  = nullptr;
+        size_t offset_ = 0;
+    };
+
+    /// @brief collect() で読み出す 1 件分の値
+    struct Entry {
+        const void*   owner           = nullptr; ///< acquire() に渡した所有者
+        DownloadState state           = DownloadState::IDLE;
+        int64_t       downloadedBytes = 0;
+        int64_t       totalBytes      = 0;       ///< 不明な場合は 0
+    };
+
+    ProgressTable();
+    ~ProgressTable();
+
+    ProgressTable(const ProgressTable&)            = delete;
+    ProgressTable& operator=(const ProgressTable&) = delete;
+
+    /// @brief スロットを借りる（スレッドセーフ。値は IDLE・0 から始まる）
+    /// @param owner collect() の Entry::owner として返す値（nullptr 以外）
+    Slot acquire(const void* owner);
+
+    /// @brief スロットを返す（スレッドセーフ。返した後は publish() しないこと）
+    void release(Slot& slot);
+
+    /// @brief スロットの値を書き換える（ロックを取らない）
+    /// 同じスロットへ同時に書いた場合、項目ごとにどちらかの値が残る
+    void publish(const Slot& slot, DownloadState state, int64_t downloadedBytes, int64_t totalBytes);
+
+    /// @brief 使用中のスロットの値をすべて読み出す（スレッドセーフ）
+    /// @param out 読み出し先。中身は置き換え、確保済みの領域は再利用する
+    /// @return 読み出した件数
+    size_t collect(std::vector<Entry>& out) const;
+
+    /// @brief 使用中のスロットの数
+    size_t size() const;
+
+private:
+    struct Block;
+
+    mutable std::mutex                  mutex_;
+    std::vector<std::unique_ptr<Block>> blocks_;    ///< mutex_ で保護（ブロック自体は解放しない）
+    std::vector<Slot>                   freeSlots_; ///< 返されたスロット（mutex_ で保護）
+    size_t                              used_ = 0;  ///< mutex_ で保護
+};
+
+} // namespace Downloader
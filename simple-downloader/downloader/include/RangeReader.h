@@ -0,0 +1,69 @@
+#pragma once
+// =============================================================================
+// RangeReader.h
+// 大きなオブジェクトから必要な区間だけを読み出し、区間ごとのバッファで返す
+// （zip の中央ディレクトリ・Parquet のフッター・tar の索引など）
+//
+// 仕組み:
+//   - 取得は Downloader::startRangeDownload() に任せる（近い区間はまとめて 1 回で取得し、
+//     segmentCount 本までの転送で並列に取得する）。受信データはシンクで区間ごとのバッファへ振り分ける
+//   - BlockCache を渡すと、区間をブロック単位に広げて、キャッシュにないブロックだけを取得する。
+//     取得したブロックはキャッシュに記録し、同じ位置の読み出しを繰り返してもリクエストしない
+//
+// 使い方:
+//   Downloader::Downloader downloader(config);
+//   BlockCache  cache;
+//   RangeReader reader(downloader, &cache);
+//   RangeReadResult tail = reader.read(url, {{size - 22, size - 1}});   // 中央ディレクトリの終端
+//
+// 注意:
+//   - 1 つの Downloader で同時に進められる読み出しは 1 件（実行中に始めた読み出しは開始できない）
+//   - read() は終わるまで戻らない。DownloadManager のループスレッドからは readAsync() を使うこと
+// =============================================================================
+
+#include "BlockCache.h"
+#include "Downloader.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Downloader {
+
+/// @brief 区間の読み出しの結果
+struct RangeReadResult {
+    DownloadResult                 download;         ///< 取得の結果（すべてキャッシュにあれば転送せずに COMPLETED）
+    std::vector<std::vector<char>> data;             ///< 要求と同じ順の内容（末尾を越えた区間は短い。失敗すると空）
+    size_t                         cachedBlocks = 0; ///< キャッシュから使ったブロックの数
+
+    bool ok() const { return download.ok(); }
+};
+
+class RangeReader {
+public:
+    /// @param downloader 取得に使う（本オブジェクトより長く生存すること）
+    /// @param cache      ブロックのキャッシュ（任意。複数の RangeReader で共有してよい）
+    explicit RangeReader(Downloader& downloader, BlockCache* cache = nullptr);
+
+    RangeReader(const RangeReader&)            = delete;
+    RangeReader& operator=(const RangeReader&) = delete;
+
+    /// @brief url の ranges を読み出す（終わるまで戻らない）
+    RangeReadResult read(const std::string& url, const std::vector<SegmentRange>& ranges);
+
+    /// @brief url の ranges を読み出し、結果を std::future で受け取る
+    /// 結果はダウンロードの終了を通知したスレッドで組み立てる
+    std::future<RangeReadResult> readAsync(const std::string& url, const std::vector<SegmentRange>& ranges);
+
+private:
+    struct ReadState;
+
+    /// 受信した区間から結果を組み立てて渡す
+    static void finish(ReadState& state, DownloadResult download);
+
+    Downloader& downloader_;
+    BlockCache* cache_;
+};
+
+} // namespace Downloader
@@ -0,0 +1,74 @@
+#pragma once
+// =============================================================================
+// ReceiveTuner.h
+// 受信速度と RTT から帯域遅延積を測り、受信バッファの大きさを決める
+//
+// 仕組み:
+//   - 1 本の接続の累計受信量を一定間隔ごとに受け取り、区間の受信速度を求める
+//   - 受信速度は区間ごとの最大値を使う（一時停止・帯域制限で遅い区間に引きずられない）
+//   - 帯域遅延積 (BDP) = 受信速度 × RTT。受信ウィンドウが BDP ちょうどだと速度が
+//     ウィンドウで頭打ちになり、それ以上の帯域を測れないため、SO_RCVBUF は BDP の
+//     2 倍を推奨する（Linux はその半分程度を受信ウィンドウとして広告する）
+//   - 推奨値は増えるだけで減らない。転送中にバッファを縮めても得るものがないため
+//
+// 使い方:
+//   ReceiveTuner tuner({});
+//   if (tuner.due(now) && tuner.sample(dlnow, now, rttUs)) {
+//       curl.setReceiveBufferSize(tuner.receiveBufferSize());
+//   }
+// =============================================================================
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Downloader {
+
+class ReceiveTuner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief 推奨値の範囲
+    struct Limits {
+        size_t minBufferSize     = 16 * 1024;        ///< CURLOPT_BUFFERSIZE の下限 (bytes)
+        size_t maxBufferSize     = 1024 * 1024;      ///< CURLOPT_BUFFERSIZE の上限 (bytes)
+        int    minReceiveBuffer  = 128 * 1024;       ///< これより小さい SO_RCVBUF は推奨しない（OS の既定で足りる）
+        int    maxReceiveBuffer  = 16 * 1024 * 1024; ///< SO_RCVBUF の上限 (bytes)
+        std::chrono::milliseconds interval{100};     ///< 受信速度を測る最小の区間
+    };
+
+    explicit ReceiveTuner(Limits limits);
+
+    /// @brief 前回の測定から interval が過ぎたか（RTT を取得する前に確かめる）
+    bool due(Clock::time_point now) const;
+
+    /// @brief 接続の累計受信量を渡して推奨値を更新する
+    /// @param totalBytes この接続で受信したバイト数（前回より減った場合は測り直す）
+    /// @param rttUs      往復遅延（マイクロ秒）。不明な場合は負値
+    /// @return true: 推奨値のいずれかが増えた
+    bool sample(int64_t totalBytes, Clock::time_point now, int64_t rttUs);
+
+    /// @brief 測定した受信速度の最大値 (bytes/sec)。未測定なら 0
+    int64_t throughput() const { return throughput_; }
+
+    /// @brief 帯域遅延積 (bytes)。RTT が分からなければ 0
+    int64_t bandwidthDelayProduct() const { return bdp_; }
+
+    /// @brief 推奨する CURLOPT_BUFFERSIZE (bytes)
+    size_t bufferSize() const { return bufferSize_; }
+
+    /// @brief 推奨する SO_RCVBUF (bytes)。0 は OS の既定のままでよい
+    int receiveBufferSize() const { return receiveBuffer_; }
+
+private:
+    Limits            limits_;
+    bool              started_      = false;
+    int64_t           lastBytes_    = 0;
+    Clock::time_point lastSample_{};
+    int64_t           throughput_   = 0;
+    int64_t           bdp_          = 0;
+    size_t            bufferSize_   = 0;
+    int               receiveBuffer_ = 0;
+};
+
+} // namespace Downloader
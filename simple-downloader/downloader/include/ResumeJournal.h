@@ -0,0 +1,101 @@
+#pragma once
+// =============================================================================
+// ResumeJournal.h
+// 再開用ジャーナル - 出力ファイルの受信済み区間を横のファイルに記録する
+//
+// 仕組み:
+//   - "<出力ファイル>.meta" に、ファイルサイズ・検証値 (ETag / Last-Modified)・
+//     受信済み区間とそのチェックサム (CRC-32) を 1 行ずつ追記する
+//   - ヘッダー部分は一時ファイルに書いてから rename して作るため、途中で落ちても
+//     壊れたヘッダーは残らない。区間の行は追記のみで、改行で終わらない末尾の行
+//     （書き込み途中で落ちた行）は読み込み時に捨てる
+//   - 区間はデータがディスクに書き出される前に記録しうる。再開時に出力ファイルの
+//     内容とチェックサムを照合し、一致しない区間（書き込み途中で落ちた部分）は
+//     取り直す
+//
+// 使い方:
+//   ResumeJournal journal;
+//   if (journal.load(ResumeJournal::pathFor(output))) {
+//       auto valid   = ResumeJournal::verify(output, journal.ranges());
+//       auto missing = ResumeJournal::missingRanges(journal.header().contentLength, valid);
+//   }
+// =============================================================================
+
+#include "Checksum.h"
+#include "Downloader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Downloader {
+
+/// @brief 受信済みの 1 区間
+struct JournalRange {
+    int64_t  first = 0; ///< 先頭バイト位置
+    int64_t  last  = 0; ///< 末尾バイト位置（この位置を含む）
+    uint32_t crc   = 0; ///< 区間の CRC-32
+
+    int64_t size() const { return last - first + 1; }
+};
+
+class ResumeJournal {
+public:
+    /// @brief ジャーナルの先頭に記録するダウンロードの情報
+    struct Header {
+        int64_t     contentLength = -1;
+        std::string etag;
+        std::string lastModified;
+
+        /// If-Range に使う検証値（ETag を優先する）。ない場合は空文字列
+        std::string validator() const { return etag.empty() ? lastModified : etag; }
+    };
+
+    /// @brief 出力ファイルに対応するジャーナルのパス
+    static std::string pathFor(const std::string& outputPath) { return outputPath + ".meta"; }
+
+    ResumeJournal() = default;
+    ResumeJournal(const ResumeJournal&)            = delete;
+    ResumeJournal& operator=(const ResumeJournal&) = delete;
+
+    /// @brief 既存のジャーナルを読み込む（追記はできない）
+    /// @return false: ない・壊れている
+    bool load(const std::string& path);
+
+    /// @brief ジャーナルを作り直し、追記できるように開く
+    /// @param ranges 引き継ぐ受信済み区間
+    bool create(const std::string& path, Header header,
+                const std::vector<JournalRange>& ranges = {});
+
+    /// @brief 受信済み区間を追記する（スレッドセーフ）
+    /// @return false: 開いていない・書き込みに失敗した
+    bool append(const JournalRange& range);
+
+    /// @brief ジャーナルを閉じてファイルを削除する（ダウンロードの完了時）
+    void remove();
+
+    const Header& header() const { return header_; }
+
+    /// @brief 読み込んだ・記録した区間（記録順）
+    std::vector<JournalRange> ranges() const;
+
+    /// @brief 出力ファイルの内容とチェックサムが一致する区間だけを返す
+    static std::vector<JournalRange> verify(const std::string& dataPath,
+                                            const std::vector<JournalRange>& ranges);
+
+    /// @brief [0, contentLength) のうち ranges に含まれない区間を先頭から順に返す
+    static std::vector<SegmentRange> missingRanges(int64_t contentLength,
+                                                   std::vector<JournalRange> ranges);
+
+private:
+    std::string  path_;
+    Header       header_;
+    mutable std::mutex        mutex_;
+    std::vector<JournalRange> ranges_; ///< mutex_ で保護
+    std::ofstream             out_;    ///< 追記用（mutex_ で保護）
+};
+
+} // namespace Downloader
@@ -0,0 +1,364 @@
+// =============================================================================
+// BandwidthScheduler.cpp
+// トークンバケットによる帯域制限の実装
+//
+// 設計方針:
+//  - 制限が 1 つもなければ tryAcquire() はロックを取らずに受け入れる
+//  - バケットの補充は時刻差から都度計算し、スケジューラースレッドは
+//    割り当て待ちがある間だけ次に割り当てられる時刻まで眠る
+//  - 割り当てのコールバックはロックの外で呼ぶ（コールバックから再度要求できる）
+// =============================================================================
+
+#include "BandwidthScheduler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+namespace Downloader {
+
+namespace {
+
+/// バケットに貯められる量（1/8 秒分。小さな帯域でも 1 回の受信は受け入れられる量）
+double burstOf(int64_t rate) {
+    return std::max(static_cast<double>(rate) / 8.0, 16.0 * 1024.0);
+}
+
+} // namespace
+
+std::string hostFromUrl(const std::string& url) {
+    const size_t scheme = url.find("://");
+    size_t begin = scheme == std::string::npos ? 0 : scheme + 3;
+    size_t end   = url.find_first_of("/?#", begin);
+    if (end == std::string::npos) end = url.size();
+
+    // userinfo@host:port → host
+    const size_t at = url.rfind('@', end);
+    if (at != std::string::npos && at >= begin) begin = at + 1;
+    if (begin < end && url[begin] == '[') {
+        const size_t close = url.find(']', begin); // IPv6 リテラル
+        if (close != std::string::npos && close < end) end = close + 1;
+    } else {
+        const size_t colon = url.find(':', begin);
+        if (colon != std::string::npos && colon < end) end = colon;
+    }
+
+    std::string host = url.substr(begin, end - begin);
+    std::transform(host.begin(), host.end(), host.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return host;
+}
+
+// =============================================================================
+// Bucket
+// =============================================================================
+
+void BandwidthScheduler::Bucket::setRate(int64_t bytesPerSec, Clock::time_point now) {
+    refill(now);
+    if (rate == 0) {
+        level = burstOf(bytesPerSec); // 制限を始めた直後は満タンから
+    }
+    rate  = std::max<int64_t>(bytesPerSec, 0);
+    level = std::min(level, burstOf(rate));
+}
+
+void BandwidthScheduler::Bucket::refill(Clock::time_point now) {
+    if (rate != 0 && now > updated) {
+        const double elapsed = std::chrono::duration<double>(now - updated).count();
+        level = std::min(level + elapsed * static_cast<double>(rate), burstOf(rate));
+    }
+    updated = now;
+}
+
+BandwidthScheduler::Clock::duration BandwidthScheduler::Bucket::untilAvailable() const {
+    if (available()) {
+        return Clock::duration::zero();
+    }
+    const double seconds = (1.0 - level) / static_cast<double>(rate);
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+}
+
+// =============================================================================
+// Channel
+// =============================================================================
+
+BandwidthScheduler::Channel::Channel(BandwidthScheduler& scheduler,
+                                     TransferPriority priority)
+    : scheduler_(scheduler)
+    , bucket_(std::make_unique<Bucket>())
+    , priority_(priority) {
+}
+
+BandwidthScheduler::Channel::~Channel() {
+    std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+    scheduler_.removeWaitersLocked(*this);
+    scheduler_.setRateLocked(*bucket_, 0);
+}
+
+void BandwidthScheduler::Channel::setLimit(int64_t bytesPerSec) {
+    {
+        std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+        scheduler_.setRateLocked(*bucket_, bytesPerSec);
+    }
+    scheduler_.workCv_.notify_one();
+}
+
+void BandwidthScheduler::Channel::setPriority(TransferPriority priority) {
+    std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+    priority_ = priority;
+}
+
+void BandwidthScheduler::Channel::setHost(const std::string& host) {
+    std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+    host_ = host;
+}
+
+bool BandwidthScheduler::Channel::tryAcquire(size_t size) {
+    if (scheduler_.limitedBuckets_.load(std::memory_order_acquire) == 0) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+    // 割り当て済みの分（一時停止中に再送されたデータ）を先に使う
+    if (credit_ >= static_cast<int64_t>(size)) {
+        credit_ -= static_cast<int64_t>(size);
+        return true;
+    }
+    if (scheduler_.hasCompetingWaitersLocked(*this)) {
+        return false; // 先に並んでいる転送を追い越さない
+    }
+    if (!scheduler_.consumeLocked(*this, size, Clock::now())) {
+        return false;
+    }
+    credit_ = 0;
+    return true;
+}
+
+bool BandwidthScheduler::Channel::acquire(size_t size,
+                                          const std::function<bool()>& abort) {
+    if (tryAcquire(size)) {
+        return true;
+    }
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    granted = false;
+    uint64_t                id      = 0;
+    {
+        std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+        id = scheduler_.enqueueLocked(*this, size, false, [&]() {
+            std::lock_guard<std::mutex> grantLock(mutex);
+            granted = true;
+            cv.notify_all();
+        });
+    }
+    scheduler_.workCv_.notify_one();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!granted) {
+        cv.wait_for(lock, std::chrono::milliseconds(20));
+        if (granted || !abort()) {
+            continue;
+        }
+        lock.unlock();
+        bool removed = false;
+        {
+            std::lock_guard<std::mutex> schedulerLock(scheduler_.mutex_);
+            removed = scheduler_.removeWaiterLocked(id);
+        }
+        lock.lock();
+        if (removed) {
+            return false;
+        }
+        // 取り除く前に割り当てられた: コールバックが呼ばれるまで待つ
+        cv.wait(lock, [&]() { return granted; });
+    }
+    return true;
+}
+
+void BandwidthScheduler::Channel::notifyWhenAvailable(size_t size,
+                                                      std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+        scheduler_.enqueueLocked(*this, size, true, std::move(callback));
+    }
+    scheduler_.workCv_.notify_one();
+}
+
+// =============================================================================
+// BandwidthScheduler
+// =============================================================================
+
+BandwidthScheduler::BandwidthScheduler() {
+    thread_ = std::thread(&BandwidthScheduler::schedulerThread, this);
+}
+
+BandwidthScheduler::~BandwidthScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    workCv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+BandwidthScheduler& BandwidthScheduler::shared() {
+    static BandwidthScheduler scheduler;
+    return scheduler;
+}
+
+std::unique_ptr<BandwidthScheduler::Channel>
+BandwidthScheduler::openChannel(TransferPriority priority) {
+    return std::unique_ptr<Channel>(new Channel(*this, priority));
+}
+
+void BandwidthScheduler::setGlobalLimit(int64_t bytesPerSec) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        setRateLocked(global_, bytesPerSec);
+    }
+    workCv_.notify_one();
+}
+
+void BandwidthScheduler::setHostLimit(const std::string& host, int64_t bytesPerSec) {
+    const std::string key = hostFromUrl(host); // 大文字小文字・ポートの違いを吸収する
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytesPerSec > 0) {
+            setRateLocked(hosts_[key], bytesPerSec);
+        } else if (auto it = hosts_.find(key); it != hosts_.end()) {
+            setRateLocked(it->second, 0);
+            hosts_.erase(it);
+        }
+    }
+    workCv_.notify_one();
+}
+
+int64_t BandwidthScheduler::getGlobalLimit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return global_.rate;
+}
+
+uint64_t BandwidthScheduler::enqueueLocked(Channel& channel, size_t size, bool toCredit,
+                                           std::function<void()> onGranted) {
+    const uint64_t id = nextWaiterId_++;
+    waiters_[static_cast<size_t>(channel.priority_)].push_back(
+        {id, &channel, size, toCredit, std::move(onGranted)});
+    return id;
+}
+
+bool BandwidthScheduler::removeWaiterLocked(uint64_t id) {
+    for (auto& queue : waiters_) {
+        auto it = std::find_if(queue.begin(), queue.end(),
+                               [id](const Waiter& w) { return w.id == id; });
+        if (it != queue.end()) {
+            queue.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BandwidthScheduler::removeWaitersLocked(const Channel& channel) {
+    for (auto& queue : waiters_) {
+        queue.erase(std::remove_if(queue.begin(), queue.end(),
+                                   [&](const Waiter& w) { return w.channel == &channel; }),
+                    queue.end());
+    }
+}
+
+bool BandwidthScheduler::consumeLocked(Channel& channel, size_t size,
+                                       Clock::time_point now) {
+    Bucket* host = nullptr;
+    if (auto it = hosts_.find(channel.host_); it != hosts_.end()) {
+        host = &it->second;
+    }
+
+    global_.refill(now);
+    channel.bucket_->refill(now);
+    if (host) host->refill(now);
+
+    if (!global_.available() || !channel.bucket_->available() ||
+        (host && !host->available())) {
+        return false;
+    }
+    global_.consume(size);
+    channel.bucket_->consume(size);
+    if (host) host->consume(size);
+    return true;
+}
+
+bool BandwidthScheduler::hasCompetingWaitersLocked(const Channel& channel) const {
+    const bool hostLimited = hosts_.count(channel.host_) != 0;
+    for (size_t p = 0; p <= static_cast<size_t>(channel.priority_); ++p) {
+        for (const auto& waiter : waiters_[p]) {
+            // 自身の上限だけで止まっている他のダウンロードとは競合しない
+            if (waiter.channel == &channel || global_.rate != 0 ||
+                (hostLimited && waiter.channel->host_ == channel.host_)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void BandwidthScheduler::setRateLocked(Bucket& bucket, int64_t bytesPerSec) {
+    const bool wasLimited = bucket.rate != 0;
+    bucket.setRate(bytesPerSec, Clock::now());
+    const bool isLimited = bucket.rate != 0;
+    if (isLimited && !wasLimited) {
+        limitedBuckets_.fetch_add(1, std::memory_order_acq_rel);
+    } else if (!isLimited && wasLimited) {
+        limitedBuckets_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void BandwidthScheduler::schedulerThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<std::function<void()>> granted;
+    while (!stopRequested_) {
+        // 優先度の高い順・到着順に、割り当てられるものをすべて割り当てる
+        const auto now  = Clock::now();
+        auto       wake = Clock::time_point::max();
+        for (auto& queue : waiters_) {
+            for (auto it = queue.begin(); it != queue.end();) {
+                Channel& channel = *it->channel;
+                if (consumeLocked(channel, it->size, now)) {
+                    if (it->toCredit) channel.credit_ += static_cast<int64_t>(it->size);
+                    granted.push_back(std::move(it->onGranted));
+                    it = queue.erase(it);
+                    continue;
+                }
+                // 足りないバケットのうち最も遅く回復するものまで待つ
+                Clock::duration wait = std::max(global_.untilAvailable(),
+                                                channel.bucket_->untilAvailable());
+                if (auto host = hosts_.find(channel.host_); host != hosts_.end()) {
+                    wait = std::max(wait, host->second.untilAvailable());
+                }
+                wake = std::min(wake, now + wait);
+                ++it;
+            }
+        }
+
+        if (!granted.empty()) {
+            lock.unlock();
+            for (auto& callback : granted) {
+                callback();
+            }
+            granted.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (wake == Clock::time_point::max()) {
+            workCv_.wait(lock);
+        } else {
+            workCv_.wait_until(lock, wake);
+        }
+    }
+}
+
+} // namespace Downloader
@@ -0,0 +1,87 @@
+// =============================================================================
+// BlockCache.cpp
+// ブロック単位のメモリ上のキャッシュの実装
+// =============================================================================
+
+#include "BlockCache.h"
+
+#include <algorithm>
+
+namespace Downloader {
+
+BlockCache::BlockCache(Options options)
+    : maxBytes_(options.maxBytes),
+      blockSize_(std::max<int64_t>(options.blockSize, 1)) {}
+
+BlockCache::Block BlockCache::get(const std::string& url, int64_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = blocks_.find(Key{url, index});
+    if (it == blocks_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    return it->second.block;
+}
+
+BlockCache::Block BlockCache::put(const std::string& url, int64_t index, std::vector<char> data) {
+    auto block = std::make_shared<const std::vector<char>>(std::move(data));
+    Block stored = block;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Key key{url, index};
+    const auto it = blocks_.find(key);
+    if (it != blocks_.end()) {
+        bytes_ -= it->second.block->size();
+        it->second.block = std::move(block);
+        bytes_ += it->second.block->size();
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+    } else {
+        bytes_ += block->size();
+        lru_.push_front(key);
+        blocks_.emplace(std::move(key), Slot{std::move(block), lru_.begin()});
+    }
+    evictLocked();
+    return stored;
+}
+
+void BlockCache::invalidate(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        if (it->url != url) {
+            ++it;
+            continue;
+        }
+        const auto slot = blocks_.find(*it);
+        bytes_ -= slot->second.block->size();
+        blocks_.erase(slot);
+        it = lru_.erase(it);
+    }
+}
+
+uint64_t BlockCache::sizeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+uint64_t BlockCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+uint64_t BlockCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void BlockCache::evictLocked() {
+    while (bytes_ > maxBytes_ && !lru_.empty()) {
+        const auto slot = blocks_.find(lru_.back());
+        bytes_ -= slot->second.block->size();
+        blocks_.erase(slot);
+        lru_.pop_back();
+    }
+}
+
+} // namespace Downloader
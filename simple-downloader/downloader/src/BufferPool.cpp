@@ -0,0 +1,261 @@
+// =============================================================================
+// BufferPool.cpp
+// 固定サイズのスラブのプールの実装
+//
+// 設計方針:
+//  - 借りる: 自分の区画 → ほかの区画 → 上限の範囲で新しく確保、の順に探す
+//    （返す側と借りる側のスレッドが違っても、保持中のスラブがある限り確保しない）
+//  - 返す: 上限を超えていれば解放し、それ以外は返したスレッドの区画に積む
+//  - 待っている呼び出し側があるときだけ waitMutex_ を取って起こす
+//    （待つ側の waiters_ の加算と返す側の idle_ の加算はどちらも seq_cst で、
+//      どちらかが必ず相手の変更を見るため起こし損ねない）
+// =============================================================================
+
+#include "BufferPool.h"
+
+#include <new>
+#include <utility>
+
+namespace Downloader {
+
+namespace {
+
+/// スラブの境界（ページ境界。O_DIRECT などの直接 I/O にもそのまま渡せる）
+constexpr std::align_val_t SLAB_ALIGNMENT{4096};
+
+/// 呼び出しスレッドの区画（スレッドが初めて借りたときに順番に割り当てる）
+size_t shardIndex(size_t shards) {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index % shards;
+}
+
+/// 予約したスラブの数を、確保に失敗したとき（例外で抜けたとき）に戻す
+class ReservationGuard {
+public:
+    explicit ReservationGuard(std::atomic<size_t>& count) : count_(&count) {}
+    ~ReservationGuard() {
+        if (count_) {
+            count_->fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    ReservationGuard(const ReservationGuard&)            = delete;
+    ReservationGuard& operator=(const ReservationGuard&) = delete;
+
+    /// 確保に成功したので予約を確定する
+    void dismiss() { count_ = nullptr; }
+
+private:
+    std::atomic<size_t>* count_;
+};
+
+} // namespace
+
+// =============================================================================
+// Buffer
+// =============================================================================
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr))
+    , data_(std::exchange(other.data_, nullptr))
+    , capacity_(std::exchange(other.capacity_, 0)) {
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool_     = std::exchange(other.pool_, nullptr);
+        data_     = std::exchange(other.data_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+BufferPool::Buffer BufferPool::Buffer::allocate(size_t capacity) {
+    if (capacity == 0) {
+        return {};
+    }
+    return Buffer(nullptr, static_cast<char*>(::operator new(capacity, SLAB_ALIGNMENT)), capacity);
+}
+
+void BufferPool::Buffer::reset() {
+    if (!data_) {
+        return;
+    }
+    if (pool_) {
+        pool_->release(data_);
+    } else {
+        ::operator delete(data_, SLAB_ALIGNMENT);
+    }
+    pool_     = nullptr;
+    data_     = nullptr;
+    capacity_ = 0;
+}
+
+// =============================================================================
+// コンストラクタ / デストラクタ
+// =============================================================================
+
+BufferPool::BufferPool(Options options)
+    : slabSize_(options.slabSize > 0 ? options.slabSize : Options{}.slabSize)
+    , maxBytes_(options.maxBytes) {
+}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+BufferPool& BufferPool::shared() {
+    static BufferPool pool;
+    return pool;
+}
+
+// =============================================================================
+// 貸し出し
+// =============================================================================
+
+BufferPool::Buffer BufferPool::tryAcquire() {
+    const size_t home = shardIndex(SHARDS);
+    char* data = popFrom(shards_[home]);
+    for (size_t i = 1; !data && idle_.load() > 0 && i < SHARDS; ++i) {
+        data = popFrom(shards_[(home + i) % SHARDS]);
+    }
+    if (!data && reserveSlab()) {
+        ReservationGuard reservation(allocated_);
+        data = allocateSlab();
+        reservation.dismiss();
+    }
+    if (!data) {
+        return {};
+    }
+    inUse_.fetch_add(1, std::memory_order_relaxed);
+    return Buffer(this, data, slabSize_);
+}
+
+BufferPool::Buffer BufferPool::acquire() {
+    while (true) {
+        if (Buffer buffer = tryAcquire()) {
+            return buffer;
+        }
+        waiters_.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(waitMutex_);
+            waitCv_.wait(lock, [this]() { return available(); });
+        }
+        waiters_.fetch_sub(1);
+    }
+}
+
+bool BufferPool::available() const {
+    if (idle_.load() > 0) {
+        return true;
+    }
+    const size_t limit = maxBytes_.load(std::memory_order_relaxed);
+    return limit == 0 || (allocated_.load(std::memory_order_relaxed) + 1) * slabSize_ <= limit;
+}
+
+void BufferPool::notifyWhenAvailable(std::function<void()> callback) {
+    waiters_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        if (!available()) {
+            callbacks_.push_back(std::move(callback));
+            return;
+        }
+    }
+    waiters_.fetch_sub(1);
+    callback();
+}
+
+void BufferPool::setMaxBytes(size_t maxBytes) {
+    maxBytes_.store(maxBytes, std::memory_order_relaxed);
+    wakeWaiters();
+}
+
+void BufferPool::trim() {
+    for (auto& shard : shards_) {
+        std::vector<char*> slabs;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            slabs.swap(shard.slabs);
+        }
+        for (char* data : slabs) {
+            idle_.fetch_sub(1);
+            freeSlab(data);
+        }
+    }
+}
+
+// =============================================================================
+// 内部処理
+// =============================================================================
+
+char* BufferPool::popFrom(Shard& shard) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.slabs.empty()) {
+        return nullptr;
+    }
+    char* data = shard.slabs.back();
+    shard.slabs.pop_back();
+    idle_.fetch_sub(1);
+    return data;
+}
+
+void BufferPool::release(char* data) {
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+
+    // 上限を下げた後は、超えている分を保持せずに解放する
+    const size_t limit = maxBytes_.load(std::memory_order_relaxed);
+    if (limit > 0 && allocated_.load(std::memory_order_relaxed) * slabSize_ > limit) {
+        freeSlab(data);
+    } else {
+        Shard& shard = shards_[shardIndex(SHARDS)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.slabs.push_back(data);
+        idle_.fetch_add(1);
+    }
+
+    if (waiters_.load() > 0) {
+        wakeWaiters();
+    }
+}
+
+bool BufferPool::reserveSlab() {
+    size_t count = allocated_.load(std::memory_order_relaxed);
+    while (true) {
+        const size_t limit = maxBytes_.load(std::memory_order_relaxed);
+        if (limit > 0 && (count + 1) * slabSize_ > limit) {
+            return false;
+        }
+        if (allocated_.compare_exchange_weak(count, count + 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+char* BufferPool::allocateSlab() {
+    return static_cast<char*>(::operator new(slabSize_, SLAB_ALIGNMENT));
+}
+
+void BufferPool::freeSlab(char* data) {
+    ::operator delete(data, SLAB_ALIGNMENT);
+    allocated_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void BufferPool::wakeWaiters() {
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        if (available()) {
+            callbacks.swap(callbacks_);
+        }
+    }
+    waiters_.fetch_sub(callbacks.size());
+    waitCv_.notify_all();
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
+
+} // namespace Downloader
@@ -0,0 +1,159 @@
+// =============================================================================
+// BufferedWriter.cpp
+// 書き込みをまとめるバッファの実装
+//
+// 設計方針:
+//  - バッファはコンストラクタで確保し、以降は再確保しない
+//    （プールを使う場合は最初の書き込みで借り、flush() まで持ち続ける）
+//  - 2 面バッファでは書き込み面と書き出し面を swap で入れ替える
+//  - 書き込み順を保つため、直接書き出しの前にも書き出しスレッドを待つ
+// =============================================================================
+
+#include "BufferedWriter.h"
+
+#include <cstring>
+
+namespace Downloader {
+
+// -----------------------------------------------------------------------------
+// コンストラクタ / デストラクタ
+// -----------------------------------------------------------------------------
+
+BufferedWriter::BufferedWriter(size_t capacity, Sink sink, bool doubleBuffer,
+                               BufferPool* pool)
+    : capacity_(pool && capacity > 0 ? pool->slabSize() : capacity)
+    , sink_(std::move(sink))
+    , pool_(pool)
+    , doubleBuffer_(doubleBuffer && capacity > 0) {
+    if (!pool_) {
+        active_ = BufferPool::Buffer::allocate(capacity_);
+        if (doubleBuffer_) {
+            pending_ = BufferPool::Buffer::allocate(capacity_);
+        }
+    }
+    if (doubleBuffer_) {
+        flusher_ = std::thread(&BufferedWriter::flusherThread, this);
+    }
+}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex_);
+            stopRequested_ = true;
+        }
+        flushCv_.notify_all();
+        flusher_.join();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// 書き込み
+// -----------------------------------------------------------------------------
+
+bool BufferedWriter::write(const char* data, size_t size) {
+    if (hasFailed()) {
+        return false;
+    }
+
+    // 入りきらない場合は先に書き出して空ける
+    if (activeSize_ + size > capacity_) {
+        flushActive();
+    }
+
+    if (size >= capacity_ || !ensureActive()) {
+        // バッファより大きなデータ・バッファを借りられない場合はコピーせずに直接書き出す
+        waitForFlusher();
+        writeThrough(data, size);
+    } else {
+        std::memcpy(active_.data() + activeSize_, data, size);
+        activeSize_ += size;
+    }
+    return !hasFailed();
+}
+
+bool BufferedWriter::flush() {
+    flushActive();
+    waitForFlusher();
+    if (pool_) {
+        // 貯めているデータがない間はスラブをほかの転送に回す
+        active_.reset();
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        pending_.reset();
+    }
+    return !hasFailed();
+}
+
+// -----------------------------------------------------------------------------
+// 内部処理
+// -----------------------------------------------------------------------------
+
+bool BufferedWriter::ensureActive() {
+    if (!active_ && pool_) {
+        active_ = pool_->tryAcquire();
+    }
+    return static_cast<bool>(active_);
+}
+
+void BufferedWriter::flushActive() {
+    if (activeSize_ == 0) {
+        return;
+    }
+
+    if (!doubleBuffer_) {
+        writeThrough(active_.data(), activeSize_);
+        activeSize_ = 0;
+        return;
+    }
+
+    // 前回分の書き出しが終わった面と入れ替え、書き出しスレッドに渡す
+    // （プールを使う場合、入れ替えた面はまだ借りていないことがある）
+    {
+        std::unique_lock<std::mutex> lock(flushMutex_);
+        flushCv_.wait(lock, [this]() { return !pendingReady_; });
+        std::swap(pending_, active_);
+        pendingSize_  = activeSize_;
+        pendingReady_ = true;
+    }
+    flushCv_.notify_all();
+    activeSize_ = 0;
+}
+
+void BufferedWriter::writeThrough(const char* data, size_t size) {
+    if (hasFailed() || size == 0) {
+        return;
+    }
+    if (!sink_ || !sink_(data, size)) {
+        failed_.store(true, std::memory_order_release);
+    }
+}
+
+void BufferedWriter::waitForFlusher() {
+    if (!doubleBuffer_) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    flushCv_.wait(lock, [this]() { return !pendingReady_; });
+}
+
+void BufferedWriter::flusherThread() {
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    while (true) {
+        flushCv_.wait(lock, [this]() { return pendingReady_ || stopRequested_; });
+        if (!pendingReady_) {
+            return; // 停止要求（書き出し待ちのデータはない）
+        }
+
+        // 書き出し中はロックを外し、転送スレッドが書き込み面へ受信を続けられるようにする
+        lock.unlock();
+        writeThrough(pending_.data(), pendingSize_);
+        lock.lock();
+        pendingSize_ = 0;
+
+        pendingReady_ = false;
+        flushCv_.notify_all();
+    }
+}
+
+} // namespace Downloader
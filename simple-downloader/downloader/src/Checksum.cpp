@@ -0,0 +1,485 @@
+// =============================================================================
+// Checksum.cpp
+// CRC-32 / CRC-32C / SHA-256 の実装
+//
+// 設計方針:
+//  - 命令セット拡張を使う関数はその関数だけに target 属性を付けてコンパイルし、
+//    ライブラリ全体のコンパイルオプションは変えない。どの実装を使うかは
+//    最初の呼び出しで CPUID を調べて一度だけ決める
+//  - ARMv8 の CRC 命令はコンパイラがその拡張を有効にしている場合
+//    (__ARM_FEATURE_CRC32) だけ使う
+// =============================================================================
+
+#include "Checksum.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define DOWNLOADER_CHECKSUM_X86 1
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#  define DOWNLOADER_CHECKSUM_ARM_CRC 1
+#  include <arm_acle.h>
+#endif
+
+// 関数単位で命令セット拡張を有効にする（MSVC は属性なしで組み込み関数を使える）
+#if defined(DOWNLOADER_CHECKSUM_X86) && !defined(_MSC_VER)
+#  define DOWNLOADER_TARGET(features) __attribute__((target(features)))
+#else
+#  define DOWNLOADER_TARGET(features)
+#endif
+
+namespace Downloader {
+
+namespace {
+
+// =============================================================================
+// CRC テーブル
+// =============================================================================
+
+/// 反転ビット順の CRC 参照テーブル
+constexpr std::array<uint32_t, 256> makeCrcTable(uint32_t polynomial) {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? polynomial ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+constexpr uint32_t CRC32_POLYNOMIAL  = 0xEDB88320u; ///< IEEE 802.3
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78u; ///< Castagnoli
+
+constexpr std::array<uint32_t, 256> CRC32_TABLE  = makeCrcTable(CRC32_POLYNOMIAL);
+constexpr std::array<uint32_t, 256> CRC32C_TABLE = makeCrcTable(CRC32C_POLYNOMIAL);
+
+uint32_t crcTableUpdate(const std::array<uint32_t, 256>& table,
+                        uint32_t crc, const char* data, size_t size) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// =============================================================================
+// CPU 機能の検出
+// =============================================================================
+
+struct CpuFeatures {
+    bool sse42 = false; ///< CRC32 命令
+    bool sha   = false; ///< SHA-NI（SSSE3 / SSE4.1 と合わせて使う）
+};
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+#if defined(DOWNLOADER_CHECKSUM_X86)
+    unsigned int regs1[4] = {};
+    unsigned int regs7[4] = {};
+#  ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    const unsigned int maxLeaf = static_cast<unsigned int>(info[0]);
+    __cpuid(info, 1);
+    for (int i = 0; i < 4; ++i) regs1[i] = static_cast<unsigned int>(info[i]);
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        for (int i = 0; i < 4; ++i) regs7[i] = static_cast<unsigned int>(info[i]);
+    }
+#  else
+    const unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &regs1[0], &regs1[1], &regs1[2], &regs1[3]);
+    if (maxLeaf >= 7) {
+        __cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+    }
+#  endif
+    const bool ssse3 = (regs1[2] >> 9) & 1;
+    const bool sse41 = (regs1[2] >> 19) & 1;
+    features.sse42   = (regs1[2] >> 20) & 1;
+    features.sha     = ssse3 && sse41 && ((regs7[1] >> 29) & 1);
+#endif
+    return features;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+// =============================================================================
+// CRC-32C のハードウェア実装
+// =============================================================================
+
+#if defined(DOWNLOADER_CHECKSUM_X86)
+
+DOWNLOADER_TARGET("sse4.2")
+uint32_t crc32cSse42(uint32_t crc, const char* data, size_t size) {
+    uint32_t c = ~crc;
+    // 8 バイト境界まで 1 バイトずつ進めてから 8 バイト単位で計算する
+    while (size > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0) {
+        c = _mm_crc32_u8(c, static_cast<unsigned char>(*data++));
+        --size;
+    }
+    uint64_t c64 = c;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        c64 = _mm_crc32_u64(c64, word);
+    }
+    c = static_cast<uint32_t>(c64);
+    while (size-- > 0) {
+        c = _mm_crc32_u8(c, static_cast<unsigned char>(*data++));
+    }
+    return ~c;
+}
+
+#elif defined(DOWNLOADER_CHECKSUM_ARM_CRC)
+
+uint32_t crc32cArm(uint32_t crc, const char* data, size_t size) {
+    uint32_t c = ~crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        c = __crc32cd(c, word);
+    }
+    while (size-- > 0) {
+        c = __crc32cb(c, static_cast<uint8_t>(*data++));
+    }
+    return ~c;
+}
+
+#endif
+
+// =============================================================================
+// CRC-32C の連結（GF(2) 上の行列で sizeB バイト分のゼロを追加する）
+// =============================================================================
+
+uint32_t gf2MatrixTimes(const uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    for (; vector != 0; vector >>= 1, ++matrix) {
+        if (vector & 1) {
+            sum ^= *matrix;
+        }
+    }
+    return sum;
+}
+
+void gf2MatrixSquare(uint32_t* square, const uint32_t* matrix) {
+    for (int n = 0; n < 32; ++n) {
+        square[n] = gf2MatrixTimes(matrix, matrix[n]);
+    }
+}
+
+// =============================================================================
+// SHA-256
+// =============================================================================
+
+constexpr std::array<uint32_t, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+#if defined(DOWNLOADER_CHECKSUM_X86)
+
+/// SHA-NI による圧縮関数。状態は ABEF / CDGH の 2 レジスタに並べ替えて持つ
+DOWNLOADER_TARGET("sha,ssse3,sse4.1")
+void sha256CompressShaNi(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    __m128i tmp    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp            = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+    state1         = _mm_shuffle_epi32(state1, 0x1B);       // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);        // ABEF
+    state1         = _mm_blend_epi16(state1, tmp, 0xF0);     // CDGH
+
+    for (; count > 0; --count, blocks += 64) {
+        const __m128i saved0 = state0;
+        const __m128i saved1 = state1;
+        __m128i msgs[4];
+
+        // 4 ラウンドずつ 16 回。メッセージスケジュールは 4 レジスタを巡回させて計算する
+        for (int g = 0; g < 16; ++g) {
+            __m128i& w = msgs[g % 4];
+            if (g < 4) {
+                w = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * g)), byteSwap);
+            }
+            __m128i msg = _mm_add_epi32(
+                w, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SHA256_K[4 * g])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g <= 14) {
+                __m128i& next = msgs[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w, msgs[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, w);
+            }
+            msg    = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g >= 1 && g <= 12) {
+                msgs[(g + 3) % 4] = _mm_sha256msg1_epu32(msgs[(g + 3) % 4], w);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, saved0);
+        state1 = _mm_add_epi32(state1, saved1);
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);    // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    // ABEF → HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+#endif
+
+using Sha256Compress = void (*)(uint32_t*, const uint8_t*, size_t);
+
+Sha256Compress selectSha256Compress() {
+#if defined(DOWNLOADER_CHECKSUM_X86)
+    if (cpuFeatures().sha) {
+        return &sha256CompressShaNi;
+    }
+#endif
+    return &detail::sha256CompressPortable;
+}
+
+void sha256Compress(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    static const Sha256Compress compress = selectSha256Compress();
+    compress(state, blocks, count);
+}
+
+} // namespace
+
+// =============================================================================
+// CRC
+// =============================================================================
+
+uint32_t crc32Update(uint32_t crc, const char* data, size_t size) {
+    return crcTableUpdate(CRC32_TABLE, crc, data, size);
+}
+
+uint32_t detail::crc32cPortable(uint32_t crc, const char* data, size_t size) {
+    return crcTableUpdate(CRC32C_TABLE, crc, data, size);
+}
+
+uint32_t crc32cUpdate(uint32_t crc, const char* data, size_t size) {
+#if defined(DOWNLOADER_CHECKSUM_X86)
+    if (cpuFeatures().sse42) {
+        return crc32cSse42(crc, data, size);
+    }
+#elif defined(DOWNLOADER_CHECKSUM_ARM_CRC)
+    return crc32cArm(crc, data, size);
+#endif
+    return detail::crc32cPortable(crc, data, size);
+}
+
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, int64_t sizeB) {
+    if (sizeB <= 0) {
+        return crcA;
+    }
+
+    // odd: 1 ビット分のゼロを追加する演算子
+    uint32_t even[32];
+    uint32_t odd[32];
+    odd[0] = CRC32C_POLYNOMIAL;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = 1u << (n - 1);
+    }
+    gf2MatrixSquare(even, odd); // 2 ビット
+    gf2MatrixSquare(odd, even); // 4 ビット
+
+    // 1 バイト（8 ビット）の演算子から始めて、sizeB の各ビットに応じて適用する
+    do {
+        gf2MatrixSquare(even, odd);
+        if (sizeB & 1) {
+            crcA = gf2MatrixTimes(even, crcA);
+        }
+        sizeB >>= 1;
+        if (sizeB == 0) {
+            break;
+        }
+        gf2MatrixSquare(odd, even);
+        if (sizeB & 1) {
+            crcA = gf2MatrixTimes(odd, crcA);
+        }
+        sizeB >>= 1;
+    } while (sizeB != 0);
+
+    return crcA ^ crcB;
+}
+
+bool crc32cAccelerated() {
+#if defined(DOWNLOADER_CHECKSUM_ARM_CRC)
+    return true;
+#else
+    return cpuFeatures().sse42;
+#endif
+}
+
+bool sha256Accelerated() {
+    return cpuFeatures().sha;
+}
+
+std::string crc32cHex(uint32_t crc) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string hex(8, '0');
+    for (int i = 7; i >= 0; --i, crc >>= 4) {
+        hex[static_cast<size_t>(i)] = DIGITS[crc & 0xF];
+    }
+    return hex;
+}
+
+// =============================================================================
+// SHA-256
+// =============================================================================
+
+void detail::sha256CompressPortable(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    for (; count > 0; --count, blocks += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t{blocks[4 * i]} << 24) | (uint32_t{blocks[4 * i + 1]} << 16) |
+                   (uint32_t{blocks[4 * i + 2]} << 8) | uint32_t{blocks[4 * i + 3]};
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t s1  = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            const uint32_t ch  = (e & f) ^ (~e & g);
+            const uint32_t t1  = h + s1 + ch + SHA256_K[static_cast<size_t>(i)] + w[i];
+            const uint32_t s0  = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            const uint32_t t2  = s0 + maj;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+void Sha256::reset() {
+    state_      = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    blockSize_  = 0;
+    totalBytes_ = 0;
+}
+
+void Sha256::update(const char* data, size_t size) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+    totalBytes_ += size;
+
+    // 前回の残りがあれば 1 ブロックに満たしてから処理する
+    if (blockSize_ > 0) {
+        const size_t take = std::min(size, block_.size() - blockSize_);
+        std::memcpy(block_.data() + blockSize_, bytes, take);
+        blockSize_ += take;
+        bytes      += take;
+        size       -= take;
+        if (blockSize_ < block_.size()) {
+            return;
+        }
+        sha256Compress(state_.data(), block_.data(), 1);
+        blockSize_ = 0;
+    }
+
+    // 揃ったブロックは受信データから直接計算する
+    const size_t blocks = size / 64;
+    if (blocks > 0) {
+        sha256Compress(state_.data(), bytes, blocks);
+        bytes += blocks * 64;
+        size  -= blocks * 64;
+    }
+    std::memcpy(block_.data(), bytes, size);
+    blockSize_ = size;
+}
+
+Sha256::Digest Sha256::finish() {
+    // 0x80 とゼロで埋め、最後の 8 バイトにビット長（ビッグエンディアン）を置く
+    const uint64_t bits = totalBytes_ * 8;
+    block_[blockSize_++] = 0x80;
+    if (blockSize_ > 56) {
+        std::memset(block_.data() + blockSize_, 0, block_.size() - blockSize_);
+        sha256Compress(state_.data(), block_.data(), 1);
+        blockSize_ = 0;
+    }
+    std::memset(block_.data() + blockSize_, 0, 56 - blockSize_);
+    for (int i = 0; i < 8; ++i) {
+        block_[56 + static_cast<size_t>(i)] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+    sha256Compress(state_.data(), block_.data(), 1);
+    blockSize_ = 0;
+
+    Digest digest{};
+    for (size_t i = 0; i < state_.size(); ++i) {
+        digest[4 * i]     = static_cast<uint8_t>(state_[i] >> 24);
+        digest[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+// =============================================================================
+// StreamingChecksum
+// =============================================================================
+
+void StreamingChecksum::update(const char* data, size_t size) {
+    switch (algorithm_) {
+    case ChecksumAlgorithm::CRC32C:
+        crc_ = crc32cUpdate(crc_, data, size);
+        break;
+    case ChecksumAlgorithm::SHA256:
+        sha_.update(data, size);
+        break;
+    case ChecksumAlgorithm::NONE:
+        break;
+    }
+}
+
+std::string StreamingChecksum::hexDigest() {
+    switch (algorithm_) {
+    case ChecksumAlgorithm::CRC32C:
+        return crc32cHex(crc_);
+    case ChecksumAlgorithm::SHA256: {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        const Sha256::Digest digest = sha_.finish();
+        std::string hex;
+        hex.reserve(digest.size() * 2);
+        for (const uint8_t byte : digest) {
+            hex.push_back(DIGITS[byte >> 4]);
+            hex.push_back(DIGITS[byte & 0xF]);
+        }
+        return hex;
+    }
+    case ChecksumAlgorithm::NONE:
+        break;
+    }
+    return {};
+}
+
+} // namespace Downloader
@@ -0,0 +1,362 @@
+// =============================================================================
+// ContentDecoder.cpp
+// Content-Encoding 展開の実装（zlib / brotli / zstd）
+//
+// 設計方針:
+//  - 各ライブラリはビルド時に見つかった場合だけ有効にする
+//    (DOWNLOADER_HAVE_ZLIB / DOWNLOADER_HAVE_BROTLI / DOWNLOADER_HAVE_ZSTD)
+//  - deflate は zlib 形式が正しいが、ヘッダーのない raw deflate を返すサーバもあるため、
+//    先頭 2 バイトが zlib ヘッダーとして読めなければ raw deflate として読む
+//  - gzip は複数のメンバーを連結したストリームも受け付ける
+// =============================================================================
+
+#include "ContentDecoder.h"
+
+#include <cctype>
+
+#ifdef DOWNLOADER_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#ifdef DOWNLOADER_HAVE_BROTLI
+#  include <brotli/decode.h>
+#endif
+#ifdef DOWNLOADER_HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+namespace Downloader {
+
+namespace {
+
+/// 前後の空白を除いて小文字にする
+std::string normalizeEncoding(std::string_view encoding) {
+    while (!encoding.empty() && std::isspace(static_cast<unsigned char>(encoding.front()))) {
+        encoding.remove_prefix(1);
+    }
+    while (!encoding.empty() && std::isspace(static_cast<unsigned char>(encoding.back()))) {
+        encoding.remove_suffix(1);
+    }
+    std::string normalized(encoding);
+    for (auto& c : normalized) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return normalized;
+}
+
+#ifdef DOWNLOADER_HAVE_ZLIB
+
+// =============================================================================
+// gzip / deflate (zlib)
+// =============================================================================
+
+class ZlibDecoder final : public ContentDecoder {
+public:
+    ZlibDecoder(bool gzip, Output output)
+        : ContentDecoder(std::move(output)), gzip_(gzip) {
+        init(gzip ? 15 + 16 : 15);
+    }
+
+    ~ZlibDecoder() override {
+        inflateEnd(&stream_);
+    }
+
+    bool decode(const char* data, size_t size) override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        started_ = true;
+        if (!gzip_ && !formatKnown_) {
+            // 先頭 2 バイトが zlib ヘッダーでなければ raw deflate として読む
+            while (head_.size() < 2 && size > 0) {
+                head_.push_back(*data++);
+                --size;
+            }
+            if (head_.size() < 2) {
+                return true;
+            }
+            formatKnown_ = true;
+            const unsigned cmf = static_cast<unsigned char>(head_[0]);
+            const unsigned flg = static_cast<unsigned char>(head_[1]);
+            if ((cmf & 0x0F) != Z_DEFLATED || ((cmf << 8) | flg) % 31 != 0) {
+                inflateEnd(&stream_);
+                init(-15);
+            }
+            if (!inflateInput(head_.data(), head_.size())) {
+                return false;
+            }
+        }
+        return inflateInput(data, size);
+    }
+
+    bool finish() override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        // 空のボディは展開するものがないので正常とみなす
+        if (!ended_ && started_) {
+            return fail("Compressed stream ended unexpectedly");
+        }
+        return true;
+    }
+
+private:
+    bool inflateInput(const char* data, size_t size) {
+        stream_.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream_.avail_in = static_cast<uInt>(size);
+        while (stream_.avail_in > 0) {
+            if (ended_) {
+                // gzip はメンバーの連結を許す。それ以外で続きがあれば壊れている
+                if (!gzip_) {
+                    return fail("Unexpected data after the end of the deflate stream");
+                }
+                inflateReset(&stream_);
+                ended_ = false;
+            }
+            // 作業領域が満杯のうちは zlib 内部に未出力のデータが残っている
+            int ret = Z_OK;
+            do {
+                stream_.next_out  = reinterpret_cast<Bytef*>(buffer_.data());
+                stream_.avail_out = static_cast<uInt>(buffer_.size());
+                ret = inflate(&stream_, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                    return fail(std::string("inflate failed: ") +
+                                (stream_.msg ? stream_.msg : std::to_string(ret)));
+                }
+                const size_t produced = buffer_.size() - stream_.avail_out;
+                if (produced > 0 && !emit(buffer_.data(), produced)) {
+                    return false;
+                }
+            } while (ret != Z_STREAM_END && stream_.avail_out == 0);
+
+            if (ret == Z_STREAM_END) {
+                ended_ = true;
+            } else if (ret == Z_BUF_ERROR) {
+                break; // これ以上進められない（入力を使い切った）
+            }
+        }
+        return true;
+    }
+
+    void init(int windowBits) {
+        stream_ = {};
+        if (inflateInit2(&stream_, windowBits) != Z_OK) {
+            lastError_ = "inflateInit2 failed";
+        }
+    }
+
+    z_stream    stream_{};
+    bool        gzip_        = false;
+    bool        formatKnown_ = false; ///< deflate: zlib 形式か raw deflate かを判定済み
+    std::string head_;                ///< deflate: 判定に使う先頭 2 バイト
+    bool        ended_       = false; ///< ストリーム（gzip メンバー）の終わりに達した
+    bool        started_     = false; ///< 入力を受け取った
+};
+
+#endif
+
+#ifdef DOWNLOADER_HAVE_BROTLI
+
+// =============================================================================
+// br (brotli)
+// =============================================================================
+
+class BrotliDecoder final : public ContentDecoder {
+public:
+    explicit BrotliDecoder(Output output)
+        : ContentDecoder(std::move(output))
+        , state_(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)) {
+        if (!state_) {
+            lastError_ = "BrotliDecoderCreateInstance failed";
+        }
+    }
+
+    ~BrotliDecoder() override {
+        if (state_) {
+            BrotliDecoderDestroyInstance(state_);
+        }
+    }
+
+    bool decode(const char* data, size_t size) override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        started_ = started_ || size > 0;
+        auto*  in       = reinterpret_cast<const uint8_t*>(data);
+        size_t inLeft   = size;
+        for (;;) {
+            auto*  out     = reinterpret_cast<uint8_t*>(buffer_.data());
+            size_t outLeft = buffer_.size();
+            const BrotliDecoderResult result =
+                BrotliDecoderDecompressStream(state_, &inLeft, &in, &outLeft, &out, nullptr);
+            if (result == BROTLI_DECODER_RESULT_ERROR) {
+                return fail(std::string("Brotli decoding failed: ") +
+                            BrotliDecoderErrorString(BrotliDecoderGetErrorCode(state_)));
+            }
+            const size_t produced = buffer_.size() - outLeft;
+            if (produced > 0 && !emit(buffer_.data(), produced)) {
+                return false;
+            }
+            if (result == BROTLI_DECODER_RESULT_SUCCESS) {
+                if (inLeft > 0) {
+                    return fail("Unexpected data after the end of the brotli stream");
+                }
+                return true;
+            }
+            if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+                return true;
+            }
+            // NEEDS_MORE_OUTPUT: 作業領域を空けて続ける
+        }
+    }
+
+    bool finish() override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        if (started_ && !BrotliDecoderIsFinished(state_)) {
+            return fail("Compressed stream ended unexpectedly");
+        }
+        return true;
+    }
+
+private:
+    BrotliDecoderState* state_   = nullptr;
+    bool                started_ = false;
+};
+
+#endif
+
+#ifdef DOWNLOADER_HAVE_ZSTD
+
+// =============================================================================
+// zstd
+// =============================================================================
+
+class ZstdDecoder final : public ContentDecoder {
+public:
+    explicit ZstdDecoder(Output output)
+        : ContentDecoder(std::move(output)), stream_(ZSTD_createDStream()) {
+        if (!stream_ || ZSTD_isError(ZSTD_initDStream(stream_))) {
+            lastError_ = "ZSTD_initDStream failed";
+        }
+    }
+
+    ~ZstdDecoder() override {
+        ZSTD_freeDStream(stream_);
+    }
+
+    bool decode(const char* data, size_t size) override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        started_ = started_ || size > 0;
+        ZSTD_inBuffer in{data, size, 0};
+        // 入力を使い切り、かつ作業領域が満杯でなくなるまで（内部に残りがない）続ける
+        for (;;) {
+            ZSTD_outBuffer out{buffer_.data(), buffer_.size(), 0};
+            const size_t ret = ZSTD_decompressStream(stream_, &out, &in);
+            if (ZSTD_isError(ret)) {
+                return fail(std::string("zstd decoding failed: ") + ZSTD_getErrorName(ret));
+            }
+            if (out.pos > 0 && !emit(buffer_.data(), out.pos)) {
+                return false;
+            }
+            frameEnded_ = ret == 0;
+            if (in.pos == in.size && out.pos < out.size) {
+                return true;
+            }
+        }
+    }
+
+    bool finish() override {
+        if (!lastError_.empty()) {
+            return false;
+        }
+        if (started_ && !frameEnded_) {
+            return fail("Compressed stream ended unexpectedly");
+        }
+        return true;
+    }
+
+private:
+    ZSTD_DStream* stream_     = nullptr;
+    bool          started_    = false;
+    bool          frameEnded_ = false; ///< 直前の呼び出しでフレームが完結した
+};
+
+#endif
+
+} // namespace
+
+// =============================================================================
+// ContentDecoder
+// =============================================================================
+
+std::string ContentDecoder::supportedEncodings() {
+    std::string encodings;
+    const auto add = [&encodings](const char* name) {
+        if (!encodings.empty()) encodings += ", ";
+        encodings += name;
+    };
+#ifdef DOWNLOADER_HAVE_ZLIB
+    add("gzip");
+    add("deflate");
+#endif
+#ifdef DOWNLOADER_HAVE_BROTLI
+    add("br");
+#endif
+#ifdef DOWNLOADER_HAVE_ZSTD
+    add("zstd");
+#endif
+    (void)add;
+    return encodings;
+}
+
+bool ContentDecoder::isIdentity(std::string_view contentEncoding) {
+    const std::string encoding = normalizeEncoding(contentEncoding);
+    return encoding.empty() || encoding == "identity";
+}
+
+std::unique_ptr<ContentDecoder> ContentDecoder::create(std::string_view contentEncoding,
+                                                       Output output) {
+    const std::string encoding = normalizeEncoding(contentEncoding);
+#ifdef DOWNLOADER_HAVE_ZLIB
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        return std::make_unique<ZlibDecoder>(true, std::move(output));
+    }
+    if (encoding == "deflate") {
+        return std::make_unique<ZlibDecoder>(false, std::move(output));
+    }
+#endif
+#ifdef DOWNLOADER_HAVE_BROTLI
+    if (encoding == "br") {
+        return std::make_unique<BrotliDecoder>(std::move(output));
+    }
+#endif
+#ifdef DOWNLOADER_HAVE_ZSTD
+    if (encoding == "zstd") {
+        return std::make_unique<ZstdDecoder>(std::move(output));
+    }
+#endif
+    (void)output;
+    return nullptr;
+}
+
+bool ContentDecoder::emit(const char* data, size_t size) {
+    if (!output_(data, size)) {
+        return fail("Failed to write decoded data");
+    }
+    return true;
+}
+
+bool ContentDecoder::fail(std::string message) {
+    if (lastError_.empty()) {
+        lastError_ = std::move(message);
+    }
+    return false;
+}
+
+} // namespace Downloader
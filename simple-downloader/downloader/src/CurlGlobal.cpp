@@ -0,0 +1,78 @@
+// =============================================================================
+// CurlGlobal.cpp
+// libcurl のグローバル初期化の実装
+//
+// 設計方針:
+//  - 初期化は ensureInitialized() の中の static オブジェクトが行う。最初に curl を使う
+//    オブジェクト（CurlHandlePool::shared() など）より先に構築が終わるため、
+//    プロセス終了時の後始末はそれらの破棄より後になる
+//  - configure() と初回の初期化は mutex で順序を決める（初期化が先なら configure は失敗する）
+// =============================================================================
+
+#include "CurlGlobal.h"
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace Downloader {
+
+namespace {
+
+std::mutex        g_mutex;
+long              g_flags = CURL_GLOBAL_DEFAULT; ///< g_mutex で保護
+std::atomic<bool> g_started{false};
+
+/// 初期化に使うフラグを確定する（以降の configure() は失敗する）
+long takeFlags() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_started.store(true, std::memory_order_release);
+    return g_flags;
+}
+
+/// curl のグローバル状態を RAII で管理する
+class GlobalState {
+public:
+    explicit GlobalState(long flags) : result_(curl_global_init(flags)) {}
+    ~GlobalState() {
+        if (result_ == CURLE_OK) {
+            curl_global_cleanup();
+        }
+    }
+
+    GlobalState(const GlobalState&)            = delete;
+    GlobalState& operator=(const GlobalState&) = delete;
+
+    bool ok() const { return result_ == CURLE_OK; }
+
+private:
+    CURLcode result_;
+};
+
+} // namespace
+
+bool CurlGlobal::configure(Features features) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_started.load(std::memory_order_acquire)) {
+        return false;
+    }
+#ifdef _WIN32
+    g_flags = features == Features::ALL ? CURL_GLOBAL_DEFAULT : CURL_GLOBAL_WIN32;
+#else
+    g_flags = features == Features::ALL ? CURL_GLOBAL_DEFAULT : CURL_GLOBAL_NOTHING;
+#endif
+    return true;
+}
+
+bool CurlGlobal::ensureInitialized() {
+    // 関数内 static の初期化はスレッドセーフで、2 回目以降はガードの確認だけになる
+    static const GlobalState state(takeFlags());
+    return state.ok();
+}
+
+bool CurlGlobal::isInitialized() {
+    return g_started.load(std::memory_order_acquire);
+}
+
+} // namespace Downloader
@@ -4,35 +4,100 @@
 // =============================================================================
 
 #include "CurlHandle.h"
+#include "CurlGlobal.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
 
+#ifndef _WIN32
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#endif
+
 namespace Downloader {
 
+static_assert(ICurlHandle::WRITE_PAUSE == CURL_WRITEFUNC_PAUSE,
+              "WRITE_PAUSE must match CURL_WRITEFUNC_PAUSE");
+
+namespace {
+
+#ifdef _WIN32
+using SockLen = int;
+#else
+using SockLen = socklen_t;
+#endif
+
+/// SO_RCVBUF を bytes まで広げる（現在の値以上なら何もしない）
+/// Linux は自動調整した値を返し、それより小さい値に固定すると自動調整が止まるため縮めない
+void growReceiveBuffer(curl_socket_t fd, int bytes) {
+    int     current = 0;
+    SockLen length  = sizeof(current);
+    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF,
+                   reinterpret_cast<char*>(&current), &length) == 0 &&
+        current >= bytes) {
+        return;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
+               reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+}
+
+} // namespace
+
 // -----------------------------------------------------------------------------
 // コンストラクタ / デストラクタ
 // -----------------------------------------------------------------------------
 
 CurlHandle::CurlHandle() {
+    if (!CurlGlobal::ensureInitialized()) {
+        throw std::runtime_error("curl_global_init() failed");
+    }
     handle_ = curl_easy_init();
     if (!handle_) {
         throw std::runtime_error("curl_easy_init() failed");
     }
+    applyCommonOptions(handle_);
+    applyDefaults();
+}
 
-    // エラーバッファを curl に登録（詳細なエラーメッセージを取得するため）
-    curl_easy_setopt(handle_, CURLOPT_ERRORBUFFER, errorBuffer_);
-
-    // デフォルト設定
-    // 進捗コールバックを有効化するために必要
-    curl_easy_setopt(handle_, CURLOPT_NOPROGRESS, 0L);
+CurlHandle::CurlHandle(CURL* handle, Releaser releaser)
+    : handle_(handle)
+    , releaser_(std::move(releaser)) {
+    if (!handle_) {
+        throw std::invalid_argument("CurlHandle: handle must not be null");
+    }
+    applyDefaults();
 }
 
 CurlHandle::~CurlHandle() {
     if (handle_) {
-        curl_easy_cleanup(handle_);
+        if (releaser_) {
+            // 所有権を返却先に渡す（コールバックは返却先でリセットされる）
+            releaser_(handle_);
+        } else {
+            curl_easy_cleanup(handle_);
+        }
         handle_ = nullptr;
     }
+    // 返却先で curl_easy_reset された後に解放する
+    curl_slist_free_all(requestHeaders_);
+    curl_slist_free_all(resolveOverrides_);
+}
+
+void CurlHandle::applyCommonOptions(CURL* handle) {
+    // 進捗コールバックを有効化するために必要
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+
+    // この転送が張った接続のソケットを覚える（CURLINFO_ACTIVESOCKET は転送中に使えない）
+    // 引数 (CURLOPT_SOCKOPTDATA) はインスタンスごとに applyDefaults() で設定する
+    curl_easy_setopt(handle, CURLOPT_SOCKOPTFUNCTION, &CurlHandle::curlSockoptCallback);
+}
+
+void CurlHandle::applyDefaults() {
+    // エラーバッファを curl に登録（詳細なエラーメッセージを取得するため）
+    curl_easy_setopt(handle_, CURLOPT_ERRORBUFFER, errorBuffer_);
+    curl_easy_setopt(handle_, CURLOPT_SOCKOPTDATA, this);
 }
 
 // -----------------------------------------------------------------------------
@@ -40,6 +105,7 @@ CurlHandle::~CurlHandle() {
 // -----------------------------------------------------------------------------
 
 void CurlHandle::setUrl(const std::string& url) {
+    url_ = url;
     curl_easy_setopt(handle_, CURLOPT_URL, url.c_str());
 }
 
@@ -49,11 +115,111 @@ void CurlHandle::setResumeFrom(int64_t startByte) {
                      static_cast<curl_off_t>(startByte));
 }
 
+void CurlHandle::setRange(int64_t first, int64_t last) {
+    // "first-last" 形式の文字列は curl 内部でコピーされる
+    const std::string range = std::to_string(first) + "-" + std::to_string(last);
+    curl_easy_setopt(handle_, CURLOPT_RANGE, range.c_str());
+}
+
+void CurlHandle::setRequestHeaders(const std::vector<std::string>& headers) {
+    // curl はリストをコピーしないため、差し替えるまで（破棄まで）保持する
+    curl_slist* list = nullptr;
+    for (const auto& header : headers) {
+        list = curl_slist_append(list, header.c_str());
+    }
+    curl_easy_setopt(handle_, CURLOPT_HTTPHEADER, list);
+    curl_slist_free_all(requestHeaders_);
+    requestHeaders_ = list;
+}
+
+void CurlHandle::setAcceptEncoding(const std::string& encodings, bool decode) {
+    // 空文字列を渡すと curl は自身が展開できる方式をすべて送る
+    curl_easy_setopt(handle_, CURLOPT_ACCEPT_ENCODING, encodings.c_str());
+    curl_easy_setopt(handle_, CURLOPT_HTTP_CONTENT_DECODING, decode ? 1L : 0L);
+}
+
+void CurlHandle::setNoBody(bool noBody) {
+    curl_easy_setopt(handle_, CURLOPT_NOBODY, noBody ? 1L : 0L);
+}
+
+void CurlHandle::setBufferSize(size_t bytes) {
+    // curl が受け付ける範囲に収める（範囲外の値は設定自体が無視される）
+    const size_t clamped = std::clamp<size_t>(bytes, 1024, CURL_MAX_READ_SIZE);
+    curl_easy_setopt(handle_, CURLOPT_BUFFERSIZE, static_cast<long>(clamped));
+}
+
+void CurlHandle::setTcpNoDelay(bool enable) {
+    curl_easy_setopt(handle_, CURLOPT_TCP_NODELAY, enable ? 1L : 0L);
+}
+
+void CurlHandle::setTcpKeepAlive(bool enable, long idleSec, long intervalSec) {
+    curl_easy_setopt(handle_, CURLOPT_TCP_KEEPALIVE, enable ? 1L : 0L);
+    if (enable) {
+        curl_easy_setopt(handle_, CURLOPT_TCP_KEEPIDLE, idleSec);
+        curl_easy_setopt(handle_, CURLOPT_TCP_KEEPINTVL, intervalSec);
+    }
+}
+
+void CurlHandle::setReceiveBufferSize(int bytes) {
+    receiveBufferSize_ = bytes;
+    // 転送中の接続にもその場で反映する（共有した接続を再利用した場合はソケットが分からない）
+    if (inCallback_ && bytes > 0 && socket_ != CURL_SOCKET_BAD) {
+        growReceiveBuffer(socket_, bytes);
+    }
+}
+
 void CurlHandle::enableHttp2() {
     // HTTP/2 を優先的に使用（サーバが対応していない場合は HTTP/1.1 にフォールバック）
     curl_easy_setopt(handle_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
 }
 
+bool CurlHandle::enableHttp3() {
+    // HTTP/3 は curl を対応する QUIC ライブラリとビルドした場合だけ使える
+    if (!(curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP3)) {
+        return false;
+    }
+    // 7.88 以降の CURL_HTTP_VERSION_3 は、QUIC で接続できなければ HTTP/2・HTTP/1.1 に戻る
+    curl_easy_setopt(handle_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_3);
+    return true;
+}
+
+void CurlHandle::setMultiplexing(bool enable) {
+    multiplexing_ = enable;
+    curl_easy_setopt(handle_, CURLOPT_PIPEWAIT, enable ? 1L : 0L);
+    if (!enable) {
+        curl_easy_setopt(handle_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+}
+
+void CurlHandle::setResolveOverrides(const std::vector<std::string>& entries) {
+    // setRequestHeaders と同じく、curl はリストをコピーしない
+    curl_slist* list = nullptr;
+    for (const auto& entry : entries) {
+        list = curl_slist_append(list, entry.c_str());
+    }
+    curl_easy_setopt(handle_, CURLOPT_RESOLVE, list);
+    curl_slist_free_all(resolveOverrides_);
+    resolveOverrides_ = list;
+}
+
+void CurlHandle::setHappyEyeballsTimeout(long ms) {
+    curl_easy_setopt(handle_, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS,
+                     ms > 0 ? ms : static_cast<long>(CURL_HET_DEFAULT));
+}
+
+void CurlHandle::setTcpFastOpen(bool enable) {
+    curl_easy_setopt(handle_, CURLOPT_TCP_FASTOPEN, enable ? 1L : 0L);
+}
+
+void CurlHandle::setTlsEarlyData(bool enable) {
+#ifdef CURLSSLOPT_EARLYDATA
+    // 他の CURLSSLOPT_* は使っていないため、このビットだけを設定する
+    curl_easy_setopt(handle_, CURLOPT_SSL_OPTIONS, enable ? static_cast<long>(CURLSSLOPT_EARLYDATA) : 0L);
+#else
+    (void)enable; // curl 8.11 より前は 0-RTT に対応していない
+#endif
+}
+
 void CurlHandle::setWriteCallback(WriteCallback cb) {
     writeCallback_ = std::move(cb);
     curl_easy_setopt(handle_, CURLOPT_WRITEFUNCTION,
@@ -68,6 +234,23 @@ void CurlHandle::setProgressCallback(ProgressCallback cb) {
     curl_easy_setopt(handle_, CURLOPT_XFERINFODATA, this);
 }
 
+void CurlHandle::setHeaderCallback(HeaderCallback cb) {
+    headerCallback_ = std::move(cb);
+    curl_easy_setopt(handle_, CURLOPT_HEADERFUNCTION,
+                     &CurlHandle::curlHeaderCallback);
+    curl_easy_setopt(handle_, CURLOPT_HEADERDATA, this);
+}
+
+void CurlHandle::setReceiver(Receiver* receiver) {
+    receiver_ = receiver;
+    curl_easy_setopt(handle_, CURLOPT_WRITEFUNCTION, &CurlHandle::curlWriteCallback);
+    curl_easy_setopt(handle_, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(handle_, CURLOPT_XFERINFOFUNCTION, &CurlHandle::curlProgressCallback);
+    curl_easy_setopt(handle_, CURLOPT_XFERINFODATA, this);
+    curl_easy_setopt(handle_, CURLOPT_HEADERFUNCTION, &CurlHandle::curlHeaderCallback);
+    curl_easy_setopt(handle_, CURLOPT_HEADERDATA, this);
+}
+
 void CurlHandle::setConnectTimeout(long seconds) {
     curl_easy_setopt(handle_, CURLOPT_CONNECTTIMEOUT, seconds);
 }
@@ -90,8 +273,20 @@ void CurlHandle::setSslVerify(bool verify) {
 // -----------------------------------------------------------------------------
 
 CurlResult CurlHandle::perform() {
-    errorBuffer_[0] = '\0'; // エラーバッファをクリア
+    beginTransfer();
     CURLcode code = curl_easy_perform(handle_);
+    return finishTransfer(code);
+}
+
+void CurlHandle::unpause() {
+    curl_easy_pause(handle_, CURLPAUSE_CONT);
+}
+
+void CurlHandle::beginTransfer() {
+    errorBuffer_[0] = '\0'; // エラーバッファをクリア
+}
+
+CurlResult CurlHandle::finishTransfer(CURLcode code) const {
     return toCurlResult(code);
 }
 
@@ -101,6 +296,65 @@ long CurlHandle::getHttpResponseCode() const {
     return httpCode;
 }
 
+int64_t CurlHandle::getContentLength() const {
+    curl_off_t length = -1;
+    if (curl_easy_getinfo(handle_, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &length) != CURLE_OK) {
+        return -1;
+    }
+    return static_cast<int64_t>(length);
+}
+
+int64_t CurlHandle::getRoundTripTimeUs() const {
+#ifdef __linux__
+    // カーネルが平滑化した RTT を使う（接続時間と違い、転送中の変化にも追従する）
+    if (inCallback_ && socket_ != CURL_SOCKET_BAD) {
+        tcp_info  info{};
+        socklen_t length = sizeof(info);
+        if (getsockopt(socket_, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 && info.tcpi_rtt > 0) {
+            return static_cast<int64_t>(info.tcpi_rtt);
+        }
+    }
+#endif
+    // TCP のハンドシェイクは 1 往復なので、接続にかかった時間で近似する
+    curl_off_t connect = 0;
+    curl_off_t lookup  = 0;
+    if (curl_easy_getinfo(handle_, CURLINFO_CONNECT_TIME_T, &connect) != CURLE_OK ||
+        curl_easy_getinfo(handle_, CURLINFO_NAMELOOKUP_TIME_T, &lookup) != CURLE_OK ||
+        connect <= lookup) {
+        return -1; // 再利用した接続・接続前
+    }
+    return static_cast<int64_t>(connect - lookup);
+}
+
+PhaseTimings CurlHandle::getTimings() const {
+    // curl の時刻はすべて転送の開始からの累計なので、前の段階との差を取る
+    const auto elapsed = [this](CURLINFO info) -> int64_t {
+        curl_off_t value = -1;
+        if (curl_easy_getinfo(handle_, info, &value) != CURLE_OK) {
+            return -1;
+        }
+        return static_cast<int64_t>(value);
+    };
+    const int64_t lookup     = elapsed(CURLINFO_NAMELOOKUP_TIME_T);
+    const int64_t connect    = elapsed(CURLINFO_CONNECT_TIME_T);
+    const int64_t appConnect = elapsed(CURLINFO_APPCONNECT_TIME_T);
+    const int64_t firstByte  = elapsed(CURLINFO_STARTTRANSFER_TIME_T);
+    const int64_t total      = elapsed(CURLINFO_TOTAL_TIME_T);
+
+    PhaseTimings timings;
+    timings.dnsUs     = lookup;
+    // 再利用した接続は CONNECT が 0 のまま（名前解決の時間だけが入ることがある）
+    timings.connectUs = connect >= 0 && lookup >= 0 ? std::max<int64_t>(connect - lookup, 0) : -1;
+    // APPCONNECT は TLS を使わない・再利用した接続では 0
+    timings.tlsUs     = appConnect > connect ? appConnect - connect : (appConnect >= 0 ? 0 : -1);
+    if (firstByte > 0) {
+        timings.firstByteUs = firstByte;
+        timings.transferUs  = total >= firstByte ? total - firstByte : -1;
+    }
+    return timings;
+}
+
 std::string CurlHandle::getLastError() const {
     if (errorBuffer_[0] != '\0') {
         return std::string(errorBuffer_);
@@ -115,23 +369,56 @@ std::string CurlHandle::getLastError() const {
 size_t CurlHandle::curlWriteCallback(char* ptr, size_t size,
                                       size_t nmemb, void* userdata) {
     auto* self = static_cast<CurlHandle*>(userdata);
-    if (!self || !self->writeCallback_) {
+    if (!self || (!self->receiver_ && !self->writeCallback_)) {
         return 0; // 0 を返すと curl がエラーとして中断する
     }
     const size_t totalBytes = size * nmemb;
-    return self->writeCallback_(ptr, totalBytes);
+    self->inCallback_ = true;
+    const size_t written = self->receiver_ ? self->receiver_->onWrite(ptr, totalBytes)
+                                           : self->writeCallback_(ptr, totalBytes);
+    self->inCallback_ = false;
+    return written;
 }
 
 int CurlHandle::curlProgressCallback(void* clientp,
                                       curl_off_t dltotal, curl_off_t dlnow,
                                       curl_off_t /*ultotal*/, curl_off_t /*ulnow*/) {
     auto* self = static_cast<CurlHandle*>(clientp);
-    if (!self || !self->progressCallback_) {
+    if (!self || (!self->receiver_ && !self->progressCallback_)) {
         return 0; // 継続
     }
-    return self->progressCallback_(
-        static_cast<int64_t>(dltotal),
-        static_cast<int64_t>(dlnow));
+    self->inCallback_ = true;
+    const int result = self->receiver_
+        ? self->receiver_->onProgress(static_cast<int64_t>(dltotal), static_cast<int64_t>(dlnow))
+        : self->progressCallback_(static_cast<int64_t>(dltotal), static_cast<int64_t>(dlnow));
+    self->inCallback_ = false;
+    return result;
+}
+
+int CurlHandle::curlSockoptCallback(void* clientp, curl_socket_t fd,
+                                    curlsocktype purpose) {
+    auto* self = static_cast<CurlHandle*>(clientp);
+    if (!self || purpose != CURLSOCKTYPE_IPCXN) {
+        return CURL_SOCKOPT_OK;
+    }
+    self->socket_ = fd;
+    // 受信ウィンドウのスケールは接続時に決まるため、connect の前に広げておく
+    if (self->receiveBufferSize_ > 0) {
+        growReceiveBuffer(fd, self->receiveBufferSize_);
+    }
+    return CURL_SOCKOPT_OK;
+}
+
+size_t CurlHandle::curlHeaderCallback(char* buffer, size_t size,
+                                       size_t nitems, void* userdata) {
+    auto* self = static_cast<CurlHandle*>(userdata);
+    const size_t totalBytes = size * nitems;
+    if (self && self->receiver_) {
+        self->receiver_->onHeader(buffer, totalBytes);
+    } else if (self && self->headerCallback_) {
+        self->headerCallback_(buffer, totalBytes);
+    }
+    return totalBytes; // ヘッダーは常に全量を受理する
 }
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,202 @@
+// =============================================================================
+// CurlHandlePool.cpp
+// CurlHandle プールと CURLSH 共有オブジェクトの実装
+//
+// 設計方針:
+//  - 状態 (State) は shared_ptr で共有し、返却処理が State を生存させる
+//  - CURLSH のロックは curl_lock_data ごとに mutex を分けて競合を減らす
+//  - 返却時に curl_easy_reset してコールバック（返却済み CurlHandle を
+//    指すポインタ）を確実に外してから保持する
+//  - 共通の設定 (prepare) は返却時とテンプレートの生成時に済ませ、貸し出しは
+//    未使用ハンドルの取り出しか curl_easy_duphandle だけにする
+// =============================================================================
+
+#include "CurlHandlePool.h"
+#include "CurlGlobal.h"
+#include "CurlHandle.h"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Downloader {
+
+// =============================================================================
+// State: プールの共有状態
+// =============================================================================
+
+struct CurlHandlePool::State {
+    explicit State(size_t maxIdleHandles)
+        : maxIdle(maxIdleHandles) {
+        if (!CurlGlobal::ensureInitialized()) {
+            throw std::runtime_error("curl_global_init() failed");
+        }
+        share = curl_share_init();
+        if (!share) {
+            throw std::runtime_error("curl_share_init() failed");
+        }
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &State::lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &State::unlock);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+        templateHandle = curl_easy_init();
+        if (!templateHandle) {
+            curl_share_cleanup(share);
+            throw std::runtime_error("curl_easy_init() failed");
+        }
+        // curl_easy_duphandle は CURLSH の参照数を数えないため、共有は複製した後に設定する
+        CurlHandle::applyCommonOptions(templateHandle);
+    }
+
+    ~State() {
+        for (CURL* easy : idle) {
+            curl_easy_cleanup(easy);
+        }
+        curl_easy_cleanup(templateHandle);
+        // 全 easy ハンドルが解放済みなので CURLSHE_IN_USE にはならない
+        curl_share_cleanup(share);
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    /// ハンドルに共通の設定を行う（CURLSH の共有と CurlHandle::applyCommonOptions）
+    void prepare(CURL* easy) {
+        CurlHandle::applyCommonOptions(easy);
+        curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    }
+
+    /// テンプレートを複製して、設定済みの新しいハンドルを作る
+    CURL* duplicate() {
+        CURL* easy = nullptr;
+        {
+            // 複製元は同時に使えないため、複製の間だけロックする
+            std::lock_guard<std::mutex> guard(templateMutex);
+            easy = curl_easy_duphandle(templateHandle);
+        }
+        if (!easy) {
+            throw std::runtime_error("curl_easy_duphandle() failed");
+        }
+        curl_easy_setopt(easy, CURLOPT_SHARE, share);
+        return easy;
+    }
+
+    /// 未使用ハンドルを取り出す（なければテンプレートから複製する）
+    CURL* take() {
+        {
+            std::lock_guard<std::mutex> guard(idleMutex);
+            if (!idle.empty()) {
+                CURL* easy = idle.back();
+                idle.pop_back();
+                return easy;
+            }
+        }
+        return duplicate();
+    }
+
+    /// 返却されたハンドルをリセットし、共通の設定をし直して保持する
+    void give(CURL* easy) {
+        // リセットで CURLOPT_SHARE も外れるが、接続は共有キャッシュに残る
+        curl_easy_reset(easy);
+        prepare(easy);
+        {
+            std::lock_guard<std::mutex> guard(idleMutex);
+            if (idle.size() < maxIdle) {
+                idle.push_back(easy);
+                return;
+            }
+        }
+        curl_easy_cleanup(easy);
+    }
+
+    static void lock(CURL* /*handle*/, curl_lock_data data,
+                     curl_lock_access /*access*/, void* userptr) {
+        static_cast<State*>(userptr)->shareMutexes[index(data)].lock();
+    }
+
+    static void unlock(CURL* /*handle*/, curl_lock_data data, void* userptr) {
+        static_cast<State*>(userptr)->shareMutexes[index(data)].unlock();
+    }
+
+    static size_t index(curl_lock_data data) {
+        const auto i = static_cast<size_t>(data);
+        return i < CURL_LOCK_DATA_LAST ? i : 0;
+    }
+
+    CURLSH*                                     share{nullptr};
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> shareMutexes;
+
+    CURL*                                       templateHandle{nullptr}; ///< applyCommonOptions だけを済ませた複製元
+    std::mutex                                  templateMutex;
+
+    const size_t                                maxIdle;
+    mutable std::mutex                          idleMutex;
+    std::vector<CURL*>                          idle;
+};
+
+// =============================================================================
+// CurlHandlePool
+// =============================================================================
+
+CurlHandlePool::CurlHandlePool(size_t maxIdle)
+    : state_(std::make_shared<State>(maxIdle)) {
+}
+
+CurlHandlePool::~CurlHandlePool() = default;
+
+CurlHandlePool& CurlHandlePool::shared() {
+    static CurlHandlePool pool;
+    return pool;
+}
+
+std::unique_ptr<ICurlHandle> CurlHandlePool::acquire() {
+    return acquireFrom(state_);
+}
+
+CurlHandlePool::Factory CurlHandlePool::makeFactory() {
+    // プール本体ではなく State を捕捉し、ファクトリ単体でも有効にする
+    std::shared_ptr<State> state = state_;
+    return [state]() { return acquireFrom(state); };
+}
+
+std::unique_ptr<ICurlHandle>
+CurlHandlePool::acquireFrom(const std::shared_ptr<State>& state) {
+    CURL* easy = state->take();
+    // 返却処理が State を所有し、プール本体より長く生存できるようにする
+    return std::make_unique<CurlHandle>(
+        easy, [state](CURL* handle) { state->give(handle); });
+}
+
+size_t CurlHandlePool::warmUp(size_t count) {
+    const size_t target = std::min(count, state_->maxIdle);
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(state_->idleMutex);
+            if (state_->idle.size() >= target) {
+                return state_->idle.size();
+            }
+        }
+        CURL* easy = state_->duplicate();
+        std::lock_guard<std::mutex> guard(state_->idleMutex);
+        if (state_->idle.size() >= target) {
+            // 他のスレッドの返却で埋まった
+            curl_easy_cleanup(easy);
+            return state_->idle.size();
+        }
+        state_->idle.push_back(easy);
+    }
+}
+
+size_t CurlHandlePool::getIdleCount() const {
+    std::lock_guard<std::mutex> guard(state_->idleMutex);
+    return state_->idle.size();
+}
+
+} // namespace Downloader
@@ -0,0 +1,195 @@
+// =============================================================================
+// DiskWriteQueue.cpp
+// 非同期書き込みキューの実装
+//
+// 設計方針:
+//  - 書き出しスレッドは 1 本。全 Stream のブロックを積まれた順に書き込むため、
+//    Stream ごとの書き込み順も保たれる
+//  - Sink の呼び出し・データのコピーはロックの外で行う
+//  - 空きの通知コールバックもロックの外で呼ぶ（コールバックから再度キューを操作できる）
+//  - プールの空きを待つのは、このキューがスラブを持っている間だけにする
+//    （書き出しスレッドが必ず返すため、ほかの利用者がスラブを持ち続けても待ち続けない）
+// =============================================================================
+
+#include "DiskWriteQueue.h"
+
+#include <cstring>
+
+namespace Downloader {
+
+// =============================================================================
+// Stream
+// =============================================================================
+
+bool DiskWriteQueue::Stream::write(const char* data, size_t size) {
+    if (size == 0) {
+        return !hasFailed();
+    }
+
+    // スラブを借り、借りられなければ書き込み済みのバッファを再利用する（容量は保持されている）
+    Block block;
+    block.size = size;
+    if (queue_.pool_ && size <= queue_.pool_->slabSize()) {
+        block.slab = queue_.pool_->tryAcquire();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_.mutex_);
+        if (failed_) {
+            return false;
+        }
+        if (!block.slab && !queue_.freeBuffers_.empty()) {
+            block.data = std::move(queue_.freeBuffers_.back());
+            queue_.freeBuffers_.pop_back();
+        }
+    }
+    if (block.slab) {
+        std::memcpy(block.slab.data(), data, size);
+    } else {
+        block.data.assign(data, data + size);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_.mutex_);
+        ++pending_;
+        queue_.queuedBytes_ += size;
+        if (block.slab) {
+            ++queue_.queuedSlabs_;
+        }
+        // Stream は open() でのみ生成され、常に shared_ptr で所有されている
+        block.stream = shared_from_this();
+        queue_.blocks_.push_back(std::move(block));
+    }
+    queue_.workCv_.notify_one();
+    return true;
+}
+
+bool DiskWriteQueue::Stream::drain() {
+    std::unique_lock<std::mutex> lock(queue_.mutex_);
+    queue_.spaceCv_.wait(lock, [this]() { return pending_ == 0; });
+    return !failed_;
+}
+
+bool DiskWriteQueue::Stream::hasFailed() const {
+    std::lock_guard<std::mutex> lock(queue_.mutex_);
+    return failed_;
+}
+
+// =============================================================================
+// コンストラクタ / デストラクタ
+// =============================================================================
+
+DiskWriteQueue::DiskWriteQueue(size_t maxQueuedBytes, BufferPool* pool)
+    : maxQueuedBytes_(maxQueuedBytes)
+    , pool_(pool) {
+    writer_ = std::thread(&DiskWriteQueue::writerThread, this);
+}
+
+DiskWriteQueue::~DiskWriteQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    workCv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+// =============================================================================
+// 公開 API
+// =============================================================================
+
+std::shared_ptr<DiskWriteQueue::Stream> DiskWriteQueue::open(Sink sink) {
+    // コンストラクタが private のため make_shared は使えない
+    return std::shared_ptr<Stream>(new Stream(*this, std::move(sink)));
+}
+
+bool DiskWriteQueue::isFull() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queuedBytes_ >= maxQueuedBytes_ || waitingForPoolLocked();
+}
+
+void DiskWriteQueue::waitForSpace() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    spaceCv_.wait(lock, [this]() { return hasSpaceLocked(); });
+}
+
+void DiskWriteQueue::notifyWhenSpace(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!hasSpaceLocked()) {
+            spaceCallbacks_.push_back(std::move(callback));
+            return;
+        }
+    }
+    callback();
+}
+
+size_t DiskWriteQueue::getQueuedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queuedBytes_;
+}
+
+// =============================================================================
+// 内部処理
+// =============================================================================
+
+bool DiskWriteQueue::hasSpaceLocked() const {
+    return queuedBytes_ <= maxQueuedBytes_ / 2 && !waitingForPoolLocked();
+}
+
+bool DiskWriteQueue::waitingForPoolLocked() const {
+    return pool_ && queuedSlabs_ > 0 && !pool_->available();
+}
+
+void DiskWriteQueue::writerThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // 停止要求があっても積まれたデータは書き切ってから終了する
+        workCv_.wait(lock, [this]() { return !blocks_.empty() || stopRequested_; });
+        if (blocks_.empty()) {
+            return;
+        }
+
+        Block block = std::move(blocks_.front());
+        blocks_.pop_front();
+        const bool skip = block.stream->failed_;
+
+        lock.unlock();
+        // 失敗済みの Stream には書かない（failed_ が立つのはこのスレッドだけ）
+        const bool ok = skip || (block.stream->sink_ &&
+                                 block.stream->sink_(block.bytes(), block.size));
+        // スラブは空きの判定より先にプールへ返す
+        const bool pooled = static_cast<bool>(block.slab);
+        block.slab.reset();
+        lock.lock();
+
+        if (!ok) {
+            block.stream->failed_ = true;
+        }
+        --block.stream->pending_;
+        queuedBytes_ -= block.size;
+        if (pooled) {
+            --queuedSlabs_;
+        } else {
+            block.data.clear();
+            freeBuffers_.push_back(std::move(block.data));
+        }
+
+        std::vector<std::function<void()>> callbacks;
+        if (hasSpaceLocked()) {
+            callbacks.swap(spaceCallbacks_);
+        }
+        spaceCv_.notify_all();
+
+        if (!callbacks.empty()) {
+            lock.unlock();
+            for (auto& callback : callbacks) {
+                callback();
+            }
+            lock.lock();
+        }
+    }
+}
+
+} // namespace Downloader
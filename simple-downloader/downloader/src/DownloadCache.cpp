@@ -0,0 +1,478 @@
+// =============================================================================
+// DownloadCache.cpp
+// ダウンロードのキャッシュ（索引の読み書き・内容の複製・LRU による削除）の実装
+//
+// 索引の形式（ネイティブのバイトオーダー。別の環境へ持ち出さない）:
+//   "DLCACHE1"  useCounter (u64)  件数 (u32)
+//   件数 × { size (i64)  lastUse (u64)  url  object  etag  lastModified }
+//   文字列は 長さ (u32) + バイト列
+//
+// 設計方針:
+//  - 内容のコピー（数 GB になりうる）はロックの外で行い、索引の更新だけをロックする
+//  - 内容は一時ファイルに作ってから rename し、途中で落ちても壊れた内容を残さない
+//  - 索引は起動時に内容の有無を確かめない（件数が多くても読み込みを速くする）。
+//    消えた内容は materialize() で見つけたときに記録ごと削除する
+// =============================================================================
+
+#include "DownloadCache.h"
+
+#include "Checksum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  include <linux/fs.h>
+#  include <sys/ioctl.h>
+#  include <unistd.h>
+#elif defined(__APPLE__)
+#  include <sys/clonefile.h>
+#endif
+
+namespace Downloader {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view MAGIC = "DLCACHE1";
+
+/// 一時ファイルの名前を重ならないようにする（同じ内容を同時に記録する場合）
+std::string temporaryPath(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+    return path + ".tmp" + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+}
+
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+/// reflink（コピーオンライトの複製）を作る。ファイルシステムが対応していなければ false
+bool cloneFile(const std::string& from, const std::string& to) {
+#if defined(__linux__) && defined(FICLONE)
+    const int source = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return false;
+    }
+    const int target = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = false;
+    if (target >= 0) {
+        ok = ::ioctl(target, FICLONE, source) == 0;
+        ::close(target);
+        if (!ok) {
+            ::unlink(to.c_str());
+        }
+    }
+    ::close(source);
+    return ok;
+#elif defined(__APPLE__)
+    return ::clonefile(from.c_str(), to.c_str(), 0) == 0;
+#else
+    (void)from;
+    (void)to;
+    return false;
+#endif
+}
+
+/// from を to（存在しないパス）に複製する: ハードリンク → reflink → コピーの順に試す
+bool copyFile(const std::string& from, const std::string& to, DownloadCache::LinkMode mode) {
+    std::error_code ec;
+    if (mode == DownloadCache::LinkMode::HARD_LINK) {
+        fs::create_hard_link(from, to, ec);
+        if (!ec) {
+            return true;
+        }
+    }
+    if (cloneFile(from, to)) {
+        return true;
+    }
+    ec.clear();
+    return fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec) && !ec;
+}
+
+// ---- 索引の読み書き ----
+
+void putU32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putU64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, const std::string& value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+/// 索引のバイト列を先頭から読む
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (data_.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool read(std::string& value) {
+        uint32_t size = 0;
+        if (!read(size) || data_.size() < size) {
+            return false;
+        }
+        value.assign(data_.data(), size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+private:
+    std::string_view data_;
+};
+
+} // namespace
+
+// =============================================================================
+// Entry
+// =============================================================================
+
+std::vector<std::string> DownloadCache::Entry::conditionalHeaders() const {
+    std::vector<std::string> headers;
+    if (!etag.empty()) {
+        headers.push_back("If-None-Match: " + etag);
+    }
+    if (!lastModified.empty()) {
+        headers.push_back("If-Modified-Since: " + lastModified);
+    }
+    return headers;
+}
+
+// =============================================================================
+// コンストラクタ / デストラクタ
+// =============================================================================
+
+DownloadCache::DownloadCache(Options options)
+    : options_(std::move(options)) {
+    std::error_code ec;
+    fs::create_directories(objectPath({}), ec);
+    load();
+}
+
+DownloadCache::~DownloadCache() {
+    flush();
+}
+
+// =============================================================================
+// 検索・複製
+// =============================================================================
+
+std::optional<DownloadCache::Entry> DownloadCache::lookup(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = records_.find(url);
+    if (it == records_.end()) {
+        return std::nullopt;
+    }
+    it->second.lastUse = ++useCounter_;
+    dirty_ = true;
+    return it->second.entry;
+}
+
+std::optional<DownloadCache::Entry> DownloadCache::lookupDigest(const std::string& sha256) {
+    const std::string object = "sha256-" + toLower(sha256);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!objects_.contains(object)) {
+        return std::nullopt;
+    }
+    for (auto& [url, record] : records_) {
+        if (record.entry.object == object) {
+            record.lastUse = ++useCounter_;
+            dirty_ = true;
+            return record.entry;
+        }
+    }
+    return std::nullopt;
+}
+
+bool DownloadCache::materialize(const Entry& entry, const std::string& outputPath) {
+    const std::string source = objectPath(entry.object);
+    std::error_code   ec;
+    if (!fs::exists(source, ec)) {
+        // 外から消された内容は記録ごと削除する
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = records_.find(entry.url);
+        if (it != records_.end() && it->second.entry.object == entry.object) {
+            eraseLocked(entry.url);
+        }
+        return false;
+    }
+
+    // 一時ファイルに作ってから置き換え、既存の出力（ハードリンクを含む）には書き込まない
+    const std::string temporary = temporaryPath(outputPath);
+    if (!copyFile(source, temporary, options_.linkMode)) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    fs::rename(temporary, outputPath, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+// =============================================================================
+// 記録・削除
+// =============================================================================
+
+bool DownloadCache::store(const std::string& url, const std::string& path,
+                          const std::string& etag, const std::string& lastModified,
+                          const std::string& sha256) {
+    std::error_code ec;
+    const auto fileSize = fs::file_size(path, ec);
+    if (ec || (options_.maxBytes > 0 && fileSize > options_.maxBytes)) {
+        return false;
+    }
+
+    // 内容が分かれば内容の名前で、分からなければ URL から決めた名前で置く
+    std::string object;
+    if (!sha256.empty()) {
+        object = "sha256-" + toLower(sha256);
+    } else {
+        StreamingChecksum name(ChecksumAlgorithm::SHA256);
+        name.update(url.data(), url.size());
+        object = "url-" + name.hexDigest();
+    }
+
+    bool shared = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shared = !sha256.empty() && objects_.contains(object);
+    }
+
+    // 内容のコピーはロックの外で一時ファイルに作る
+    const std::string target    = objectPath(object);
+    std::string       temporary;
+    if (!shared) {
+        temporary = temporaryPath(target);
+        if (!copyFile(path, temporary, options_.linkMode)) {
+            fs::remove(temporary, ec);
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto        previous = records_.find(url);
+    const std::string replaced = previous != records_.end() ? previous->second.entry.object : "";
+    if (!temporary.empty()) {
+        const auto existing = objects_.find(object);
+        if (existing != objects_.end() && object != replaced) {
+            // 同時に同じ内容が記録された。作った一時ファイルは使わない
+            fs::remove(temporary, ec);
+        } else {
+            // URL から決めた名前の内容は、同じ URL の古い内容を置き換える
+            fs::rename(temporary, target, ec);
+            if (ec) {
+                fs::remove(temporary, ec);
+                return false;
+            }
+            if (existing != objects_.end()) {
+                totalBytes_ -= static_cast<uint64_t>(existing->second);
+            }
+            objects_[object] = static_cast<int64_t>(fileSize);
+            totalBytes_ += fileSize;
+        }
+    }
+
+    Record record;
+    record.entry   = {url, object, etag, lastModified, static_cast<int64_t>(fileSize)};
+    record.lastUse = ++useCounter_;
+    records_[url]  = std::move(record);
+    dirty_         = true;
+    if (!replaced.empty() && replaced != object) {
+        releaseObjectLocked(replaced);
+    }
+
+    evictLocked(url);
+    saveLocked();
+    return true;
+}
+
+void DownloadCache::remove(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    eraseLocked(url);
+}
+
+bool DownloadCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !dirty_ || saveLocked();
+}
+
+void DownloadCache::detach(const std::string& path) {
+    std::error_code ec;
+    if (fs::hard_link_count(path, ec) > 1 && !ec) {
+        fs::remove(path, ec);
+    }
+}
+
+size_t DownloadCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_.size();
+}
+
+uint64_t DownloadCache::totalBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalBytes_;
+}
+
+// =============================================================================
+// 内部処理
+// =============================================================================
+
+std::string DownloadCache::objectPath(const std::string& object) const {
+    return (fs::path(options_.directory) / "objects" / object).string();
+}
+
+std::string DownloadCache::indexPath() const {
+    return (fs::path(options_.directory) / "index.bin").string();
+}
+
+bool DownloadCache::load() {
+    std::ifstream in(indexPath(), std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.compare(0, MAGIC.size(), MAGIC) != 0) {
+        return false;
+    }
+
+    Reader   reader(std::string_view(data).substr(MAGIC.size()));
+    uint64_t useCounter = 0;
+    uint32_t count      = 0;
+    if (!reader.read(useCounter) || !reader.read(count)) {
+        return false;
+    }
+
+    std::unordered_map<std::string, Record>  records;
+    std::unordered_map<std::string, int64_t> objects;
+    uint64_t                                 totalBytes = 0;
+    records.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Record record;
+        Entry& entry = record.entry;
+        if (!reader.read(entry.size) || !reader.read(record.lastUse) ||
+            !reader.read(entry.url) || !reader.read(entry.object) ||
+            !reader.read(entry.etag) || !reader.read(entry.lastModified) ||
+            entry.size < 0 || entry.object.empty()) {
+            return false; // 壊れた索引は使わない（空のキャッシュから始める）
+        }
+        if (objects.emplace(entry.object, entry.size).second) {
+            totalBytes += static_cast<uint64_t>(entry.size);
+        }
+        std::string url = entry.url;
+        records[std::move(url)] = std::move(record);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_    = std::move(records);
+    objects_    = std::move(objects);
+    totalBytes_ = totalBytes;
+    useCounter_ = useCounter;
+    return true;
+}
+
+bool DownloadCache::saveLocked() {
+    std::string data(MAGIC);
+    putU64(data, useCounter_);
+    putU32(data, static_cast<uint32_t>(records_.size()));
+    for (const auto& [url, record] : records_) {
+        putU64(data, static_cast<uint64_t>(record.entry.size));
+        putU64(data, record.lastUse);
+        putString(data, record.entry.url);
+        putString(data, record.entry.object);
+        putString(data, record.entry.etag);
+        putString(data, record.entry.lastModified);
+    }
+
+    const std::string path      = indexPath();
+    const std::string temporary = temporaryPath(path);
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out.good()) {
+            std::error_code ec;
+            fs::remove(temporary, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, path, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+void DownloadCache::eraseLocked(const std::string& url) {
+    const auto it = records_.find(url);
+    if (it == records_.end()) {
+        return;
+    }
+    const std::string object = it->second.entry.object;
+    records_.erase(it);
+    dirty_ = true;
+    releaseObjectLocked(object);
+}
+
+void DownloadCache::releaseObjectLocked(const std::string& object) {
+    if (referencesLocked(object) > 0) {
+        return;
+    }
+    const auto size = objects_.find(object);
+    if (size != objects_.end()) {
+        totalBytes_ -= static_cast<uint64_t>(size->second);
+        objects_.erase(size);
+    }
+    std::error_code ec;
+    fs::remove(objectPath(object), ec);
+}
+
+void DownloadCache::evictLocked(const std::string& keep) {
+    while (options_.maxBytes > 0 && totalBytes_ > options_.maxBytes) {
+        auto oldest = records_.end();
+        for (auto it = records_.begin(); it != records_.end(); ++it) {
+            if (it->first != keep &&
+                (oldest == records_.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+        if (oldest == records_.end()) {
+            return;
+        }
+        eraseLocked(std::string(oldest->first));
+    }
+}
+
+size_t DownloadCache::referencesLocked(const std::string& object) const {
+    return static_cast<size_t>(std::count_if(records_.begin(), records_.end(),
+                                             [&object](const auto& item) {
+                                                 return item.second.entry.object == object;
+                                             }));
+}
+
+} // namespace Downloader
@@ -0,0 +1,269 @@
+// =============================================================================
+// DownloadMetrics.cpp
+// 計測値の記録（区画ごとの atomic）と Prometheus / OTLP JSON への出力の実装
+// =============================================================================
+
+#include "DownloadMetrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace Downloader {
+
+// =============================================================================
+// 区画
+// =============================================================================
+
+size_t Metrics::shardIndex() {
+    // スレッドが初めて記録したときに順番に割り当てる（スレッド ID のハッシュより偏らない）
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+// =============================================================================
+// MetricCounter
+// =============================================================================
+
+uint64_t MetricCounter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// =============================================================================
+// MetricHistogram
+// =============================================================================
+
+uint64_t MetricHistogram::upperBound(size_t bucket) {
+    if (bucket + 1 >= BUCKETS) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return uint64_t{1} << bucket;
+}
+
+void MetricHistogram::record(uint64_t value) {
+    // value 以上の最小の 2 のべき乗を上限とする区間（2^(i-1) < value <= 2^i）
+    const size_t bucket = value <= 1
+        ? 0
+        : std::min<size_t>(static_cast<size_t>(std::bit_width(value - 1)), BUCKETS - 1);
+    auto& shard = shards_[Metrics::shardIndex()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const {
+    Snapshot result;
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            result.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    // count は区間の合計から求める（記録の途中で読んでも出力の累積件数と食い違わない）
+    for (const uint64_t n : result.counts) {
+        result.count += n;
+    }
+    return result;
+}
+
+uint64_t MetricHistogram::Snapshot::percentile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<uint64_t>(
+        std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= std::max<uint64_t>(rank, 1)) {
+            return upperBound(i);
+        }
+    }
+    return upperBound(BUCKETS - 1);
+}
+
+// =============================================================================
+// 出力
+// =============================================================================
+
+namespace {
+
+struct CounterInfo {
+    const char*                   name;
+    const char*                   unit;  ///< Prometheus の名前の単位 ("" は件数)
+    double                        scale; ///< 記録値から出力値への係数
+    const char*                   help;
+    MetricCounter DownloadMetrics::* member;
+};
+
+struct HistogramInfo {
+    const char*                     name;
+    const char*                     unit;
+    double                          scale;
+    const char*                     help;
+    MetricHistogram DownloadMetrics::* member;
+};
+
+constexpr double US = 1e-6;
+
+const CounterInfo COUNTERS[] = {
+    {"downloads_started",   "",        1,  "Downloads started",                        &DownloadMetrics::downloadsStarted},
+    {"downloads_completed", "",        1,  "Downloads completed",                      &DownloadMetrics::downloadsCompleted},
+    {"downloads_failed",    "",        1,  "Downloads failed",                         &DownloadMetrics::downloadsFailed},
+    {"downloads_cancelled", "",        1,  "Downloads cancelled",                      &DownloadMetrics::downloadsCancelled},
+    {"transfers",           "",        1,  "HTTP transfers performed",                 &DownloadMetrics::transfers},
+    {"retries",             "",        1,  "Transfers retried after transient errors", &DownloadMetrics::retries},
+    {"cache_hits",          "",        1,  "Downloads served from the cache",          &DownloadMetrics::cacheHits},
+    {"peer_received",       "bytes",   1,  "Body bytes received from peers",           &DownloadMetrics::peerBytes},
+    {"received",            "bytes",   1,  "Body bytes received",                      &DownloadMetrics::bytesReceived},
+    {"written",             "bytes",   1,  "Bytes written to the output",              &DownloadMetrics::bytesWritten},
+    {"paused",              "seconds", US, "Time spent paused",                        &DownloadMetrics::pausedUs},
+    {"backpressure",        "seconds", US, "Time receiving was stalled by backpressure or rate limits", &DownloadMetrics::backpressureUs},
+};
+
+const HistogramInfo HISTOGRAMS[] = {
+    {"write_callback_duration",    "seconds",          US, "Duration of one curl write callback",     &DownloadMetrics::writeCallbackUs},
+    {"disk_write_duration",        "seconds",          US, "Duration of one write to the output file", &DownloadMetrics::diskWriteUs},
+    {"observer_callback_duration", "seconds",          US, "Duration of one observer notification",   &DownloadMetrics::observerCallbackUs},
+    {"dns_duration",               "seconds",          US, "Name resolution time per transfer",       &DownloadMetrics::dnsUs},
+    {"connect_duration",           "seconds",          US, "TCP connect time per transfer",           &DownloadMetrics::connectUs},
+    {"tls_duration",               "seconds",          US, "TLS handshake time per transfer",         &DownloadMetrics::tlsUs},
+    {"first_byte_duration",        "seconds",          US, "Time to first byte per transfer",         &DownloadMetrics::firstByteUs},
+    {"transfer_duration",          "seconds",          US, "Body transfer time per transfer",         &DownloadMetrics::transferUs},
+    {"throughput",                 "bytes_per_second", 1,  "Average throughput of completed downloads", &DownloadMetrics::throughputBytesPerSec},
+};
+
+/// 単位の OpenTelemetry (UCUM) 表記
+const char* otelUnit(const std::string& unit) {
+    if (unit == "seconds") {
+        return "s";
+    }
+    if (unit == "bytes") {
+        return "By";
+    }
+    if (unit == "bytes_per_second") {
+        return "By/s";
+    }
+    return "1";
+}
+
+std::string formatNumber(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+std::string formatCount(uint64_t value, double scale) {
+    return scale == 1 ? std::to_string(value) : formatNumber(static_cast<double>(value) * scale);
+}
+
+std::string jsonString(const std::string& value) {
+    std::string result = "\"";
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+std::string promName(const std::string& prefix, const char* name, const std::string& unit) {
+    std::string result = prefix.empty() ? name : prefix + "_" + name;
+    if (!unit.empty()) {
+        result += "_" + unit;
+    }
+    return result;
+}
+
+int64_t unixNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+DownloadMetrics::DownloadMetrics()
+    : startTimeNs_(unixNanos()) {
+}
+
+std::string DownloadMetrics::toPrometheus(const std::string& prefix) const {
+    std::string out;
+    for (const auto& info : COUNTERS) {
+        const std::string name = promName(prefix, info.name, info.unit) + "_total";
+        out += "# HELP " + name + " " + info.help + "\n";
+        out += "# TYPE " + name + " counter\n";
+        out += name + " " + formatCount((this->*info.member).value(), info.scale) + "\n";
+    }
+    for (const auto& info : HISTOGRAMS) {
+        const std::string name = promName(prefix, info.name, info.unit);
+        const auto snapshot    = (this->*info.member).snapshot();
+        out += "# HELP " + name + " " + info.help + "\n";
+        out += "# TYPE " + name + " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i + 1 < MetricHistogram::BUCKETS; ++i) {
+            cumulative += snapshot.counts[i];
+            out += name + "_bucket{le=\"" +
+                   formatNumber(static_cast<double>(MetricHistogram::upperBound(i)) * info.scale) +
+                   "\"} " + std::to_string(cumulative) + "\n";
+        }
+        out += name + "_bucket{le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+        out += name + "_sum " + formatCount(snapshot.sum, info.scale) + "\n";
+        out += name + "_count " + std::to_string(snapshot.count) + "\n";
+    }
+    return out;
+}
+
+std::string DownloadMetrics::toOpenTelemetryJson(const std::string& scope) const {
+    const std::string times = "\"startTimeUnixNano\":\"" + std::to_string(startTimeNs_) +
+                              "\",\"timeUnixNano\":\"" + std::to_string(unixNanos()) + "\"";
+    const std::string base  = scope.empty() ? "" : scope + ".";
+
+    std::string metrics;
+    const auto append = [&metrics](const std::string& metric) {
+        metrics += (metrics.empty() ? "" : ",") + metric;
+    };
+
+    for (const auto& info : COUNTERS) {
+        const uint64_t value = (this->*info.member).value();
+        // 秒に換算する値は小数、件数・バイト数は整数（OTLP/JSON では 64bit 整数を文字列で表す）
+        const std::string point = info.scale == 1
+            ? "\"asInt\":\"" + std::to_string(value) + "\""
+            : "\"asDouble\":" + formatCount(value, info.scale);
+        append("{\"name\":" + jsonString(base + info.name) +
+               ",\"description\":" + jsonString(info.help) +
+               ",\"unit\":\"" + otelUnit(info.unit) + "\"" +
+               ",\"sum\":{\"aggregationTemporality\":2,\"isMonotonic\":true,\"dataPoints\":[{" +
+               times + "," + point + "}]}}");
+    }
+    for (const auto& info : HISTOGRAMS) {
+        const auto snapshot = (this->*info.member).snapshot();
+        std::string counts;
+        std::string bounds;
+        for (size_t i = 0; i < MetricHistogram::BUCKETS; ++i) {
+            counts += (i ? ",\"" : "\"") + std::to_string(snapshot.counts[i]) + "\"";
+            if (i + 1 < MetricHistogram::BUCKETS) {
+                bounds += (i ? "," : "") +
+                          formatNumber(static_cast<double>(MetricHistogram::upperBound(i)) * info.scale);
+            }
+        }
+        append("{\"name\":" + jsonString(base + info.name) +
+               ",\"description\":" + jsonString(info.help) +
+               ",\"unit\":\"" + otelUnit(info.unit) + "\"" +
+               ",\"histogram\":{\"aggregationTemporality\":2,\"dataPoints\":[{" + times +
+               ",\"count\":\"" + std::to_string(snapshot.count) + "\"" +
+               ",\"sum\":" + formatCount(snapshot.sum, info.scale) +
+               ",\"bucketCounts\":[" + counts + "],\"explicitBounds\":[" + bounds + "]}]}}");
+    }
+
+    return "{\"resourceMetrics\":[{\"resource\":{\"attributes\":[]},\"scopeMetrics\":[{"
+           "\"scope\":{\"name\":" + jsonString(scope) + "},\"metrics\":[" + metrics + "]}]}]}";
+}
+
+} // namespace Downloader
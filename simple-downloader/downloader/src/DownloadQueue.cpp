@@ -0,0 +1,433 @@
+// =============================================================================
+// DownloadQueue.cpp
+// ダウンロードジョブキューの実装
+//
+// 設計方針:
+//  - ジョブの取り出しはワーカーごとのロックで行い、取り出しとホスト枠の確保を
+//    同じロックの中で済ませる（枠のないジョブはキューに残す）
+//  - 取り出せるジョブがないワーカーは generation_ が進むまで眠る。
+//    ジョブの追加・ホスト枠の解放・停止のたびに進める
+//  - ジョブの終了は内部のオブザーバーで待つ。ジョブのオブザーバーは
+//    実行中だけ Downloader に登録する
+// =============================================================================
+
+#include "DownloadQueue.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace Downloader {
+
+// =============================================================================
+// JobObserver: 実行中のジョブの終了を待つ
+// =============================================================================
+
+class DownloadQueue::JobObserver final : public IDownloaderObserver {
+public:
+    void onProgress(int64_t, int64_t, double) override {}
+    void onPaused() override {}
+    void onResumed() override {}
+    void onCompleted() override { finish(DownloadState::COMPLETED, {}); }
+    void onError(const std::string& message) override { finish(DownloadState::ERROR, message); }
+    void onCancelled() override { finish(DownloadState::CANCELLED, {}); }
+
+    /// 次のジョブの開始前に呼ぶ
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_ = DownloadState::IDLE;
+        error_.clear();
+    }
+
+    /// ジョブが終了するまで待ち、終了状態を返す
+    DownloadState wait(std::string& error) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return state_ != DownloadState::IDLE; });
+        error = error_;
+        return state_;
+    }
+
+private:
+    void finish(DownloadState state, const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_ = state;
+        error_ = error;
+        cv_.notify_all();
+    }
+
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    DownloadState           state_{DownloadState::IDLE};
+    std::string             error_;
+};
+
+// =============================================================================
+// コンストラクタ / デストラクタ
+// =============================================================================
+
+DownloadQueue::DownloadQueue(DownloadQueueConfig config)
+    : config_(std::move(config)) {
+    const size_t count = std::max<size_t>(config_.maxConcurrent, 1);
+    workers_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto worker      = std::make_unique<Worker>();
+        worker->observer = std::make_unique<JobObserver>();
+
+        auto factory = config_.curlFactory;
+        if (config_.manager) {
+            worker->downloader = factory
+                ? std::make_unique<Downloader>(config_.downloader, *config_.manager, factory)
+                : std::make_unique<Downloader>(config_.downloader, *config_.manager);
+        } else {
+            worker->downloader = factory
+                ? std::make_unique<Downloader>(config_.downloader, factory)
+                : std::make_unique<Downloader>(config_.downloader);
+        }
+        worker->downloader->addObserver(worker->observer.get());
+        workers_.push_back(std::move(worker));
+    }
+    // 全ワーカーを用意してから起動する（起動直後から他のワーカーのキューを見るため）
+    for (size_t i = 0; i < count; ++i) {
+        workers_[i]->thread = std::thread(&DownloadQueue::workerThread, this, i);
+    }
+}
+
+DownloadQueue::~DownloadQueue() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopRequested_ = true;
+    }
+    cancelAll();
+    wakeAll();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+// =============================================================================
+// ジョブの登録・取り消し
+// =============================================================================
+
+JobId DownloadQueue::enqueue(DownloadJob job) {
+    Entry entry;
+    entry.id   = nextId_.fetch_add(1, std::memory_order_relaxed);
+    entry.host = hostFromUrl(job.url);
+    entry.job  = std::move(job);
+    const JobId id = entry.id;
+
+    Worker& worker = *workers_[nextWorker_.fetch_add(1, std::memory_order_relaxed) %
+                               workers_.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<size_t>(entry.job.priority)].push_back(std::move(entry));
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wakeAll();
+    return id;
+}
+
+std::vector<JobId> DownloadQueue::enqueue(std::vector<DownloadJob> jobs) {
+    std::vector<JobId> ids;
+    ids.reserve(jobs.size());
+    for (auto& job : jobs) {
+        ids.push_back(enqueue(std::move(job)));
+    }
+    return ids;
+}
+
+bool DownloadQueue::cancel(JobId id) {
+    std::optional<Entry> removed;
+    {
+        std::unique_lock<std::shared_mutex> take(takeMutex_);
+        for (auto& worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            if (worker->runningId == id) {
+                cancelRunningLocked(*worker);
+                return true;
+            }
+            for (auto& queue : worker->queues) {
+                auto it = std::find_if(queue.begin(), queue.end(),
+                                       [id](const Entry& e) { return e.id == id; });
+                if (it != queue.end()) {
+                    removed = std::move(*it);
+                    queue.erase(it);
+                    break;
+                }
+            }
+            if (removed) {
+                break;
+            }
+        }
+    }
+    if (!removed) {
+        return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_acq_rel);
+    finishCancelled(*removed);
+    return true;
+}
+
+void DownloadQueue::cancelAll() {
+    std::vector<Entry> removed;
+    {
+        std::unique_lock<std::shared_mutex> take(takeMutex_);
+        for (auto& worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            for (auto& queue : worker->queues) {
+                std::move(queue.begin(), queue.end(), std::back_inserter(removed));
+                queue.clear();
+            }
+            if (worker->runningId != 0) {
+                cancelRunningLocked(*worker);
+            }
+        }
+    }
+    queued_.fetch_sub(removed.size(), std::memory_order_acq_rel);
+    for (const auto& entry : removed) {
+        finishCancelled(entry);
+    }
+}
+
+void DownloadQueue::cancelRunningLocked(Worker& worker) {
+    // startDownload() の前なら、開始直後に runJob() がキャンセルする
+    worker.cancelRequested = true;
+    if (worker.started) {
+        worker.downloader->cancel();
+    }
+}
+
+void DownloadQueue::finishCancelled(const Entry& entry) {
+    DownloadJobResult result;
+    result.id    = entry.id;
+    result.url   = entry.job.url;
+    result.state = DownloadState::CANCELLED;
+    finishJob(result, entry.job.observer);
+}
+
+bool DownloadQueue::waitForIdle(std::chrono::milliseconds timeout) {
+    const auto idle = [this]() {
+        return queued_.load(std::memory_order_acquire) == 0 &&
+               running_.load(std::memory_order_acquire) == 0;
+    };
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    if (timeout == std::chrono::milliseconds::max()) {
+        wakeCv_.wait(lock, idle);
+        return true;
+    }
+    return wakeCv_.wait_for(lock, timeout, idle);
+}
+
+DownloadQueueStats DownloadQueue::getStats() const {
+    DownloadQueueStats stats;
+    stats.queued          = queued_.load(std::memory_order_relaxed);
+    stats.running         = running_.load(std::memory_order_relaxed);
+    stats.completed       = completed_.load(std::memory_order_relaxed);
+    stats.failed          = failed_.load(std::memory_order_relaxed);
+    stats.cancelled       = cancelled_.load(std::memory_order_relaxed);
+    stats.downloadedBytes = finishedBytes_.load(std::memory_order_relaxed);
+    for (const auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (worker->runningId != 0) {
+            stats.downloadedBytes += worker->downloader->getStats().downloadedBytes;
+        }
+    }
+    return stats;
+}
+
+// =============================================================================
+// ジョブの取り出し
+// =============================================================================
+
+std::optional<DownloadQueue::Entry> DownloadQueue::takeJob(size_t self) {
+    // 優先度の高いものから: 自分のキューの先頭 → 他のワーカーのキューの末尾
+    for (size_t priority = 0; priority < std::size(workers_[self]->queues); ++priority) {
+        if (auto entry = popRunnable(*workers_[self], priority, false)) {
+            return entry;
+        }
+        for (size_t k = 1; k < workers_.size(); ++k) {
+            Worker& victim = *workers_[(self + k) % workers_.size()];
+            if (auto entry = popRunnable(victim, priority, true)) {
+                return entry;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<DownloadQueue::Entry> DownloadQueue::popRunnable(Worker& worker,
+                                                               size_t priority,
+                                                               bool fromBack) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto& queue = worker.queues[priority];
+    if (queue.empty()) {
+        return std::nullopt;
+    }
+
+    auto take = [&](auto it) -> std::optional<Entry> {
+        if (!reserveHost(it->host)) {
+            return std::nullopt;
+        }
+        Entry entry = std::move(*it);
+        return entry;
+    };
+
+    if (fromBack) {
+        for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+            if (auto entry = take(it)) {
+                queue.erase(std::next(it).base());
+                return entry;
+            }
+        }
+    } else {
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (auto entry = take(it)) {
+                queue.erase(it);
+                return entry;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+bool DownloadQueue::reserveHost(const std::string& host) {
+    if (config_.maxPerHost == 0) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(hostMutex_);
+    size_t& running = runningPerHost_[host];
+    if (running >= config_.maxPerHost) {
+        return false;
+    }
+    ++running;
+    return true;
+}
+
+void DownloadQueue::releaseHost(const std::string& host) {
+    if (config_.maxPerHost == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(hostMutex_);
+    auto it = runningPerHost_.find(host);
+    if (it != runningPerHost_.end() && --it->second == 0) {
+        runningPerHost_.erase(it);
+    }
+}
+
+// =============================================================================
+// ジョブの実行
+// =============================================================================
+
+void DownloadQueue::workerThread(size_t self) {
+    Worker& worker = *workers_[self];
+    for (;;) {
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            if (stopRequested_) {
+                return;
+            }
+            generation = generation_;
+        }
+
+        std::optional<Entry> entry;
+        {
+            std::shared_lock<std::shared_mutex> take(takeMutex_);
+            entry = takeJob(self);
+            if (entry) {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.runningId       = entry->id;
+                worker.started         = false;
+                worker.cancelRequested = false;
+                // running_ を先に増やし、waitForIdle() が途中で空と判断しないようにする
+                running_.fetch_add(1, std::memory_order_acq_rel);
+                queued_.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+        if (!entry) {
+            // 取り出した後に追加・解放されたジョブを取りこぼさないよう世代で待つ
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wakeCv_.wait(lock, [&]() {
+                return stopRequested_ || generation_ != generation;
+            });
+            continue;
+        }
+
+        const DownloadJobResult result = runJob(worker, *entry);
+        releaseHost(entry->host);
+        finishJob(result, nullptr);
+        running_.fetch_sub(1, std::memory_order_acq_rel);
+        wakeAll();
+    }
+}
+
+DownloadJobResult DownloadQueue::runJob(Worker& worker, Entry& entry) {
+    DownloadJobResult result;
+    result.id  = entry.id;
+    result.url = entry.job.url;
+
+    Downloader& downloader = *worker.downloader;
+    worker.observer->reset();
+    downloader.setPriority(entry.job.priority);
+    if (entry.job.observer) {
+        downloader.addObserver(entry.job.observer);
+    }
+
+    const bool started = entry.job.sink
+        ? downloader.startDownload(entry.job.url, *entry.job.sink)
+        : downloader.startDownload(entry.job.url, entry.job.outputPath);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.started = started;
+        if (started && worker.cancelRequested) {
+            downloader.cancel();
+        }
+    }
+    if (started) {
+        result.state = worker.observer->wait(result.error);
+    } else {
+        result.state = DownloadState::ERROR;
+        result.error = "Failed to start download";
+    }
+    result.downloadedBytes = downloader.getStats().downloadedBytes;
+
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.runningId = 0;
+        worker.started   = false;
+    }
+    if (entry.job.observer) {
+        downloader.removeObserver(entry.job.observer);
+    }
+    return result;
+}
+
+void DownloadQueue::finishJob(const DownloadJobResult& result,
+                              IDownloaderObserver* observer) {
+    switch (result.state) {
+    case DownloadState::COMPLETED: completed_.fetch_add(1, std::memory_order_relaxed); break;
+    case DownloadState::CANCELLED: cancelled_.fetch_add(1, std::memory_order_relaxed); break;
+    default:                       failed_.fetch_add(1, std::memory_order_relaxed);    break;
+    }
+    finishedBytes_.fetch_add(result.downloadedBytes, std::memory_order_relaxed);
+
+    // 実行されずに取り消されたジョブは、ここでジョブのオブザーバーに知らせる
+    if (observer && result.state == DownloadState::CANCELLED) {
+        observer->onCancelled();
+    }
+    if (config_.onJobFinished) {
+        config_.onJobFinished(result);
+    }
+    wakeAll();
+}
+
+void DownloadQueue::wakeAll() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        ++generation_;
+    }
+    wakeCv_.notify_all();
+}
+
+} // namespace Downloader
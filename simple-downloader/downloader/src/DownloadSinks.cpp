@@ -0,0 +1,184 @@
+// =============================================================================
+// DownloadSinks.cpp
+// IDownloadSink 標準実装
+// =============================================================================
+
+#include "DownloadSinks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace Downloader {
+
+// =============================================================================
+// MemorySink
+// =============================================================================
+
+MemorySink::MemorySink(std::vector<char> buffer)
+    : buffer_(std::move(buffer)) {
+    buffer_.clear();
+}
+
+bool MemorySink::open(int64_t expectedSize) {
+    buffer_.clear(); // 容量は保持される
+    if (expectedSize > 0) {
+        buffer_.resize(static_cast<size_t>(expectedSize));
+    }
+    return true;
+}
+
+bool MemorySink::write(int64_t offset, std::span<const char> data) {
+    const size_t position = static_cast<size_t>(offset);
+    if (position == buffer_.size()) {
+        // サイズ不明のダウンロードは末尾への追記になる（容量は倍々に伸びる）
+        buffer_.insert(buffer_.end(), data.begin(), data.end());
+        return true;
+    }
+    if (position + data.size() > buffer_.size()) {
+        buffer_.resize(position + data.size());
+    }
+    // 事前確保した範囲への書き込み（セグメントごとに重ならない区間）
+    std::memcpy(buffer_.data() + position, data.data(), data.size());
+    return true;
+}
+
+std::vector<char> MemorySink::take() {
+    return std::exchange(buffer_, {});
+}
+
+void MemorySink::recycle(std::vector<char> buffer) {
+    if (buffer.capacity() > buffer_.capacity()) {
+        buffer_ = std::move(buffer);
+    }
+    buffer_.clear();
+}
+
+// =============================================================================
+// PooledMemorySink
+// =============================================================================
+
+bool PooledMemorySink::open(int64_t expectedSize) {
+    clear();
+    if (expectedSize > 0) {
+        // スラブの表だけを先に確保する（セグメントが同時に伸ばさないように）
+        const size_t slab = pool_.slabSize();
+        std::lock_guard<std::mutex> lock(mutex_);
+        slabs_.resize((static_cast<size_t>(expectedSize) + slab - 1) / slab);
+    }
+    return true;
+}
+
+bool PooledMemorySink::write(int64_t offset, std::span<const char> data) {
+    const size_t slab     = pool_.slabSize();
+    size_t       position = static_cast<size_t>(offset);
+    while (!data.empty()) {
+        const size_t index  = position / slab;
+        const size_t within = position % slab;
+        const size_t count  = std::min(data.size(), slab - within);
+
+        // スラブの表はロックして引き、コピーはロックの外で行う
+        // （セグメントは重ならない区間に書くため、同じスラブへの同時のコピーも衝突しない）
+        char* target = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (index >= slabs_.size()) {
+                slabs_.resize(index + 1);
+            }
+            if (!slabs_[index]) {
+                slabs_[index] = pool_.tryAcquire();
+                if (!slabs_[index]) {
+                    return false;
+                }
+            }
+            target = slabs_[index].data();
+            size_  = std::max(size_, position + count);
+        }
+        std::memcpy(target + within, data.data(), count);
+
+        data      = data.subspan(count);
+        position += count;
+    }
+    return true;
+}
+
+size_t PooledMemorySink::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+std::vector<std::span<const char>> PooledMemorySink::chunks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::span<const char>> out;
+    const size_t slab = pool_.slabSize();
+    for (size_t i = 0; i * slab < size_; ++i) {
+        const size_t count = std::min(slab, size_ - i * slab);
+        if (!slabs_[i]) {
+            return {}; // 書き込まれていない区間がある（ダウンロードが完了していない）
+        }
+        out.emplace_back(slabs_[i].data(), count);
+    }
+    return out;
+}
+
+size_t PooledMemorySink::copyTo(std::span<char> out) const {
+    size_t copied = 0;
+    for (const auto& chunk : chunks()) {
+        const size_t count = std::min(chunk.size(), out.size() - copied);
+        std::memcpy(out.data() + copied, chunk.data(), count);
+        copied += count;
+        if (copied == out.size()) {
+            break;
+        }
+    }
+    return copied;
+}
+
+void PooledMemorySink::clear() {
+    std::vector<BufferPool::Buffer> slabs;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slabs.swap(slabs_);
+        size_ = 0;
+    }
+    // スラブはロックの外でプールへ返す（slabs の破棄で返る）
+}
+
+// =============================================================================
+// CallbackSink
+// =============================================================================
+
+CallbackSink::CallbackSink(Callback onData, OpenCallback onOpen,
+                           std::function<bool()> onClose)
+    : onData_(std::move(onData))
+    , onOpen_(std::move(onOpen))
+    , onClose_(std::move(onClose)) {
+}
+
+bool CallbackSink::open(int64_t expectedSize) {
+    return onOpen_ ? onOpen_(expectedSize) : true;
+}
+
+bool CallbackSink::write(int64_t /*offset*/, std::span<const char> data) {
+    return onData_ ? onData_(data) : true;
+}
+
+bool CallbackSink::close() {
+    return onClose_ ? onClose_() : true;
+}
+
+// =============================================================================
+// StreamSink
+// =============================================================================
+
+bool StreamSink::write(int64_t /*offset*/, std::span<const char> data) {
+    out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return out_.good();
+}
+
+bool StreamSink::close() {
+    out_.flush();
+    return out_.good();
+}
+
+} // namespace Downloader
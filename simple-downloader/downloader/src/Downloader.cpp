@@ -4,66 +4,551 @@
 //
 // 設計方針:
 //  - ワーカースレッドが curl を介してデータを受信し、ファイルに書き込む
-//  - 一時停止は condition_variable で実装（CPU を消費しない待機）
+//  - 一時停止は WRITE_PAUSE (CURL_WRITEFUNC_PAUSE) で転送を止めて実装し、
+//    長時間続いた場合は接続を切断して再開時に Range で続きから取り直す
 //  - キャンセルは atomic フラグで curl コールバックから中断する
 //  - レジュームは CURLOPT_RESUME_FROM_LARGE で実現（HTTP Range ヘッダー）
-//  - 1024 バイトのチャンクバッファで低メモリを維持
+//  - 受信データは BufferedWriter でまとめ、大きな単位でファイルに書き出す
+//    （FileWriter が位置を指定して書く。領域の事前確保・direct I/O・ページキャッシュの破棄・
+//    定期的な fdatasync は設定に従い、atomicOutput では一時ファイルを完了時に rename する）
+//  - 出力先はファイル・呼び出し側のメモリ・IDownloadSink のいずれか
+//  - サイズが分かる場合は mmap した出力ファイル（または呼び出し側のメモリ）へ
+//    受信データを直接コピーする
+//  - asyncDiskWrites 時は DiskWriteQueue の書き出しスレッドがファイルに書き込み、
+//    キューが上限に達した転送は空きができるまで止める
+//  - Range 対応サーバでは複数セグメントを並列取得し、各オフセットに書き込む
+//  - 複数ミラーでは区間をミラーに振り分け、区間を終えた転送は残りの最も多い区間の
+//    後半を受信速度の比で引き取る（引き取られた側は rangeMutex の下で区間の終わりを
+//    確かめてから書き込む）。失敗した転送は最も速いミラーで続きから取り直す
+//  - 一時的な失敗（切断・タイムアウト・429/503 など）は指数バックオフで待ってから
+//    restartTransfer で受信済みの位置の続きを取り直す。複数ミラーでは先に別のミラーへ切り替える
+//  - resumeJournal 時は受信済み区間を ResumeJournal に記録し、再開時は内容を
+//    照合して欠けた区間だけを If-Range 付きのセグメントとして取り直す
+//  - ダイジェストは書き込みコールバックで受信と同時に計算する。CRC-32C は
+//    セグメントごとに並列に計算して連結し、連結できない SHA-256 を分割して
+//    取得した場合（ジャーナルからの再開を含む）だけ完了後に出力を読み直す
+//  - 圧縮転送は curl に展開させる (INLINE) か、圧縮されたまま受信して
+//    DiskWriteQueue の別スレッドで ContentDecoder が展開する (PIPELINED)
+//  - adaptiveReceiveBuffer 時は転送ごとの ReceiveTuner が帯域遅延積を測り、
+//    転送中の接続の SO_RCVBUF を広げ、次の接続の CURLOPT_BUFFERSIZE を決める
+//  - 帯域制限は BandwidthScheduler の受信枠で行い、割り当てを超える受信は
+//    ワーカースレッド駆動では待機、イベントループ駆動では WRITE_PAUSE で止める
+//  - warmUp() は接続元ごとに HEAD を送り、共有の DNS・TLS セッション・接続キャッシュを
+//    温めておく。各転送の時間の内訳はジョブで最初に応答を受けたものを統計に残す
+//  - DownloadManager 駆動時は curl_multi のイベントループ上で転送する
+//  - オブザーバーリストはコピーオンライトで、通知時はロックを取らない。
+//    進捗通知は間引いてから配信し、asyncObserverDispatch 時は専用スレッドに任せる
+//  - config.metrics があれば、受信量・再試行・停止時間と、コールバック・書き出し・
+//    接続の各段階の時間を DownloadMetrics に記録する（記録はロックを取らない）
 // =============================================================================
 
 #include "Downloader.h"
+#include "BufferedWriter.h"
+#include "Checksum.h"
+#include "ContentDecoder.h"
 #include "CurlHandle.h"
+#include "CurlHandlePool.h"
+#include "DiskWriteQueue.h"
+#include "DownloadManager.h"
+#include "DownloadMetrics.h"
+#include "IPeerTracker.h"
+#include "MappedFile.h"
+#include "ObserverDispatcher.h"
+#include "PeerServer.h"
+#include "ReceiveTuner.h"
+#include "ResumeJournal.h"
 
 #include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
 #include <stdexcept>
-
-#ifdef _WIN32
-#  include <windows.h> // CURL グローバル初期化のために必要な場合がある
-#endif
+#include <string_view>
+#include <utility>
 
 namespace Downloader {
 
 // =============================================================================
-// グローバル curl 初期化 (プロセス単位で一度だけ実施)
+// HTTP ヘッダー解析ヘルパー
+// =============================================================================
+
+namespace {
+
+/// 前後の空白と改行を取り除く
+std::string_view trim(std::string_view text) {
+    while (!text.empty() &&
+           std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() &&
+           std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+/// ASCII の大文字小文字を無視して比較する
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// "Name: value" 形式のヘッダー行を分解する
+/// @return true: ヘッダー行だった / false: ステータス行や空行
+bool parseHeaderLine(std::string_view line,
+                     std::string_view& name, std::string_view& value) {
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return false;
+    name  = trim(line.substr(0, colon));
+    value = trim(line.substr(colon + 1));
+    return !name.empty();
+}
+
+/// URL の接続元（"scheme://host:port" の部分、小文字）。同じ接続を使える URL の判定に使う
+std::string originOf(std::string_view url) {
+    const size_t scheme = url.find("://");
+    const size_t begin  = scheme == std::string_view::npos ? 0 : scheme + 3;
+    std::string origin(url.substr(0, url.find_first_of("/?#", begin)));
+    std::transform(origin.begin(), origin.end(), origin.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return origin;
+}
+
+/// Retry-After の値（秒数または HTTP-date）を待ち時間に変換する
+/// @return 待ち時間 (ms)。解釈できなければ -1
+long parseRetryAfter(std::string_view value) {
+    if (!value.empty() && std::all_of(value.begin(), value.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c));
+        })) {
+        const long long seconds = std::strtoll(std::string(value).c_str(), nullptr, 10);
+        return static_cast<long>(std::min<long long>(seconds, std::numeric_limits<long>::max() / 1000) * 1000);
+    }
+    const time_t date = curl_getdate(std::string(value).c_str(), nullptr);
+    if (date < 0) {
+        return -1;
+    }
+    const auto until = std::chrono::system_clock::from_time_t(date) - std::chrono::system_clock::now();
+    return static_cast<long>(std::max<long long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(until).count(), 0));
+}
+
+/// ファイルの先頭 limit バイト（負値なら全体）をダイジェストに加える
+/// @return false: 開けない・limit に満たない
+bool hashFile(const std::string& path, int64_t limit, StreamingChecksum& checksum) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    int64_t remaining = limit;
+    while (limit < 0 || remaining > 0) {
+        const auto want = limit < 0 ? buffer.size()
+                                    : static_cast<size_t>(std::min<int64_t>(
+                                          remaining, static_cast<int64_t>(buffer.size())));
+        in.read(buffer.data(), static_cast<std::streamsize>(want));
+        const auto got = static_cast<size_t>(in.gcount());
+        checksum.update(buffer.data(), got);
+        remaining -= static_cast<int64_t>(got);
+        if (got < want) {
+            break;
+        }
+    }
+    return limit < 0 ? in.eof() : remaining == 0;
+}
+
+/// 出力ファイルへの書き込みの設定
+FileWriter::Options fileWriterOptions(const DownloaderConfig& config) {
+    FileWriter::Options options;
+    options.directIo  = config.directIo;
+    options.dropCache = config.dropWrittenPages;
+    if (config.fileSync == FileSyncPolicy::PERIODIC) {
+        options.syncInterval = std::max<int64_t>(config.fileSyncInterval, 1);
+    }
+    return options;
+}
+
+/// since からの経過時間 (µs)
+uint64_t elapsedUs(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - since).count());
+}
+
+/// steady_clock の現在時刻 (ns)
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// セグメントごとに計算するダイジェスト（連結できない SHA-256 は完了後に読み直す）
+ChecksumAlgorithm segmentAlgorithm(ChecksumAlgorithm algorithm) {
+    return algorithm == ChecksumAlgorithm::CRC32C ? ChecksumAlgorithm::CRC32C
+                                                  : ChecksumAlgorithm::NONE;
+}
+
+} // namespace
+
+// =============================================================================
+// セグメント分割
+// =============================================================================
+
+std::vector<SegmentRange> planSegments(int64_t contentLength,
+                                       size_t  segmentCount,
+                                       int64_t minSegmentSize) {
+    std::vector<SegmentRange> segments;
+    if (contentLength <= 0 || segmentCount == 0) {
+        return segments;
+    }
+
+    // 最小サイズを下回らない範囲でセグメント数を決める
+    const int64_t minSize  = std::max<int64_t>(1, minSegmentSize);
+    const int64_t maxCount = std::max<int64_t>(1, contentLength / minSize);
+    const int64_t count    = std::min(static_cast<int64_t>(segmentCount), maxCount);
+    const int64_t baseSize = contentLength / count;
+
+    segments.reserve(static_cast<size_t>(count));
+    int64_t first = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        // 端数は最後のセグメントに含める
+        const int64_t last = (i == count - 1) ? contentLength - 1
+                                              : first + baseSize - 1;
+        segments.push_back({first, last});
+        first = last + 1;
+    }
+    return segments;
+}
+
+std::vector<SegmentRange> coalesceRanges(std::vector<SegmentRange> ranges, int64_t maxGap) {
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                [](const SegmentRange& range) {
+                                    return range.first < 0 || range.last < range.first;
+                                }),
+                 ranges.end());
+    std::sort(ranges.begin(), ranges.end(),
+              [](const SegmentRange& a, const SegmentRange& b) { return a.first < b.first; });
+
+    const int64_t gap = std::max<int64_t>(maxGap, 0);
+    std::vector<SegmentRange> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first - merged.back().last - 1 <= gap) {
+            merged.back().last = std::max(merged.back().last, range.last);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+// =============================================================================
+// Transfer: 1 本の curl 転送の状態
 // =============================================================================
 
-/// RAII でプロセス全体の curl グローバル状態を管理するクラス
-/// 複数の Downloader インスタンスが共存してもセーフ
-class CurlGlobalInit {
+struct Downloader::Transfer final : std::enable_shared_from_this<Transfer>, ICurlHandle::Receiver {
+    std::unique_ptr<ICurlHandle> curl;
+    Downloader*   owner        = nullptr; ///< 受け取ったイベントを渡す先（attachCallbacks で設定する）
+    MetricHistogram* writeLatency = nullptr; ///< 書き込みコールバックの所要時間（計測しない場合は nullptr）
+    FileWriter    file;                  ///< 出力先（HEAD では未使用）
+    bool          reservePending = false; ///< 最初の書き込みで応答のサイズまで領域を確保する
+    std::shared_ptr<DiskWriteQueue::Stream> diskStream; ///< 非同期書き込み時の file への書き込み口
+    std::unique_ptr<BufferedWriter> writer; ///< file への書き込みをまとめる
+    std::span<char> destination;         ///< writer がない場合に直接コピーする書き込み先
+    IDownloadSink* sink         = nullptr; ///< 書き込み先のシンク（writer・destination より優先）
+    int64_t       sinkOffset   = 0;      ///< sink へ書き込む先頭位置
+    std::shared_ptr<MappedFile> mapped;  ///< destination をマップしたファイル（共有所有）
+    bool          outputPending = false; ///< 出力先を最初の書き込みで決める
+    size_t        index        = 0;      ///< セグメント番号
+    bool          probe        = false;  ///< Range 対応を調べる HEAD
+    size_t        mirror       = 0;      ///< 取得元のミラー
+    SegmentRange  range{};               ///< 担当区間（ranged の場合のみ有効。balancing_ では range.last を rangeMutex で保護）
+    std::mutex    rangeMutex;            ///< balancing_: 区間の後半を引き取る側と排他する
+    int64_t       claimed      = 0;      ///< balancing_: 書き込むと決めたバイト数（rangeMutex で保護）
+    bool          done         = false;  ///< balancing_: 転送が終わった（引き取りの対象にしない。rangeMutex で保護）
+    bool          trimmed      = false;  ///< balancing_: 後半を引き取られた区間の終わりで止めた
+    int64_t       mirrorStart  = 0;      ///< 現在のミラーで受信を始めたときの received
+    std::chrono::steady_clock::time_point mirrorSince{}; ///< 現在のミラーで受信を始めた時刻
+    bool          peerData     = false;  ///< 現在の区間の一部をピアから受信した
+    std::vector<std::string> requestHeaders; ///< 追加のリクエストヘッダー（取り直すときにも付ける）
+    bool          ranged       = false;  ///< Range 指定の転送か
+    int64_t       offset       = 0;      ///< 単一ストリームの開始位置（レジューム位置）
+    int64_t       received     = 0;      ///< この転送で書き込んだバイト数
+    bool          overflow     = false;  ///< Range を無視した応答を検出した
+    bool          acceptRanges = false;  ///< HEAD: Accept-Ranges: bytes が返された
+    long          status       = 0;      ///< 応答のステータスコード（HTTP 以外は 0）
+    std::string   etag;                  ///< 応答の ETag
+    std::string   lastModified;          ///< 応答の Last-Modified
+    std::string   contentEncoding;       ///< 応答の Content-Encoding
+    std::unique_ptr<ContentDecoder> decoder; ///< PIPELINED: 展開用のスレッドだけが使う
+    std::shared_ptr<DiskWriteQueue::Stream> decodeStream; ///< PIPELINED: 展開用のスレッドへの受け渡し口
+    bool          decoderChecked = false; ///< PIPELINED: 展開するかを判定済み
+    std::string   decodeError;           ///< 展開用のスレッドでの失敗（decodeStream の drain 後に読む）
+    int64_t       journalStart = -1;     ///< ジャーナルに未記録の区間の先頭（-1: なし）
+    uint32_t      journalCrc   = 0;      ///< 未記録の区間の CRC-32
+    bool          journalChecked = false; ///< 単一ストリーム: ジャーナルを作るか判定済み
+    StreamingChecksum checksum;          ///< 書き込んだデータのダイジェスト
+    std::optional<ReceiveTuner> tuner;   ///< adaptiveReceiveBuffer の場合のみ（進捗コールバックだけが使う）
+    bool          suspended    = false;  ///< 長時間の一時停止で接続を切断した
+    int           retries      = 0;      ///< 続けて再試行した回数（受信が進んだ試行の後は 0 に戻す）
+    int64_t       attemptStart = 0;      ///< 今の試行を始めたときの received
+    long          retryAfterMs = -1;     ///< 応答の Retry-After (ms)、-1: なし
+    std::chrono::milliseconds retryWait{0}; ///< イベントループ駆動: 再試行を開始するまでの待ち時間
+    bool          backingOff   = false;  ///< イベントループ駆動: 再試行の開始を待っている（throttleMutex で保護）
+    std::atomic<bool> paused{false};     ///< WRITE_PAUSE で停止中
+    std::chrono::steady_clock::time_point pausedAt{}; ///< 停止した時刻
+    std::atomic<bool> throttled{false};  ///< 書き込み待ちの上限・帯域制限で WRITE_PAUSE 中
+    DiskWriteQueue* waitingQueue = nullptr; ///< throttled の原因になったキュー
+    std::mutex    throttleMutex;         ///< throttled の解除と curl の差し替えを排他する
+    bool          withheld     = false;  ///< 最後の書き込みコールバックで WRITE_PAUSE を返した
+    std::chrono::steady_clock::time_point withheldAt{}; ///< withheld にした時刻（停止時間の計測用）
+    int64_t       wireReported = 0;      ///< INLINE: 計測値に加えた受信量（進捗コールバックの dlnow）
+    size_t        bandwidthWait = 0;     ///< withheld の原因が帯域制限の場合、待っているバイト数
+    CurlResult    result       = CurlResult::OK;
+    std::string   error;                 ///< perform 中の例外メッセージ
+    std::function<void(CurlResult)> onFinished; ///< DownloadManager 駆動時の完了処理
+
+    ~Transfer() override { closeOutput(); }
+
+    // curl ハンドルからの受信イベント（Downloader の処理を直接呼ぶ）
+    size_t onWrite(const char* data, size_t size) override;
+    int onProgress(int64_t dltotal, int64_t dlnow) override;
+    void onHeader(const char* data, size_t size) override { parseHeader(std::string_view(data, size)); }
+
+    /// 応答ヘッダーを 1 行解析する（リダイレクト時は最後のレスポンスの値だけが残る）
+    void parseHeader(std::string_view line);
+
+    /// 次に書き込むファイル上の位置
+    int64_t position() const { return (ranged ? range.first : offset) + received; }
+
+    /// 出力ファイルを開き、書き込みバッファを用意する
+    /// @param diskQueue 非同期書き込みに使うキュー（nullptr の場合は転送スレッドで書く）
+    /// @param position  書き込み開始位置（負値の場合はシークしない）
+    bool openOutput(const std::string& path, FileWriter::Mode mode,
+                    const DownloaderConfig& config, DiskWriteQueue* diskQueue,
+                    int64_t position = -1);
+
+    /// バッファを書き出し、書き込み完了を待ってファイルを閉じる
+    /// @return false: 書き込みに失敗した
+    bool closeOutput();
+};
+
+size_t Downloader::Transfer::onWrite(const char* data, size_t size) {
+    if (probe) {
+        return size; // HEAD はボディを受け取らない
+    }
+    ScopedLatency timer(writeLatency);
+    return owner->onTransferWrite(*this, data, size);
+}
+
+int Downloader::Transfer::onProgress(int64_t dltotal, int64_t dlnow) {
+    if (probe) {
+        return owner->cancelRequested_.load(std::memory_order_acquire) ? 1 : 0;
+    }
+    return owner->onTransferProgress(*this, dltotal, dlnow);
+}
+
+void Downloader::Transfer::parseHeader(std::string_view line) {
+    if (line.rfind("HTTP/", 0) == 0) {
+        const size_t space = line.find(' ');
+        status = 0;
+        if (space != std::string_view::npos) {
+            const std::string_view code = line.substr(space + 1, 3);
+            std::from_chars(code.data(), code.data() + code.size(), status);
+        }
+        acceptRanges = false;
+        etag.clear();
+        lastModified.clear();
+        contentEncoding.clear();
+        retryAfterMs = -1;
+        return;
+    }
+    std::string_view name;
+    std::string_view value;
+    if (!parseHeaderLine(line, name, value)) {
+        return;
+    }
+    if (iequals(name, "Accept-Ranges")) {
+        acceptRanges = iequals(value, "bytes");
+    } else if (iequals(name, "ETag")) {
+        etag = value;
+    } else if (iequals(name, "Last-Modified")) {
+        lastModified = value;
+    } else if (iequals(name, "Content-Encoding")) {
+        contentEncoding = value;
+    } else if (iequals(name, "Retry-After")) {
+        retryAfterMs = parseRetryAfter(value);
+    } else if (iequals(name, "Content-Range") && ranged) {
+        // 末尾を越えて要求した区間は、応答の全体サイズまでに縮める（"bytes first-last/total"）
+        const size_t slash = value.rfind('/');
+        int64_t      total = -1;
+        if (slash != std::string_view::npos) {
+            std::from_chars(value.data() + slash + 1, value.data() + value.size(), total);
+        }
+        std::lock_guard<std::mutex> lock(rangeMutex);
+        if (total > range.first && range.last >= total) {
+            range.last = total - 1;
+        }
+    }
+}
+
+bool Downloader::Transfer::openOutput(const std::string& path,
+                                      FileWriter::Mode mode,
+                                      const DownloaderConfig& config,
+                                      DiskWriteQueue* diskQueue,
+                                      int64_t position) {
+    // BufferedWriter がまとめて書くため、書き出し 1 回がそのまま 1 回の pwrite になる
+    if (!file.open(path, mode, fileWriterOptions(config))) {
+        return false;
+    }
+    if (position >= 0) {
+        file.seek(position);
+    }
+
+    FileWriter*      out     = &file;
+    MetricHistogram* latency = config.metrics ? &config.metrics->diskWriteUs : nullptr;
+    BufferedWriter::Sink sink = [out, latency](const char* data, size_t size) {
+        ScopedLatency timer(latency);
+        return out->write(data, size);
+    };
+    if (diskQueue) {
+        // ファイルへの書き込みは書き出しスレッドが行い、転送側はブロックを積むだけ
+        diskStream = diskQueue->open(std::move(sink));
+        DiskWriteQueue::Stream* stream = diskStream.get();
+        sink = [stream](const char* data, size_t size) {
+            return stream->write(data, size);
+        };
+    }
+
+    // 非同期書き込みでは書き出しスレッドが別にあるため 2 面バッファは使わない
+    writer = std::make_unique<BufferedWriter>(
+        config.writeBufferSize, std::move(sink),
+        config.doubleBufferWrites && !diskQueue, config.bufferPool);
+    return true;
+}
+
+bool Downloader::Transfer::closeOutput() {
+    bool ok = true;
+    // 展開待ちのデータを先に書き込ませる（展開結果は decodeError に残る）
+    if (decodeStream) {
+        ok = decodeStream->drain();
+        decodeStream.reset();
+    }
+    if (writer) {
+        ok = writer->flush();
+        writer.reset();
+    }
+    if (diskStream) {
+        ok = diskStream->drain() && ok;
+        diskStream.reset();
+    }
+    // マッピングは最後のセグメントが手放したときに解除される
+    destination = {};
+    mapped.reset();
+    if (file.isOpen()) {
+        ok = file.close() && ok;
+    }
+    return ok;
+}
+
+namespace {
+
+/// オブザーバーリストの解放を removeObserver へ知らせる
+class ListRelease {
 public:
-    CurlGlobalInit() {
-        // curl_global_init はスレッドセーフではないため、
-        // 静的初期化（シングルトン）でプロセス開始時に一度だけ呼ぶ
-        curl_global_init(CURL_GLOBAL_ALL);
+    void signal() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return released_; });
     }
-    ~CurlGlobalInit() {
-        curl_global_cleanup();
+
+private:
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    bool                    released_ = false;
+};
+
+/// オブザーバーリストのデリーター（最後の参照が外れたら ListRelease を通知する）
+struct ListDeleter {
+    std::shared_ptr<ListRelease> release = std::make_shared<ListRelease>();
+
+    void operator()(const std::vector<IDownloaderObserver*>* list) const {
+        delete list;
+        release->signal();
     }
 };
 
-// プログラム起動時に一度だけ初期化される
-static CurlGlobalInit g_curlGlobalInit;
+/// 解放を待てるオブザーバーリストを生成する
+std::shared_ptr<const std::vector<IDownloaderObserver*>> makeObserverList(
+    std::vector<IDownloaderObserver*> observers) {
+    return {new std::vector<IDownloaderObserver*>(std::move(observers)), ListDeleter{}};
+}
+
+} // namespace
 
 // =============================================================================
 // コンストラクタ / デストラクタ
 // =============================================================================
 
 Downloader::Downloader(DownloaderConfig config)
-    : config_(std::move(config))
-    , curlFactory_([]() -> std::unique_ptr<ICurlHandle> {
-          return std::make_unique<CurlHandle>();
-      }) {
-    // write バッファを設定されたチャンクサイズで事前確保（低メモリ設計）
-    writeBuffer_.resize(config_.chunkSize);
+    // プロセス共有プールから借りて DNS・TLS セッション・接続を再利用する
+    : Downloader(std::move(config), CurlHandlePool::shared().makeFactory()) {
 }
 
 Downloader::Downloader(DownloaderConfig config, CurlFactory curlFactory)
     : config_(std::move(config))
-    , curlFactory_(std::move(curlFactory)) {
-    writeBuffer_.resize(config_.chunkSize);
+    , curlFactory_(std::move(curlFactory))
+    , observers_(makeObserverList({})) {
+    if (config_.asyncDiskWrites) {
+        diskQueue_ = std::make_unique<DiskWriteQueue>(config_.diskQueueLimit, config_.bufferPool);
+    }
+    decoding_ = config_.contentDecoding;
+    if (decoding_ == ContentDecoding::PIPELINED) {
+        if (ContentDecoder::supportedEncodings().empty()) {
+            decoding_ = ContentDecoding::INLINE;
+        } else {
+            decodeQueue_ = std::make_unique<DiskWriteQueue>(config_.diskQueueLimit, config_.bufferPool);
+        }
+    }
+    BandwidthScheduler& scheduler = config_.bandwidthScheduler
+                                        ? *config_.bandwidthScheduler
+                                        : BandwidthScheduler::shared();
+    bandwidth_ = scheduler.openChannel(config_.priority);
+    bandwidth_->setLimit(config_.maxBytesPerSec);
+    if (config_.asyncObserverDispatch) {
+        dispatcher_ = std::make_unique<ObserverDispatcher>();
+    }
+}
+
+Downloader::Downloader(DownloaderConfig config, DownloadManager& manager)
+    : Downloader(std::move(config)) {
+    manager_      = &manager;
+    progressSlot_ = manager.progressTable().acquire(this);
+}
+
+Downloader::Downloader(DownloaderConfig config, DownloadManager& manager,
+                       CurlFactory curlFactory)
+    : Downloader(std::move(config), std::move(curlFactory)) {
+    manager_      = &manager;
+    progressSlot_ = manager.progressTable().acquire(this);
 }
 
 Downloader::~Downloader() {
@@ -71,8 +556,19 @@ Downloader::~Downloader() {
     cancel();
 
     // ワーカースレッドが起動していれば join して完全終了を待つ
-    if (workerThread_.joinable()) {
-        workerThread_.join();
+    joinWorker();
+
+    // イベントループ上の完了処理が終わるまで待つ
+    {
+        std::unique_lock<std::mutex> lock(jobMutex_);
+        jobCv_.wait(lock, [this]() { return !jobActive_; });
+    }
+
+    // 積まれている通知をすべて配信してからディスパッチスレッドを終了する
+    dispatcher_.reset();
+
+    if (manager_) {
+        manager_->progressTable().release(progressSlot_);
     }
 }
 
@@ -80,21 +576,56 @@ Downloader::~Downloader() {
 // Observer 管理
 // =============================================================================
 
+namespace {
+
+/// このスレッドがオブザーバーのコールバックを実行中か（removeObserver の待機判定用）
+thread_local int observerCallbackDepth = 0;
+
+/// observerCallbackDepth を上げ、オブザーバーが例外を投げても戻す
+struct CallbackDepthGuard {
+    CallbackDepthGuard() { ++observerCallbackDepth; }
+    ~CallbackDepthGuard() { --observerCallbackDepth; }
+
+    CallbackDepthGuard(const CallbackDepthGuard&)            = delete;
+    CallbackDepthGuard& operator=(const CallbackDepthGuard&) = delete;
+};
+
+} // namespace
+
 void Downloader::addObserver(IDownloaderObserver* observer) {
     if (!observer) return;
     std::lock_guard<std::mutex> lock(observerMutex_);
+    const auto current = observers_.load(std::memory_order_acquire);
     // 重複登録を防ぐ
-    auto it = std::find(observers_.begin(), observers_.end(), observer);
-    if (it == observers_.end()) {
-        observers_.push_back(observer);
+    if (std::find(current->begin(), current->end(), observer) != current->end()) {
+        return;
     }
+    ObserverList next(*current);
+    next.push_back(observer);
+    observers_.store(makeObserverList(std::move(next)), std::memory_order_release);
 }
 
 void Downloader::removeObserver(IDownloaderObserver* observer) {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    observers_.erase(
-        std::remove(observers_.begin(), observers_.end(), observer),
-        observers_.end());
+    std::shared_ptr<const ObserverList> previous;
+    {
+        std::lock_guard<std::mutex> lock(observerMutex_);
+        previous = observers_.load(std::memory_order_acquire);
+        if (std::find(previous->begin(), previous->end(), observer) == previous->end()) {
+            return;
+        }
+        ObserverList next(*previous);
+        next.erase(std::remove(next.begin(), next.end(), observer), next.end());
+        observers_.store(makeObserverList(std::move(next)), std::memory_order_release);
+    }
+
+    // 古いリストを持つ通知（配信待ちを含む）がなくなり、リストが解放されるまで待つ。
+    // コールバック内から呼ばれた場合は自身がリストを持っているため待たない
+    if (observerCallbackDepth > 0) {
+        return;
+    }
+    const auto release = std::get_deleter<ListDeleter>(previous)->release;
+    previous.reset();
+    release->wait();
 }
 
 // =============================================================================
@@ -102,7 +633,83 @@ void Downloader::removeObserver(IDownloaderObserver* observer) {
 // =============================================================================
 
 bool Downloader::startDownload(const std::string& url,
-                               const std::string& outputPath) {
+                               const std::string& outputPath,
+                               CompletionHandler onDone) {
+    return startDownload(std::vector<std::string>{url}, outputPath, std::move(onDone));
+}
+
+bool Downloader::startDownload(const std::string& url,
+                               std::span<char> destination,
+                               CompletionHandler onDone) {
+    return startDownload(std::vector<std::string>{url}, destination, std::move(onDone));
+}
+
+bool Downloader::startDownload(const std::string& url, IDownloadSink& sink,
+                               CompletionHandler onDone) {
+    return startDownload(std::vector<std::string>{url}, sink, std::move(onDone));
+}
+
+bool Downloader::startDownload(const std::vector<std::string>& mirrors,
+                               const std::string& outputPath,
+                               CompletionHandler onDone) {
+    OutputTarget output;
+    output.path = outputPath;
+    return start(mirrors, std::move(output), std::move(onDone));
+}
+
+bool Downloader::startDownload(const std::vector<std::string>& mirrors,
+                               std::span<char> destination,
+                               CompletionHandler onDone) {
+    OutputTarget output;
+    output.toMemory    = true;
+    output.destination = destination;
+    return start(mirrors, std::move(output), std::move(onDone));
+}
+
+bool Downloader::startDownload(const std::vector<std::string>& mirrors, IDownloadSink& sink,
+                               CompletionHandler onDone) {
+    OutputTarget output;
+    output.sink = &sink;
+    return start(mirrors, std::move(output), std::move(onDone));
+}
+
+bool Downloader::startRangeDownload(const std::string& url, const std::vector<SegmentRange>& ranges,
+                                    const std::string& outputPath, CompletionHandler onDone) {
+    auto merged = coalesceRanges(ranges, config_.rangeCoalesceGap);
+    if (merged.empty()) {
+        // 空の区間リストを start() に渡すとオブジェクト全体のダウンロードになる
+        return false;
+    }
+    OutputTarget output;
+    output.path = outputPath;
+    return start({url}, std::move(output), std::move(onDone), std::move(merged));
+}
+
+bool Downloader::startRangeDownload(const std::string& url, const std::vector<SegmentRange>& ranges,
+                                    IDownloadSink& sink, CompletionHandler onDone) {
+    if (!sink.supportsRandomAccess()) {
+        return false;
+    }
+    auto merged = coalesceRanges(ranges, config_.rangeCoalesceGap);
+    if (merged.empty()) {
+        return false;
+    }
+    OutputTarget output;
+    output.sink = &sink;
+    return start({url}, std::move(output), std::move(onDone), std::move(merged));
+}
+
+bool Downloader::start(const std::vector<std::string>& urls, OutputTarget output,
+                       CompletionHandler onDone, std::vector<SegmentRange> ranges) {
+    if (urls.empty()) {
+        return false;
+    }
+    // 展開した出力の位置は区間の位置と対応しないため、圧縮転送では区間を読み出せない
+    const bool rangeRead = !ranges.empty();
+    if (rangeRead && decoding_ != ContentDecoding::NONE) {
+        return false;
+    }
+
     // 既に実行中の場合は拒否する
     DownloadState current = state_.load(std::memory_order_acquire);
     if (current == DownloadState::DOWNLOADING ||
@@ -111,25 +718,102 @@ bool Downloader::startDownload(const std::string& url,
     }
 
     // 前回のスレッドが残っていれば join して完全終了を待つ
-    if (workerThread_.joinable()) {
-        workerThread_.join();
+    joinWorker();
+
+    // 前回のジョブ（イベントループ上の完了処理）が終わるまで待つ
+    {
+        std::unique_lock<std::mutex> lock(jobMutex_);
+        jobCv_.wait(lock, [this]() { return !jobActive_; });
+        jobActive_  = true;
+        completion_ = std::move(onDone);
+        transferError_.clear();
+        // 先頭の区間から順に取り出せるよう逆順に持つ
+        pendingRanges_.assign(ranges.rbegin(), ranges.rend());
+    }
+
+    // 内容を照合できるダウンロードは、同じ内容を持つピアをミラーの後ろに加える
+    std::vector<std::string> peers;
+    if (config_.peerTracker && !rangeRead && config_.checksumAlgorithm != ChecksumAlgorithm::NONE &&
+        !trim(config_.expectedChecksum).empty() && decoding_ == ContentDecoding::NONE) {
+        const std::string self = config_.peerServer ? config_.peerServer->peerUrl(urls.front())
+                                                    : std::string();
+        for (auto& peer : config_.peerTracker->peersFor(urls.front())) {
+            if (peers.size() >= config_.maxPeers) {
+                break;
+            }
+            if (peer != self && std::find(urls.begin(), urls.end(), peer) == urls.end() &&
+                std::find(peers.begin(), peers.end(), peer) == peers.end()) {
+                peers.push_back(std::move(peer));
+            }
+        }
+    }
+
+    // 一時ファイルに書き込み、完了時に出力へ置き換える（ジャーナル・レジュームも一時ファイルで行う）
+    if (config_.atomicOutput && !output.toMemory && !output.sink) {
+        output.finalPath = output.path;
+        output.path += ".part";
     }
 
     // 状態をリセットする
     {
         std::lock_guard<std::mutex> lock(statsMutex_);
-        url_        = url;
-        outputPath_ = outputPath;
+        url_        = urls.front();
+        output_     = std::move(output);
+        sinkOpened_ = false;
+        checksum_.clear();
+        timings_ = {};
+        mirrors_.clear();
+        for (const auto& url : urls) {
+            mirrors_.push_back({url});
+        }
+        for (auto& peer : peers) {
+            mirrors_.push_back({.url = std::move(peer), .peer = true});
+        }
+    }
+    // 受信枠のホストは先頭のミラーで決める（ミラーごとのホスト上限は区別しない）
+    bandwidth_->setHost(hostFromUrl(urls.front()));
+    const size_t sources = urls.size() + peers.size();
+    balancing_     = sources > 1;
+    segmentCount_  = balancing_ ? std::max(config_.segmentCount, sources) : config_.segmentCount;
+    rangeRead_     = rangeRead;
+    rangeExtent_   = rangeRead ? ranges.back().last + 1 : 0;
+    discardOutput_ = false;
+    originRetry_   = false;
+    peerBytes_.store(0, std::memory_order_relaxed);
+    rangeBytes_    = 0;
+    for (const auto& range : ranges) {
+        rangeBytes_ += range.size();
     }
     downloadedBytes_.store(0, std::memory_order_relaxed);
     totalBytes_.store(0, std::memory_order_relaxed);
+    wireBytes_.store(0, std::memory_order_relaxed);
+    wireTotalBytes_.store(0, std::memory_order_relaxed);
+    retryCount_.store(0, std::memory_order_relaxed);
+    lastProgressBytes_.store(-1, std::memory_order_relaxed);
+    lastProgressNs_.store(0, std::memory_order_relaxed);
+    pausedSinceNs_.store(0, std::memory_order_relaxed);
+    startedAt_ = std::chrono::steady_clock::now();
+    if (config_.metrics) {
+        config_.metrics->downloadsStarted.add(1);
+    }
     pauseRequested_.store(false, std::memory_order_release);
     cancelRequested_.store(false, std::memory_order_release);
+    transferFailed_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        pauseNotified_ = false;
+    }
 
     state_.store(DownloadState::DOWNLOADING, std::memory_order_release);
+    publishProgress();
 
-    // ワーカースレッドを起動する
-    workerThread_ = std::thread(&Downloader::workerThread, this);
+    if (manager_) {
+        // イベントループ駆動: 最初の転送を登録するだけでリターンする
+        runDownload();
+    } else {
+        // ワーカースレッドを起動する
+        workerThread_ = std::thread(&Downloader::workerThread, this);
+    }
 
     return true;
 }
@@ -140,6 +824,7 @@ void Downloader::pause() {
                                        std::memory_order_acq_rel)) {
         // pause フラグを立てる（curl コールバック内で検出する）
         pauseRequested_.store(true, std::memory_order_release);
+        pausedSinceNs_.store(steadyNowNs(), std::memory_order_relaxed);
     }
 }
 
@@ -148,8 +833,29 @@ void Downloader::resume() {
     if (state_.compare_exchange_strong(expected, DownloadState::DOWNLOADING,
                                        std::memory_order_acq_rel)) {
         pauseRequested_.store(false, std::memory_order_release);
-        // 一時停止中のワーカースレッドを起こす
+        recordPauseEnd();
+
+        std::vector<TransferPtr> suspended;
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex_);
+            if (pauseNotified_) {
+                pauseNotified_ = false;
+                notifyResumed();
+            }
+            // WRITE_PAUSE で停止している転送を再開させる
+            unpauseTransfersLocked();
+            suspended.swap(suspendedTransfers_);
+        }
+
+        // 接続を切断して待機中のワーカースレッドを起こす
         pauseCv_.notify_all();
+
+        // 接続を切断して保留中の転送は続きから取り直す
+        for (const auto& transfer : suspended) {
+            if (!resubmitTransfer(transfer)) {
+                finishManagedTransfer(transfer, CurlResult::OTHER_ERROR);
+            }
+        }
     }
 }
 
@@ -157,40 +863,146 @@ void Downloader::cancel() {
     // IDLE 以外の全状態からキャンセル可能
     cancelRequested_.store(true, std::memory_order_release);
     pauseRequested_.store(false, std::memory_order_release);
+    recordPauseEnd();
 
     // 一時停止中のワーカーが condition_variable で待機している場合は起こす
+    std::vector<TransferPtr> suspended;
     {
         std::lock_guard<std::mutex> lock(pauseMutex_);
         // ロックを取得することで、ワーカーが cv.wait() に入る前/後のどちらの
         // タイミングでキャンセルされても確実に起こせる
+
+        // WRITE_PAUSE 中の転送は再開させ、書き込みコールバックで中断させる
+        unpauseTransfersLocked();
+        suspended.swap(suspendedTransfers_);
+
+        // 再試行を待っている転送はすぐに開始させ、同じく中断させる
+        if (manager_) {
+            for (const auto& transfer : activeTransfers_) {
+                std::lock_guard<std::mutex> throttleLock(transfer->throttleMutex);
+                if (std::exchange(transfer->backingOff, false)) {
+                    manager_->unpause(*transfer->curl);
+                }
+            }
+        }
     }
     pauseCv_.notify_all();
+
+    // 接続を切断して保留中の転送は、その場で中断として完了させる
+    for (const auto& transfer : suspended) {
+        finishManagedTransfer(transfer, CurlResult::ABORTED_BY_CALLBACK);
+    }
+}
+
+void Downloader::recordPauseEnd() {
+    // pause() から最初の resume() / cancel() までを 1 回だけ数える
+    const int64_t since = pausedSinceNs_.exchange(0, std::memory_order_relaxed);
+    if (since > 0 && config_.metrics) {
+        config_.metrics->pausedUs.add(static_cast<uint64_t>(std::max<int64_t>(steadyNowNs() - since, 0) / 1000));
+    }
 }
 
 // =============================================================================
-// 状態取得
+// 接続の事前確立
 // =============================================================================
 
-DownloadStats Downloader::getStats() const {
-    DownloadStats stats;
-    stats.state         = state_.load(std::memory_order_acquire);
-    stats.downloadedBytes = downloadedBytes_.load(std::memory_order_relaxed);
-    stats.totalBytes    = totalBytes_.load(std::memory_order_relaxed);
+size_t Downloader::warmUp(const std::vector<std::string>& urls) {
+    // 同じ接続元への 2 本目は 1 本目の接続を待つだけなので、接続元ごとに 1 本にする
+    std::vector<std::string> targets;
+    std::vector<std::string> origins;
+    for (const auto& url : urls) {
+        std::string origin = originOf(url);
+        if (std::find(origins.begin(), origins.end(), origin) == origins.end()) {
+            origins.push_back(std::move(origin));
+            targets.push_back(url);
+        }
+    }
 
-    if (stats.totalBytes > 0) {
-        stats.percent = static_cast<double>(stats.downloadedBytes) /
-                        static_cast<double>(stats.totalBytes) * 100.0;
+    std::atomic<size_t> connected{0};
+    auto warmOne = [this, &connected](const std::string& url) {
+        try {
+            auto curl = createHandleFor(url);
+            if (!curl) {
+                return;
+            }
+            // 応答のステータスは問わない（4xx でも接続はキャッシュに残る）
+            curl->setNoBody(true);
+            // 進捗コールバックがないと curl が既定の進捗表示を標準エラーに出す
+            curl->setProgressCallback([](int64_t, int64_t) { return 0; });
+            if (curl->perform() == CurlResult::OK) {
+                connected.fetch_add(1, std::memory_order_relaxed);
+            }
+        } catch (const std::exception&) {
+            // 事前確立の失敗はダウンロードの失敗ではないため、数えないだけにする
+        }
+    };
+    if (targets.size() == 1) {
+        warmOne(targets.front());
     } else {
-        stats.percent = -1.0;
+        std::vector<std::thread> threads;
+        threads.reserve(targets.size());
+        for (const auto& url : targets) {
+            threads.emplace_back(warmOne, std::cref(url));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
     }
+    return connected.load(std::memory_order_relaxed);
+}
+
+// =============================================================================
+// 状態取得
+// =============================================================================
+
+DownloadProgress Downloader::getProgress() const noexcept {
+    DownloadProgress progress;
+    progress.state           = state_.load(std::memory_order_acquire);
+    progress.downloadedBytes = downloadedBytes_.load(std::memory_order_relaxed);
+    progress.totalBytes      = totalBytes_.load(std::memory_order_relaxed);
+    progress.wireBytes       = wireBytes_.load(std::memory_order_relaxed);
+    progress.percent         = progressPercent(progress.downloadedBytes, progress.totalBytes);
+    progress.retryCount      = retryCount_.load(std::memory_order_relaxed);
+    return progress;
+}
+
+DownloadStats Downloader::getStats() const {
+    const DownloadProgress progress = getProgress();
+    DownloadStats stats;
+    stats.state           = progress.state;
+    stats.downloadedBytes = progress.downloadedBytes;
+    stats.totalBytes      = progress.totalBytes;
+    stats.wireBytes       = progress.wireBytes;
+    stats.percent         = progress.percent;
+    stats.retryCount      = progress.retryCount;
 
     std::lock_guard<std::mutex> lock(statsMutex_);
     stats.url        = url_;
-    stats.outputPath = outputPath_;
+    stats.outputPath = output_.finalPath.empty() ? output_.path : output_.finalPath;
+    stats.checksum   = checksum_;
+    if (mirrors_.size() > 1) {
+        for (const auto& mirror : mirrors_) {
+            stats.mirrors.push_back({mirror.url, mirror.bytes, mirror.rate, mirror.failed, mirror.peer});
+        }
+    }
+    stats.timings = timings_;
 
     return stats;
 }
 
+void Downloader::setMaxBytesPerSec(int64_t bytesPerSec) {
+    bandwidth_->setLimit(bytesPerSec);
+}
+
+void Downloader::setPriority(TransferPriority priority) {
+    bandwidth_->setPriority(priority);
+}
+
+Downloader::OutputTarget Downloader::getOutput() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return output_;
+}
+
 DownloadState Downloader::getState() const {
     return state_.load(std::memory_order_acquire);
 }
@@ -200,119 +1012,1693 @@ DownloadState Downloader::getState() const {
 // =============================================================================
 
 void Downloader::workerThread() {
+    runDownload();
+
+    // onDone はジョブの処理をすべて終えてから呼ぶ（破棄・次の開始をしてよいため、以降はメンバーに触れない）
+    if (auto completion = std::exchange(deferredCompletion_, nullptr)) {
+        completion();
+    }
+}
+
+void Downloader::joinWorker() {
+    if (!workerThread_.joinable()) {
+        return;
+    }
+    if (workerThread_.get_id() == std::this_thread::get_id()) {
+        // ワーカースレッドの onDone の中から呼ばれた: onDone の後はメンバーに触れないので切り離してよい
+        workerThread_.detach();
+    } else {
+        workerThread_.join();
+    }
+}
+
+void Downloader::runDownload() {
     // 例外はすべてここでキャッチして onError に変換する
     try {
-        doDownload();
+        beginDownload();
     } catch (const std::exception& e) {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError(std::string("Unexpected exception: ") + e.what());
+        failDownload(std::string("Unexpected exception: ") + e.what());
     } catch (...) {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Unknown exception in worker thread");
+        failDownload("Unknown exception in worker thread");
     }
 }
 
-void Downloader::doDownload() {
-    // --------------------------------------------------------
-    // (1) 出力ファイルを開く
-    //     レジューム対応のため、既存ファイルがあれば追記モードで開く
-    // --------------------------------------------------------
-    std::string outputPath;
-    std::string url;
-    {
-        std::lock_guard<std::mutex> lock(statsMutex_);
-        outputPath = outputPath_;
-        url        = url_;
+void Downloader::beginDownload() {
+    const OutputTarget output = getOutput();
+    const bool         toFile = !output.toMemory && !output.sink;
+    // 展開した出力の位置は圧縮されたボディの位置と対応しないため、
+    // 圧縮転送は続きからも分割しても取得できない
+    const bool         decoding = decoding_ != ContentDecoding::NONE;
+
+    // 前回のダウンロードの配布は、出力を上書きする前にやめる
+    withdrawFromPeers();
+
+    // 区間の読み出しはキャッシュ・ジャーナル・レジュームを使わない
+    if (rangeRead_) {
+        cache_ = {};
+        journal_.reset();
+        journalEnabled_ = false;
+        journalResume_  = false;
+        journalMismatch_.store(false, std::memory_order_relaxed);
+        startRanges();
+        return;
+    }
+
+    // キャッシュにあれば、内容のダイジェストか条件付きリクエストで確かめてから使う
+    cache_         = {};
+    cache_.enabled = config_.cache && toFile && !decoding && !balancing_;
+    if (cache_.enabled) {
+        // キャッシュとハードリンクを共有している出力には書き込まない
+        DownloadCache::detach(output.path);
+        const std::string expected(trim(config_.expectedChecksum));
+        if (config_.checksumAlgorithm == ChecksumAlgorithm::SHA256 && !expected.empty()) {
+            const auto entry = config_.cache->lookupDigest(expected);
+            if (entry && completeFromCache(*entry, expected)) {
+                return;
+            }
+        }
+        std::string url;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            url = url_;
+        }
+        cache_.entry = config_.cache->lookup(url);
+    }
+
+    // ジャーナルがあれば、記録された区間を検証して欠けた部分だけを取り直す
+    journal_.reset();
+    journalEnabled_ = config_.resumeJournal && toFile && !decoding;
+    journalResume_  = false;
+    journalMismatch_.store(false, std::memory_order_relaxed);
+    // （キャッシュの記録を再検証する場合は、304 でなければ最初から取り直す）
+    if (journalEnabled_ && !cache_.entry && resumeFromJournal(output.path)) {
+        return;
     }
 
     // 既存ファイルのサイズを確認してレジューム位置を決定する
+    // （メモリ領域・シンクへのダウンロードは常に先頭から）
     int64_t resumeFrom = 0;
-    {
-        std::ifstream existing(outputPath, std::ios::binary | std::ios::ate);
+    if (toFile && !decoding && !cache_.entry) {
+        std::ifstream existing(output.path, std::ios::binary | std::ios::ate);
         if (existing.is_open()) {
             resumeFrom = static_cast<int64_t>(existing.tellg());
         }
     }
     downloadedBytes_.store(resumeFrom, std::memory_order_relaxed);
 
-    // ファイルを追記モードで開く
-    std::ofstream outFile(outputPath,
-                          std::ios::binary |
-                          (resumeFrom > 0 ? std::ios::app : std::ios::trunc));
-    if (!outFile.is_open()) {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Failed to open output file: " + outputPath);
+    // 新規ダウンロードかつ分割が有効な場合は、Range 対応を調べてセグメント取得する
+    // （順にしか受け取れないシンクと、読み直せないシンクへの SHA-256 は分割しない）
+    const bool sinkSplittable = output.sink && output.sink->supportsRandomAccess() &&
+                                config_.checksumAlgorithm != ChecksumAlgorithm::SHA256;
+    if (segmentCount_ > 1 && resumeFrom == 0 && !decoding &&
+        (!output.sink || sinkSplittable)) {
+        startProbe();
         return;
     }
 
+    startSingleStream(resumeFrom);
+}
+
+// =============================================================================
+// 単一ストリームダウンロード
+// =============================================================================
+
+void Downloader::startSingleStream(int64_t resumeFrom, size_t mirror) {
+    const OutputTarget output = getOutput();
+
     // --------------------------------------------------------
-    // (2) curl ハンドルを初期化する（ファクトリで生成）
+    // (1) curl ハンドルを初期化する（ファクトリで生成）
     // --------------------------------------------------------
-    auto curl = curlFactory_();
-    if (!curl) {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Failed to create curl handle");
+    auto transfer = createTransfer(mirror);
+    if (!transfer) {
+        failDownload("Failed to create curl handle");
         return;
     }
+    transfer->offset   = resumeFrom;
+    transfer->checksum = StreamingChecksum(config_.checksumAlgorithm);
 
-    curl->setUrl(url);
-    curl->setConnectTimeout(config_.connectTimeoutSec);
-    curl->setUserAgent(config_.userAgent);
-    curl->setFollowLocation(config_.followRedirects);
-    curl->setSslVerify(config_.sslVerify);
+    // キャッシュの記録があれば、変わっていない場合に 304 を返すよう条件を付ける
+    if (cache_.entry) {
+        transfer->requestHeaders = cache_.entry->conditionalHeaders();
+        transfer->curl->setRequestHeaders(transfer->requestHeaders);
+    }
 
-    if (config_.useHttp2) {
-        curl->enableHttp2();
+    // 続きから取得する場合は、既存の部分をダイジェストに含めておく
+    if (resumeFrom > 0 && config_.checksumAlgorithm != ChecksumAlgorithm::NONE &&
+        !hashFile(output.path, resumeFrom, transfer->checksum)) {
+        failDownload("Failed to read output file: " + output.path);
+        return;
+    }
+
+    // --------------------------------------------------------
+    // (2) 出力先を用意する
+    //     レジューム対応のため、既存ファイルがあれば追記モードで開く
+    //     シンクと mmap 出力はサイズが分かる最初の書き込みまで開くのを遅らせる
+    // --------------------------------------------------------
+    if (output.toMemory) {
+        transfer->destination = output.destination;
+    } else if (output.sink || (config_.memoryMappedOutput && resumeFrom == 0)) {
+        transfer->outputPending = true;
+    } else if (!transfer->openOutput(output.path,
+                                     resumeFrom > 0 ? FileWriter::Mode::APPEND : FileWriter::Mode::TRUNCATE,
+                                     config_, diskQueue_.get())) {
+        failDownload("Failed to open output file: " + output.path);
+        return;
+    } else {
+        // サイズは応答を受け取るまで分からないため、領域は最初の書き込みで確保する
+        transfer->reservePending = config_.preallocateOutput && decoding_ == ContentDecoding::NONE;
     }
 
     // レジューム位置を設定する（0 の場合は通常のダウンロード）
     if (resumeFrom > 0) {
-        curl->setResumeFrom(resumeFrom);
+        transfer->curl->setResumeFrom(resumeFrom);
+    }
+
+    // --------------------------------------------------------
+    // (3) 書き込み・進捗コールバックを設定して実行する
+    // --------------------------------------------------------
+    attachCallbacks(*transfer);
+    runTransfers({transfer}, nullptr,
+                 [this, transfer]() { finishSingleStream(*transfer); });
+}
+
+void Downloader::finishSingleStream(Transfer& transfer) {
+    if (balancing_) {
+        creditMirror(transfer, transfer.result != CurlResult::OK);
+    }
+
+    // ボディが空でも出力ファイルは作る
+    if (transfer.outputPending) {
+        openPendingOutput(transfer);
+    }
+
+    // 完了通知の前にバッファを書き出してファイルを閉じる
+    const bool written = transfer.closeOutput();
+    commitJournal(transfer);
+
+    // キャンセルチェック（コールバックからの中断はキャンセル扱い）
+    if (cancelRequested_.load(std::memory_order_acquire)) {
+        cancelDownload();
+        return;
+    }
+
+    // 一時停止中に終わった転送は切断扱いで取り直すため、PAUSED のままここに
+    // 来るのは pause() と転送の終了が競合した場合だけ。結果をそのまま採用する
+
+    // キャッシュの内容から変わっていなければ、受信せずにキャッシュから完了する
+    if (transfer.status == 304 && cache_.entry) {
+        completeRevalidated(transfer.mirror);
+        return;
+    }
+
+    if (!transfer.error.empty()) {
+        failDownload(transfer.error);
+        return;
+    }
+
+    if (!transfer.decodeError.empty()) {
+        failDownload(transfer.decodeError);
+        return;
+    }
+
+    if (!written) {
+        failDownload("Failed to write output file");
+        return;
+    }
+
+    // HTTP レスポンスコードを確認する（4xx/5xx はエラー。エラー応答のボディを
+    // 書かずに止めた場合は curl の結果も失敗になるため、先に確かめる。416 は Range 非対応）
+    const long httpCode = transfer.curl->getHttpResponseCode();
+    if (httpCode >= 400 && transfer.result != CurlResult::RANGE_NOT_SATISFIED) {
+        failDownload("HTTP error: " + std::to_string(httpCode));
+    } else if (transfer.result != CurlResult::OK) {
+        // コールバックからの中断は cancel とは別扱い（書き込みエラーなど）
+        // cancelRequested_ チェックは上で済んでいるのでここはエラー
+        failDownload(describeFailure(transfer.result, *transfer.curl));
+    } else if (transfer.decoder && !transfer.decoder->finish()) {
+        failDownload("Failed to decode content: " + transfer.decoder->getLastError());
+    } else {
+        cache_.etag         = transfer.etag;
+        cache_.lastModified = transfer.lastModified;
+        verifyAndComplete(transfer.checksum.hexDigest());
+    }
+}
+
+// =============================================================================
+// セグメント分割ダウンロード
+// =============================================================================
+
+void Downloader::startProbe(size_t mirror) {
+    auto probe = createTransfer(mirror);
+    if (!probe) {
+        // 分割できない場合は通常のダウンロードにフォールバックする
+        startSingleStream(0);
+        return;
+    }
+
+    probe->probe = true;
+    if (cache_.entry) {
+        probe->requestHeaders = cache_.entry->conditionalHeaders();
+        probe->curl->setRequestHeaders(probe->requestHeaders);
+    }
+    attachCallbacks(*probe);
+
+    runTransfers({probe}, nullptr,
+                 [this, probe]() { onProbeFinished(*probe); });
+}
+
+void Downloader::onProbeFinished(const Transfer& probe) {
+    if (cancelRequested_.load(std::memory_order_acquire)) {
+        cancelDownload();
+        return;
+    }
+
+    if (probe.status == 304 && cache_.entry) {
+        completeRevalidated(probe.mirror);
+        return;
+    }
+
+    const bool ok = probe.result == CurlResult::OK &&
+                    probe.curl->getHttpResponseCode() < 400;
+    const int64_t contentLength = ok ? probe.curl->getContentLength() : -1;
+
+    // 応答しないミラーは外し、次のミラーに問い合わせる
+    if (!ok && balancing_) {
+        size_t next = SIZE_MAX;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            mirrors_[probe.mirror].failed = true;
+        }
+        next = pickMirror();
+        if (next != SIZE_MAX) {
+            startProbe(next);
+            return;
+        }
+    }
+
+    cache_.etag         = probe.etag;
+    cache_.lastModified = probe.lastModified;
+    if (probe.acceptRanges && contentLength > 0) {
+        const auto segments = planSegments(contentLength,
+                                           segmentCount_,
+                                           config_.minSegmentSize);
+        if (segments.size() > 1) {
+            if (journalEnabled_) {
+                openJournal(contentLength, probe.etag, probe.lastModified);
+            }
+            startSegments(contentLength, segments);
+            return;
+        }
+    }
+
+    // 分割できない場合は通常のダウンロードにフォールバックする
+    startSingleStream(0, probe.mirror);
+}
+
+void Downloader::startRanges() {
+    // 最初は segmentCount 本までの転送に 1 区間ずつ割り当て、残りは区間を終えた転送が順に引き取る
+    std::vector<SegmentRange> initial;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        const size_t count = std::min(std::max<size_t>(segmentCount_, 1), pendingRanges_.size());
+        for (size_t i = 0; i < count; ++i) {
+            initial.push_back(pendingRanges_.back());
+            pendingRanges_.pop_back();
+        }
+    }
+    startSegments(rangeExtent_, initial);
+}
+
+bool Downloader::sizeOutputFile(const std::string& path, int64_t contentLength, FileWriter::Mode mode) {
+    FileWriter file;
+    if (!file.open(path, mode)) {
+        failDownload("Failed to open output file: " + path);
+        return false;
+    }
+    // 再開時は前回のサイズが違うこともあるため、確保した後にサイズを合わせる
+    if ((config_.preallocateOutput && !file.allocate(contentLength)) || !file.truncate(contentLength)) {
+        failDownload("Failed to preallocate output file: " + file.getLastError());
+        return false;
+    }
+    return true;
+}
+
+void Downloader::startSegments(int64_t contentLength,
+                               const std::vector<SegmentRange>& segments,
+                               const std::string& ifRange) {
+    const OutputTarget output      = getOutput();
+    const std::string& outputPath  = output.path;
+    std::span<char>    destination = output.destination;
+
+    // --------------------------------------------------------
+    // (1) 出力先を最終サイズで事前確保する
+    //     各セグメントは自分のオフセットに直接書き込む
+    // --------------------------------------------------------
+    // （ジャーナルからの再開では受信済みの内容を残すため mmap せずに書き足す）
+    const bool resuming = !ifRange.empty();
+    std::shared_ptr<MappedFile> mapped;
+    if (resuming) {
+        if (!sizeOutputFile(outputPath, contentLength, FileWriter::Mode::UPDATE)) {
+            return;
+        }
+    } else if (output.sink) {
+        if (!openSink(*output.sink, contentLength)) {
+            failDownload("Download sink rejected the download");
+            return;
+        }
+    } else if (output.toMemory) {
+        if (static_cast<uint64_t>(contentLength) > destination.size()) {
+            failDownload("Destination buffer is too small: " +
+                         std::to_string(contentLength) + " bytes required");
+            return;
+        }
+    } else if (config_.memoryMappedOutput) {
+        mapped = std::make_shared<MappedFile>();
+        if (!mapped->open(outputPath, contentLength)) {
+            failDownload("Failed to map output file: " + mapped->getLastError());
+            return;
+        }
+        destination = std::span<char>(mapped->data(),
+                                      static_cast<size_t>(contentLength));
+    } else if (!sizeOutputFile(outputPath, contentLength, FileWriter::Mode::TRUNCATE)) {
+        return;
+    }
+    // 最終サイズの穴のあるファイルが残ると、次回はサイズから完了済みと見なして末尾から
+    // 再開してしまう。受信済みの区間を記録しない場合は、失敗・キャンセル時に消す
+    discardOutput_ = !resuming && !journal_ && !rangeRead_ && !output.toMemory && !output.sink;
+    const bool direct = output.toMemory || mapped;
+    if (!direct) {
+        destination = {};
+    }
+    // 書き終えた区間から順にほかのノードへ配布する
+    if (config_.peerServer && !output.toMemory && !output.sink && !rangeRead_) {
+        shareWithPeers(contentLength);
+    }
+
+    totalBytes_.store(rangeRead_ ? rangeBytes_ : contentLength, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        segmentCrcs_.clear();
+        nextSegmentIndex_ = segments.size();
+    }
+
+    // 区間は使えるミラーに順に振り分ける（HEAD で失敗したミラーは使わない）
+    std::vector<size_t> healthy;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        for (size_t i = 0; i < mirrors_.size(); ++i) {
+            if (!mirrors_[i].failed) {
+                healthy.push_back(i);
+            }
+        }
+    }
+    if (healthy.empty()) {
+        healthy.push_back(0);
+    }
+
+    // --------------------------------------------------------
+    // (2) セグメントごとに独立したストリームと curl ハンドルを用意する
+    // --------------------------------------------------------
+    std::vector<TransferPtr> transfers;
+    transfers.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        auto transfer = createTransfer(healthy[i % healthy.size()]);
+        if (!transfer) {
+            failDownload("Failed to create curl handle");
+            return;
+        }
+        transfer->index    = i;
+        transfer->range    = segments[i];
+        transfer->ranged   = true;
+        transfer->checksum = StreamingChecksum(segmentAlgorithm(config_.checksumAlgorithm));
+        if (!openSegmentOutput(*transfer, destination, mapped)) {
+            failDownload("Failed to open output file: " + outputPath);
+            return;
+        }
+        transfer->curl->setRange(segments[i].first, segments[i].last);
+        if (resuming) {
+            // 前回から内容が変わっていれば、サーバは Range を無視して全体を返す
+            transfer->requestHeaders = {"If-Range: " + ifRange};
+            transfer->curl->setRequestHeaders(transfer->requestHeaders);
+        }
+        attachCallbacks(*transfer);
+        transfers.push_back(std::move(transfer));
+    }
+    // マッピングはセグメントだけが所有し、最後のセグメントの終了時に解除する
+    mapped.reset();
+
+    // --------------------------------------------------------
+    // (3) 並列取得する。1 つでも失敗したら残りのセグメントも中断させる
+    // --------------------------------------------------------
+    runTransfers(
+        std::move(transfers),
+        [this](Transfer& transfer) {
+            const bool written = transfer.closeOutput();
+            commitJournal(transfer);
+            recordSegmentCrc(transfer);
+            if (cancelRequested_.load(std::memory_order_acquire)) {
+                return;
+            }
+            if (transfer.overflow && journalResume_) {
+                journalMismatch_.store(true, std::memory_order_release);
+            }
+            std::string error = checkSegment(transfer);
+            if (error.empty() && !written) {
+                error = "Failed to write output file";
+            }
+            if (balancing_) {
+                creditMirror(transfer, !error.empty());
+            }
+            if (error.empty()) {
+                publishSegment(transfer);
+            }
+            if (!error.empty() &&
+                !transferFailed_.exchange(true, std::memory_order_acq_rel)) {
+                {
+                    std::lock_guard<std::mutex> lock(jobMutex_);
+                    transferError_ = "Segment " + std::to_string(transfer.index) +
+                                     " failed: " + error;
+                }
+                // 再試行を待っている他の区間を起こして終わらせる
+                std::lock_guard<std::mutex> lock(pauseMutex_);
+                pauseCv_.notify_all();
+            }
+        },
+        [this]() { finishSegments(); });
+}
+
+std::string Downloader::checkSegment(const Transfer& transfer) const {
+    if (!transfer.error.empty()) {
+        return transfer.error;
+    }
+    if (transfer.overflow) {
+        return "Server ignored Range request";
+    }
+    const long httpCode = transfer.curl->getHttpResponseCode();
+    if (httpCode >= 400 && transfer.result != CurlResult::RANGE_NOT_SATISFIED) {
+        return "HTTP error: " + std::to_string(httpCode);
+    }
+
+    // 後半を引き取られた区間は、書き込みを止めた分だけ curl の結果が失敗になる
+    const bool trimmedComplete = transfer.trimmed && transfer.received == transfer.range.size();
+    if (transfer.result != CurlResult::OK && !trimmedComplete) {
+        return describeFailure(transfer.result, *transfer.curl);
+    }
+
+    const int64_t expected = transfer.range.size();
+    if (transfer.received != expected) {
+        return "Incomplete segment: received " + std::to_string(transfer.received) +
+               " of " + std::to_string(expected) + " bytes";
+    }
+    return {};
+}
+
+void Downloader::finishSegments() {
+    if (cancelRequested_.load(std::memory_order_acquire)) {
+        cancelDownload();
+        return;
+    }
+
+    if (journalMismatch_.load(std::memory_order_acquire)) {
+        restartWithoutJournal();
+        return;
+    }
+
+    if (transferFailed_.load(std::memory_order_acquire)) {
+        std::string message;
+        {
+            std::lock_guard<std::mutex> lock(jobMutex_);
+            message = transferError_;
+        }
+        failDownload(message);
+        return;
+    }
+
+    // 区間の読み出しはオブジェクトの一部なので、ダイジェストを照合できない
+    if (rangeRead_) {
+        completeDownload();
+        return;
+    }
+
+    // CRC-32C は区間の値を先頭から順に連結する（ジャーナルからの再開では受信済みの
+    // 区間を計算していないため、SHA-256 と同じく読み直す）
+    std::string digest;
+    if (config_.checksumAlgorithm == ChecksumAlgorithm::CRC32C && !journalResume_) {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        std::sort(segmentCrcs_.begin(), segmentCrcs_.end(),
+                  [](const SegmentCrc& a, const SegmentCrc& b) { return a.first < b.first; });
+        uint32_t crc = 0;
+        for (const auto& segment : segmentCrcs_) {
+            crc = crc32cCombine(crc, segment.crc, segment.size);
+        }
+        digest = crc32cHex(crc);
+    }
+    verifyAndComplete(std::move(digest));
+}
+
+// =============================================================================
+// 複数ミラー
+// =============================================================================
+
+namespace {
+
+/// 経過時間あたりの受信速度 (bytes/sec)。測れなければ 0
+double rateSince(int64_t bytes, std::chrono::steady_clock::time_point since,
+                 std::chrono::steady_clock::time_point now) {
+    const auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count();
+    return bytes > 0 && elapsedNs > 0 ? static_cast<double>(bytes) * 1e9 / static_cast<double>(elapsedNs)
+                                      : 0.0;
+}
+
+} // namespace
+
+std::string Downloader::mirrorUrl(size_t mirror) const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return mirror < mirrors_.size() ? mirrors_[mirror].url : url_;
+}
+
+size_t Downloader::pickMirror() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    size_t best = SIZE_MAX;
+    for (size_t i = 0; i < mirrors_.size(); ++i) {
+        if (!mirrors_[i].failed && (best == SIZE_MAX || mirrors_[i].rate > mirrors_[best].rate)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void Downloader::creditMirror(Transfer& transfer, bool failed) {
+    const auto    now   = std::chrono::steady_clock::now();
+    const int64_t bytes = transfer.received - transfer.mirrorStart;
+    const auto    rate  = static_cast<int64_t>(rateSince(bytes, transfer.mirrorSince, now));
+    bool          peer  = false;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        auto& mirror = mirrors_[transfer.mirror];
+        mirror.bytes += bytes;
+        if (rate > 0) {
+            mirror.rate = mirror.rate == 0 ? rate : (mirror.rate + rate) / 2;
+        }
+        mirror.failed = mirror.failed || failed;
+        peer          = mirror.peer;
+    }
+    if (peer && bytes > 0) {
+        transfer.peerData = true;
+        peerBytes_.fetch_add(bytes, std::memory_order_relaxed);
+        if (config_.metrics) {
+            config_.metrics->peerBytes.add(static_cast<uint64_t>(bytes));
+        }
+    }
+    std::lock_guard<std::mutex> lock(transfer.rangeMutex);
+    transfer.mirrorStart = transfer.received;
+    transfer.mirrorSince = now;
+}
+
+bool Downloader::openSegmentOutput(Transfer& transfer, std::span<char> base,
+                                   std::shared_ptr<MappedFile> mapped) {
+    const OutputTarget output = getOutput();
+    if (output.sink) {
+        transfer.sink       = output.sink;
+        transfer.sinkOffset = transfer.range.first;
+        return true;
+    }
+    if (!base.empty()) {
+        transfer.destination = base.subspan(static_cast<size_t>(transfer.range.first),
+                                            static_cast<size_t>(transfer.range.size()));
+        transfer.mapped      = std::move(mapped);
+        return true;
+    }
+    return transfer.openOutput(output.path, FileWriter::Mode::UPDATE, config_, diskQueue_.get(),
+                               transfer.range.first);
+}
+
+void Downloader::recordSegmentCrc(const Transfer& transfer) {
+    std::lock_guard<std::mutex> lock(jobMutex_);
+    segmentCrcs_.push_back({transfer.range.first, transfer.checksum.crc32c(), transfer.received});
+}
+
+// =============================================================================
+// ピア配布
+// =============================================================================
+
+void Downloader::publishSegment(const Transfer& transfer) {
+    // ピアから受信した区間は、壊れていればほかのノードへ広げてしまうため照合まで待つ
+    if (!peerShare_.empty() && transfer.received > 0 && !transfer.peerData) {
+        config_.peerServer->markAvailable(peerShare_, transfer.range.first,
+                                          transfer.range.first + transfer.received - 1);
+    }
+}
+
+void Downloader::shareWithPeers(int64_t contentLength) {
+    peerShare_ = mirrorUrl(0);
+    config_.peerServer->share(peerShare_, getOutput().path, contentLength);
+}
+
+void Downloader::withdrawFromPeers() {
+    if (!peerShare_.empty()) {
+        config_.peerServer->unshare(peerShare_);
+        peerShare_.clear();
+    }
+}
+
+bool Downloader::reassignTransfer(Transfer& transfer) {
+    if (!balancing_ && !rangeRead_ && config_.maxRetries <= 0) {
+        return false;
+    }
+    if (transfer.ranged) {
+        std::lock_guard<std::mutex> lock(transfer.rangeMutex);
+        transfer.done = true;
+    }
+    if (cancelRequested_.load(std::memory_order_acquire) ||
+        transferFailed_.load(std::memory_order_acquire) || transfer.suspended) {
+        return false;
+    }
+    // 書き込み・展開の失敗は別のミラーから取り直しても直らない
+    if (!transfer.error.empty() || !transfer.decodeError.empty()) {
+        return false;
+    }
+
+    if (transfer.probe) {
+        // 応答しないミラーからの切り替えは onProbeFinished が行う
+        const bool ok = transfer.result == CurlResult::OK &&
+                        transfer.curl->getHttpResponseCode() < 400;
+        return !ok && retryTransfer(transfer);
+    }
+    if (transfer.ranged) {
+        if (transfer.overflow && journalResume_) {
+            return false; // 内容が変わっていた。ジャーナルを捨てて取り直す
+        }
+        if (checkSegment(transfer).empty()) {
+            return (rangeRead_ && takePendingRange(transfer)) || (balancing_ && stealWork(transfer));
+        }
+    } else if (transfer.result == CurlResult::OK &&
+               transfer.curl->getHttpResponseCode() < 400) {
+        return false;
+    }
+    // 使えるミラーが他にあればすぐに切り替え、なければ待ってから同じ取得元で取り直す
+    return (balancing_ && failoverTransfer(transfer)) || retryTransfer(transfer);
+}
+
+bool Downloader::failoverTransfer(Transfer& transfer) {
+    creditMirror(transfer, true);
+    if (decoding_ != ContentDecoding::NONE) {
+        return false; // 展開した位置からは続きを取れない
+    }
+    const size_t next = pickMirror();
+    if (next == SIZE_MAX) {
+        return false; // すべてのミラーが失敗した
+    }
+    transfer.mirror   = next;
+    transfer.result   = CurlResult::OK;
+    transfer.overflow = false;
+    transfer.trimmed  = false;
+    return restartTransfer(transfer);
+}
+
+bool Downloader::stealWork(Transfer& thief) {
+    const int64_t minSteal  = std::max<int64_t>(config_.minStealSize, 1);
+    const auto    now       = std::chrono::steady_clock::now();
+    const double  thiefRate = rateSince(thief.received - thief.mirrorStart, thief.mirrorSince, now);
+
+    std::vector<TransferPtr> active;
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        active = activeTransfers_;
+    }
+
+    // 今の速度のままでは終わるまで最も長くかかる区間を選ぶ（速度を測れなければ最優先）
+    TransferPtr victim;
+    double      longest = -1.0;
+    for (const auto& candidate : active) {
+        if (candidate.get() == &thief || !candidate->ranged) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(candidate->rangeMutex);
+        const int64_t remaining = candidate->range.size() - candidate->claimed;
+        if (candidate->done || remaining < 2 * minSteal) {
+            continue;
+        }
+        const double rate = rateSince(candidate->claimed - candidate->mirrorStart,
+                                      candidate->mirrorSince, now);
+        const double eta  = rate > 0 ? static_cast<double>(remaining) / rate
+                                     : std::numeric_limits<double>::infinity();
+        if (eta > longest) {
+            longest = eta;
+            victim  = candidate;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    // 残りを両者の速度の比で分け、引き取る側が後半を受け持つ（両者がほぼ同時に終わる）
+    SegmentRange stolen;
+    {
+        std::lock_guard<std::mutex> lock(victim->rangeMutex);
+        const int64_t remaining = victim->range.size() - victim->claimed;
+        if (victim->done || remaining < 2 * minSteal) {
+            return false;
+        }
+        const double victimRate = rateSince(victim->claimed - victim->mirrorStart,
+                                            victim->mirrorSince, now);
+        const double share = thiefRate > 0 && victimRate > 0
+                                 ? static_cast<double>(remaining) * thiefRate / (thiefRate + victimRate)
+                                 : static_cast<double>(remaining) / 2;
+        if (share < static_cast<double>(minSteal)) {
+            return false; // 新しい接続を張るほどの量を引き取れない（引き取る側が遅い）
+        }
+        const int64_t take = std::min(static_cast<int64_t>(share), remaining - minSteal);
+        stolen             = {victim->range.last - take + 1, victim->range.last};
+        victim->range.last = stolen.first - 1;
+    }
+    return rearmSegment(thief, stolen);
+}
+
+bool Downloader::takePendingRange(Transfer& transfer) {
+    SegmentRange next;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        if (pendingRanges_.empty()) {
+            return false;
+        }
+        next = pendingRanges_.back();
+        pendingRanges_.pop_back();
+    }
+    return rearmSegment(transfer, next);
+}
+
+bool Downloader::rearmSegment(Transfer& transfer, const SegmentRange& range) {
+    // 終えた区間を確定してから、同じ転送で次の区間を取得する
+    std::shared_ptr<MappedFile> mapped = transfer.mapped;
+    const OutputTarget output = getOutput();
+    const std::span<char> base =
+        mapped ? std::span<char>(mapped->data(), static_cast<size_t>(mapped->size()))
+               : output.toMemory ? output.destination : std::span<char>();
+    const bool written = transfer.closeOutput();
+    commitJournal(transfer);
+    recordSegmentCrc(transfer);
+    if (balancing_) {
+        creditMirror(transfer, false);
+    }
+    if (!written) {
+        transfer.error = "Failed to write output file";
+        return false;
+    }
+    publishSegment(transfer);
+
+    {
+        std::lock_guard<std::mutex> lock(transfer.rangeMutex);
+        transfer.range       = range;
+        transfer.received    = 0;
+        transfer.trimmed     = false;
+        transfer.mirrorStart = 0;
+        transfer.mirrorSince = std::chrono::steady_clock::now();
+        transfer.peerData    = false;
+    }
+    transfer.result       = CurlResult::OK;
+    transfer.overflow     = false;
+    transfer.retries      = 0;
+    transfer.attemptStart = 0;
+    transfer.checksum = StreamingChecksum(segmentAlgorithm(config_.checksumAlgorithm));
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        transfer.index = nextSegmentIndex_++;
+    }
+    if (!openSegmentOutput(transfer, base, std::move(mapped))) {
+        transfer.error = "Failed to open output file: " + output.path;
+        return false;
+    }
+    return restartTransfer(transfer);
+}
+
+// =============================================================================
+// 再試行
+// =============================================================================
+
+bool Downloader::isRetryable(const Transfer& transfer) const {
+    // エラー応答は指定されたステータスコードだけを取り直す（ボディは書いていない）
+    const long httpCode = transfer.curl->getHttpResponseCode();
+    if (httpCode >= 400) {
+        const auto& statuses = config_.retryHttpStatus;
+        return std::find(statuses.begin(), statuses.end(), httpCode) != statuses.end();
+    }
+    switch (transfer.result) {
+    case CurlResult::NETWORK_ERROR:
+    case CurlResult::OTHER_ERROR:
+        return true;
+    case CurlResult::OK:
+        // 区間の途中で接続が閉じられた
+        return transfer.ranged && transfer.received < transfer.range.size();
+    default:
+        // 中断・Range 非対応は取り直しても同じ結果になる
+        return false;
+    }
+}
+
+std::chrono::milliseconds Downloader::retryDelay(const Transfer& transfer) const {
+    const long maxDelay = std::max(config_.retryMaxDelayMs, 0L);
+    if (transfer.retryAfterMs >= 0) {
+        return std::chrono::milliseconds(std::min(transfer.retryAfterMs, maxDelay));
+    }
+    // retryBaseDelayMs × 2^(retries-1) を上限で打ち切り、後半の半分をランダムにずらす
+    const int  shift   = std::clamp(transfer.retries - 1, 0, 30);
+    const long backoff = static_cast<long>(std::min<long long>(
+        static_cast<long long>(std::max(config_.retryBaseDelayMs, 0L)) << shift, maxDelay));
+    thread_local std::minstd_rand engine(std::random_device{}());
+    std::uniform_int_distribution<long> jitter(0, backoff / 2);
+    return std::chrono::milliseconds(backoff - backoff / 2 + jitter(engine));
+}
+
+bool Downloader::waitForRetry(std::chrono::milliseconds delay) {
+    std::unique_lock<std::mutex> lock(pauseMutex_);
+    return !pauseCv_.wait_for(lock, delay, [this]() {
+        return cancelRequested_.load(std::memory_order_acquire) ||
+               transferFailed_.load(std::memory_order_acquire);
+    });
+}
+
+bool Downloader::retryTransfer(Transfer& transfer) {
+    // 受信が進んだ試行の後は数え直す（不安定な回線で長いファイルを取り切れるように）
+    if (transfer.received > transfer.attemptStart) {
+        transfer.retries = 0;
+    }
+    // 展開した位置からは続きを取れない
+    if (transfer.retries >= config_.maxRetries || decoding_ != ContentDecoding::NONE ||
+        transfer.overflow || !isRetryable(transfer)) {
+        return false;
+    }
+    ++transfer.retries;
+    retryCount_.fetch_add(1, std::memory_order_relaxed);
+    if (config_.metrics) {
+        config_.metrics->retries.add(1);
+    }
+
+    const auto delay = retryDelay(transfer);
+    if (!manager_ && delay.count() > 0 && !waitForRetry(delay)) {
+        return false;
+    }
+    transfer.result  = CurlResult::OK;
+    transfer.trimmed = false;
+    if (!restartTransfer(transfer)) {
+        return false;
+    }
+    transfer.attemptStart = transfer.received;
+    if (manager_) {
+        transfer.retryWait = delay;
+    }
+    return true;
+}
+
+// =============================================================================
+// 再開用ジャーナル
+// =============================================================================
+
+namespace {
+
+/// 隣り合う区間のうち間が最も狭いものから併合し、maxCount 個以下にする
+/// （壊れた区間が散らばっていても、転送の数をセグメント数までに抑える）
+std::vector<SegmentRange> mergeRanges(std::vector<SegmentRange> ranges, size_t maxCount) {
+    while (ranges.size() > maxCount) {
+        size_t narrowest = 0;
+        for (size_t i = 1; i + 1 < ranges.size(); ++i) {
+            if (ranges[i + 1].first - ranges[i].last <
+                ranges[narrowest + 1].first - ranges[narrowest].last) {
+                narrowest = i;
+            }
+        }
+        ranges[narrowest].last = ranges[narrowest + 1].last;
+        ranges.erase(ranges.begin() + static_cast<std::ptrdiff_t>(narrowest) + 1);
+    }
+    return ranges;
+}
+
+} // namespace
+
+bool Downloader::resumeFromJournal(const std::string& outputPath) {
+    const std::string journalPath = ResumeJournal::pathFor(outputPath);
+    ResumeJournal previous;
+    if (!previous.load(journalPath)) {
+        return false;
+    }
+
+    // 検証値がない・ファイルがない・サイズが合わない場合は、ファイルの内容を
+    // 信用できないので両方を捨てて最初から取り直す
+    const int64_t length = previous.header().contentLength;
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size(outputPath, ec);
+    if (ec || previous.header().validator().empty() ||
+        fileSize > static_cast<std::uintmax_t>(length)) {
+        previous.remove();
+        std::filesystem::remove(outputPath, ec);
+        return false;
+    }
+
+    // 内容とチェックサムが一致する区間だけを受信済みとみなす
+    const auto valid   = ResumeJournal::verify(outputPath, previous.ranges());
+    const auto missing = mergeRanges(ResumeJournal::missingRanges(length, valid),
+                                     std::max<size_t>(segmentCount_, 1));
+    int64_t remaining = 0;
+    for (const auto& range : missing) {
+        remaining += range.size();
+    }
+    totalBytes_.store(length, std::memory_order_relaxed);
+    downloadedBytes_.store(length - remaining, std::memory_order_relaxed);
+
+    if (missing.empty()) {
+        previous.remove();
+        verifyAndComplete({});
+        return true;
+    }
+
+    // 検証できた区間だけを引き継いで作り直し、続きを記録する
+    auto journal = std::make_unique<ResumeJournal>();
+    if (journal->create(journalPath, previous.header(), valid)) {
+        journal_ = std::move(journal);
+    }
+    journalResume_ = true;
+    startSegments(length, missing, previous.header().validator());
+    return true;
+}
+
+bool Downloader::completeFromCache(const DownloadCache::Entry& entry, const std::string& digest) {
+    if (!config_.cache->materialize(entry, getOutput().path)) {
+        return false;
+    }
+    cache_.hit = true;
+    downloadedBytes_.store(entry.size, std::memory_order_relaxed);
+    totalBytes_.store(entry.size, std::memory_order_relaxed);
+    if (config_.metrics) {
+        config_.metrics->cacheHits.add(1);
+    }
+    // ダイジェストが分からなければ、複製した出力から計算して照合する
+    verifyAndComplete(digest);
+    return true;
+}
+
+void Downloader::completeRevalidated(size_t mirror) {
+    const DownloadCache::Entry entry = *std::exchange(cache_.entry, std::nullopt);
+    if (!completeFromCache(entry)) {
+        // 内容が消えていれば、条件を付けずに取り直す
+        startSingleStream(0, mirror);
+    }
+}
+
+void Downloader::storeInCache() {
+    std::string url;
+    std::string sha256;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        url = url_;
+        if (config_.checksumAlgorithm == ChecksumAlgorithm::SHA256) {
+            sha256 = checksum_;
+        }
+    }
+    // 再検証も内容の照合もできない応答は記録しない
+    if (cache_.etag.empty() && cache_.lastModified.empty() && sha256.empty()) {
+        return;
+    }
+    config_.cache->store(url, getOutput().path, cache_.etag, cache_.lastModified, sha256);
+}
+
+void Downloader::restartWithoutJournal() {
+    const std::string outputPath = getOutput().path;
+    std::error_code ec;
+    if (journal_) {
+        journal_->remove();
+        journal_.reset();
+    } else {
+        std::filesystem::remove(ResumeJournal::pathFor(outputPath), ec);
+    }
+    std::filesystem::remove(outputPath, ec);
+
+    transferFailed_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        transferError_.clear();
+    }
+    downloadedBytes_.store(0, std::memory_order_relaxed);
+    totalBytes_.store(0, std::memory_order_relaxed);
+    beginDownload();
+}
+
+void Downloader::restartFromOrigin() {
+    // ピアは失敗したミラーとして扱い、配布元だけから取得する
+    // （配布は beginDownload() が出力を上書きする前にやめる）
+    originRetry_ = true;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        for (auto& mirror : mirrors_) {
+            mirror.failed = mirror.failed || mirror.peer;
+        }
+        checksum_.clear();
+    }
+
+    peerBytes_.store(0, std::memory_order_relaxed);
+    transferFailed_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        transferError_.clear();
+    }
+    downloadedBytes_.store(0, std::memory_order_relaxed);
+    totalBytes_.store(0, std::memory_order_relaxed);
+    beginDownload();
+}
+
+bool Downloader::openJournal(int64_t contentLength, const std::string& etag,
+                             const std::string& lastModified) {
+    // 検証値がなければ、再開時にサーバ側の内容が変わっていないことを確かめられない
+    if (contentLength <= 0 || (etag.empty() && lastModified.empty())) {
+        return false;
+    }
+    auto journal = std::make_unique<ResumeJournal>();
+    if (!journal->create(ResumeJournal::pathFor(getOutput().path),
+                         {contentLength, etag, lastModified})) {
+        return false;
+    }
+    journal_ = std::move(journal);
+    return true;
+}
+
+void Downloader::recordJournal(Transfer& transfer, const char* data, size_t size) {
+    // 単一ストリームは最初の書き込みでサイズと検証値が分かってから作る
+    // （セグメント転送では開始前に作ってあり、転送スレッドからは書き換えない）
+    if (!journal_ && !transfer.ranged && !transfer.journalChecked) {
+        transfer.journalChecked = true;
+        if (transfer.offset == 0) {
+            openJournal(transfer.curl->getContentLength(),
+                        transfer.etag, transfer.lastModified);
+        }
+    }
+    if (!journal_) {
+        return;
+    }
+
+    const int64_t chunk    = std::max<int64_t>(config_.journalChunkSize, 1);
+    int64_t       position = transfer.position();
+    if (transfer.journalStart < 0) {
+        transfer.journalStart = position;
+    }
+    while (size > 0) {
+        const size_t take = static_cast<size_t>(std::min<int64_t>(
+            static_cast<int64_t>(size), chunk - (position - transfer.journalStart)));
+        transfer.journalCrc = crc32Update(transfer.journalCrc, data, take);
+        data     += take;
+        size     -= take;
+        position += static_cast<int64_t>(take);
+        if (position - transfer.journalStart == chunk) {
+            journal_->append({transfer.journalStart, position - 1, transfer.journalCrc});
+            transfer.journalStart = position;
+            transfer.journalCrc   = 0;
+        }
+    }
+}
+
+void Downloader::commitJournal(Transfer& transfer) {
+    const int64_t end = transfer.position();
+    if (journal_ && transfer.journalStart >= 0 && end > transfer.journalStart) {
+        journal_->append({transfer.journalStart, end - 1, transfer.journalCrc});
+    }
+    transfer.journalStart = -1;
+    transfer.journalCrc   = 0;
+}
+
+// =============================================================================
+// 転送の生成と実行
+// =============================================================================
+
+std::unique_ptr<ICurlHandle> Downloader::createHandle(size_t mirror) {
+    return createHandleFor(mirrorUrl(mirror));
+}
+
+std::unique_ptr<ICurlHandle> Downloader::createHandleFor(const std::string& url) {
+    auto curl = curlFactory_();
+    if (!curl) {
+        return nullptr;
+    }
+
+    curl->setUrl(url);
+    curl->setConnectTimeout(config_.connectTimeoutSec);
+    curl->setUserAgent(config_.userAgent);
+    curl->setFollowLocation(config_.followRedirects);
+    curl->setSslVerify(config_.sslVerify);
+
+    if (config_.connectionSharing == ConnectionSharing::SEPARATE) {
+        curl->setMultiplexing(false);
+    } else {
+        if (!(config_.useHttp3 && curl->enableHttp3()) && config_.useHttp2) {
+            curl->enableHttp2();
+        }
+        if (manager_) {
+            curl->setMultiplexing(true);
+        }
+    }
+    curl->setTcpNoDelay(config_.tcpNoDelay);
+    curl->setTcpKeepAlive(config_.tcpKeepAlive, config_.tcpKeepIdleSec, config_.tcpKeepIntervalSec);
+    if (config_.happyEyeballsTimeoutMs > 0) {
+        curl->setHappyEyeballsTimeout(config_.happyEyeballsTimeoutMs);
+    }
+    if (config_.tcpFastOpen) {
+        curl->setTcpFastOpen(true);
+    }
+    if (config_.tlsEarlyData) {
+        curl->setTlsEarlyData(true);
+    }
+    if (!config_.resolveOverrides.empty()) {
+        curl->setResolveOverrides(config_.resolveOverrides);
+    }
+    const size_t bufferSize =
+        std::max(config_.chunkSize, tunedChunkSize_.load(std::memory_order_relaxed));
+    if (bufferSize > 0) {
+        curl->setBufferSize(bufferSize);
+    }
+    const int receiveBuffer =
+        std::max(config_.socketReceiveBuffer, tunedReceiveBuffer_.load(std::memory_order_relaxed));
+    if (receiveBuffer > 0) {
+        curl->setReceiveBufferSize(receiveBuffer);
+    }
+    if (decoding_ != ContentDecoding::NONE) {
+        // INLINE は curl が展開できるすべてを、PIPELINED は自前で展開できる方式だけを求める
+        const bool inlineDecoding = decoding_ == ContentDecoding::INLINE;
+        curl->setAcceptEncoding(inlineDecoding ? std::string() : ContentDecoder::supportedEncodings(),
+                                inlineDecoding);
+    }
+    return curl;
+}
+
+Downloader::TransferPtr Downloader::createTransfer(size_t mirror) {
+    auto curl = createHandle(mirror);
+    if (!curl) {
+        return nullptr;
+    }
+
+    auto transfer         = std::make_shared<Transfer>();
+    transfer->curl        = std::move(curl);
+    transfer->mirror      = mirror;
+    transfer->mirrorSince = std::chrono::steady_clock::now();
+    if (config_.adaptiveReceiveBuffer) {
+        ReceiveTuner::Limits limits;
+        limits.minBufferSize    = config_.chunkSize > 0 ? config_.chunkSize : limits.minBufferSize;
+        limits.maxBufferSize    = std::max(config_.maxChunkSize, limits.minBufferSize);
+        limits.maxReceiveBuffer = config_.maxSocketReceiveBuffer;
+        transfer->tuner.emplace(limits);
+    }
+    return transfer;
+}
+
+void Downloader::attachCallbacks(Transfer& transfer) {
+    // Transfer が curl ハンドルを所有するため、受け取り先として自身を渡しても先に破棄されない。
+    // std::function を介さずに書き込み・進捗を直接呼ぶ（受信ごとのヒープ確保・型消去がない）
+    transfer.owner        = this;
+    transfer.writeLatency = config_.metrics ? &config_.metrics->writeCallbackUs : nullptr;
+    if (transfer.probe) {
+        // HEAD はボディを受け取らないため、ヘッダーの解析とキャンセルの確認だけを行う
+        transfer.curl->setNoBody(true);
+    }
+    transfer.curl->setReceiver(&transfer);
+}
+
+bool Downloader::openPendingOutput(Transfer& transfer) {
+    transfer.outputPending = false;
+
+    const OutputTarget output     = getOutput();
+    const std::string& outputPath = output.path;
+    // 圧縮転送の Content-Length は展開前のサイズなので、サイズ不明として開く
+    const int64_t      length     = decoding_ != ContentDecoding::NONE
+                                        ? -1 : transfer.curl->getContentLength();
+
+    if (output.sink) {
+        if (!openSink(*output.sink, length)) {
+            transfer.error = "Download sink rejected the download";
+            return false;
+        }
+        transfer.sink       = output.sink;
+        transfer.sinkOffset = transfer.offset;
+        return true;
+    }
+
+    if (length > 0) {
+        auto mapped = std::make_shared<MappedFile>();
+        if (!mapped->open(outputPath, length)) {
+            transfer.error = "Failed to map output file: " + mapped->getLastError();
+            return false;
+        }
+        transfer.destination = std::span<char>(mapped->data(),
+                                               static_cast<size_t>(length));
+        transfer.mapped      = std::move(mapped);
+        return true;
+    }
+
+    // サイズが分からない応答（chunked など）は通常のファイル書き込みにする
+    if (!transfer.openOutput(outputPath, FileWriter::Mode::TRUNCATE, config_, diskQueue_.get())) {
+        transfer.error = "Failed to open output file: " + outputPath;
+        return false;
+    }
+    return true;
+}
+
+bool Downloader::openSink(IDownloadSink& sink, int64_t expectedSize) {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        sinkOpened_ = true;
+    }
+    return sink.open(expectedSize >= 0 ? expectedSize : -1);
+}
+
+bool Downloader::closeSink() {
+    IDownloadSink* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        if (sinkOpened_) {
+            sink        = output_.sink;
+            sinkOpened_ = false;
+        }
+    }
+    return !sink || sink->close();
+}
+
+bool Downloader::restartTransfer(Transfer& transfer) {
+    if (decoding_ != ContentDecoding::NONE) {
+        transfer.error = "Compressed transfer cannot be resumed";
+        return false;
+    }
+    auto curl = createHandle(transfer.mirror);
+    if (!curl) {
+        transfer.error = "Failed to create curl handle";
+        return false;
+    }
+    // 古いハンドルはここで解放され、接続がプールに戻る
+    transfer.curl      = std::move(curl);
+    transfer.suspended = false;
+    transfer.withheld  = false;
+
+    // 書き込み済みの位置から続きを要求する
+    if (transfer.ranged) {
+        std::lock_guard<std::mutex> lock(transfer.rangeMutex);
+        transfer.claimed = transfer.received;
+        transfer.done    = false;
+        transfer.curl->setRange(transfer.range.first + transfer.received,
+                                transfer.range.last);
+    } else if (transfer.offset + transfer.received > 0) {
+        transfer.curl->setResumeFrom(transfer.offset + transfer.received);
+    }
+    if (!transfer.requestHeaders.empty()) {
+        transfer.curl->setRequestHeaders(transfer.requestHeaders);
+    }
+    attachCallbacks(transfer);
+    return true;
+}
+
+void Downloader::runTransfers(std::vector<TransferPtr> transfers,
+                              std::function<void(Transfer&)> onEach,
+                              std::function<void()> onAll) {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        activeTransfers_.insert(activeTransfers_.end(),
+                                transfers.begin(), transfers.end());
+    }
+
+    // 完了した転送を pause/resume/cancel の操作対象から外す
+    auto retire = [this](const TransferPtr& transfer) {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        activeTransfers_.erase(
+            std::remove(activeTransfers_.begin(), activeTransfers_.end(), transfer),
+            activeTransfers_.end());
+    };
+
+    if (manager_) {
+        // イベントループ駆動: 最後に完了した転送のハンドラが onAll を呼ぶ
+        auto remaining = std::make_shared<std::atomic<size_t>>(transfers.size());
+        for (const auto& transfer : transfers) {
+            // Transfer 自身を捕捉するが、finishManagedTransfer で解放される
+            transfer->onFinished =
+                [this, transfer, remaining, retire, onEach, onAll](CurlResult result) {
+                    transfer->result = result;
+                    retire(transfer);
+                    if (onEach) {
+                        try {
+                            onEach(*transfer);
+                        } catch (...) {
+                            // onAll まで必ず到達させるため、失敗として記録だけする
+                            transferFailed_.store(true, std::memory_order_release);
+                        }
+                    }
+                    if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        try {
+                            onAll();
+                        } catch (const std::exception& e) {
+                            failDownload(std::string("Unexpected exception: ") + e.what());
+                        } catch (...) {
+                            failDownload("Unknown exception in event loop");
+                        }
+                    }
+                };
+            submitTransfer(transfer);
+        }
+        return;
+    }
+
+    // ワーカースレッド駆動: 1 本ならこのスレッドで、複数ならスレッドを分けて実行する
+    auto performOne = [&](const TransferPtr& transfer) {
+        try {
+            do {
+                transfer->result = transfer->curl->perform();
+                recordTimings(*transfer);
+                suspendIfPaused(*transfer);
+                // 長時間の一時停止で接続を切断した場合は、再開後に続きから取り直す
+                while (transfer->suspended && waitForResume() &&
+                       restartTransfer(*transfer)) {
+                    transfer->result = transfer->curl->perform();
+                    recordTimings(*transfer);
+                    suspendIfPaused(*transfer);
+                }
+            } while (reassignTransfer(*transfer));
+        } catch (const std::exception& e) {
+            transfer->result = CurlResult::OTHER_ERROR;
+            transfer->error  = std::string("Unexpected exception: ") + e.what();
+        }
+        retire(transfer);
+        if (onEach) {
+            onEach(*transfer);
+        }
+    };
+
+    if (transfers.size() == 1) {
+        performOne(transfers.front());
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(transfers.size());
+        for (const auto& transfer : transfers) {
+            threads.emplace_back([&performOne, transfer]() { performOne(transfer); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    onAll();
+}
+
+void Downloader::submitTransfer(const TransferPtr& transfer, std::chrono::milliseconds delay) {
+    if (delay.count() > 0) {
+        std::lock_guard<std::mutex> lock(transfer->throttleMutex);
+        transfer->backingOff = true;
+    }
+    manager_->submit(*transfer->curl, [this, transfer](CurlResult result) {
+        {
+            std::lock_guard<std::mutex> lock(transfer->throttleMutex);
+            transfer->backingOff = false;
+        }
+        recordTimings(*transfer);
+        suspendIfPaused(*transfer);
+        if (transfer->suspended && parkTransfer(transfer)) {
+            return;
+        }
+        if (restartWhenWritable(transfer)) {
+            return;
+        }
+        transfer->result = result;
+        if (reassignTransfer(*transfer)) {
+            // 再試行は待ち時間が過ぎてから、ミラーの切り替え・引き取りはすぐに開始する
+            submitTransfer(transfer, std::exchange(transfer->retryWait, std::chrono::milliseconds(0)));
+            return;
+        }
+        finishManagedTransfer(transfer, result);
+    }, delay);
+}
+
+void Downloader::recordTimings(const Transfer& transfer) {
+    // 接続の確立にかかった時間を見るため、最初に応答を受けた転送だけを残す
+    const PhaseTimings timings = transfer.curl->getTimings();
+    if (DownloadMetrics* metrics = config_.metrics) {
+        metrics->transfers.add(1);
+        const auto record = [](MetricHistogram& histogram, int64_t us) {
+            if (us >= 0) {
+                histogram.record(static_cast<uint64_t>(us));
+            }
+        };
+        record(metrics->dnsUs, timings.dnsUs);
+        record(metrics->connectUs, timings.connectUs);
+        record(metrics->tlsUs, timings.tlsUs);
+        record(metrics->firstByteUs, timings.firstByteUs);
+        record(metrics->transferUs, timings.transferUs);
+    }
+    if (timings.firstByteUs < 0) {
+        return; // 応答を受ける前に失敗した
+    }
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    if (timings_.firstByteUs < 0) {
+        timings_ = timings;
+    }
+}
+
+void Downloader::finishManagedTransfer(const TransferPtr& transfer,
+                                       CurlResult result) {
+    // 循環参照を断ってから呼ぶ（呼び出し後に this が破棄されうる）
+    auto onFinished = std::move(transfer->onFinished);
+    transfer->onFinished = nullptr;
+    if (onFinished) {
+        onFinished(result);
+    }
+}
+
+bool Downloader::parkTransfer(const TransferPtr& transfer) {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        if (cancelRequested_.load(std::memory_order_acquire)) {
+            return false; // 中断として完了させる
+        }
+        if (pauseRequested_.load(std::memory_order_acquire)) {
+            // ソケットもスレッドも保持せずに resume() / cancel() を待つ
+            suspendedTransfers_.push_back(transfer);
+            return true;
+        }
+    }
+    // 切断と同時に resume された場合はすぐに取り直す
+    return resubmitTransfer(transfer);
+}
+
+bool Downloader::resubmitTransfer(const TransferPtr& transfer) {
+    if (!restartTransfer(*transfer)) {
+        return false;
+    }
+    submitTransfer(transfer);
+    return true;
+}
+
+// =============================================================================
+// curl コールバック
+// =============================================================================
+
+size_t Downloader::onTransferWrite(Transfer& transfer,
+                                   const char* data, size_t size) {
+    transfer.withheld      = false;
+    transfer.bandwidthWait = 0;
+
+    // キャンセル検出: 書き込みコールバック内でフラグを確認
+    // 他セグメントが失敗した場合も同様に中断する
+    if (cancelRequested_.load(std::memory_order_acquire) ||
+        transferFailed_.load(std::memory_order_acquire)) {
+        // 0 を返すと curl が CURLE_WRITE_ERROR を発生させてダウンロードを中断する
+        return 0;
+    }
+
+    // 一時停止検出
+    // コールバック内でブロックせず、転送自体を一時停止させる
+    // このチャンクは書き込まずに返し、再開時に curl から再送される
+    if (pauseRequested_.load(std::memory_order_acquire) && enterPause(transfer)) {
+        return ICurlHandle::WRITE_PAUSE;
+    }
+
+    // 書き込み待ち（展開待ち）が上限に達していれば、追いつくまで受信を止める
+    if (diskQueue_ && diskQueue_->isFull() && throttleTransfer(transfer, *diskQueue_)) {
+        return ICurlHandle::WRITE_PAUSE;
+    }
+    if (transfer.decodeStream && decodeQueue_->isFull() &&
+        throttleTransfer(transfer, *decodeQueue_)) {
+        return ICurlHandle::WRITE_PAUSE;
+    }
+
+    // 複数ミラー・再試行では、エラー応答のボディを書かずに止めて取り直す
+    if (transfer.status >= 400 && (balancing_ || config_.maxRetries > 0)) {
+        return 0;
+    }
+
+    // 帯域の割り当てを超える受信は、割り当てられるまで止める
+    if (!bandwidth_->tryAcquire(size)) {
+        const size_t granted = waitForBandwidth(transfer, size);
+        if (granted != size) {
+            return granted;
+        }
+    }
+
+    // Range を無視して全体を返すサーバから他区間を上書きしないようにする
+    // （206 ではなく 200 が返された時点で、最初のデータを書く前に止める）
+    if (transfer.ranged && balancing_ && transfer.status != 200) {
+        // 後半を別の転送に引き取られていれば、新しい区間の終わりまでだけ書いて止める
+        std::lock_guard<std::mutex> lock(transfer.rangeMutex);
+        const int64_t room = transfer.range.size() - transfer.claimed;
+        if (static_cast<int64_t>(size) > room) {
+            transfer.trimmed = true;
+            if (room <= 0) {
+                return 0;
+            }
+            size = static_cast<size_t>(room);
+        }
+        transfer.claimed += static_cast<int64_t>(size);
+    } else if (transfer.ranged &&
+               (transfer.status == 200 ||
+                transfer.received + static_cast<int64_t>(size) > transfer.range.size())) {
+        transfer.overflow = true;
+        return 0;
+    }
+
+    if (transfer.outputPending && !openPendingOutput(transfer)) {
+        return 0;
+    }
+    if (transfer.reservePending) {
+        // 応答のサイズまで領域を確保する（サイズは変えないため、途中で止まっても続きから再開できる）
+        transfer.reservePending = false;
+        const int64_t length = transfer.curl->getContentLength();
+        if (length > 0) {
+            transfer.file.reserve(transfer.offset + length);
+        }
+    }
+
+    if (decoding_ == ContentDecoding::PIPELINED && !transfer.decoderChecked &&
+        !openDecoder(transfer)) {
+        return 0;
+    }
+
+    if (transfer.decodeStream) {
+        // 展開と書き込みは展開用のスレッドに任せ、受信データを積むだけで戻る
+        if (!transfer.decodeStream->write(data, size)) {
+            return 0; // 展開・書き込みに失敗した
+        }
+    } else if (!writeOutput(transfer, data, size, transfer.error)) {
+        return 0;
+    }
+
+    // INLINE では展開後のデータが渡されるため、受信量は進捗コールバックで更新する
+    if (decoding_ != ContentDecoding::INLINE) {
+        wireBytes_.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+        if (config_.metrics) {
+            config_.metrics->bytesReceived.add(size);
+        }
     }
+    // 書き込んだバイト数を返す（区間の終わりで止めた場合は受け取った量より少なくなり、
+    // curl が転送を終える）
+    return size;
+}
 
-    // --------------------------------------------------------
-    // (3) 書き込みコールバック設定
-    //     1024 バイトのチャンクでストリーミング書き込みする
-    // --------------------------------------------------------
-    curl->setWriteCallback([this, &outFile](const char* data, size_t size) -> size_t {
-        // キャンセル検出: 書き込みコールバック内でフラグを確認
-        if (cancelRequested_.load(std::memory_order_acquire)) {
-            // 0 を返すと curl が CURLE_WRITE_ERROR を発生させてダウンロードを中断する
-            return 0;
+bool Downloader::writeOutput(Transfer& transfer, const char* data, size_t size,
+                             std::string& error) {
+    if (transfer.sink) {
+        const int64_t position = transfer.sinkOffset + transfer.received;
+        if (!transfer.sink->write(position, std::span<const char>(data, size))) {
+            error = "Download sink rejected data";
+            return false;
+        }
+    } else if (transfer.writer) {
+        // 書き込みバッファに追加する（満杯になるとまとめてファイルに書き出す）
+        if (!transfer.writer->write(data, size)) {
+            return false; // 書き込みエラー
+        }
+    } else {
+        // 出力先（mmap したファイル・呼び出し側のメモリ）へ直接コピーする
+        const size_t position = static_cast<size_t>(transfer.received);
+        if (size > transfer.destination.size() - position) {
+            error = "Destination buffer is too small";
+            return false;
         }
+        std::memcpy(transfer.destination.data() + position, data, size);
+    }
 
-        // 一時停止検出
-        if (pauseRequested_.load(std::memory_order_acquire)) {
-            // 一時停止状態に遷移（すでに PAUSED になっているはずだが念のため）
-            // 書き込み前に一時停止を待機する
-            bool shouldContinue = waitIfPaused();
-            if (!shouldContinue) {
-                return 0; // キャンセルされた場合
+    if (journalEnabled_) {
+        recordJournal(transfer, data, size);
+    }
+    transfer.checksum.update(data, size);
+
+    // ダウンロード済みバイト数を更新する
+    transfer.received += static_cast<int64_t>(size);
+    downloadedBytes_.fetch_add(static_cast<int64_t>(size),
+                               std::memory_order_relaxed);
+    if (config_.metrics) {
+        config_.metrics->bytesWritten.add(size);
+    }
+    return true;
+}
+
+bool Downloader::openDecoder(Transfer& transfer) {
+    transfer.decoderChecked = true;
+    if (ContentDecoder::isIdentity(transfer.contentEncoding)) {
+        return true; // 圧縮されていなければそのまま書き込む
+    }
+
+    Transfer* raw = &transfer;
+    transfer.decoder = ContentDecoder::create(
+        transfer.contentEncoding, [this, raw](const char* data, size_t size) {
+            return writeOutput(*raw, data, size, raw->decodeError);
+        });
+    if (!transfer.decoder) {
+        transfer.error = "Unsupported Content-Encoding: " + transfer.contentEncoding;
+        return false;
+    }
+
+    // 展開用のスレッドが積まれた順に展開し、展開したデータを出力先に書き込む
+    transfer.decodeStream = decodeQueue_->open([this, raw](const char* data, size_t size) {
+        if (cancelRequested_.load(std::memory_order_acquire) ||
+            transferFailed_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        // 書き出しスレッドが追いつくまで展開を待つ（受信は展開待ちの上限で止まる）
+        if (diskQueue_ && diskQueue_->isFull()) {
+            diskQueue_->waitForSpace();
+        }
+        if (!raw->decoder->decode(data, size)) {
+            if (raw->decodeError.empty()) {
+                raw->decodeError = "Failed to decode content: " + raw->decoder->getLastError();
             }
+            transferFailed_.store(true, std::memory_order_release);
+            return false;
         }
+        return true;
+    });
+    return true;
+}
 
-        // ファイルに書き込む
-        outFile.write(data, static_cast<std::streamsize>(size));
-        if (outFile.fail()) {
-            return 0; // 書き込みエラー
-        }
+int Downloader::onTransferProgress(Transfer& transfer,
+                                   int64_t dltotal, int64_t dlnow) {
+    // キャンセル検出
+    if (cancelRequested_.load(std::memory_order_acquire) ||
+        transferFailed_.load(std::memory_order_acquire)) {
+        return 1; // 非0を返すと curl が中断する
+    }
 
-        // ダウンロード済みバイト数を更新する
-        downloadedBytes_.fetch_add(static_cast<int64_t>(size),
-                                   std::memory_order_relaxed);
+    // 一時停止中も進捗コールバックは呼ばれ続ける
+    if (transfer.paused.load(std::memory_order_acquire) &&
+        pollPausedTransfer(transfer)) {
+        return 1; // 接続を切断する（resume() で続きから取り直す）
+    }
 
-        return size; // 書き込んだバイト数を返す
-    });
+    if (transfer.tuner) {
+        tuneReceiveBuffer(transfer, dlnow);
+    }
 
-    // --------------------------------------------------------
-    // (4) 進捗コールバック設定
-    // --------------------------------------------------------
-    curl->setProgressCallback([this](int64_t dltotal, int64_t dlnow) -> int {
-        // キャンセル検出
-        if (cancelRequested_.load(std::memory_order_acquire)) {
-            return 1; // 非0を返すと curl が中断する
+    // 圧縮転送では展開後のサイズが分からないため、受信したボディの量で進捗を示す
+    if (decoding_ != ContentDecoding::NONE) {
+        if (dltotal > 0) {
+            wireTotalBytes_.store(dltotal, std::memory_order_relaxed);
         }
-
+        if (decoding_ == ContentDecoding::INLINE) {
+            wireBytes_.store(dlnow, std::memory_order_relaxed);
+            if (config_.metrics && dlnow > transfer.wireReported) {
+                config_.metrics->bytesReceived.add(static_cast<uint64_t>(dlnow - transfer.wireReported));
+                transfer.wireReported = dlnow;
+            }
+        }
+    } else if (!transfer.ranged) {
+        // セグメント転送では totalBytes_ は事前確保したファイルサイズで固定
         // 総バイト数を更新する（レジューム時は既存ファイルサイズを加算）
         const int64_t baseOffset = downloadedBytes_.load(std::memory_order_relaxed) -
                                    dlnow; // 現在セッションの dlnow を除いた base
@@ -322,78 +2708,302 @@ void Downloader::doDownload() {
         if (dltotal > 0) {
             totalBytes_.store(dltotal + baseOffset, std::memory_order_relaxed);
         }
+    }
 
-        // 進捗通知
-        const int64_t downloaded = downloadedBytes_.load(std::memory_order_relaxed);
-        const int64_t total      = totalBytes_.load(std::memory_order_relaxed);
-        double percent = -1.0;
-        if (total > 0) {
-            percent = static_cast<double>(downloaded) /
-                      static_cast<double>(total) * 100.0;
-        }
-        notifyProgress(downloaded, total, percent);
+    // 進捗通知（セグメント転送では全セグメントの合計）
+    const int64_t downloaded = downloadedBytes_.load(std::memory_order_relaxed);
+    if (!claimProgressNotification(downloaded)) {
+        return 0; // 間引く（受信量が変わっていない・間隔が短い）
+    }
+    const int64_t total      = totalBytes_.load(std::memory_order_relaxed);
+    notifyProgress(downloaded, total, progressPercent(downloaded, total));
 
-        return 0; // 継続
-    });
+    return 0; // 継続
+}
 
-    // --------------------------------------------------------
-    // (5) ダウンロード実行
-    // --------------------------------------------------------
-    CurlResult result = curl->perform();
+namespace {
 
-    // ファイルを閉じる（スコープアウトで自動的に閉じられるが明示的にフラッシュ）
-    outFile.flush();
+/// value が現在の値より大きければ置き換える
+template <typename T>
+void raiseTo(std::atomic<T>& target, T value) {
+    T current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
 
-    // --------------------------------------------------------
-    // (6) 結果処理
-    // --------------------------------------------------------
+} // namespace
 
-    // キャンセルチェック（コールバックからの中断はキャンセル扱い）
-    if (cancelRequested_.load(std::memory_order_acquire)) {
-        state_.store(DownloadState::CANCELLED, std::memory_order_release);
-        notifyCancelled();
+void Downloader::tuneReceiveBuffer(Transfer& transfer, int64_t dlnow) {
+    const auto now = ReceiveTuner::Clock::now();
+    if (!transfer.tuner->due(now) ||
+        !transfer.tuner->sample(dlnow, now, transfer.curl->getRoundTripTimeUs())) {
         return;
     }
+    const int receiveBuffer = transfer.tuner->receiveBufferSize();
+    if (receiveBuffer > 0) {
+        transfer.curl->setReceiveBufferSize(receiveBuffer);
+    }
+    raiseTo(tunedChunkSize_, transfer.tuner->bufferSize());
+    raiseTo(tunedReceiveBuffer_, receiveBuffer);
+}
+
+// =============================================================================
+// 終了処理
+// =============================================================================
+
+std::string Downloader::digestOutput() {
+    const OutputTarget output = getOutput();
+    StreamingChecksum  checksum(config_.checksumAlgorithm);
+
+    if (output.toMemory) {
+        const auto size = std::min(static_cast<size_t>(downloadedBytes_.load(std::memory_order_relaxed)),
+                                   output.destination.size());
+        checksum.update(output.destination.data(), size);
+    } else if (output.sink || !hashFile(output.path, -1, checksum)) {
+        return {}; // シンクの内容は読み直せない
+    }
+    return checksum.hexDigest();
+}
 
-    // 一時停止中にここに到達した場合（レジューム待ち中にキャンセルされた etc.）
-    if (state_.load(std::memory_order_acquire) == DownloadState::PAUSED) {
-        // pause() → waitIfPaused() でキャンセルが返った場合はここに来ない
-        // この分岐は安全のためのガード
-        state_.store(DownloadState::CANCELLED, std::memory_order_release);
-        notifyCancelled();
+void Downloader::verifyAndComplete(std::string digest) {
+    if (config_.checksumAlgorithm == ChecksumAlgorithm::NONE) {
+        completeDownload();
         return;
     }
 
-    if (result == CurlResult::OK) {
-        // HTTP レスポンスコードを確認する（4xx/5xx はエラー）
-        const long httpCode = curl->getHttpResponseCode();
-        if (httpCode >= 400) {
-            state_.store(DownloadState::ERROR, std::memory_order_release);
-            notifyError("HTTP error: " + std::to_string(httpCode));
-        } else {
-            // 完了: 100% の進捗通知を出してから完了通知
-            const int64_t total = totalBytes_.load(std::memory_order_relaxed);
-            const int64_t downloaded = downloadedBytes_.load(std::memory_order_relaxed);
-            notifyProgress(downloaded, total > 0 ? total : downloaded, 100.0);
+    if (digest.empty()) {
+        digest = digestOutput();
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        checksum_ = digest;
+    }
+    if (digest.empty()) {
+        failDownload("Failed to compute checksum of the output");
+        return;
+    }
 
-            state_.store(DownloadState::COMPLETED, std::memory_order_release);
-            notifyCompleted();
+    const std::string_view expected = trim(config_.expectedChecksum);
+    if (!expected.empty() && !iequals(expected, digest)) {
+        // 壊れた内容から再開しないよう、ファイル出力はジャーナルごと捨てる
+        const OutputTarget output = getOutput();
+        if (!output.toMemory && !output.sink) {
+            std::error_code ec;
+            if (journal_) {
+                journal_->remove();
+            }
+            std::filesystem::remove(output.path, ec);
         }
-    } else if (result == CurlResult::ABORTED_BY_CALLBACK) {
-        // コールバックからの中断は cancel とは別扱い（書き込みエラーなど）
-        // cancelRequested_ チェックは上で済んでいるのでここはエラー
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Download aborted: " + curl->getLastError());
-    } else if (result == CurlResult::NETWORK_ERROR) {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Network error: " + curl->getLastError());
-    } else if (result == CurlResult::RANGE_NOT_SATISFIED) {
+        // ピアから受信した内容が壊れていた可能性があるため、一度だけ配布元から取り直す
+        // （シンクへ渡した内容は取り消せないので取り直さない）
+        if (peerBytes_.load(std::memory_order_relaxed) > 0 && !originRetry_ && !output.sink) {
+            restartFromOrigin();
+            return;
+        }
+        failDownload("Checksum mismatch: expected " + std::string(expected) +
+                     ", got " + digest);
+        return;
+    }
+    completeDownload();
+}
+
+void Downloader::completeDownload() {
+    // シンクの後処理（フラッシュなど）に失敗した場合は完了させない
+    if (!closeSink()) {
+        failDownload("Download sink failed to finish");
+        return;
+    }
+
+    // 出力ファイルを確定する（失敗した場合はジャーナルを残し、次回は一時ファイルから再開する）
+    bool        renamed = false;
+    std::string fileError;
+    if (!finalizeOutputFile(renamed, fileError)) {
+        failDownload(fileError);
+        return;
+    }
+
+    // 受信済みのデータはすべて揃ったのでジャーナルは不要
+    if (journal_) {
+        journal_->remove();
+        journal_.reset();
+    }
+
+    // 受信した内容をキャッシュに記録し、次回は条件付きリクエストで再検証する
+    if (cache_.enabled && !cache_.hit) {
+        storeInCache();
+    }
+
+    // 揃った内容をほかのノードへ配布する（分割せずに受信した場合はここから始める）
+    const OutputTarget output = getOutput();
+    if (config_.peerServer && !output.toMemory && !output.sink && !rangeRead_) {
+        if (peerShare_.empty() || renamed) {
+            // 一時ファイルで配布していた場合は、置き換えた先で配布し直す
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(output.path, ec);
+            if (!ec && size > 0) {
+                shareWithPeers(static_cast<int64_t>(size));
+            }
+        }
+        if (!peerShare_.empty()) {
+            config_.peerServer->markComplete(peerShare_);
+        }
+    }
+
+    // 完了: 100% の進捗通知を出してから完了通知
+    const int64_t total = totalBytes_.load(std::memory_order_relaxed);
+    const int64_t downloaded = downloadedBytes_.load(std::memory_order_relaxed);
+    notifyProgress(downloaded, total > 0 ? total : downloaded, 100.0);
+
+    if (DownloadMetrics* metrics = config_.metrics) {
+        metrics->downloadsCompleted.add(1);
+        const uint64_t us = elapsedUs(startedAt_);
+        const auto     received = static_cast<uint64_t>(wireBytes_.load(std::memory_order_relaxed));
+        if (us > 0 && received > 0) {
+            metrics->throughputBytesPerSec.record(static_cast<uint64_t>(
+                static_cast<double>(received) * 1e6 / static_cast<double>(us)));
+        }
+    }
+
+    state_.store(DownloadState::COMPLETED, std::memory_order_release);
+    notifyCompleted();
+    endJob();
+}
+
+bool Downloader::finalizeOutputFile(bool& renamed, std::string& error) {
+    const OutputTarget output = getOutput();
+    if (output.toMemory || output.sink) {
+        return true;
+    }
+    // 書き込みはすべて閉じているため、パスから開き直して書き出す
+    const bool durable = config_.fileSync != FileSyncPolicy::NONE;
+    if (durable && !FileWriter::syncFile(output.path, error)) {
+        error = "Failed to sync output file: " + error;
+        return false;
+    }
+    if (output.finalPath.empty()) {
+        return true;
+    }
+    if (!FileWriter::replace(output.path, output.finalPath, durable, error)) {
+        error = "Failed to rename output file: " + error;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        output_.path = output.finalPath;
+        output_.finalPath.clear();
+    }
+    renamed = true;
+    return true;
+}
+
+void Downloader::failDownload(const std::string& message) {
+    closeSink();
+    journal_.reset(); // 次回の再開に使うためファイルは残す
+    discardPartialOutput();
+    withdrawFromPeers();
+    if (config_.metrics) {
+        config_.metrics->downloadsFailed.add(1);
+    }
+    state_.store(DownloadState::ERROR, std::memory_order_release);
+    notifyError(message);
+    endJob(message);
+}
+
+void Downloader::cancelDownload() {
+    closeSink();
+    journal_.reset();
+    discardPartialOutput();
+    withdrawFromPeers();
+    if (config_.metrics) {
+        config_.metrics->downloadsCancelled.add(1);
+    }
+    state_.store(DownloadState::CANCELLED, std::memory_order_release);
+    notifyCancelled();
+    endJob();
+}
+
+void Downloader::discardPartialOutput() {
+    if (!discardOutput_) {
+        return;
+    }
+    discardOutput_ = false;
+    std::error_code ec;
+    std::filesystem::remove(getOutput().path, ec);
+}
+
+void Downloader::endJob(const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex_);
+        activeTransfers_.clear();
+    }
+
+    // onDone に渡す結果は、ジョブの終了を記録する前に組み立てておく
+    CompletionHandler onDone;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        onDone = std::exchange(completion_, nullptr);
+    }
+    DownloadResult result;
+    if (onDone) {
+        result.state = state_.load(std::memory_order_acquire);
+        result.error = error;
+        result.stats = getStats();
+        if (!manager_) {
+            // ワーカースレッド駆動では、転送の後始末を終えた workerThread() の最後で呼ぶ
+            deferredCompletion_ = [onDone = std::move(onDone), result = std::move(result)]() mutable {
+                onDone(std::move(result));
+            };
+            onDone = nullptr;
+        }
+    }
+
+    // DownloadManager 駆動ではこの通知の直後に this が破棄されうるため、
+    // ロックを保持したまま通知し、以降はメンバーに触れない
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        jobActive_ = false;
+        jobCv_.notify_all();
+    }
+    if (onDone) {
+        onDone(std::move(result));
+    }
+}
+
+// =============================================================================
+// DownloadAwaiter
+// =============================================================================
+
+bool DownloadAwaiter::await_suspend(std::coroutine_handle<> caller) {
+    caller_ = caller;
+    const bool started = start_([this](DownloadResult result) {
+        result_ = std::move(result);
+        const std::coroutine_handle<> resumed = caller_;
+        // 中断が済んでいれば再開する（まだなら await_suspend が中断せずに続ける）
+        if (finished_.exchange(true, std::memory_order_acq_rel)) {
+            resumed.resume();
+        }
+    });
+    if (!started) {
+        result_ = DownloadResult::rejected();
+        return false;
+    }
+    // 開始処理の中で終了していれば中断しない
+    return !finished_.exchange(true, std::memory_order_acq_rel);
+}
+
+std::string Downloader::describeFailure(CurlResult result,
+                                        const ICurlHandle& curl) {
+    switch (result) {
+    case CurlResult::ABORTED_BY_CALLBACK:
+        return "Download aborted: " + curl.getLastError();
+    case CurlResult::NETWORK_ERROR:
+        return "Network error: " + curl.getLastError();
+    case CurlResult::RANGE_NOT_SATISFIED:
         // サーバが Range をサポートしていない場合はエラー
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Server does not support resume (Range not satisfied)");
-    } else {
-        state_.store(DownloadState::ERROR, std::memory_order_release);
-        notifyError("Download failed: " + curl->getLastError());
+        return "Server does not support resume (Range not satisfied)";
+    default:
+        return "Download failed: " + curl.getLastError();
     }
 }
 
@@ -401,71 +3011,320 @@ void Downloader::doDownload() {
 // 一時停止待機
 // =============================================================================
 
-bool Downloader::waitIfPaused() {
-    std::unique_lock<std::mutex> lock(pauseMutex_);
+bool Downloader::enterPause(Transfer& transfer) {
+    std::lock_guard<std::mutex> lock(pauseMutex_);
+    if (!pauseRequested_.load(std::memory_order_acquire)) {
+        return false; // 直前に resume / cancel された
+    }
+
+    transfer.pausedAt = std::chrono::steady_clock::now();
+    transfer.paused.store(true, std::memory_order_release);
+    // onPaused 通知は一度だけ出す（複数セグメントが同時に停止しても 1 回）
+    if (!pauseNotified_) {
+        pauseNotified_ = true;
+        notifyPaused();
+    }
+    return true;
+}
+
+bool Downloader::pollPausedTransfer(Transfer& transfer) {
+    if (!pauseRequested_.load(std::memory_order_acquire)) {
+        // ワーカースレッド駆動では curl_easy_pause を転送スレッドからしか
+        // 呼べないため、ここで再開する（resume() と先着で 1 回だけ）
+        if (transfer.paused.exchange(false, std::memory_order_acq_rel)) {
+            transfer.curl->unpause();
+        }
+        return false;
+    }
+
+    // 展開中の転送は続きから取り直せないため切断しない
+    if (config_.pauseReleaseMs < 0 || decoding_ != ContentDecoding::NONE ||
+        std::chrono::steady_clock::now() - transfer.pausedAt <
+            std::chrono::milliseconds(config_.pauseReleaseMs)) {
+        return false;
+    }
+
+    // resume() が先に unpause していなければ切断する
+    if (!transfer.paused.exchange(false, std::memory_order_acq_rel)) {
+        return false;
+    }
+    transfer.suspended = true;
+    return true;
+}
+
+void Downloader::suspendIfPaused(Transfer& transfer) {
+    // WRITE_PAUSE を保留できないプロトコル (file:// など) では停止したまま
+    // 転送が終わり、未書き込みのデータが失われる。切断扱いにして取り直す
+    if (transfer.paused.exchange(false, std::memory_order_acq_rel)) {
+        transfer.suspended = true;
+    }
+}
+
+bool Downloader::throttleTransfer(Transfer& transfer, DiskWriteQueue& queue) {
+    if (!manager_) {
+        // ワーカースレッド駆動では転送ごとにスレッドがあり、ここで待っても他の
+        // 転送は止まらない（curl_easy_pause も転送スレッドからしか呼べない）
+        const auto since = std::chrono::steady_clock::now();
+        queue.waitForSpace();
+        if (config_.metrics) {
+            config_.metrics->backpressureUs.add(elapsedUs(since));
+        }
+        return false;
+    }
+
+    // イベントループを塞がないよう転送だけを止め、空きができたら再開する
+    transfer.waitingQueue = &queue;
+    queue.notifyWhenSpace(withholdTransfer(transfer));
+    return true;
+}
+
+size_t Downloader::waitForBandwidth(Transfer& transfer, size_t size) {
+    if (manager_) {
+        // 割り当てはスケジューラースレッドが行い、再送されたデータに充てられる
+        bandwidth_->notifyWhenAvailable(size, withholdTransfer(transfer));
+        transfer.bandwidthWait = size;
+        return ICurlHandle::WRITE_PAUSE;
+    }
+
+    // ワーカースレッド駆動では転送スレッドで待つ（受信が止まり TCP の窓も閉じる）
+    const auto interrupted = [this]() {
+        return pauseRequested_.load(std::memory_order_acquire) ||
+               cancelRequested_.load(std::memory_order_acquire) ||
+               transferFailed_.load(std::memory_order_acquire);
+    };
+    const auto since   = std::chrono::steady_clock::now();
+    size_t     granted = size;
+    while (!bandwidth_->acquire(size, interrupted)) {
+        if (cancelRequested_.load(std::memory_order_acquire) ||
+            transferFailed_.load(std::memory_order_acquire)) {
+            granted = 0;
+            break;
+        }
+        if (pauseRequested_.load(std::memory_order_acquire) && enterPause(transfer)) {
+            granted = ICurlHandle::WRITE_PAUSE;
+            break;
+        }
+    }
+    if (config_.metrics) {
+        config_.metrics->backpressureUs.add(elapsedUs(since));
+    }
+    return granted;
+}
+
+std::function<void()> Downloader::withholdTransfer(Transfer& transfer) {
+    transfer.withheld   = true;
+    transfer.withheldAt = std::chrono::steady_clock::now();
+    transfer.throttled.store(true, std::memory_order_release);
+    MetricCounter* stall = config_.metrics ? &config_.metrics->backpressureUs : nullptr;
+    return [this, stall, self = transfer.shared_from_this()]() {
+        std::lock_guard<std::mutex> lock(self->throttleMutex);
+        // restartWhenWritable() が先に解除していれば転送は終わっている
+        // （その場合は Downloader が破棄済みのこともあるため this に触れない）
+        if (self->throttled.exchange(false, std::memory_order_acq_rel)) {
+            if (stall) {
+                stall->add(elapsedUs(self->withheldAt));
+            }
+            manager_->unpause(*self->curl);
+        }
+    };
+}
+
+bool Downloader::restartWhenWritable(const TransferPtr& transfer) {
+    if (!transfer->withheld) {
+        return false;
+    }
+    transfer->withheld = false;
+    {
+        // 空きの通知による unpause を無効にしてから curl を差し替える
+        std::lock_guard<std::mutex> lock(transfer->throttleMutex);
+        transfer->throttled.store(false, std::memory_order_release);
+    }
+    if (cancelRequested_.load(std::memory_order_acquire) ||
+        transferFailed_.load(std::memory_order_acquire)) {
+        return false;
+    }
 
-    // onPaused 通知は一度だけ出す（pauseRequested_ が初めて true になった時）
-    notifyPaused();
+    auto restart = [this, transfer]() {
+        if (config_.metrics) {
+            config_.metrics->backpressureUs.add(elapsedUs(transfer->withheldAt));
+        }
+        if (!resubmitTransfer(transfer)) {
+            finishManagedTransfer(transfer, CurlResult::OTHER_ERROR);
+        }
+    };
+    if (const size_t waiting = std::exchange(transfer->bandwidthWait, 0); waiting > 0) {
+        bandwidth_->notifyWhenAvailable(waiting, std::move(restart));
+    } else {
+        transfer->waitingQueue->notifyWhenSpace(std::move(restart));
+    }
+    return true;
+}
 
+bool Downloader::waitForResume() {
+    std::unique_lock<std::mutex> lock(pauseMutex_);
     // 一時停止が解除されるか、キャンセルされるまで待機する
     pauseCv_.wait(lock, [this]() {
         return !pauseRequested_.load(std::memory_order_acquire) ||
                cancelRequested_.load(std::memory_order_acquire);
     });
+    return !cancelRequested_.load(std::memory_order_acquire);
+}
 
-    if (cancelRequested_.load(std::memory_order_acquire)) {
-        return false; // キャンセル
+void Downloader::unpauseTransfersLocked() {
+    // ワーカースレッド駆動では進捗コールバックが転送スレッド上で再開する
+    if (!manager_) return;
+    for (const auto& transfer : activeTransfers_) {
+        if (transfer->paused.exchange(false, std::memory_order_acq_rel)) {
+            manager_->unpause(*transfer->curl);
+        }
     }
-
-    // 再開通知
-    notifyResumed();
-    return true; // 再開
 }
 
 // =============================================================================
 // Observer 通知ヘルパー
 // =============================================================================
 
+template <typename Deliver>
+void Downloader::dispatchToObservers(Deliver deliver, bool coalesce) {
+    if (!dispatcher_) {
+        deliverToObservers(deliver);
+        return;
+    }
+
+    auto snapshot = observers_.load(std::memory_order_acquire);
+    if (snapshot->empty()) {
+        return;
+    }
+
+    // 配信が終わるまでスナップショットを保持する（removeObserver はその解放を待つ）
+    MetricHistogram* latency = config_.metrics ? &config_.metrics->observerCallbackUs : nullptr;
+    auto run = [snapshot = std::move(snapshot), deliver = std::move(deliver), latency]() {
+        ScopedLatency      timer(latency);
+        CallbackDepthGuard depth;
+        for (auto* obs : *snapshot) {
+            deliver(*obs);
+        }
+    };
+
+    if (coalesce) {
+        dispatcher_->postLatest(std::move(run));
+    } else {
+        dispatcher_->post(std::move(run));
+    }
+}
+
+template <typename Deliver>
+void Downloader::deliverToObservers(const Deliver& deliver) {
+    // 配信が終わるまでスナップショットを保持する（removeObserver はその解放を待つ）
+    const auto snapshot = observers_.load(std::memory_order_acquire);
+    if (snapshot->empty()) {
+        return;
+    }
+    ScopedLatency      timer(config_.metrics ? &config_.metrics->observerCallbackUs : nullptr);
+    CallbackDepthGuard depth;
+    for (auto* obs : *snapshot) {
+        deliver(*obs);
+    }
+}
+
+bool Downloader::claimProgressNotification(int64_t downloaded) {
+    const int64_t lastBytes = lastProgressBytes_.load(std::memory_order_relaxed);
+    if (downloaded == lastBytes) {
+        return false;
+    }
+    if (lastBytes >= 0 && config_.progressMinBytes > 0 &&
+        downloaded - lastBytes < config_.progressMinBytes) {
+        return false;
+    }
+
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t lastNs = lastProgressNs_.load(std::memory_order_relaxed);
+    if (lastBytes >= 0 && config_.progressIntervalMs > 0 &&
+        now - lastNs < static_cast<int64_t>(config_.progressIntervalMs) * 1000000) {
+        return false;
+    }
+
+    // 同時に条件を満たしたセグメントのうち 1 つだけが通知する
+    if (!lastProgressNs_.compare_exchange_strong(lastNs, now,
+                                                 std::memory_order_relaxed)) {
+        return false;
+    }
+    lastProgressBytes_.store(downloaded, std::memory_order_relaxed);
+    return true;
+}
+
+double Downloader::progressPercent(int64_t downloaded, int64_t total) const {
+    if (decoding_ != ContentDecoding::NONE) {
+        downloaded = wireBytes_.load(std::memory_order_relaxed);
+        total      = wireTotalBytes_.load(std::memory_order_relaxed);
+    }
+    if (total <= 0) {
+        return -1.0;
+    }
+    return static_cast<double>(downloaded) / static_cast<double>(total) * 100.0;
+}
+
+void Downloader::publishProgress() {
+    if (manager_) {
+        manager_->progressTable().publish(progressSlot_, state_.load(std::memory_order_acquire),
+                                          downloadedBytes_.load(std::memory_order_relaxed),
+                                          totalBytes_.load(std::memory_order_relaxed));
+    }
+}
+
 void Downloader::notifyProgress(int64_t downloaded, int64_t total, double percent) {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onProgress(downloaded, total, percent);
+    publishProgress();
+    if (!dispatcher_) {
+        deliverToObservers([=](IDownloaderObserver& obs) {
+            obs.onProgress(downloaded, total, percent);
+        });
+        return;
+    }
+
+    // 値は置き場所に書き、イベントは this だけを捕捉する。std::function の内部に収まるため
+    // 通知ごとにヒープ確保をせず、未配信のイベントがあればそれが最新の値を配信する
+    {
+        std::lock_guard<std::mutex> lock(progressMutex_);
+        pendingProgress_ = {downloaded, total, percent};
     }
+    dispatcher_->postLatest([this]() { deliverPendingProgress(); });
 }
 
-void Downloader::notifyCompleted() {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onCompleted();
+void Downloader::deliverPendingProgress() {
+    PendingProgress progress;
+    {
+        std::lock_guard<std::mutex> lock(progressMutex_);
+        progress = pendingProgress_;
     }
+    deliverToObservers([&progress](IDownloaderObserver& obs) {
+        obs.onProgress(progress.downloaded, progress.total, progress.percent);
+    });
+}
+
+void Downloader::notifyCompleted() {
+    publishProgress();
+    dispatchToObservers([](IDownloaderObserver& obs) { obs.onCompleted(); });
 }
 
 void Downloader::notifyError(const std::string& message) {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onError(message);
-    }
+    publishProgress();
+    dispatchToObservers([message](IDownloaderObserver& obs) { obs.onError(message); });
 }
 
 void Downloader::notifyPaused() {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onPaused();
-    }
+    publishProgress();
+    dispatchToObservers([](IDownloaderObserver& obs) { obs.onPaused(); });
 }
 
 void Downloader::notifyResumed() {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onResumed();
-    }
+    publishProgress();
+    dispatchToObservers([](IDownloaderObserver& obs) { obs.onResumed(); });
 }
 
 void Downloader::notifyCancelled() {
-    std::lock_guard<std::mutex> lock(observerMutex_);
-    for (auto* obs : observers_) {
-        obs->onCancelled();
-    }
+    publishProgress();
+    dispatchToObservers([](IDownloaderObserver& obs) { obs.onCancelled(); });
 }
 
 } // namespace Downloader
@@ -0,0 +1,550 @@
+// =============================================================================
+// FileWriter.cpp
+// 出力ファイルへの書き込みの実装（POSIX / Windows）
+//
+// 設計方針:
+//  - 失敗時は getLastError() に理由を残す。領域の確保は未対応のファイルシステムでは
+//    サイズを伸ばすだけで代用する（MappedFile と同じ）
+//  - direct ハンドルでの書き込みに失敗したら direct ハンドルを閉じ、同じ区間を通常のハンドルで
+//    書き直す（揃えの要件が ALIGNMENT より大きいデバイスなど）
+// =============================================================================
+
+#include "FileWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace Downloader {
+
+namespace {
+
+/// directIo で呼び出し側のバッファを写す整列したバッファのサイズ
+constexpr size_t BOUNCE_SIZE = 1024 * 1024;
+
+/// dropCache で書き出しをまとめて始める区間の大きさ
+constexpr int64_t DROP_WINDOW = 8 * 1024 * 1024;
+
+} // namespace
+
+FileWriter::~FileWriter() {
+    close();
+}
+
+// =============================================================================
+// 共通の実装
+// =============================================================================
+
+bool FileWriter::write(const char* data, size_t size) {
+    if (!writeAt(position_, data, size)) {
+        return false;
+    }
+    position_ += static_cast<int64_t>(size);
+    return true;
+}
+
+bool FileWriter::writeAt(int64_t offset, const char* data, size_t size) {
+    if (!open_) {
+        lastError_ = "File is not open";
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+
+    const int64_t end = offset + static_cast<int64_t>(size);
+    const int64_t alignedFirst = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    const int64_t alignedEnd   = end / ALIGNMENT * ALIGNMENT;
+    if (!direct_ || alignedFirst >= alignedEnd) {
+        return writeBuffered(offset, data, size) && afterWrite(offset, size);
+    }
+
+    // 境界に揃った部分だけを direct ハンドルで書き、揃わない先頭と末尾は通常のハンドルで書く
+    if (offset < alignedFirst &&
+        !writeBuffered(offset, data, static_cast<size_t>(alignedFirst - offset))) {
+        return false;
+    }
+    if (!writeAligned(alignedFirst, data + (alignedFirst - offset),
+                      static_cast<size_t>(alignedEnd - alignedFirst))) {
+        return false;
+    }
+    if (alignedEnd < end &&
+        !writeBuffered(alignedEnd, data + (alignedEnd - offset), static_cast<size_t>(end - alignedEnd))) {
+        return false;
+    }
+    return afterWrite(offset, size);
+}
+
+bool FileWriter::writeAligned(int64_t offset, const char* data, size_t size) {
+    if (reinterpret_cast<uintptr_t>(data) % ALIGNMENT == 0) {
+        if (writeDirect(offset, data, size)) {
+            return true;
+        }
+    } else {
+        if (bounce_.empty()) {
+            bounce_.resize(BOUNCE_SIZE + ALIGNMENT);
+        }
+        const uintptr_t base    = reinterpret_cast<uintptr_t>(bounce_.data());
+        char*           aligned = bounce_.data() + (ALIGNMENT - base % ALIGNMENT) % ALIGNMENT;
+        size_t          done    = 0;
+        while (done < size) {
+            const size_t chunk = std::min(size - done, BOUNCE_SIZE);
+            std::memcpy(aligned, data + done, chunk);
+            if (!writeDirect(offset + static_cast<int64_t>(done), aligned, chunk)) {
+                break;
+            }
+            done += chunk;
+        }
+        if (done == size) {
+            return true;
+        }
+    }
+
+    // 書けなかった区間（途中まで書けていても）を通常のハンドルで書き直し、以降も通常のハンドルで書く
+    closeDirect();
+    direct_ = false;
+    bounce_.clear();
+    bounce_.shrink_to_fit();
+    return writeBuffered(offset, data, size);
+}
+
+bool FileWriter::afterWrite(int64_t offset, size_t size) {
+    if (options_.dropCache) {
+        if (pendingSize_ > 0 && offset == pendingStart_ + pendingSize_) {
+            pendingSize_ += static_cast<int64_t>(size);
+        } else {
+            rotateDropWindow();
+            pendingStart_ = offset;
+            pendingSize_  = static_cast<int64_t>(size);
+        }
+        if (pendingSize_ >= DROP_WINDOW) {
+            rotateDropWindow();
+        }
+    }
+    if (options_.syncInterval > 0) {
+        unsynced_ += static_cast<int64_t>(size);
+        if (unsynced_ >= options_.syncInterval) {
+            return sync();
+        }
+    }
+    return true;
+}
+
+void FileWriter::rotateDropWindow() {
+    if (pendingSize_ > 0) {
+        startWriteback(pendingStart_, pendingSize_);
+    }
+    if (flushingSize_ > 0) {
+        dropPages(flushingStart_, flushingSize_);
+    }
+    flushingStart_ = pendingStart_;
+    flushingSize_  = pendingSize_;
+    pendingSize_   = 0;
+}
+
+#ifdef _WIN32
+
+// =============================================================================
+// Windows 実装
+// =============================================================================
+
+namespace {
+
+std::string lastErrorMessage(const char* what) {
+    return std::string(what) + " failed (error " + std::to_string(GetLastError()) + ")";
+}
+
+bool writeHandleAt(HANDLE handle, int64_t offset, const char* data, size_t size) {
+    while (size > 0) {
+        // 同期ハンドルでも OVERLAPPED の位置に書き込まれる
+        OVERLAPPED overlapped{};
+        overlapped.Offset     = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        const DWORD chunk   = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        DWORD       written = 0;
+        if (!WriteFile(handle, data, chunk, &written, &overlapped) || written == 0) {
+            return false;
+        }
+        data   += written;
+        size   -= written;
+        offset += written;
+    }
+    return true;
+}
+
+int64_t fileSize(HANDLE handle) {
+    LARGE_INTEGER size;
+    return GetFileSizeEx(handle, &size) ? size.QuadPart : -1;
+}
+
+} // namespace
+
+bool FileWriter::open(const std::string& path, Mode mode, Options options) {
+    close();
+    lastError_.clear();
+    options_ = options;
+
+    constexpr DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, share, nullptr,
+                              mode == Mode::TRUNCATE ? CREATE_ALWAYS : OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        lastError_ = lastErrorMessage("CreateFile");
+        return false;
+    }
+    file_     = file;
+    open_     = true;
+    position_ = mode == Mode::APPEND ? std::max<int64_t>(fileSize(file), 0) : 0;
+
+    if (options.directIo) {
+        HANDLE direct = CreateFileA(path.c_str(), GENERIC_WRITE, share, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, nullptr);
+        if (direct != INVALID_HANDLE_VALUE) {
+            directFile_ = direct;
+            direct_     = true;
+        }
+    }
+    return true;
+}
+
+bool FileWriter::allocate(int64_t size) {
+    HANDLE file = static_cast<HANDLE>(file_);
+    if (size <= fileSize(file)) {
+        return true;
+    }
+    // 領域を確保してからサイズを伸ばす（SetFileValidData は特権が必要なため使わない）
+    FILE_ALLOCATION_INFO allocation{};
+    allocation.AllocationSize.QuadPart = size;
+    SetFileInformationByHandle(file, FileAllocationInfo, &allocation, sizeof(allocation));
+    return truncate(size);
+}
+
+bool FileWriter::truncate(int64_t size) {
+    FILE_END_OF_FILE_INFO end{};
+    end.EndOfFile.QuadPart = size;
+    if (!SetFileInformationByHandle(static_cast<HANDLE>(file_), FileEndOfFileInfo, &end, sizeof(end))) {
+        lastError_ = lastErrorMessage("SetFileInformationByHandle");
+        return false;
+    }
+    return true;
+}
+
+void FileWriter::reserve(int64_t size) {
+    // 現在のサイズより小さい確保はファイルを切り詰めるため、伸ばす場合だけ設定する
+    HANDLE file = static_cast<HANDLE>(file_);
+    if (size > fileSize(file)) {
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = size;
+        SetFileInformationByHandle(file, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+}
+
+bool FileWriter::writeBuffered(int64_t offset, const char* data, size_t size) {
+    if (!writeHandleAt(static_cast<HANDLE>(file_), offset, data, size)) {
+        lastError_ = lastErrorMessage("WriteFile");
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::writeDirect(int64_t offset, const char* data, size_t size) {
+    return writeHandleAt(static_cast<HANDLE>(directFile_), offset, data, size);
+}
+
+void FileWriter::closeDirect() {
+    if (directFile_) {
+        CloseHandle(directFile_);
+        directFile_ = nullptr;
+    }
+}
+
+void FileWriter::startWriteback(int64_t, int64_t) {}
+
+void FileWriter::dropPages(int64_t, int64_t) {}
+
+bool FileWriter::sync() {
+    unsynced_ = 0;
+    if (!FlushFileBuffers(static_cast<HANDLE>(file_))) {
+        lastError_ = lastErrorMessage("FlushFileBuffers");
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::close() {
+    closeDirect();
+    if (file_) {
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+    open_         = false;
+    direct_       = false;
+    position_     = 0;
+    unsynced_     = 0;
+    pendingSize_  = 0;
+    flushingSize_ = 0;
+    return true;
+}
+
+bool FileWriter::syncFile(const std::string& path, std::string& error) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = lastErrorMessage("CreateFile");
+        return false;
+    }
+    const bool ok = FlushFileBuffers(file) != 0;
+    if (!ok) {
+        error = lastErrorMessage("FlushFileBuffers");
+    }
+    CloseHandle(file);
+    return ok;
+}
+
+bool FileWriter::replace(const std::string& from, const std::string& to, bool durable, std::string& error) {
+    const DWORD flags = MOVEFILE_REPLACE_EXISTING | (durable ? MOVEFILE_WRITE_THROUGH : 0);
+    if (!MoveFileExA(from.c_str(), to.c_str(), flags)) {
+        error = lastErrorMessage("MoveFileEx");
+        return false;
+    }
+    return true;
+}
+
+#else
+
+// =============================================================================
+// POSIX 実装
+// =============================================================================
+
+namespace {
+
+std::string lastErrorMessage(const char* what, int error) {
+    return std::string(what) + " failed: " + std::strerror(error);
+}
+
+/// @return 0: 成功、それ以外: errno
+int writeFdAt(int fd, int64_t offset, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        data   += written;
+        size   -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return 0;
+}
+
+int syncFd(int fd) {
+#ifdef __APPLE__
+    return ::fsync(fd);
+#else
+    return ::fdatasync(fd);
+#endif
+}
+
+} // namespace
+
+bool FileWriter::open(const std::string& path, Mode mode, Options options) {
+    close();
+    lastError_.clear();
+    options_ = options;
+
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (mode == Mode::TRUNCATE ? O_TRUNC : 0);
+    fd_ = ::open(path.c_str(), flags, 0644);
+    if (fd_ < 0) {
+        lastError_ = lastErrorMessage("open", errno);
+        return false;
+    }
+    open_ = true;
+    if (mode == Mode::APPEND) {
+        struct stat st {};
+        position_ = ::fstat(fd_, &st) == 0 ? static_cast<int64_t>(st.st_size) : 0;
+    }
+
+    if (options.directIo) {
+#if defined(O_DIRECT)
+        directFd_ = ::open(path.c_str(), O_WRONLY | O_CLOEXEC | O_DIRECT);
+#elif defined(F_NOCACHE)
+        directFd_ = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (directFd_ >= 0 && ::fcntl(directFd_, F_NOCACHE, 1) != 0) {
+            ::close(directFd_);
+            directFd_ = -1;
+        }
+#endif
+        direct_ = directFd_ >= 0; // 対応しないファイルシステムでは通常の書き込みにする
+    }
+    return true;
+}
+
+bool FileWriter::allocate(int64_t size) {
+    // 領域を先に確保する（fallocate / posix_fallocate は既存の内容を残し、短くはしない）
+#ifdef __linux__
+    const int allocError = ::fallocate(fd_, 0, 0, static_cast<off_t>(size)) == 0 ? 0 : errno;
+#else
+    const int allocError = posix_fallocate(fd_, 0, static_cast<off_t>(size));
+#endif
+    if (allocError == 0) {
+        return true;
+    }
+    if (allocError != EOPNOTSUPP && allocError != EINVAL) {
+        lastError_ = lastErrorMessage("fallocate", allocError);
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd_, &st) == 0 && st.st_size >= size) {
+        return true;
+    }
+    return truncate(size);
+}
+
+bool FileWriter::truncate(int64_t size) {
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        lastError_ = lastErrorMessage("ftruncate", errno);
+        return false;
+    }
+    return true;
+}
+
+void FileWriter::reserve(int64_t size) {
+#ifdef __linux__
+    if (size > 0) {
+        ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+    }
+#else
+    (void)size;
+#endif
+}
+
+bool FileWriter::writeBuffered(int64_t offset, const char* data, size_t size) {
+    const int error = writeFdAt(fd_, offset, data, size);
+    if (error != 0) {
+        lastError_ = lastErrorMessage("pwrite", error);
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::writeDirect(int64_t offset, const char* data, size_t size) {
+    return writeFdAt(directFd_, offset, data, size) == 0;
+}
+
+void FileWriter::closeDirect() {
+    if (directFd_ >= 0) {
+        ::close(directFd_);
+        directFd_ = -1;
+    }
+}
+
+void FileWriter::startWriteback(int64_t offset, int64_t size) {
+#ifdef __linux__
+    ::sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(size), SYNC_FILE_RANGE_WRITE);
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+void FileWriter::dropPages(int64_t offset, int64_t size) {
+#ifdef __linux__
+    // 書き出しが終わるまでは dirty なページは捨てられないため、先に待つ
+    ::sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(size),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+bool FileWriter::sync() {
+    unsynced_ = 0;
+    if (syncFd(fd_) != 0) {
+        lastError_ = lastErrorMessage("fdatasync", errno);
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::close() {
+    bool ok = true;
+    if (fd_ >= 0) {
+        if (options_.dropCache) {
+            rotateDropWindow();
+            rotateDropWindow();
+        }
+        closeDirect();
+        if (::close(fd_) != 0) {
+            lastError_ = lastErrorMessage("close", errno);
+            ok = false;
+        }
+        fd_ = -1;
+    }
+    open_         = false;
+    direct_       = false;
+    position_     = 0;
+    unsynced_     = 0;
+    pendingSize_  = 0;
+    flushingSize_ = 0;
+    return ok;
+}
+
+bool FileWriter::syncFile(const std::string& path, std::string& error) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = lastErrorMessage("open", errno);
+        return false;
+    }
+    const bool ok = syncFd(fd) == 0;
+    if (!ok) {
+        error = lastErrorMessage("fdatasync", errno);
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool FileWriter::replace(const std::string& from, const std::string& to, bool durable, std::string& error) {
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        error = lastErrorMessage("rename", errno);
+        return false;
+    }
+    if (!durable) {
+        return true;
+    }
+    // 名前の置き換えはディレクトリの内容なので、ディレクトリを fsync して残す
+    std::string directory = std::filesystem::path(to).parent_path().string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECTORY);
+    if (fd < 0) {
+        error = lastErrorMessage("open", errno);
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    if (!ok) {
+        error = lastErrorMessage("fsync", errno);
+    }
+    ::close(fd);
+    return ok;
+}
+
+#endif
+
+} // namespace Downloader
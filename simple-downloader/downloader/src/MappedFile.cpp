@@ -0,0 +1,187 @@
+// =============================================================================
+// MappedFile.cpp
+// 出力ファイルのメモリマップ実装（POSIX / Windows）
+//
+// 設計方針:
+//  - 失敗時は途中まで取得した資源を close() で解放し、getLastError() に理由を残す
+//  - 領域確保は posix_fallocate を優先し、未対応なら ftruncate で代用する
+//    （Windows の SetFileValidData は特権が必要なため使わず、SetEndOfFile で伸ばす）
+// =============================================================================
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <cstring>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace Downloader {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+// =============================================================================
+// Windows 実装
+// =============================================================================
+
+namespace {
+
+std::string lastErrorMessage(const char* what) {
+    return std::string(what) + " failed (error " + std::to_string(GetLastError()) + ")";
+}
+
+} // namespace
+
+bool MappedFile::open(const std::string& path, int64_t size) {
+    close();
+    lastError_.clear();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                              nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        lastError_ = lastErrorMessage("CreateFile");
+        return false;
+    }
+    file_ = file;
+    open_ = true;
+
+    LARGE_INTEGER end;
+    end.QuadPart = size;
+    if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        lastError_ = lastErrorMessage("SetEndOfFile");
+        close();
+        return false;
+    }
+    size_ = size;
+    if (size == 0) {
+        return true; // 空ファイルはマップできない
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping) {
+        lastError_ = lastErrorMessage("CreateFileMapping");
+        close();
+        return false;
+    }
+    mapping_ = mapping;
+
+    data_ = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+    if (!data_) {
+        lastError_ = lastErrorMessage("MapViewOfFile");
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::close() {
+    bool ok = true;
+    if (data_) {
+        ok = UnmapViewOfFile(data_) != 0;
+        if (!ok) lastError_ = lastErrorMessage("UnmapViewOfFile");
+        data_ = nullptr;
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_) {
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+    size_ = 0;
+    open_ = false;
+    return ok;
+}
+
+#else
+
+// =============================================================================
+// POSIX 実装
+// =============================================================================
+
+namespace {
+
+std::string lastErrorMessage(const char* what, int error) {
+    return std::string(what) + " failed: " + std::strerror(error);
+}
+
+} // namespace
+
+bool MappedFile::open(const std::string& path, int64_t size) {
+    close();
+    lastError_.clear();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        lastError_ = lastErrorMessage("open", errno);
+        return false;
+    }
+    open_ = true;
+    if (size == 0) {
+        return true; // 空ファイルはマップできない
+    }
+
+    // ディスク領域を先に確保する（posix_fallocate は errno を設定せず戻り値で返す）
+    const int allocError = posix_fallocate(fd_, 0, static_cast<off_t>(size));
+    if (allocError != 0) {
+        if (allocError != EOPNOTSUPP && allocError != EINVAL) {
+            lastError_ = lastErrorMessage("posix_fallocate", allocError);
+            close();
+            return false;
+        }
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            lastError_ = lastErrorMessage("ftruncate", errno);
+            close();
+            return false;
+        }
+    }
+    size_ = size;
+
+    void* mapped = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        lastError_ = lastErrorMessage("mmap", errno);
+        close();
+        return false;
+    }
+    data_ = static_cast<char*>(mapped);
+
+    // 各区間は先頭から順に書き込まれることをカーネルに伝える
+    madvise(mapped, static_cast<size_t>(size), MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedFile::close() {
+    bool ok = true;
+    if (data_) {
+        if (munmap(data_, static_cast<size_t>(size_)) != 0) {
+            lastError_ = lastErrorMessage("munmap", errno);
+            ok = false;
+        }
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        if (::close(fd_) != 0 && ok) {
+            lastError_ = lastErrorMessage("close", errno);
+            ok = false;
+        }
+        fd_ = -1;
+    }
+    size_ = 0;
+    open_ = false;
+    return ok;
+}
+
+#endif
+
+} // namespace Downloader
@@ -0,0 +1,101 @@
+// =============================================================================
+// ObserverDispatcher.cpp
+// オブザーバー通知キューの実装
+//
+// 設計方針:
+//  - イベントはロックの外で実行する（イベントから再度 post() できる）
+//  - イベントの例外は握りつぶし、ディスパッチスレッドと flush() の待機を止めない
+//  - postLatest() はキューに目印（空の Event）だけを積み、中身は latest_ に置く。
+//    目印を取り出した時点の最新イベントを実行する
+// =============================================================================
+
+#include "ObserverDispatcher.h"
+
+#include <utility>
+
+namespace Downloader {
+
+ObserverDispatcher::ObserverDispatcher() {
+    thread_ = std::thread(&ObserverDispatcher::dispatchThread, this);
+}
+
+ObserverDispatcher::~ObserverDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    workCv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ObserverDispatcher::post(Event event) {
+    if (!event) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(std::move(event));
+    }
+    workCv_.notify_one();
+}
+
+void ObserverDispatcher::postLatest(Event event) {
+    if (!event) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        latest_ = std::move(event);
+        if (latestQueued_) {
+            return; // まだ実行されていない目印がある
+        }
+        latestQueued_ = true;
+        events_.emplace_back();
+    }
+    workCv_.notify_one();
+}
+
+void ObserverDispatcher::flush() {
+    if (isDispatchThread()) {
+        return; // 自身の実行完了は待てない
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCv_.wait(lock, [this]() { return events_.empty() && !running_; });
+}
+
+bool ObserverDispatcher::isDispatchThread() const {
+    return std::this_thread::get_id() == thread_.get_id();
+}
+
+void ObserverDispatcher::dispatchThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        workCv_.wait(lock, [this]() { return stopRequested_ || !events_.empty(); });
+        if (events_.empty()) {
+            return; // 停止要求かつ積まれたイベントはすべて実行済み
+        }
+
+        Event event = std::move(events_.front());
+        events_.pop_front();
+        if (!event) {
+            event         = std::move(latest_);
+            latest_       = nullptr;
+            latestQueued_ = false;
+        }
+
+        running_ = true;
+        lock.unlock();
+        try {
+            event();
+        } catch (...) {
+            // オブザーバーの例外でスレッドを終わらせない（同期通知と同じく呼び出し側へは伝えない）
+        }
+        event = nullptr; // キャプチャをロックの外で解放する
+        lock.lock();
+        running_ = false;
+
+        if (events_.empty()) {
+            idleCv_.notify_all();
+        }
+    }
+}
+
+} // namespace Downloader
@@ -0,0 +1,494 @@
+// =============================================================================
+// PeerServer.cpp
+// ピア配布サーバの実装（POSIX ソケット / Winsock）
+// =============================================================================
+
+#include "PeerServer.h"
+
+#include "Checksum.h"
+#include "IPeerTracker.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <fcntl.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#  ifdef __linux__
+#    include <sys/sendfile.h>
+#  endif
+#endif
+
+namespace Downloader {
+
+namespace {
+
+#ifdef _WIN32
+using NativeSocket = SOCKET;
+constexpr int SEND_FLAGS = 0;
+
+bool invalid(NativeSocket socket) { return socket == INVALID_SOCKET; }
+void closeSocket(NativeSocket socket) { ::closesocket(socket); }
+
+/// Winsock の初期化（プロセスで一度だけ）
+void initSockets() {
+    static const bool initialized = []() {
+        WSADATA data;
+        return ::WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!initialized) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+}
+#else
+using NativeSocket = int;
+#  ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL; // 切断された接続への送信で SIGPIPE を出さない
+#  else
+constexpr int SEND_FLAGS = 0;
+#  endif
+
+bool invalid(NativeSocket socket) { return socket < 0; }
+void closeSocket(NativeSocket socket) { ::close(socket); }
+
+void initSockets() {}
+#endif
+
+NativeSocket native(intptr_t socket) { return static_cast<NativeSocket>(socket); }
+
+constexpr std::string_view PATH_PREFIX = "/peer/";
+
+/// すべて送る
+bool sendAll(intptr_t socket, const char* data, size_t size) {
+    while (size > 0) {
+        const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+        const auto sent = ::send(native(socket), data, chunk, SEND_FLAGS);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool sendAll(intptr_t socket, std::string_view text) {
+    return sendAll(socket, text.data(), text.size());
+}
+
+/// ASCII の大文字小文字を無視して前方一致を調べる
+bool startsWithIgnoreCase(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) !=
+            std::tolower(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// 要求からヘッダーの値を探す（なければ空）
+std::string_view headerValue(std::string_view request, std::string_view name) {
+    size_t line = request.find("\r\n");
+    while (line != std::string_view::npos && line + 2 < request.size()) {
+        const size_t begin = line + 2;
+        const size_t end   = request.find("\r\n", begin);
+        const std::string_view header =
+            request.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+        if (startsWithIgnoreCase(header, name) && header.size() > name.size() &&
+            header[name.size()] == ':') {
+            std::string_view value = header.substr(name.size() + 1);
+            while (!value.empty() && value.front() == ' ') {
+                value.remove_prefix(1);
+            }
+            return value;
+        }
+        line = end;
+    }
+    return {};
+}
+
+/// 本文のない応答
+std::string emptyResponse(std::string_view status, bool keepAlive) {
+    std::string response = "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Length: 0\r\n";
+    response += keepAlive ? "\r\n" : "Connection: close\r\n\r\n";
+    return response;
+}
+
+/// [first, last] が受信済みの区間の 1 つに含まれるか
+bool covered(const std::vector<SegmentRange>& ranges, int64_t first, int64_t last) {
+    const auto it = std::upper_bound(ranges.begin(), ranges.end(), first,
+                                     [](int64_t position, const SegmentRange& range) {
+                                         return position < range.first;
+                                     });
+    return it != ranges.begin() && std::prev(it)->last >= last;
+}
+
+} // namespace
+
+// =============================================================================
+// 待ち受け
+// =============================================================================
+
+PeerServer::PeerServer(Options options)
+    : options_(std::move(options)) {
+    initSockets();
+    const NativeSocket listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (invalid(listener)) {
+        throw std::runtime_error("Failed to create listening socket");
+    }
+    const int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR,
+                 reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port   = htons(options_.port);
+    socklen_t length   = sizeof(address);
+    if (::inet_pton(AF_INET, options_.bindAddress.c_str(), &address.sin_addr) != 1 ||
+        ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        closeSocket(listener);
+        throw std::runtime_error("Failed to listen on " + options_.bindAddress + ":" +
+                                 std::to_string(options_.port));
+    }
+    listener_ = static_cast<Socket>(listener);
+    port_     = ntohs(address.sin_port);
+
+    acceptThread_ = std::thread(&PeerServer::acceptLoop, this);
+}
+
+PeerServer::~PeerServer() {
+    // 先に登録を外し、新しい要求が来ないようにする
+    std::unordered_map<std::string, Share> shares;
+    {
+        std::lock_guard<std::mutex> lock(sharesMutex_);
+        shares.swap(shares_);
+    }
+    if (options_.tracker) {
+        for (const auto& [key, share] : shares) {
+            options_.tracker->withdraw(share.url, peerUrl(share.url));
+        }
+    }
+
+    stopping_.store(true, std::memory_order_release);
+    // accept と recv で止まっているスレッドを shutdown で起こす
+    ::shutdown(native(listener_), 2);
+    closeSocket(native(listener_));
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    for (const auto& connection : connections_) {
+        ::shutdown(native(connection->socket), 2);
+    }
+    for (const auto& connection : connections_) {
+        connection->thread.join();
+        closeSocket(native(connection->socket));
+    }
+    connections_.clear();
+}
+
+std::string PeerServer::keyFor(const std::string& url) {
+    StreamingChecksum digest(ChecksumAlgorithm::SHA256);
+    digest.update(url.data(), url.size());
+    return std::string(PATH_PREFIX) + digest.hexDigest();
+}
+
+std::string PeerServer::peerUrl(const std::string& url) const {
+    const std::string& host = options_.advertisedHost.empty() ? options_.bindAddress
+                                                               : options_.advertisedHost;
+    return "http://" + host + ":" + std::to_string(port_) + keyFor(url);
+}
+
+void PeerServer::acceptLoop() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const NativeSocket client = ::accept(native(listener_), nullptr, nullptr);
+        if (invalid(client)) {
+            if (stopping_.load(std::memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+        const int noDelay = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY,
+                     reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        reapConnections();
+        auto connection    = std::make_unique<Connection>();
+        connection->socket = static_cast<Socket>(client);
+        Connection* raw    = connection.get();
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        if (stopping_.load(std::memory_order_acquire)) {
+            closeSocket(client);
+            return;
+        }
+        if (connections_.size() >= options_.maxConnections) {
+            // 混んでいるピアは断り、要求側に別の取得元を使わせる
+            sendAll(connection->socket, emptyResponse("503 Service Unavailable", false));
+            closeSocket(client);
+            continue;
+        }
+        connection->thread = std::thread([this, raw]() {
+            serve(*raw);
+            raw->done.store(true, std::memory_order_release);
+        });
+        connections_.push_back(std::move(connection));
+    }
+}
+
+void PeerServer::reapConnections() {
+    std::vector<std::unique_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        const auto split = std::partition(connections_.begin(), connections_.end(),
+                                          [](const std::unique_ptr<Connection>& connection) {
+                                              return !connection->done.load(std::memory_order_acquire);
+                                          });
+        std::move(split, connections_.end(), std::back_inserter(finished));
+        connections_.erase(split, connections_.end());
+    }
+    for (const auto& connection : finished) {
+        connection->thread.join();
+        closeSocket(native(connection->socket));
+    }
+}
+
+// =============================================================================
+// 配布する内容
+// =============================================================================
+
+std::string PeerServer::share(const std::string& url, const std::string& path,
+                              int64_t contentLength) {
+    {
+        std::lock_guard<std::mutex> lock(sharesMutex_);
+        shares_[keyFor(url)] = {url, path, contentLength, {}};
+    }
+    std::string announced = peerUrl(url);
+    if (options_.tracker) {
+        options_.tracker->announce(url, announced);
+    }
+    return announced;
+}
+
+void PeerServer::markAvailable(const std::string& url, int64_t first, int64_t last) {
+    std::lock_guard<std::mutex> lock(sharesMutex_);
+    const auto it = shares_.find(keyFor(url));
+    if (it == shares_.end() || first > last) {
+        return;
+    }
+    auto& ranges = it->second.ranges;
+    const SegmentRange added{first, std::min(last, it->second.contentLength - 1)};
+    ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), added,
+                                   [](const SegmentRange& a, const SegmentRange& b) {
+                                       return a.first < b.first;
+                                   }),
+                  added);
+
+    // 重なる・隣接する区間をまとめる
+    std::vector<SegmentRange> merged;
+    merged.reserve(ranges.size());
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().last + 1) {
+            merged.back().last = std::max(merged.back().last, range.last);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    ranges.swap(merged);
+}
+
+void PeerServer::markComplete(const std::string& url) {
+    std::lock_guard<std::mutex> lock(sharesMutex_);
+    const auto it = shares_.find(keyFor(url));
+    if (it != shares_.end() && it->second.contentLength > 0) {
+        it->second.ranges = {{0, it->second.contentLength - 1}};
+    }
+}
+
+void PeerServer::unshare(const std::string& url) {
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> lock(sharesMutex_);
+        removed = shares_.erase(keyFor(url)) > 0;
+    }
+    if (removed && options_.tracker) {
+        options_.tracker->withdraw(url, peerUrl(url));
+    }
+}
+
+std::vector<SegmentRange> PeerServer::availableRanges(const std::string& url) const {
+    std::lock_guard<std::mutex> lock(sharesMutex_);
+    const auto it = shares_.find(keyFor(url));
+    return it == shares_.end() ? std::vector<SegmentRange>() : it->second.ranges;
+}
+
+// =============================================================================
+// 要求の処理
+// =============================================================================
+
+void PeerServer::serve(Connection& connection) {
+    std::string buffer;
+    std::array<char, 4096> chunk{};
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const size_t end = buffer.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (buffer.size() > 64 * 1024) {
+                return; // ヘッダーが大きすぎる
+            }
+            const auto got = ::recv(native(connection.socket), chunk.data(),
+                                    static_cast<int>(chunk.size()), 0);
+            if (got <= 0) {
+                return; // 相手が閉じた・サーバの停止
+            }
+            buffer.append(chunk.data(), static_cast<size_t>(got));
+            continue;
+        }
+        // 要求はボディを持たない (GET / HEAD) ため、空行までが 1 つの要求
+        const std::string request = buffer.substr(0, end + 2);
+        buffer.erase(0, end + 4);
+        if (!respond(connection.socket, request)) {
+            return;
+        }
+    }
+}
+
+bool PeerServer::respond(Socket socket, const std::string& request) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    // 要求行: "METHOD /peer/<key> HTTP/1.1"
+    const std::string_view line = std::string_view(request).substr(0, request.find("\r\n"));
+    const size_t methodEnd = line.find(' ');
+    const size_t pathEnd   = line.find(' ', methodEnd + 1);
+    const std::string_view method = line.substr(0, methodEnd);
+    const std::string_view path   = methodEnd == std::string_view::npos
+                                        ? std::string_view()
+                                        : line.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    const bool keepAlive = !startsWithIgnoreCase(headerValue(request, "Connection"), "close");
+
+    if (method != "GET" && method != "HEAD") {
+        sendAll(socket, emptyResponse("405 Method Not Allowed", false));
+        return false;
+    }
+
+    // Range: bytes=first-last / bytes=first-（複数区間・末尾からの指定は扱わず全体とみなす）
+    int64_t first   = 0;
+    int64_t last    = -1;
+    bool    partial = false;
+    const std::string_view range = headerValue(request, "Range");
+    if (range.substr(0, 6) == "bytes=" && range.find(',') == std::string_view::npos) {
+        const std::string spec(range.substr(6));
+        const size_t dash = spec.find('-');
+        if (dash != std::string::npos && dash > 0) {
+            first   = std::strtoll(spec.substr(0, dash).c_str(), nullptr, 10);
+            last    = dash + 1 < spec.size() ? std::strtoll(spec.c_str() + dash + 1, nullptr, 10) : -1;
+            partial = true;
+        }
+    }
+
+    // 配布中の内容と、要求された区間が受信済みかを調べる（送信中はロックを持たない）
+    std::string filePath;
+    int64_t     size      = 0;
+    bool        available = false;
+    {
+        std::lock_guard<std::mutex> lock(sharesMutex_);
+        const auto it = shares_.find(std::string(path));
+        if (it != shares_.end()) {
+            filePath = it->second.path;
+            size     = it->second.contentLength;
+            last     = partial && last >= 0 ? std::min(last, size - 1) : size - 1;
+            available = method == "HEAD" || covered(it->second.ranges, first, last);
+        }
+    }
+    if (filePath.empty()) {
+        return sendAll(socket, emptyResponse("404 Not Found", keepAlive)) && keepAlive;
+    }
+    if (partial && (first >= size || first > last)) {
+        const std::string header = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" +
+                                   std::to_string(size) + "\r\nContent-Length: 0\r\n\r\n";
+        return sendAll(socket, header) && keepAlive;
+    }
+    if (!available) {
+        // まだ受信していない区間。要求側は別の取得元から取る
+        return sendAll(socket, emptyResponse("404 Not Found", keepAlive)) && keepAlive;
+    }
+
+    std::string header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    header += "Content-Length: " + std::to_string(last - first + 1) + "\r\n";
+    if (partial) {
+        header += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                  "/" + std::to_string(size) + "\r\n";
+    }
+    header += "Accept-Ranges: bytes\r\n";
+    header += "Content-Type: application/octet-stream\r\n";
+    header += keepAlive ? "\r\n" : "Connection: close\r\n\r\n";
+    if (!sendAll(socket, header)) {
+        return false;
+    }
+    if (method == "HEAD" || size <= 0) {
+        return keepAlive;
+    }
+    return sendFile(socket, filePath, first, last) && keepAlive;
+}
+
+bool PeerServer::sendFile(Socket socket, const std::string& path, int64_t first, int64_t last) {
+    int64_t remaining = last - first + 1;
+#ifdef __linux__
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    off_t offset = static_cast<off_t>(first);
+    while (remaining > 0 && !stopping_.load(std::memory_order_acquire)) {
+        const auto sent = ::sendfile(native(socket), fd, &offset,
+                                     static_cast<size_t>(std::min<int64_t>(remaining, 1 << 30)));
+        if (sent <= 0) {
+            break;
+        }
+        remaining -= sent;
+        servedBytes_.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+    }
+    ::close(fd);
+#else
+    constexpr int64_t SEND_CHUNK = 256 * 1024; // 読み込んで送る単位
+    std::ifstream in(path, std::ios::binary);
+    if (!in.seekg(static_cast<std::streamoff>(first))) {
+        return false;
+    }
+    std::vector<char> buffer(static_cast<size_t>(std::min<int64_t>(remaining, SEND_CHUNK)));
+    while (remaining > 0 && !stopping_.load(std::memory_order_acquire)) {
+        const auto take = static_cast<std::streamsize>(std::min<int64_t>(remaining, SEND_CHUNK));
+        if (!in.read(buffer.data(), take) ||
+            !sendAll(socket, buffer.data(), static_cast<size_t>(take))) {
+            break;
+        }
+        remaining -= take;
+        servedBytes_.fetch_add(static_cast<uint64_t>(take), std::memory_order_relaxed);
+    }
+#endif
+    // 送りきれなかった場合は Content-Length と合わないため接続を閉じる
+    return remaining == 0;
+}
+
+} // namespace Downloader
@@ -0,0 +1,51 @@
+// =============================================================================
+// PeerTracker.cpp
+// プロセス内で保持する追跡サービスの実装
+// =============================================================================
+
+#include "PeerTracker.h"
+
+#include <algorithm>
+
+namespace Downloader {
+
+std::vector<std::string> PeerTracker::peersFor(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = swarms_.find(url);
+    if (it == swarms_.end() || it->second.peers.empty()) {
+        return {};
+    }
+
+    Swarm& swarm = it->second;
+    const size_t start = swarm.next % swarm.peers.size();
+    swarm.next = start + 1;
+
+    std::vector<std::string> result;
+    result.reserve(swarm.peers.size());
+    result.insert(result.end(), swarm.peers.begin() + static_cast<std::ptrdiff_t>(start), swarm.peers.end());
+    result.insert(result.end(), swarm.peers.begin(), swarm.peers.begin() + static_cast<std::ptrdiff_t>(start));
+    return result;
+}
+
+void PeerTracker::announce(const std::string& url, const std::string& peerUrl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& peers = swarms_[url].peers;
+    if (std::find(peers.begin(), peers.end(), peerUrl) == peers.end()) {
+        peers.push_back(peerUrl);
+    }
+}
+
+void PeerTracker::withdraw(const std::string& url, const std::string& peerUrl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = swarms_.find(url);
+    if (it == swarms_.end()) {
+        return;
+    }
+    auto& peers = it->second.peers;
+    peers.erase(std::remove(peers.begin(), peers.end(), peerUrl), peers.end());
+    if (peers.empty()) {
+        swarms_.erase(it);
+    }
+}
+
+} // namespace Downloader
@@ -0,0 +1,90 @@
+// =============================================================================
+// ProgressTable.cpp
+// 進捗の表（ブロック単位のスロット確保と、項目ごとの配列への読み書き）の実装
+// =============================================================================
+
+#include "ProgressTable.h"
+
+namespace Downloader {
+
+// 項目ごとの配列。頻繁に読む受信量・全体サイズ・状態はそれぞれキャッシュラインの
+// 境界から始め、書き込みが別の項目の読み出しを妨げないようにする
+struct ProgressTable::Block {
+    alignas(CACHE_LINE_SIZE) std::array<std::atomic<int64_t>, BLOCK_SIZE> downloadedBytes{};
+    alignas(CACHE_LINE_SIZE) std::array<std::atomic<int64_t>, BLOCK_SIZE> totalBytes{};
+    alignas(CACHE_LINE_SIZE) std::array<std::atomic<DownloadState>, BLOCK_SIZE> states{};
+    alignas(CACHE_LINE_SIZE) std::array<const void*, BLOCK_SIZE> owners{}; ///< nullptr: 空き（mutex_ で保護）
+};
+
+ProgressTable::ProgressTable()  = default;
+ProgressTable::~ProgressTable() = default;
+
+ProgressTable::Slot ProgressTable::acquire(const void* owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (freeSlots_.empty()) {
+        // 新しいブロックのスロットを末尾から積み、先頭から順に使う
+        blocks_.push_back(std::make_unique<Block>());
+        for (size_t i = BLOCK_SIZE; i > 0; --i) {
+            freeSlots_.push_back(Slot(blocks_.back().get(), i - 1));
+        }
+    }
+    Slot slot = freeSlots_.back();
+    freeSlots_.pop_back();
+
+    auto* block = static_cast<Block*>(slot.block_);
+    block->downloadedBytes[slot.offset_].store(0, std::memory_order_relaxed);
+    block->totalBytes[slot.offset_].store(0, std::memory_order_relaxed);
+    block->states[slot.offset_].store(DownloadState::IDLE, std::memory_order_relaxed);
+    block->owners[slot.offset_] = owner;
+    ++used_;
+    return slot;
+}
+
+void ProgressTable::release(Slot& slot) {
+    if (!slot) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    static_cast<Block*>(slot.block_)->owners[slot.offset_] = nullptr;
+    freeSlots_.push_back(slot);
+    --used_;
+    slot = Slot();
+}
+
+void ProgressTable::publish(const Slot& slot, DownloadState state,
+                            int64_t downloadedBytes, int64_t totalBytes) {
+    if (!slot) {
+        return;
+    }
+    auto* block = static_cast<Block*>(slot.block_);
+    block->downloadedBytes[slot.offset_].store(downloadedBytes, std::memory_order_relaxed);
+    block->totalBytes[slot.offset_].store(totalBytes, std::memory_order_relaxed);
+    block->states[slot.offset_].store(state, std::memory_order_relaxed);
+}
+
+size_t ProgressTable::collect(std::vector<Entry>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.reserve(used_);
+    for (const auto& block : blocks_) {
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            if (!block->owners[i]) {
+                continue;
+            }
+            Entry entry;
+            entry.owner           = block->owners[i];
+            entry.state           = block->states[i].load(std::memory_order_relaxed);
+            entry.downloadedBytes = block->downloadedBytes[i].load(std::memory_order_relaxed);
+            entry.totalBytes      = block->totalBytes[i].load(std::memory_order_relaxed);
+            out.push_back(entry);
+        }
+    }
+    return out.size();
+}
+
+size_t ProgressTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+}
+
+} // namespace Downloader
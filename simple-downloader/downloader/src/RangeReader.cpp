@@ -0,0 +1,206 @@
+// =============================================================================
+// RangeReader.cpp
+// 区間の読み出しの実装
+// =============================================================================
+
+#include "RangeReader.h"
+
+#include "IDownloadSink.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace Downloader {
+
+namespace {
+
+/// 受信データを書き込む 1 区間
+struct Target {
+    SegmentRange      range;
+    std::vector<char> buffer;      ///< range.size() バイト
+    size_t            request = 0; ///< キャッシュを使わない場合: 対応する要求の番号
+    int64_t           filled  = 0; ///< 書き込まれた最も後ろの位置 - range.first（ScatterSink の mutex で保護）
+};
+
+/// 受信データを、重なる区間のバッファへコピーするシンク
+/// 転送ごとのスレッドから重ならない位置へ同時に呼ばれる
+class ScatterSink final : public IDownloadSink {
+public:
+    /// @param targets first の順に並んだ区間（シンクより長く生存し、要素を増減しないこと）
+    explicit ScatterSink(std::vector<Target>& targets) : targets_(targets) {
+        // 区間は重なることがあるため、last の累積最大で書き込み位置にかかる最初の区間を探す
+        reach_.reserve(targets.size());
+        int64_t reach = -1;
+        for (const auto& target : targets) {
+            reach = std::max(reach, target.range.last);
+            reach_.push_back(reach);
+        }
+    }
+
+    bool open(int64_t) override { return true; }
+
+    bool write(int64_t offset, std::span<const char> data) override {
+        const int64_t end = offset + static_cast<int64_t>(data.size());
+        auto i = static_cast<size_t>(std::lower_bound(reach_.begin(), reach_.end(), offset) - reach_.begin());
+        for (; i < targets_.size() && targets_[i].range.first < end; ++i) {
+            Target&       target = targets_[i];
+            const int64_t from   = std::max(offset, target.range.first);
+            const int64_t to     = std::min(end, target.range.last + 1);
+            if (from >= to) {
+                continue;
+            }
+            std::memcpy(target.buffer.data() + (from - target.range.first), data.data() + (from - offset),
+                        static_cast<size_t>(to - from));
+            std::lock_guard<std::mutex> lock(mutex_);
+            target.filled = std::max(target.filled, to - target.range.first);
+        }
+        return true;
+    }
+
+    bool supportsRandomAccess() const override { return true; }
+
+private:
+    std::vector<Target>& targets_;
+    std::vector<int64_t> reach_; ///< reach_[i]: targets_[0..i] の last の最大
+    std::mutex           mutex_;
+};
+
+} // namespace
+
+/// 1 回の読み出しの状態（ダウンロードの終了まで onDone が所有する）
+struct RangeReader::ReadState {
+    std::string                          url;
+    std::vector<SegmentRange>            ranges;  ///< 要求された区間（要求の順）
+    BlockCache*                          cache = nullptr;
+    std::map<int64_t, BlockCache::Block> blocks;  ///< キャッシュを使う場合: 区間にかかるブロック
+    std::vector<Target>                  targets; ///< 取得する区間（first の順）
+    std::unique_ptr<ScatterSink>         sink;
+    std::promise<RangeReadResult>        promise;
+    RangeReadResult                      result;
+};
+
+RangeReader::RangeReader(Downloader& downloader, BlockCache* cache)
+    : downloader_(downloader), cache_(cache) {}
+
+RangeReadResult RangeReader::read(const std::string& url, const std::vector<SegmentRange>& ranges) {
+    return readAsync(url, ranges).get();
+}
+
+std::future<RangeReadResult> RangeReader::readAsync(const std::string& url,
+                                                    const std::vector<SegmentRange>& ranges) {
+    auto state    = std::make_shared<ReadState>();
+    state->url    = url;
+    state->ranges = ranges;
+    state->cache  = cache_;
+    auto future   = state->promise.get_future();
+
+    for (const auto& range : ranges) {
+        if (range.first < 0 || range.last < range.first) {
+            DownloadResult invalid;
+            invalid.state = DownloadState::ERROR;
+            invalid.error = "Invalid range: " + std::to_string(range.first) + "-" + std::to_string(range.last);
+            finish(*state, std::move(invalid));
+            return future;
+        }
+    }
+
+    if (cache_) {
+        // 区間をブロック単位に広げ、キャッシュにないブロックだけを取得する
+        const int64_t     blockSize = cache_->blockSize();
+        std::set<int64_t> needed;
+        for (const auto& range : ranges) {
+            for (int64_t index = range.first / blockSize; index <= range.last / blockSize; ++index) {
+                needed.insert(index);
+            }
+        }
+        for (const int64_t index : needed) {
+            if (auto block = cache_->get(url, index)) {
+                state->blocks[index] = std::move(block);
+                ++state->result.cachedBlocks;
+            } else {
+                const int64_t first = index * blockSize;
+                state->targets.push_back({{first, first + blockSize - 1},
+                                          std::vector<char>(static_cast<size_t>(blockSize))});
+            }
+        }
+    } else {
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            state->targets.push_back({ranges[i], std::vector<char>(static_cast<size_t>(ranges[i].size())), i});
+        }
+        std::sort(state->targets.begin(), state->targets.end(),
+                  [](const Target& a, const Target& b) { return a.range.first < b.range.first; });
+    }
+
+    if (state->targets.empty()) {
+        DownloadResult cached;
+        cached.state = DownloadState::COMPLETED;
+        finish(*state, std::move(cached));
+        return future;
+    }
+
+    std::vector<SegmentRange> fetch;
+    fetch.reserve(state->targets.size());
+    for (const auto& target : state->targets) {
+        fetch.push_back(target.range);
+    }
+    state->sink = std::make_unique<ScatterSink>(state->targets);
+    const bool started = downloader_.startRangeDownload(
+        url, fetch, *state->sink,
+        [state](DownloadResult result) { finish(*state, std::move(result)); });
+    if (!started) {
+        finish(*state, DownloadResult::rejected());
+    }
+    return future;
+}
+
+void RangeReader::finish(ReadState& state, DownloadResult download) {
+    RangeReadResult& result = state.result;
+    result.download = std::move(download);
+    if (!result.ok()) {
+        state.promise.set_value(std::move(result));
+        return;
+    }
+
+    if (!state.cache) {
+        result.data.resize(state.ranges.size());
+        for (auto& target : state.targets) {
+            target.buffer.resize(static_cast<size_t>(target.filled));
+            result.data[target.request] = std::move(target.buffer);
+        }
+        state.promise.set_value(std::move(result));
+        return;
+    }
+
+    // 取得したブロックを記録してから、要求された区間をブロックから切り出す
+    // （末尾のブロックは短く、それより後ろのブロックは空になる）
+    const int64_t blockSize = state.cache->blockSize();
+    for (auto& target : state.targets) {
+        const int64_t index = target.range.first / blockSize;
+        target.buffer.resize(static_cast<size_t>(target.filled));
+        state.blocks[index] = state.cache->put(state.url, index, std::move(target.buffer));
+    }
+    result.data.reserve(state.ranges.size());
+    for (const auto& range : state.ranges) {
+        std::vector<char> out;
+        out.reserve(static_cast<size_t>(range.size()));
+        for (int64_t index = range.first / blockSize; index <= range.last / blockSize; ++index) {
+            const std::vector<char>& block = *state.blocks.at(index);
+            const int64_t blockFirst = index * blockSize;
+            const int64_t from = std::max(range.first, blockFirst) - blockFirst;
+            const int64_t to   = std::min(range.last - blockFirst + 1, static_cast<int64_t>(block.size()));
+            if (from < to) {
+                out.insert(out.end(), block.begin() + from, block.begin() + to);
+            }
+            if (static_cast<int64_t>(block.size()) < blockSize) {
+                break;
+            }
+        }
+        result.data.push_back(std::move(out));
+    }
+    state.promise.set_value(std::move(result));
+}
+
+} // namespace Downloader
@@ -0,0 +1,80 @@
+// =============================================================================
+// ReceiveTuner.cpp
+// 帯域遅延積に基づく受信バッファの推奨値の実装
+// =============================================================================
+
+#include "ReceiveTuner.h"
+
+#include <algorithm>
+
+namespace Downloader {
+
+namespace {
+
+/// value 以上の最小の 2 のべき乗
+int64_t roundUpPow2(int64_t value) {
+    int64_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+ReceiveTuner::ReceiveTuner(Limits limits)
+    : limits_(limits)
+    , bufferSize_(limits.minBufferSize) {
+}
+
+bool ReceiveTuner::due(Clock::time_point now) const {
+    return !started_ || now - lastSample_ >= limits_.interval;
+}
+
+bool ReceiveTuner::sample(int64_t totalBytes, Clock::time_point now, int64_t rttUs) {
+    if (!started_) {
+        started_    = true;
+        lastBytes_  = totalBytes;
+        lastSample_ = now;
+        return false;
+    }
+
+    const auto elapsedUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - lastSample_).count();
+    if (totalBytes < lastBytes_) {
+        // 接続を張り直した（累計が 0 から数え直しになった）
+        lastBytes_  = totalBytes;
+        lastSample_ = now;
+        return false;
+    }
+    if (elapsedUs <= 0) {
+        return false;
+    }
+    const int64_t rate = (totalBytes - lastBytes_) * 1000000 / elapsedUs;
+    lastBytes_  = totalBytes;
+    lastSample_ = now;
+    throughput_ = std::max(throughput_, rate);
+    if (rttUs <= 0) {
+        return false;
+    }
+    bdp_ = throughput_ * rttUs / 1000000;
+
+    bool grown = false;
+    // curl のバッファは 1 回の recv で受け取る量。BDP の 1/4 あれば RTT あたり数回で読み切れる
+    const auto buffer = static_cast<size_t>(std::clamp<int64_t>(
+        roundUpPow2(bdp_ / 4), static_cast<int64_t>(limits_.minBufferSize),
+        static_cast<int64_t>(limits_.maxBufferSize)));
+    if (buffer > bufferSize_) {
+        bufferSize_ = buffer;
+        grown       = true;
+    }
+    const auto receive = static_cast<int>(
+        std::min<int64_t>(roundUpPow2(bdp_ * 2), limits_.maxReceiveBuffer));
+    if (receive >= limits_.minReceiveBuffer && receive > receiveBuffer_) {
+        receiveBuffer_ = receive;
+        grown          = true;
+    }
+    return grown;
+}
+
+} // namespace Downloader
@@ -0,0 +1,230 @@
+// =============================================================================
+// ResumeJournal.cpp
+// 再開用ジャーナルの実装
+//
+// ファイル形式（1 行 1 項目のテキスト。値に改行は含まない）:
+//   downloader-journal 1
+//   length <バイト数>
+//   etag <ETag>                    （ある場合）
+//   last-modified <Last-Modified>  （ある場合）
+//   range <先頭> <末尾> <CRC-32 (16 進)>   ← 以降は追記
+// =============================================================================
+
+#include "ResumeJournal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+
+namespace Downloader {
+
+namespace {
+
+constexpr std::string_view MAGIC = "downloader-journal 1";
+
+std::string formatRange(const JournalRange& range) {
+    char crc[9];
+    std::snprintf(crc, sizeof(crc), "%08x", range.crc);
+    return "range " + std::to_string(range.first) + " " + std::to_string(range.last) +
+           " " + crc + "\n";
+}
+
+/// "range <first> <last> <crc>" を解析する
+bool parseRange(const std::string& value, JournalRange& range) {
+    std::istringstream in(value);
+    int64_t     first = -1;
+    int64_t     last  = -1;
+    std::string crc;
+    if (!(in >> first >> last >> crc) || first < 0 || last < first || crc.size() != 8) {
+        return false;
+    }
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(crc.c_str(), &end, 16);
+    if (*end != '\0') {
+        return false;
+    }
+    range = {first, last, static_cast<uint32_t>(parsed)};
+    return true;
+}
+
+} // namespace
+
+// =============================================================================
+// 読み込み・作成
+// =============================================================================
+
+bool ResumeJournal::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    const std::string text{std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>()};
+
+    Header                    header;
+    std::vector<JournalRange> ranges;
+    size_t begin = 0;
+    bool   first = true;
+    // 改行で終わらない末尾の行は書き込み途中なので読まない
+    for (size_t end = text.find('\n'); end != std::string::npos;
+         begin = end + 1, end = text.find('\n', begin)) {
+        const std::string line = text.substr(begin, end - begin);
+        if (first) {
+            if (line != MAGIC) {
+                return false;
+            }
+            first = false;
+            continue;
+        }
+        const size_t      space = line.find(' ');
+        const std::string key   = line.substr(0, space);
+        const std::string value = space == std::string::npos ? "" : line.substr(space + 1);
+        if (key == "length") {
+            header.contentLength = std::strtoll(value.c_str(), nullptr, 10);
+        } else if (key == "etag") {
+            header.etag = value;
+        } else if (key == "last-modified") {
+            header.lastModified = value;
+        } else if (key == "range") {
+            JournalRange range;
+            if (!parseRange(value, range)) {
+                break; // 壊れた行以降は信用しない
+            }
+            ranges.push_back(range);
+        }
+    }
+    if (first || header.contentLength <= 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.close();
+    path_   = path;
+    header_ = std::move(header);
+    ranges_ = std::move(ranges);
+    return true;
+}
+
+bool ResumeJournal::create(const std::string& path, Header header,
+                           const std::vector<JournalRange>& ranges) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.close();
+    path_   = path;
+    header_ = std::move(header);
+    ranges_ = ranges;
+
+    // ヘッダーと引き継ぐ区間を一時ファイルに書いてから置き換える
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out << MAGIC << "\n" << "length " << header_.contentLength << "\n";
+        if (!header_.etag.empty())         out << "etag " << header_.etag << "\n";
+        if (!header_.lastModified.empty()) out << "last-modified " << header_.lastModified << "\n";
+        for (const auto& range : ranges_) {
+            out << formatRange(range);
+        }
+        out.close();
+        if (out.fail()) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        return false;
+    }
+
+    out_.open(path, std::ios::binary | std::ios::app);
+    return out_.is_open();
+}
+
+bool ResumeJournal::append(const JournalRange& range) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) {
+        return false;
+    }
+    ranges_.push_back(range);
+    // 1 行ずつ書き出し、落ちても直前の行までは残るようにする
+    out_ << formatRange(range);
+    out_.flush();
+    return !out_.fail();
+}
+
+void ResumeJournal::remove() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.close();
+    if (!path_.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+    ranges_.clear();
+}
+
+std::vector<JournalRange> ResumeJournal::ranges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ranges_;
+}
+
+// =============================================================================
+// 検証
+// =============================================================================
+
+std::vector<JournalRange> ResumeJournal::verify(const std::string& dataPath,
+                                                const std::vector<JournalRange>& ranges) {
+    std::vector<JournalRange> valid;
+    std::ifstream in(dataPath, std::ios::binary);
+    if (!in.is_open()) {
+        return valid;
+    }
+
+    std::vector<char> buffer(256 * 1024);
+    for (const auto& range : ranges) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(range.first));
+        uint32_t crc       = 0;
+        int64_t  remaining = range.size();
+        while (remaining > 0 && in) {
+            const auto chunk = static_cast<std::streamsize>(
+                std::min<int64_t>(remaining, static_cast<int64_t>(buffer.size())));
+            in.read(buffer.data(), chunk);
+            crc = crc32Update(crc, buffer.data(), static_cast<size_t>(in.gcount()));
+            remaining -= in.gcount();
+        }
+        if (remaining == 0 && crc == range.crc) {
+            valid.push_back(range);
+        }
+    }
+    return valid;
+}
+
+std::vector<SegmentRange> ResumeJournal::missingRanges(int64_t contentLength,
+                                                       std::vector<JournalRange> ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const JournalRange& a, const JournalRange& b) { return a.first < b.first; });
+
+    std::vector<SegmentRange> missing;
+    int64_t next = 0; // まだ埋まっていない最初の位置
+    for (const auto& range : ranges) {
+        if (range.first > next) {
+            missing.push_back({next, std::min(range.first, contentLength) - 1});
+        }
+        next = std::max(next, range.last + 1);
+        if (next >= contentLength) {
+            break;
+        }
+    }
+    if (next < contentLength) {
+        missing.push_back({next, contentLength - 1});
+    }
+    // ファイルサイズを超える区間（壊れた記録）から生じた空区間を除く
+    missing.erase(std::remove_if(missing.begin(), missing.end(),
+                                 [](const SegmentRange& r) { return r.size() <= 0; }),
+                  missing.end());
+    return missing;
+}
+
+} // namespace Downloader
@@ -10,14 +10,15 @@
 //   2. 2 秒後に一時停止
 //   3. 2 秒後に再開
 //   4. 大きなファイルの場合は 5 秒後にキャンセル（小さいファイルは完了まで待機）
+//   終了はポーリングせず、fetchAsync() の std::future で待つ
 // =============================================================================
 
 #include "Downloader.h"
 #include "IDownloaderObserver.h"
 
-#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -103,7 +104,6 @@ public:
     void onCompleted() override {
         std::cout << "\n"; // 進捗バーの行を改行
         LOG(name_, ">>> COMPLETED <<<");
-        completed_.store(true, std::memory_order_release);
     }
 
     // -------------------------------------------------------------------------
@@ -112,7 +112,6 @@ public:
     void onError(const std::string& errorMessage) override {
         std::cout << "\n";
         LOG(name_, ">>> ERROR: " + errorMessage + " <<<");
-        error_.store(true, std::memory_order_release);
     }
 
     // -------------------------------------------------------------------------
@@ -136,42 +135,18 @@ public:
     void onCancelled() override {
         std::cout << "\n";
         LOG(name_, ">>> CANCELLED <<<");
-        cancelled_.store(true, std::memory_order_release);
     }
 
-    // -------------------------------------------------------------------------
-    // 終了検出用ヘルパー
-    // -------------------------------------------------------------------------
-    bool isFinished() const {
-        return completed_.load(std::memory_order_acquire) ||
-               error_.load(std::memory_order_acquire)     ||
-               cancelled_.load(std::memory_order_acquire);
-    }
-
-    bool isCompleted()  const { return completed_.load(std::memory_order_acquire); }
-    bool isError()      const { return error_.load(std::memory_order_acquire); }
-    bool isCancelled()  const { return cancelled_.load(std::memory_order_acquire); }
-
 private:
-    std::string         name_;
-    std::atomic<bool>   completed_{false};
-    std::atomic<bool>   error_{false};
-    std::atomic<bool>   cancelled_{false};
+    std::string name_;
 };
 
 // =============================================================================
-// ヘルパー: 最大タイムアウト付きで終了を待機する
+// ヘルパー: 最大タイムアウト付きで終了を待機する（スリープでのポーリングはしない）
 // =============================================================================
-bool waitForFinish(const ConsoleObserver& observer,
+bool waitForFinish(const std::future<DownloadResult>& finished,
                    std::chrono::milliseconds timeout) {
-    const auto deadline = std::chrono::steady_clock::now() + timeout;
-    while (!observer.isFinished()) {
-        if (std::chrono::steady_clock::now() >= deadline) {
-            return false; // タイムアウト
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    return true;
+    return finished.wait_for(timeout) == std::future_status::ready;
 }
 
 // =============================================================================
@@ -183,9 +158,12 @@ void demoDownloadWithControls(const std::string& url,
     LOG("Demo", "URL: " + url);
     LOG("Demo", "Output: " + outputPath);
 
-    // Downloader 生成（デフォルト設定 + チャンクサイズ 1024 バイト明示）
+    // Downloader 生成（デフォルト設定 + 受信バッファを回線に合わせて広げる）
     DownloaderConfig config;
-    config.chunkSize = 1024; // 1 KB チャンク
+    config.adaptiveReceiveBuffer = true;
+    // プログレスバーの描画は 100ms ごとにまとめ、転送スレッドでは行わない
+    config.progressIntervalMs    = 100;
+    config.asyncObserverDispatch = true;
 
     // 名前空間と同名のため完全修飾名を使用
     Downloader::Downloader downloader(config);
@@ -198,15 +176,10 @@ void demoDownloadWithControls(const std::string& url,
     // (1) ダウンロード開始
     // --------------------------------------------------------
     LOG("Demo", "Starting download...");
-    if (!downloader.startDownload(url, outputPath)) {
-        LOG("Demo", "Failed to start download (already running?)");
-        return;
-    }
+    std::future<DownloadResult> finished = downloader.fetchAsync(url, outputPath);
 
-    // 2 秒後に一時停止
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-
-    if (!observer.isFinished()) {
+    // 2 秒後に一時停止（その前に終われば何もしない）
+    if (!waitForFinish(finished, std::chrono::seconds(2))) {
         // --------------------------------------------------------
         // (2) 一時停止
         // --------------------------------------------------------
@@ -214,15 +187,13 @@ void demoDownloadWithControls(const std::string& url,
         downloader.pause();
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
-        // ダウンロードが一時停止されたことを確認
-        auto stats = downloader.getStats();
+        // ダウンロードが一時停止されたことを確認（数値だけならロックを取らない getProgress で足りる）
+        const auto progress = downloader.getProgress();
         LOG("Demo", "State after pause: " +
-            std::to_string(static_cast<int>(stats.state)));
+            std::to_string(static_cast<int>(progress.state)));
 
         // 2 秒停止
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
-        if (!observer.isFinished()) {
+        if (!waitForFinish(finished, std::chrono::seconds(2))) {
             // --------------------------------------------------------
             // (3) 再開
             // --------------------------------------------------------
@@ -230,9 +201,7 @@ void demoDownloadWithControls(const std::string& url,
             downloader.resume();
 
             // 5 秒待ってまだ終わっていなければキャンセル
-            bool finished = waitForFinish(observer, std::chrono::seconds(5));
-
-            if (!finished && !observer.isFinished()) {
+            if (!waitForFinish(finished, std::chrono::seconds(5))) {
                 // --------------------------------------------------------
                 // (4) キャンセル
                 // --------------------------------------------------------
@@ -243,16 +212,19 @@ void demoDownloadWithControls(const std::string& url,
     }
 
     // 完了・キャンセル・エラーのいずれかを待機（最大 10 秒）
-    waitForFinish(observer, std::chrono::seconds(10));
+    if (!waitForFinish(finished, std::chrono::seconds(10))) {
+        LOG("Demo", "Download did not finish in time");
+        return;
+    }
 
     // 最終統計を表示
-    auto stats = downloader.getStats();
+    const DownloadResult result = finished.get();
     LOG("Demo", "Final stats:");
-    LOG("Demo", "  Downloaded: " + std::to_string(stats.downloadedBytes) + " bytes");
-    LOG("Demo", "  Total:      " + std::to_string(stats.totalBytes) + " bytes");
-    LOG("Demo", "  Completed:  " + std::string(observer.isCompleted() ? "YES" : "NO"));
-    LOG("Demo", "  Cancelled:  " + std::string(observer.isCancelled() ? "YES" : "NO"));
-    LOG("Demo", "  Error:      " + std::string(observer.isError() ? "YES" : "NO"));
+    LOG("Demo", "  Downloaded: " + std::to_string(result.stats.downloadedBytes) + " bytes");
+    LOG("Demo", "  Total:      " + std::to_string(result.stats.totalBytes) + " bytes");
+    LOG("Demo", "  Completed:  " + std::string(result.ok() ? "YES" : "NO"));
+    LOG("Demo", "  Cancelled:  " + std::string(result.state == DownloadState::CANCELLED ? "YES" : "NO"));
+    LOG("Demo", "  Error:      " + std::string(result.error.empty() ? "NO" : result.error));
     LOG("Demo", "=== Downloader Demo End ===");
 }
 
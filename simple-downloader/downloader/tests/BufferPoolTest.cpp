@@ -0,0 +1,152 @@
+// =============================================================================
+// BufferPoolTest.cpp
+// BufferPool（スラブの再利用・確保の上限・空きの通知）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 小さなスラブで上限に達する状況を作り、借りる・返すの順序で検証する
+//  - 別スレッドから返す場合は、待機側が戻ることを期限付きで確認する
+// =============================================================================
+
+#include "BufferPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+
+// =============================================================================
+// 貸し出しテスト
+// =============================================================================
+
+/// 返したスラブが次の貸し出しで再利用され、新しく確保されないこと
+TEST(BufferPoolTest, ReleasedSlab_IsReused) {
+    BufferPool pool({.slabSize = 4096});
+
+    char* first = nullptr;
+    {
+        BufferPool::Buffer buffer = pool.tryAcquire();
+        ASSERT_TRUE(buffer);
+        EXPECT_EQ(buffer.capacity(), 4096u);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % 4096, 0u);
+        EXPECT_EQ(pool.inUseBytes(), 4096u);
+        first = buffer.data();
+    }
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+    EXPECT_EQ(pool.allocatedBytes(), 4096u);
+
+    BufferPool::Buffer again = pool.tryAcquire();
+    EXPECT_EQ(again.data(), first);
+    EXPECT_EQ(pool.allocatedBytes(), 4096u);
+}
+
+/// 上限に達すると借りられず、返されると再び借りられること
+TEST(BufferPoolTest, Ceiling_RejectsUntilReleased) {
+    BufferPool pool({.slabSize = 1024, .maxBytes = 2048});
+
+    BufferPool::Buffer a = pool.tryAcquire();
+    BufferPool::Buffer b = pool.tryAcquire();
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(b);
+    EXPECT_FALSE(pool.available());
+    EXPECT_FALSE(pool.tryAcquire());
+    EXPECT_EQ(pool.allocatedBytes(), 2048u);
+
+    a.reset();
+    EXPECT_TRUE(pool.available());
+    EXPECT_TRUE(pool.tryAcquire());
+}
+
+/// スラブの確保が例外で失敗したとき、予約した分が確保済みに残らないこと
+TEST(BufferPoolTest, FailedAllocation_RollsBackReservation) {
+    BufferPool pool({.slabSize = std::numeric_limits<size_t>::max() / 2});
+
+    EXPECT_THROW(pool.tryAcquire(), std::bad_alloc);
+    EXPECT_EQ(pool.allocatedBytes(), 0u);
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+}
+
+/// ほかのスレッドが返したスラブも、新しく確保せずに借りられること
+TEST(BufferPoolTest, SlabReleasedOnOtherThread_IsBorrowed) {
+    BufferPool pool({.slabSize = 1024, .maxBytes = 1024});
+
+    std::thread([&pool]() {
+        BufferPool::Buffer buffer = pool.tryAcquire();
+        ASSERT_TRUE(buffer);
+    }).join();
+
+    EXPECT_TRUE(pool.tryAcquire());
+    EXPECT_EQ(pool.allocatedBytes(), 1024u);
+}
+
+/// 上限を下げると、超えている分は返されたときに解放されること
+TEST(BufferPoolTest, LoweredCeiling_FreesOnRelease) {
+    BufferPool pool({.slabSize = 1024});
+    std::vector<BufferPool::Buffer> buffers;
+    for (int i = 0; i < 4; ++i) {
+        buffers.push_back(pool.tryAcquire());
+    }
+    pool.setMaxBytes(2048);
+    buffers.clear();
+    EXPECT_EQ(pool.allocatedBytes(), 2048u);
+
+    pool.trim();
+    EXPECT_EQ(pool.allocatedBytes(), 0u);
+}
+
+// =============================================================================
+// 空きの通知テスト
+// =============================================================================
+
+/// notifyWhenAvailable() は空きがあればその場で、なければ返されたときに呼ばれること
+TEST(BufferPoolTest, NotifyWhenAvailable_RunsOnRelease) {
+    BufferPool pool({.slabSize = 1024, .maxBytes = 1024});
+
+    bool immediate = false;
+    pool.notifyWhenAvailable([&immediate]() { immediate = true; });
+    EXPECT_TRUE(immediate);
+
+    BufferPool::Buffer buffer = pool.tryAcquire();
+    ASSERT_TRUE(buffer);
+    std::atomic<int> notified{0};
+    pool.notifyWhenAvailable([&notified]() { ++notified; });
+    EXPECT_EQ(notified.load(), 0);
+
+    buffer.reset();
+    EXPECT_EQ(notified.load(), 1);
+
+    // 通知は一度だけ
+    pool.tryAcquire().reset();
+    EXPECT_EQ(notified.load(), 1);
+}
+
+/// acquire() はほかのスレッドが返すまで待機すること
+TEST(BufferPoolTest, Acquire_BlocksUntilReleased) {
+    BufferPool pool({.slabSize = 1024, .maxBytes = 1024});
+    BufferPool::Buffer held = pool.tryAcquire();
+    ASSERT_TRUE(held);
+
+    auto waiter = std::async(std::launch::async, [&pool]() {
+        return static_cast<bool>(pool.acquire());
+    });
+    EXPECT_EQ(waiter.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+
+    held.reset();
+    ASSERT_EQ(waiter.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_TRUE(waiter.get());
+}
+
+/// allocate() で確保したバッファはプールに数えられないこと
+TEST(BufferPoolTest, Allocate_IsNotPooled) {
+    BufferPool::Buffer buffer = BufferPool::Buffer::allocate(100);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(buffer.capacity(), 100u);
+    EXPECT_FALSE(BufferPool::Buffer::allocate(0));
+}
@@ -0,0 +1,200 @@
+// =============================================================================
+// BufferedWriterTest.cpp
+// BufferedWriter（書き込みのまとめ・2 面バッファ）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - Sink の呼び出し回数とサイズを記録して、まとめ書きの単位を検証する
+//  - 書き出された内容は常に書き込み順どおりであることを確認する
+// =============================================================================
+
+#include "BufferedWriter.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class BufferedWriterTest : public ::testing::Test {
+protected:
+    /// @brief 書き出しを記録する Sink を生成する
+    BufferedWriter::Sink recordingSink(std::chrono::milliseconds delay = {}) {
+        return [this, delay](const char* data, size_t size) {
+            if (delay.count() > 0) {
+                std::this_thread::sleep_for(delay);
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            output_.append(data, size);
+            flushSizes_.push_back(size);
+            return true;
+        };
+    }
+
+    /// @brief 連番のテストデータを生成する
+    static std::string makeData(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>('a' + i % 26);
+        }
+        return data;
+    }
+
+    std::mutex          mutex_;
+    std::string         output_;
+    std::vector<size_t> flushSizes_;
+};
+
+// =============================================================================
+// まとめ書きテスト
+// =============================================================================
+
+/// 小さな書き込みはバッファが満杯になるまでまとめられること
+TEST_F(BufferedWriterTest, SmallWrites_AreCoalesced) {
+    BufferedWriter writer(4096, recordingSink());
+    const std::string data = makeData(10 * 1024);
+
+    for (size_t offset = 0; offset < data.size(); offset += 512) {
+        ASSERT_TRUE(writer.write(data.data() + offset, 512));
+    }
+    ASSERT_TRUE(writer.flush());
+
+    EXPECT_EQ(output_, data);
+    ASSERT_EQ(flushSizes_.size(), 3u); // 4096 + 4096 + 残り 2048
+    EXPECT_EQ(flushSizes_[0], 4096u);
+    EXPECT_EQ(flushSizes_[2], 2048u);
+    EXPECT_EQ(writer.getBufferedBytes(), 0u);
+}
+
+/// バッファより大きな書き込みはバッファを経由せずに書き出されること
+TEST_F(BufferedWriterTest, LargeWrite_BypassesBuffer_AndKeepsOrder) {
+    BufferedWriter writer(1024, recordingSink());
+    const std::string data = makeData(5000);
+
+    ASSERT_TRUE(writer.write(data.data(), 100));
+    ASSERT_TRUE(writer.write(data.data() + 100, 4900));
+    ASSERT_TRUE(writer.flush());
+
+    EXPECT_EQ(output_, data);
+    ASSERT_EQ(flushSizes_.size(), 2u);
+    EXPECT_EQ(flushSizes_[0], 100u);
+    EXPECT_EQ(flushSizes_[1], 4900u);
+}
+
+/// 容量 0 ではバッファせずにそのまま書き出されること
+TEST_F(BufferedWriterTest, ZeroCapacity_WritesThrough) {
+    BufferedWriter writer(0, recordingSink());
+    ASSERT_TRUE(writer.write("abc", 3));
+    EXPECT_EQ(output_, "abc");
+    EXPECT_EQ(flushSizes_.size(), 1u);
+}
+
+/// 書き出しに失敗すると以降の書き込みも失敗すること
+TEST_F(BufferedWriterTest, SinkFailure_IsSticky) {
+    BufferedWriter writer(16, [](const char*, size_t) { return false; });
+    EXPECT_TRUE(writer.write("0123456789", 10)); // まだバッファ内
+    EXPECT_FALSE(writer.write("0123456789", 10)); // 書き出しで失敗
+    EXPECT_TRUE(writer.hasFailed());
+    EXPECT_FALSE(writer.flush());
+}
+
+/// デストラクタで残りのデータが書き出されること
+TEST_F(BufferedWriterTest, Destructor_FlushesRemainingData) {
+    {
+        BufferedWriter writer(1024, recordingSink());
+        writer.write("tail", 4);
+    }
+    EXPECT_EQ(output_, "tail");
+}
+
+// =============================================================================
+// 2 面バッファテスト
+// =============================================================================
+
+/// 2 面バッファでも書き込み順どおりに書き出されること
+TEST_F(BufferedWriterTest, DoubleBuffer_PreservesOrder) {
+    BufferedWriter writer(2048, recordingSink(std::chrono::milliseconds(1)), true);
+    const std::string data = makeData(64 * 1024 + 123);
+
+    size_t offset = 0;
+    size_t step   = 1;
+    while (offset < data.size()) {
+        // 大小さまざまな書き込みを混ぜる（直接書き出しの経路も通す）
+        const size_t size = std::min(data.size() - offset, (step * 797) % 3000 + 1);
+        ASSERT_TRUE(writer.write(data.data() + offset, size));
+        offset += size;
+        ++step;
+    }
+    ASSERT_TRUE(writer.flush());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(output_, data);
+}
+
+/// 2 面バッファでは書き出し中も次の面へ書き込めること
+TEST_F(BufferedWriterTest, DoubleBuffer_WritesWhileFlushing) {
+    BufferedWriter writer(1024, recordingSink(std::chrono::milliseconds(50)), true);
+    const std::string data = makeData(1024);
+
+    ASSERT_TRUE(writer.write(data.data(), 1000));
+    // 1 面目を書き出しスレッドに渡す（50ms かかる）
+    ASSERT_TRUE(writer.write(data.data(), 1000));
+
+    // 書き出し完了を待たずに 2 面目へ書き込める
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(writer.write(data.data(), 10));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(40));
+
+    ASSERT_TRUE(writer.flush());
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(output_.size(), 2010u);
+}
+
+// =============================================================================
+// プールのテスト
+// =============================================================================
+
+/// プールを使うとスラブの大きさでまとめ、flush() でスラブを返すこと
+TEST_F(BufferedWriterTest, Pool_CoalescesIntoSlabs_AndReturnsOnFlush) {
+    BufferPool pool({.slabSize = 1024});
+    BufferedWriter writer(4096, recordingSink(), true, &pool);
+    const std::string data = makeData(3000);
+
+    for (size_t offset = 0; offset < data.size(); offset += 100) {
+        ASSERT_TRUE(writer.write(data.data() + offset, 100));
+    }
+    EXPECT_GT(pool.inUseBytes(), 0u);
+    ASSERT_TRUE(writer.flush());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(output_, data);
+    EXPECT_EQ(flushSizes_.front(), 1000u); // 1024 に入る 100 bytes × 10
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+}
+
+/// プールが上限に達していればバッファせずに書き出し、メモリを増やさないこと
+TEST_F(BufferedWriterTest, PoolExhausted_WritesThrough) {
+    BufferPool pool({.slabSize = 1024, .maxBytes = 1024});
+    BufferPool::Buffer held = pool.tryAcquire();
+    ASSERT_TRUE(held);
+
+    BufferedWriter writer(1024, recordingSink(), false, &pool);
+    ASSERT_TRUE(writer.write("abc", 3));
+    EXPECT_EQ(writer.getBufferedBytes(), 0u);
+    EXPECT_EQ(output_, "abc");
+
+    // 返されれば再びまとめる
+    held.reset();
+    ASSERT_TRUE(writer.write("def", 3));
+    EXPECT_EQ(writer.getBufferedBytes(), 3u);
+    ASSERT_TRUE(writer.flush());
+    EXPECT_EQ(output_, "abcdef");
+}
@@ -0,0 +1,160 @@
+// =============================================================================
+// ChecksumTest.cpp
+// CRC-32 / CRC-32C / SHA-256 の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 公開されている検査値（RFC 3720・FIPS 180-2 の例）と一致することを確かめる
+//  - 実行環境で使われる高速版は、命令セット拡張を使わない実装と突き合わせる
+//  - データの分割位置によって結果が変わらないことを確かめる
+// =============================================================================
+
+#include "Checksum.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+
+namespace {
+
+std::string sha256Hex(const std::string& data) {
+    StreamingChecksum checksum(ChecksumAlgorithm::SHA256);
+    checksum.update(data.data(), data.size());
+    return checksum.hexDigest();
+}
+
+/// 長さ・アライメントの異なる試験データ
+std::string sampleData(size_t size) {
+    std::string data(size, '\0');
+    uint32_t x = 12345;
+    for (auto& c : data) {
+        x = x * 1103515245u + 12345u;
+        c = static_cast<char>(x >> 16);
+    }
+    return data;
+}
+
+} // namespace
+
+// =============================================================================
+// CRC
+// =============================================================================
+
+/// CRC-32 が標準の検査値と一致し、分割して計算しても同じになること
+TEST(ChecksumTest, Crc32_MatchesReferenceValue) {
+    const std::string text = "123456789";
+    EXPECT_EQ(crc32Update(0, text.data(), text.size()), 0xCBF43926u);
+    const uint32_t head = crc32Update(0, text.data(), 4);
+    EXPECT_EQ(crc32Update(head, text.data() + 4, text.size() - 4), 0xCBF43926u);
+}
+
+/// CRC-32C が RFC 3720 の検査値と一致すること
+TEST(ChecksumTest, Crc32c_MatchesReferenceValues) {
+    const std::string text = "123456789";
+    EXPECT_EQ(crc32cUpdate(0, text.data(), text.size()), 0xE3069283u);
+
+    std::string zeros(32, '\0');
+    std::string ones(32, '\xff');
+    std::string ascending(32, '\0');
+    for (size_t i = 0; i < ascending.size(); ++i) {
+        ascending[i] = static_cast<char>(i);
+    }
+    EXPECT_EQ(crc32cUpdate(0, zeros.data(), zeros.size()), 0x8A9136AAu);
+    EXPECT_EQ(crc32cUpdate(0, ones.data(), ones.size()), 0x62A8AB43u);
+    EXPECT_EQ(crc32cUpdate(0, ascending.data(), ascending.size()), 0x46DD794Eu);
+    EXPECT_EQ(crc32cHex(0xE3069283u), "e3069283");
+}
+
+/// 高速版が表引きの実装と一致すること（長さ・先頭のアライメントを変える）
+TEST(ChecksumTest, Crc32c_MatchesPortableImplementation) {
+    const std::string data = sampleData(4096 + 17);
+    for (size_t offset = 0; offset < 9; ++offset) {
+        for (const size_t size : {size_t{0}, size_t{1}, size_t{7}, size_t{8}, size_t{63}, size_t{4096}}) {
+            EXPECT_EQ(crc32cUpdate(0, data.data() + offset, size),
+                      detail::crc32cPortable(0, data.data() + offset, size))
+                << "offset=" << offset << " size=" << size;
+        }
+    }
+}
+
+/// 区間ごとの CRC-32C を連結すると全体の値になること
+TEST(ChecksumTest, Crc32cCombine_EqualsWholeChecksum) {
+    const std::string data  = sampleData(100000);
+    const uint32_t    whole = crc32cUpdate(0, data.data(), data.size());
+
+    for (const size_t split : {size_t{0}, size_t{1}, size_t{4095}, size_t{50000}, data.size()}) {
+        const uint32_t a = crc32cUpdate(0, data.data(), split);
+        const uint32_t b = crc32cUpdate(0, data.data() + split, data.size() - split);
+        EXPECT_EQ(crc32cCombine(a, b, static_cast<int64_t>(data.size() - split)), whole)
+            << "split=" << split;
+    }
+}
+
+// =============================================================================
+// SHA-256
+// =============================================================================
+
+/// FIPS 180-2 の例と一致すること（空・1 ブロック・2 ブロック・100 万文字）
+TEST(ChecksumTest, Sha256_MatchesReferenceValues) {
+    EXPECT_EQ(sha256Hex(""),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(sha256Hex("abc"),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(sha256Hex(std::string(1000000, 'a')),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+/// 分割位置によらず同じダイジェストになること（ブロック境界をまたぐ分割を含む）
+TEST(ChecksumTest, Sha256_SplitUpdates_ProduceSameDigest) {
+    const std::string data     = sampleData(1000);
+    const std::string expected = sha256Hex(data);
+
+    for (const size_t step : {size_t{1}, size_t{3}, size_t{55}, size_t{64}, size_t{65}, size_t{999}}) {
+        StreamingChecksum checksum(ChecksumAlgorithm::SHA256);
+        for (size_t pos = 0; pos < data.size(); pos += step) {
+            checksum.update(data.data() + pos, std::min(step, data.size() - pos));
+        }
+        EXPECT_EQ(checksum.hexDigest(), expected) << "step=" << step;
+    }
+}
+
+/// 高速版の圧縮関数が汎用の実装と一致すること
+TEST(ChecksumTest, Sha256_MatchesPortableImplementation) {
+    const std::string data = sampleData(64 * 5);
+
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    detail::sha256CompressPortable(state, reinterpret_cast<const uint8_t*>(data.data()), 5);
+
+    // 汎用版でパディングのブロックまで計算し、Sha256（高速版を使う）のダイジェストと比べる
+    std::vector<uint8_t> padding(64, 0);
+    padding[0] = 0x80;
+    const uint64_t bits = data.size() * 8;
+    for (int i = 0; i < 8; ++i) {
+        padding[56 + static_cast<size_t>(i)] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+    detail::sha256CompressPortable(state, padding.data(), 1);
+
+    std::string portable;
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    for (const uint32_t word : state) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            portable.push_back(DIGITS[(word >> shift) & 0xF]);
+        }
+    }
+    EXPECT_EQ(sha256Hex(data), portable) << "accelerated=" << sha256Accelerated();
+}
+
+/// NONE ではダイジェストを計算しないこと
+TEST(ChecksumTest, None_ProducesEmptyDigest) {
+    StreamingChecksum checksum;
+    checksum.update("abc", 3);
+    EXPECT_EQ(checksum.algorithm(), ChecksumAlgorithm::NONE);
+    EXPECT_TRUE(checksum.hexDigest().empty());
+}
@@ -0,0 +1,178 @@
+// =============================================================================
+// ContentDecoderTest.cpp
+// ContentDecoder（Content-Encoding の逐次展開）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 各方式の圧縮データは事前に作ったものを埋め込む（テストは圧縮ライブラリに依存しない）
+//  - ビルドに含まれなかった方式のテストは GTEST_SKIP で飛ばす
+//  - 入力をどこで区切っても同じ結果になることを確かめる
+// =============================================================================
+
+#include "ContentDecoder.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace Downloader;
+
+namespace {
+
+constexpr char TEXT[] =
+    "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.";
+
+/// raw deflate のデータ（gzip・zlib 形式の本体）
+const std::string DEFLATE_BODY(
+    "\x0b\xc9\x48\x55\x28\x2c\xcd\x4c\xce\x56\x48\x2a\xca\x2f\xcf\x53"
+    "\x48\xcb\xaf\x50\xc8\x2a\xcd\x2d\x28\x56\xc8\x2f\x4b\x2d\x52\x28"
+    "\x01\x4a\xe7\x24\x56\x55\x2a\xa4\xe4\xa7\xeb\x29\x84\x90\xa0\x18\x00", 49);
+
+const std::string GZIP_SAMPLE =
+    std::string("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03", 10) + DEFLATE_BODY +
+    std::string("\xa7\x0a\xe9\x9a\x59\x00\x00\x00", 8);
+
+const std::string ZLIB_SAMPLE =
+    std::string("\x78\xda", 2) + DEFLATE_BODY + std::string("\xae\xd1\x20\x2f", 4);
+
+const std::string BROTLI_SAMPLE(
+    "\x1b\x58\x00\x00\x44\xdb\x46\xa9\x2e\x24\x5b\x32\x14\xc5\x53\x91"
+    "\x67\x72\xf2\xe7\x28\x46\x41\x95\x57\xb6\xb2\x59\xd0\x7c\xe1\x95"
+    "\xa7\x23\xf2\xa2\xac\x36\x26\xb8\x45\x1f\x18\xc3\xaa\xfb\x0f\x81"
+    "\xc9\x00\x00", 51);
+
+const std::string ZSTD_SAMPLE(
+    "\x28\xb5\x2f\xfd\x24\x59\xb5\x01\x00\xe4\x02\x54\x68\x65\x20\x71"
+    "\x75\x69\x63\x6b\x20\x62\x72\x6f\x77\x6e\x20\x66\x6f\x78\x20\x6a"
+    "\x75\x6d\x70\x73\x20\x6f\x76\x65\x72\x20\x74\x68\x65\x20\x6c\x61"
+    "\x7a\x79\x20\x64\x6f\x67\x2e\x20\x54\x01\x00\x06\x9a\xaa\x0c\x9d"
+    "\xb4\xcd\x6c", 67);
+
+bool isSupported(const std::string& encoding) {
+    const std::string supported = ", " + ContentDecoder::supportedEncodings() + ",";
+    return supported.find(", " + encoding + ",") != std::string::npos;
+}
+
+/// input を step バイトずつ渡して展開する
+/// @return false: decode() か finish() が失敗した
+bool decodeAll(const std::string& encoding, const std::string& input, size_t step,
+               std::string& output, std::string* error = nullptr) {
+    auto decoder = ContentDecoder::create(encoding, [&output](const char* data, size_t size) {
+        output.append(data, size);
+        return true;
+    });
+    if (!decoder) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t pos = 0; ok && pos < input.size(); pos += step) {
+        ok = decoder->decode(input.data() + pos, std::min(step, input.size() - pos));
+    }
+    ok = ok && decoder->finish();
+    if (error) {
+        *error = decoder->getLastError();
+    }
+    return ok;
+}
+
+struct Sample {
+    const char*        encoding;
+    const std::string* data;
+};
+
+const Sample SAMPLES[] = {
+    {"gzip",    &GZIP_SAMPLE},
+    {"deflate", &ZLIB_SAMPLE},
+    {"deflate", &DEFLATE_BODY}, // ヘッダーのない raw deflate
+    {"br",      &BROTLI_SAMPLE},
+    {"zstd",    &ZSTD_SAMPLE},
+};
+
+} // namespace
+
+// =============================================================================
+// 展開
+// =============================================================================
+
+/// 各方式のデータを、区切り方によらず元の内容に展開できること
+TEST(ContentDecoderTest, Decode_AnySplit_ProducesOriginal) {
+    for (const auto& sample : SAMPLES) {
+        if (!isSupported(sample.encoding)) {
+            continue;
+        }
+        for (const size_t step : {size_t{1}, size_t{2}, size_t{5}, sample.data->size()}) {
+            std::string output;
+            EXPECT_TRUE(decodeAll(sample.encoding, *sample.data, step, output))
+                << sample.encoding << " step=" << step;
+            EXPECT_EQ(output, TEXT) << sample.encoding << " step=" << step;
+        }
+    }
+}
+
+/// 連結した gzip メンバーはすべて展開されること
+TEST(ContentDecoderTest, Gzip_ConcatenatedMembers) {
+    if (!isSupported("gzip")) {
+        GTEST_SKIP() << "gzip is not supported in this build";
+    }
+    std::string output;
+    EXPECT_TRUE(decodeAll("gzip", GZIP_SAMPLE + GZIP_SAMPLE + GZIP_SAMPLE, 7, output));
+    EXPECT_EQ(output, std::string(TEXT) + TEXT + TEXT);
+}
+
+/// 途中で切れたデータは finish() で失敗すること
+TEST(ContentDecoderTest, Truncated_FailsOnFinish) {
+    for (const auto& sample : SAMPLES) {
+        if (!isSupported(sample.encoding)) {
+            continue;
+        }
+        std::string output;
+        std::string error;
+        EXPECT_FALSE(decodeAll(sample.encoding, sample.data->substr(0, sample.data->size() - 4),
+                               3, output, &error))
+            << sample.encoding;
+        EXPECT_FALSE(error.empty()) << sample.encoding;
+    }
+}
+
+/// 壊れたデータは decode() で失敗し、理由を返すこと
+TEST(ContentDecoderTest, Corrupt_FailsOnDecode) {
+    for (const auto& encoding : {"gzip", "br", "zstd"}) {
+        if (!isSupported(encoding)) {
+            continue;
+        }
+        auto decoder = ContentDecoder::create(encoding, [](const char*, size_t) { return true; });
+        ASSERT_NE(decoder, nullptr) << encoding;
+        const std::string garbage(64, '\xff');
+        EXPECT_FALSE(decoder->decode(garbage.data(), garbage.size())) << encoding;
+        EXPECT_FALSE(decoder->getLastError().empty()) << encoding;
+    }
+}
+
+/// 出力関数が失敗したら展開を中断すること
+TEST(ContentDecoderTest, OutputFailure_StopsDecoding) {
+    if (!isSupported("gzip")) {
+        GTEST_SKIP() << "gzip is not supported in this build";
+    }
+    auto decoder = ContentDecoder::create("gzip", [](const char*, size_t) { return false; });
+    ASSERT_NE(decoder, nullptr);
+    EXPECT_FALSE(decoder->decode(GZIP_SAMPLE.data(), GZIP_SAMPLE.size()));
+    EXPECT_EQ(decoder->getLastError(), "Failed to write decoded data");
+}
+
+// =============================================================================
+// 方式の判定
+// =============================================================================
+
+/// 無圧縮・未対応の方式には展開器を作らないこと（方式名の大文字小文字は問わない）
+TEST(ContentDecoderTest, Create_IdentityAndUnsupported) {
+    EXPECT_TRUE(ContentDecoder::isIdentity(""));
+    EXPECT_TRUE(ContentDecoder::isIdentity(" Identity "));
+    EXPECT_FALSE(ContentDecoder::isIdentity("gzip"));
+
+    const auto discard = [](const char*, size_t) { return true; };
+    EXPECT_EQ(ContentDecoder::create("compress", discard), nullptr);
+    EXPECT_EQ(ContentDecoder::create("gzip, br", discard), nullptr);
+    if (isSupported("gzip")) {
+        EXPECT_NE(ContentDecoder::create(" GZIP", discard), nullptr);
+    }
+}
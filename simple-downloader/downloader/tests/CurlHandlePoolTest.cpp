@@ -0,0 +1,182 @@
+// =============================================================================
+// CurlHandlePoolTest.cpp
+// CurlHandlePool（ハンドル再利用・CURLSH 共有・テンプレートの複製）と
+// CurlGlobal（初回使用時の初期化）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 返却・再貸し出しは native() の CURL* が一致するかで検証する
+//  - 実際の転送は file:// URL で行う（ネットワーク不要）
+// =============================================================================
+
+#include "CurlHandlePool.h"
+#include "CurlGlobal.h"
+#include "CurlHandle.h"
+#include "Downloader.h"
+#include "MockCurlHandle.h"
+#include "MockObserver.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+using namespace Downloader::Test;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class CurlHandlePoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "curl_handle_pool_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    /// @brief file:// URL 用のソースファイルを作成する
+    std::string makeSourceFile(const std::string& name, size_t size) {
+        const fs::path path = tempDir_ / name;
+        std::ofstream out(path, std::ios::binary);
+        for (size_t i = 0; i < size; ++i) {
+            out.put(MockCurlHandle::patternByte(i));
+        }
+        return "file://" + fs::absolute(path).generic_string();
+    }
+
+    static CURL* nativeOf(const std::unique_ptr<ICurlHandle>& handle) {
+        auto* curl = dynamic_cast<CurlHandle*>(handle.get());
+        return curl ? curl->native() : nullptr;
+    }
+
+    fs::path tempDir_;
+};
+
+// =============================================================================
+// 貸し出し・返却テスト
+// =============================================================================
+
+/// 返却したハンドルが次の acquire で再利用されること
+TEST_F(CurlHandlePoolTest, Acquire_ReusesReturnedHandle) {
+    CurlHandlePool pool;
+
+    auto first = pool.acquire();
+    CURL* native = nativeOf(first);
+    ASSERT_NE(native, nullptr);
+    EXPECT_EQ(pool.getIdleCount(), 0u);
+
+    first.reset();
+    EXPECT_EQ(pool.getIdleCount(), 1u);
+
+    auto second = pool.acquire();
+    EXPECT_EQ(nativeOf(second), native);
+    EXPECT_EQ(pool.getIdleCount(), 0u);
+}
+
+/// 上限を超えて返却されたハンドルは破棄されること
+TEST_F(CurlHandlePoolTest, Release_KeepsAtMostMaxIdle) {
+    CurlHandlePool pool(2);
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+    }
+    EXPECT_EQ(pool.getIdleCount(), 2u);
+}
+
+/// ファクトリと貸し出し中のハンドルはプールより長く生存できること
+TEST_F(CurlHandlePoolTest, Factory_OutlivesPool) {
+    CurlHandlePool::Factory factory;
+    std::unique_ptr<ICurlHandle> leased;
+    {
+        CurlHandlePool pool;
+        factory = pool.makeFactory();
+        leased  = pool.acquire();
+    }
+    auto fresh = factory();
+    EXPECT_NE(nativeOf(fresh), nullptr);
+    leased.reset();
+    fresh.reset();
+}
+
+/// warmUp は maxIdle までの未使用ハンドルを前もって作り、貸し出しはそれを使うこと
+TEST_F(CurlHandlePoolTest, WarmUp_PrebuildsIdleHandles) {
+    CurlHandlePool pool(4);
+    EXPECT_EQ(pool.warmUp(3), 3u);
+    EXPECT_EQ(pool.warmUp(2), 3u);
+    EXPECT_EQ(pool.warmUp(10), 4u);
+
+    std::vector<std::unique_ptr<ICurlHandle>> leased;
+    for (int i = 0; i < 5; ++i) {
+        leased.push_back(pool.acquire());
+        EXPECT_NE(nativeOf(leased.back()), nullptr);
+    }
+    // 4 本は作っておいたもの、残り 1 本はテンプレートから複製したもの
+    EXPECT_EQ(pool.getIdleCount(), 0u);
+    leased.clear();
+    EXPECT_EQ(pool.getIdleCount(), 4u);
+}
+
+// =============================================================================
+// CurlGlobal テスト
+// =============================================================================
+
+/// 初期化は一度だけ行い、初期化した後は機能を変更できないこと
+TEST_F(CurlHandlePoolTest, CurlGlobal_InitializesOnceOnFirstUse) {
+    std::vector<std::thread> threads;
+    std::vector<char>        results(8, 0);
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&results, i] { results[i] = CurlGlobal::ensureInitialized(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const char ok : results) {
+        EXPECT_TRUE(ok);
+    }
+    EXPECT_TRUE(CurlGlobal::isInitialized());
+    EXPECT_FALSE(CurlGlobal::configure(CurlGlobal::Features::NO_SSL));
+
+    // 初期化の後もハンドルは作れる
+    auto handle = std::make_unique<CurlHandle>();
+    EXPECT_NE(handle->native(), nullptr);
+}
+
+// =============================================================================
+// Downloader 連携テスト (file:// URL)
+// =============================================================================
+
+/// 連続したダウンロードがプールのハンドルを使い回すこと
+TEST_F(CurlHandlePoolTest, Downloader_ReusesHandlesAcrossDownloads) {
+    CurlHandlePool pool;
+    constexpr size_t SIZE = 32 * 1024;
+    {
+        Downloader::Downloader downloader(DownloaderConfig{}, pool.makeFactory());
+        for (int i = 0; i < 3; ++i) {
+            MockObserver observer;
+            downloader.addObserver(&observer);
+
+            const std::string url = makeSourceFile("src" + std::to_string(i), SIZE);
+            const fs::path out = tempDir_ / ("out" + std::to_string(i) + ".bin");
+            ASSERT_TRUE(downloader.startDownload(url, out.string()));
+            ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+            EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+            EXPECT_EQ(fs::file_size(out), SIZE);
+
+            downloader.removeObserver(&observer);
+        }
+    }
+    // 逐次実行なので同時に貸し出されるハンドルは 1 本だけ
+    EXPECT_EQ(pool.getIdleCount(), 1u);
+}
@@ -0,0 +1,221 @@
+// =============================================================================
+// DiskWriteQueueTest.cpp
+// DiskWriteQueue（非同期書き込みキュー・上限による背圧）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - Sink に待機を入れて「ディスクが遅い」状況を作り、上限と空きの通知を検証する
+//  - 書き込みの完了は drain() で待ってから検証する
+// =============================================================================
+
+#include "DiskWriteQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace Downloader;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class DiskWriteQueueTest : public ::testing::Test {
+protected:
+    /// @brief 書き込みを output に追記する Sink を生成する
+    DiskWriteQueue::Sink appendTo(std::string& output) {
+        return [this, &output](const char* data, size_t size) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            output.append(data, size);
+            return true;
+        };
+    }
+
+    /// @brief release() されるまで書き込みを止める Sink を生成する（遅いディスクの代わり）
+    DiskWriteQueue::Sink gatedSink(std::string& output) {
+        return [this, &output](const char* data, size_t size) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            gateCv_.wait(lock, [this]() { return released_; });
+            output.append(data, size);
+            return true;
+        };
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_ = true;
+        }
+        gateCv_.notify_all();
+    }
+
+    std::mutex              mutex_;
+    std::condition_variable gateCv_;
+    bool                    released_{false};
+};
+
+// =============================================================================
+// 書き込みテスト
+// =============================================================================
+
+/// 出力先ごとに書き込み順が保たれること
+TEST_F(DiskWriteQueueTest, Streams_KeepWriteOrder) {
+    DiskWriteQueue queue(1024 * 1024);
+    std::string a;
+    std::string b;
+    auto streamA = queue.open(appendTo(a));
+    auto streamB = queue.open(appendTo(b));
+
+    std::string expectedA;
+    std::string expectedB;
+    for (int i = 0; i < 100; ++i) {
+        const std::string chunk = std::to_string(i) + ",";
+        ASSERT_TRUE(streamA->write(chunk.data(), chunk.size()));
+        ASSERT_TRUE(streamB->write(chunk.data(), 1));
+        expectedA += chunk;
+        expectedB += chunk[0];
+    }
+
+    ASSERT_TRUE(streamA->drain());
+    ASSERT_TRUE(streamB->drain());
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(a, expectedA);
+    EXPECT_EQ(b, expectedB);
+}
+
+/// 書き込みに失敗すると drain() と以降の write() が失敗すること
+TEST_F(DiskWriteQueueTest, SinkFailure_IsReportedOnDrain) {
+    DiskWriteQueue queue(1024);
+    std::atomic<int> calls{0};
+    auto stream = queue.open([&calls](const char*, size_t) {
+        ++calls;
+        return false;
+    });
+
+    ASSERT_TRUE(stream->write("abc", 3));
+    EXPECT_FALSE(stream->drain());
+    EXPECT_TRUE(stream->hasFailed());
+    EXPECT_FALSE(stream->write("def", 3));
+    EXPECT_EQ(calls.load(), 1);
+}
+
+/// デストラクタが積まれたデータを書き切ること
+TEST_F(DiskWriteQueueTest, Destructor_WritesQueuedData) {
+    std::string output;
+    {
+        DiskWriteQueue queue(1024);
+        auto stream = queue.open(appendTo(output));
+        stream->write("tail", 4);
+    }
+    EXPECT_EQ(output, "tail");
+}
+
+// =============================================================================
+// 背圧テスト
+// =============================================================================
+
+/// 上限に達すると isFull() になり、半分まで減ると空きが通知されること
+TEST_F(DiskWriteQueueTest, Full_NotifiesWhenDrained) {
+    DiskWriteQueue queue(100);
+    std::string output;
+    auto stream = queue.open(gatedSink(output));
+
+    const std::string block(40, 'x');
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(stream->write(block.data(), block.size()));
+    }
+    EXPECT_TRUE(queue.isFull());
+    EXPECT_EQ(queue.getQueuedBytes(), 120u);
+
+    std::atomic<bool> notified{false};
+    queue.notifyWhenSpace([&notified]() { notified = true; });
+    EXPECT_FALSE(notified.load());
+
+    release();
+    ASSERT_TRUE(stream->drain());
+    // 通知は書き出しスレッドから drain() の完了とは非同期に呼ばれる
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!notified.load() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(notified.load());
+    EXPECT_FALSE(queue.isFull());
+}
+
+/// 空きがあれば notifyWhenSpace() はその場でコールバックを呼ぶこと
+TEST_F(DiskWriteQueueTest, NotifyWhenSpace_RunsImmediatelyWhenNotFull) {
+    DiskWriteQueue queue(100);
+    bool notified = false;
+    queue.notifyWhenSpace([&notified]() { notified = true; });
+    EXPECT_TRUE(notified);
+}
+
+/// waitForSpace() が書き込みの進行まで待機すること
+TEST_F(DiskWriteQueueTest, WaitForSpace_BlocksUntilDrained) {
+    DiskWriteQueue queue(10);
+    std::string output;
+    auto stream = queue.open(gatedSink(output));
+    ASSERT_TRUE(stream->write("0123456789", 10));
+    ASSERT_TRUE(queue.isFull());
+
+    std::thread releaser([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release();
+    });
+    queue.waitForSpace();
+    EXPECT_FALSE(queue.isFull());
+    releaser.join();
+}
+
+// =============================================================================
+// プールのテスト
+// =============================================================================
+
+/// プールが上限に達すると、積んだスラブが書き込まれて返るまで isFull() になること
+TEST_F(DiskWriteQueueTest, PoolExhausted_IsFullUntilSlabsReturn) {
+    BufferPool pool({.slabSize = 64, .maxBytes = 128});
+    DiskWriteQueue queue(1024 * 1024, &pool);
+    std::string output;
+    auto stream = queue.open(gatedSink(output));
+
+    ASSERT_TRUE(stream->write("first", 5));
+    ASSERT_TRUE(stream->write("second", 6));
+    EXPECT_EQ(pool.inUseBytes(), 128u);
+    EXPECT_TRUE(queue.isFull());
+
+    // 借りられない分はヒープに積み、書き込みは失わない
+    ASSERT_TRUE(stream->write("third", 5));
+
+    std::atomic<bool> notified{false};
+    queue.notifyWhenSpace([&notified]() { notified = true; });
+    EXPECT_FALSE(notified.load());
+
+    release();
+    ASSERT_TRUE(stream->drain());
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!notified.load() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(notified.load());
+    EXPECT_FALSE(queue.isFull());
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+    EXPECT_EQ(output, "firstsecondthird");
+}
+
+/// キューがスラブを持っていなければ、プールが上限でも待たないこと（ほかの利用者を待たない）
+TEST_F(DiskWriteQueueTest, PoolHeldElsewhere_DoesNotBlock) {
+    BufferPool pool({.slabSize = 64, .maxBytes = 64});
+    BufferPool::Buffer held = pool.tryAcquire();
+    DiskWriteQueue queue(1024, &pool);
+    std::string output;
+    auto stream = queue.open(appendTo(output));
+
+    EXPECT_FALSE(queue.isFull());
+    ASSERT_TRUE(stream->write("data", 4));
+    ASSERT_TRUE(stream->drain());
+    EXPECT_EQ(output, "data");
+}
@@ -0,0 +1,151 @@
+// =============================================================================
+// DownloadCacheTest.cpp
+// DownloadCache（索引の永続化・内容の共有・LRU による削除・出力先への複製）の
+// GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 一時ディレクトリに小さなファイルを置き、Downloader を介さずに直接検証する
+//  - 索引の永続化は、同じディレクトリで作り直したキャッシュから読めることで確かめる
+// =============================================================================
+
+#include "DownloadCache.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace Downloader;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class DownloadCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root_ = fs::temp_directory_path() / "download_cache_test";
+        fs::remove_all(root_);
+        fs::create_directories(root_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(root_);
+    }
+
+    DownloadCache::Options options(uint64_t maxBytes = 0) const {
+        return {.directory = (root_ / "cache").string(), .maxBytes = maxBytes};
+    }
+
+    /// @brief 作業ディレクトリに content を書いたファイルを作る
+    std::string writeFile(const std::string& name, const std::string& content) const {
+        const fs::path path = root_ / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path.string();
+    }
+
+    static std::string readFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    fs::path root_;
+};
+
+// =============================================================================
+// 記録・複製テスト
+// =============================================================================
+
+/// 記録した内容を出力先へ複製でき、索引はキャッシュを作り直しても読めること
+TEST_F(DownloadCacheTest, Store_PersistsAcrossInstances) {
+    {
+        DownloadCache cache(options());
+        ASSERT_TRUE(cache.store("http://example.com/a", writeFile("a", "alpha"),
+                                "\"e1\"", "Wed, 01 Jan 2025 00:00:00 GMT"));
+    }
+
+    DownloadCache cache(options());
+    const auto entry = cache.lookup("http://example.com/a");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->size, 5);
+    EXPECT_EQ(entry->conditionalHeaders(),
+              (std::vector<std::string>{"If-None-Match: \"e1\"",
+                                        "If-Modified-Since: Wed, 01 Jan 2025 00:00:00 GMT"}));
+
+    // 既存の出力は置き換える
+    const std::string output = writeFile("out", "previous content");
+    ASSERT_TRUE(cache.materialize(*entry, output));
+    EXPECT_EQ(readFile(output), "alpha");
+    EXPECT_FALSE(cache.lookup("http://example.com/missing").has_value());
+}
+
+/// SHA-256 が同じ内容は別の URL でも 1 つを共有し、ダイジェストから探せること
+TEST_F(DownloadCacheTest, SameDigest_SharesObject) {
+    DownloadCache cache(options());
+    const std::string digest(64, 'a');
+    ASSERT_TRUE(cache.store("http://a.example.com/x", writeFile("x", "payload"), "", "", digest));
+    ASSERT_TRUE(cache.store("http://b.example.com/y", writeFile("y", "payload"), "", "", digest));
+
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.totalBytes(), 7u);
+    const auto entry = cache.lookupDigest(std::string(64, 'A'));
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->object, "sha256-" + digest);
+
+    // 片方を削除しても、もう片方が参照している内容は残る
+    cache.remove("http://a.example.com/x");
+    EXPECT_EQ(cache.totalBytes(), 7u);
+    cache.remove("http://b.example.com/y");
+    EXPECT_EQ(cache.totalBytes(), 0u);
+}
+
+/// 上限を超えると最も長く使われていない URL から削除されること
+TEST_F(DownloadCacheTest, Ceiling_EvictsLeastRecentlyUsed) {
+    DownloadCache cache(options(10));
+    ASSERT_TRUE(cache.store("http://example.com/1", writeFile("1", "1111"), "\"1\"", ""));
+    ASSERT_TRUE(cache.store("http://example.com/2", writeFile("2", "2222"), "\"2\"", ""));
+    ASSERT_TRUE(cache.lookup("http://example.com/1").has_value()); // 1 を新しくする
+
+    ASSERT_TRUE(cache.store("http://example.com/3", writeFile("3", "3333"), "\"3\"", ""));
+    EXPECT_TRUE(cache.lookup("http://example.com/1").has_value());
+    EXPECT_FALSE(cache.lookup("http://example.com/2").has_value());
+    EXPECT_TRUE(cache.lookup("http://example.com/3").has_value());
+    EXPECT_EQ(cache.totalBytes(), 8u);
+
+    // 上限より大きな内容は記録しない
+    EXPECT_FALSE(cache.store("http://example.com/big", writeFile("big", std::string(11, 'x')),
+                             "\"b\"", ""));
+}
+
+/// 内容が外から消されていれば複製に失敗し、記録も削除されること
+TEST_F(DownloadCacheTest, MissingObject_DropsEntry) {
+    DownloadCache cache(options());
+    ASSERT_TRUE(cache.store("http://example.com/a", writeFile("a", "alpha"), "\"e\"", ""));
+    const auto entry = cache.lookup("http://example.com/a");
+    ASSERT_TRUE(entry.has_value());
+
+    fs::remove(root_ / "cache" / "objects" / entry->object);
+    EXPECT_FALSE(cache.materialize(*entry, (root_ / "out").string()));
+    EXPECT_FALSE(cache.lookup("http://example.com/a").has_value());
+}
+
+/// ハードリンクで複製した出力は detach() でリンクが外れ、キャッシュの内容は残ること
+TEST_F(DownloadCacheTest, HardLink_DetachKeepsCachedContent) {
+    DownloadCache cache({.directory = (root_ / "cache").string(),
+                         .linkMode  = DownloadCache::LinkMode::HARD_LINK});
+    ASSERT_TRUE(cache.store("http://example.com/a", writeFile("a", "alpha"), "\"e\"", ""));
+    const auto entry = cache.lookup("http://example.com/a");
+    ASSERT_TRUE(entry.has_value());
+
+    const std::string output = (root_ / "out").string();
+    ASSERT_TRUE(cache.materialize(*entry, output));
+    EXPECT_GT(fs::hard_link_count(output), 1u);
+
+    DownloadCache::detach(output);
+    EXPECT_FALSE(fs::exists(output));
+    ASSERT_TRUE(cache.materialize(*entry, output));
+    EXPECT_EQ(readFile(output), "alpha");
+}
@@ -0,0 +1,766 @@
+// =============================================================================
+// DownloadManagerTest.cpp
+// DownloadManager（curl_multi イベントループ）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - モックは perform() をループスレッド上で同期実行する経路を検証する
+//  - file:// URL で本番 CurlHandle を curl_multi 経由で駆動する経路を検証する
+//    （ネットワーク不要）
+// =============================================================================
+
+#include "ContentDecoder.h"
+#include "DownloadManager.h"
+#include "Downloader.h"
+#include "MockCurlHandle.h"
+#include "MockObserver.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+using namespace Downloader::Test;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class DownloadManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "download_manager_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    /// @brief MockCurlHandle を使うマネージャー駆動の Downloader を生成する
+    std::unique_ptr<Downloader::Downloader> makeDownloader(DownloadManager& manager,
+                                                           MockConfig mockConfig = {},
+                                                           DownloaderConfig config = {}) {
+        return std::make_unique<Downloader::Downloader>(
+            config, manager,
+            [mockConfig]() -> std::unique_ptr<ICurlHandle> {
+                return std::make_unique<MockCurlHandle>(mockConfig);
+            });
+    }
+
+    /// @brief file:// URL 用のソースファイルを作成する
+    std::string makeSourceFile(const std::string& name, size_t size) {
+        const fs::path path = tempDir_ / name;
+        std::ofstream out(path, std::ios::binary);
+        for (size_t i = 0; i < size; ++i) {
+            out.put(MockCurlHandle::patternByte(i));
+        }
+        return "file://" + fs::absolute(path).generic_string();
+    }
+
+    static std::vector<char> readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    fs::path tempDir_;
+};
+
+// =============================================================================
+// 基本動作テスト
+// =============================================================================
+
+/// スレッド数 0 を指定しても 1 本のループが起動すること
+TEST_F(DownloadManagerTest, ZeroThreads_StartsOneLoop) {
+    DownloadManager manager(0);
+    EXPECT_EQ(manager.getThreadCount(), 1u);
+    EXPECT_EQ(manager.getActiveTransferCount(), 0u);
+}
+
+/// 多数のダウンロードを少数のループスレッドで完了できること
+TEST_F(DownloadManagerTest, ManyDownloads_CompleteOnFixedThreads) {
+    DownloadManager manager(2);
+
+    MockConfig cfg;
+    cfg.totalSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    constexpr int COUNT = 16;
+    std::vector<MockObserver> observers(COUNT);
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    for (int i = 0; i < COUNT; ++i) {
+        downloaders.push_back(makeDownloader(manager, cfg));
+        downloaders.back()->addObserver(&observers[i]);
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        const fs::path out = tempDir_ / ("out" + std::to_string(i) + ".bin");
+        ASSERT_TRUE(downloaders[i]->startDownload("http://example.com/file.bin",
+                                                  out.string()));
+    }
+
+    for (int i = 0; i < COUNT; ++i) {
+        ASSERT_TRUE(observers[i].waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observers[i].isCompleted()) << observers[i].getLastError();
+        EXPECT_EQ(downloaders[i]->getState(), DownloadState::COMPLETED);
+    }
+    EXPECT_EQ(manager.getThreadCount(), 2u);
+}
+
+/// マネージャーの進捗の表に、生存中のダウンローダーの状態と受信量が残ること
+TEST_F(DownloadManagerTest, ProgressTable_TracksDownloaders) {
+    DownloadManager manager(2);
+
+    MockConfig cfg;
+    cfg.totalSize  = 8 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    constexpr int COUNT = 8;
+    std::vector<MockObserver> observers(COUNT);
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    for (int i = 0; i < COUNT; ++i) {
+        downloaders.push_back(makeDownloader(manager, cfg));
+        downloaders.back()->addObserver(&observers[i]);
+    }
+    EXPECT_EQ(manager.progressTable().size(), static_cast<size_t>(COUNT));
+
+    for (int i = 0; i < COUNT; ++i) {
+        const fs::path out = tempDir_ / ("table" + std::to_string(i) + ".bin");
+        ASSERT_TRUE(downloaders[i]->startDownload("http://example.com/file.bin", out.string()));
+    }
+    for (auto& observer : observers) {
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    }
+
+    std::vector<ProgressTable::Entry> entries;
+    ASSERT_EQ(manager.progressTable().collect(entries), static_cast<size_t>(COUNT));
+    for (const auto& entry : entries) {
+        EXPECT_EQ(entry.state, DownloadState::COMPLETED);
+        EXPECT_EQ(entry.downloadedBytes, cfg.totalSize);
+        EXPECT_EQ(entry.totalBytes, cfg.totalSize);
+    }
+
+    // 破棄したダウンローダーの行は表から消える
+    downloaders.pop_back();
+    EXPECT_EQ(manager.progressTable().collect(entries), static_cast<size_t>(COUNT - 1));
+    for (const auto& entry : entries) {
+        EXPECT_NE(entry.owner, nullptr);
+    }
+}
+
+// =============================================================================
+// pause / resume / cancel テスト
+// =============================================================================
+
+/// マネージャー駆動では WRITE_PAUSE で転送を停止し、再開できること
+TEST_F(DownloadManagerTest, PauseResume_UsesWritePause) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 50 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    std::atomic<MockCurlHandle*> lastMock{nullptr};
+    Downloader::Downloader downloader(
+        DownloaderConfig{}, manager,
+        [cfg, &lastMock]() -> std::unique_ptr<ICurlHandle> {
+            auto mock = std::make_unique<MockCurlHandle>(cfg);
+            lastMock = mock.get();
+            return mock;
+        });
+    MockObserver observer;
+    downloader.addObserver(&observer);
+
+    const fs::path out = tempDir_ / "paused.bin";
+    downloader.startDownload("http://example.com/large.bin", out.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+
+    downloader.pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+    EXPECT_EQ(downloader.getState(), DownloadState::PAUSED);
+
+    // onPaused は書き込みコールバック内で通知されるため、WRITE_PAUSE の
+    // 受理（モック側のカウント）はわずかに遅れて反映される
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (lastMock.load()->getPauseCount() == 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_GT(lastMock.load()->getPauseCount(), 0);
+
+    downloader.resume();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted());
+    EXPECT_EQ(observer.getPausedCallCount(), 1);
+    EXPECT_EQ(observer.getResumedCallCount(), 1);
+    EXPECT_EQ(fs::file_size(out), cfg.totalSize);
+}
+
+/// 一時停止中の cancel で転送が中断されること
+TEST_F(DownloadManagerTest, CancelWhilePaused_NotifiesCancelled) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 100 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    auto downloader = makeDownloader(manager, cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/large.bin",
+                              (tempDir_ / "cancel.bin").string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+    downloader->pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCancelled());
+    EXPECT_EQ(observer.getCompletedCallCount(), 0);
+}
+
+/// 長い一時停止では転送をマネージャーから外し、再開時にセグメントの続きから取り直すこと
+TEST_F(DownloadManagerTest, LongPause_ParksSegments_AndResumesWithRange) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+    config.pauseReleaseMs = 0;
+    auto downloader = makeDownloader(manager, cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const fs::path out = tempDir_ / "parked.bin";
+    downloader->startDownload("http://example.com/large.bin", out.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+
+    downloader->pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+
+    // すべてのセグメントが切断され、ループ上の転送がなくなるまで待つ
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (manager.getActiveTransferCount() > 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(manager.getActiveTransferCount(), 0u);
+    EXPECT_EQ(downloader->getState(), DownloadState::PAUSED);
+
+    downloader->resume();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(observer.getResumedCallCount(), 1);
+
+    const auto content = readFile(out);
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// 切断して保留中の転送も cancel で中断されること
+TEST_F(DownloadManagerTest, CancelWhileParked_NotifiesCancelled) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 100 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    DownloaderConfig config;
+    config.pauseReleaseMs = 0;
+    auto downloader = makeDownloader(manager, cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/large.bin",
+                              (tempDir_ / "parked_cancel.bin").string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+    downloader->pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (manager.getActiveTransferCount() > 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(manager.getActiveTransferCount(), 0u);
+
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCancelled());
+    EXPECT_EQ(observer.getCompletedCallCount(), 0);
+}
+
+/// 実行中の Downloader を破棄してもデッドロックしないこと
+TEST_F(DownloadManagerTest, Destructor_WaitsForRunningJob) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 500 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    MockObserver observer;
+    {
+        auto downloader = makeDownloader(manager, cfg);
+        downloader->addObserver(&observer);
+        downloader->startDownload("http://example.com/file.bin",
+                                  (tempDir_ / "destroy.bin").string());
+        observer.waitForProgress(5, std::chrono::seconds(2));
+    }
+    EXPECT_TRUE(observer.isCancelled());
+    EXPECT_EQ(manager.getActiveTransferCount(), 0u);
+}
+
+// =============================================================================
+// curl_multi 経路テスト (file:// URL)
+// =============================================================================
+
+/// 本番 CurlHandle を curl_multi で駆動して複数ファイルを取得できること
+TEST_F(DownloadManagerTest, NativeHandles_DownloadFileUrls) {
+    DownloadManager manager(1);
+
+    constexpr int COUNT = 4;
+    constexpr size_t SIZE = 64 * 1024;
+    std::vector<MockObserver> observers(COUNT);
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    for (int i = 0; i < COUNT; ++i) {
+        downloaders.push_back(
+            std::make_unique<Downloader::Downloader>(DownloaderConfig{}, manager));
+        downloaders.back()->addObserver(&observers[i]);
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        const std::string url = makeSourceFile("src" + std::to_string(i), SIZE);
+        const fs::path out = tempDir_ / ("native" + std::to_string(i) + ".bin");
+        ASSERT_TRUE(downloaders[i]->startDownload(url, out.string()));
+    }
+
+    for (int i = 0; i < COUNT; ++i) {
+        ASSERT_TRUE(observers[i].waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observers[i].isCompleted()) << observers[i].getLastError();
+        const auto content = readFile(tempDir_ / ("native" + std::to_string(i) + ".bin"));
+        ASSERT_EQ(content.size(), SIZE);
+        EXPECT_EQ(content[SIZE - 1], MockCurlHandle::patternByte(SIZE - 1));
+    }
+}
+
+/// 本番 CurlHandle で セグメント分割ダウンロードが curl_multi 上で動くこと
+TEST_F(DownloadManagerTest, NativeHandles_SegmentedDownload) {
+    DownloadManager manager(1);
+
+    constexpr size_t SIZE = 256 * 1024 + 17;
+    const std::string url = makeSourceFile("segmented_src", SIZE);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 16 * 1024;
+    Downloader::Downloader downloader(config, manager);
+    MockObserver observer;
+    downloader.addObserver(&observer);
+
+    const fs::path out = tempDir_ / "segmented.bin";
+    ASSERT_TRUE(downloader.startDownload(url, out.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const auto content = readFile(out);
+    ASSERT_EQ(content.size(), SIZE);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// 書き込み待ちの上限で止めた転送が、空きができてから欠けなく再開されること
+/// （file:// は WRITE_PAUSE のまま終わるため、続きから取り直す経路も通る）
+TEST_F(DownloadManagerTest, NativeHandles_AsyncDiskWrites_Backpressure) {
+    DownloadManager manager(1);
+
+    constexpr size_t SIZE = 512 * 1024 + 5;
+    const std::string url = makeSourceFile("async_src", SIZE);
+
+    DownloaderConfig config;
+    config.writeBufferSize = 16 * 1024;
+    config.asyncDiskWrites = true;
+    config.diskQueueLimit  = 32 * 1024; // すぐに上限に達する
+    config.minSegmentSize  = 64 * 1024;
+
+    for (const size_t segments : {size_t{1}, size_t{2}}) {
+        config.segmentCount = segments;
+        Downloader::Downloader downloader(config, manager);
+        MockObserver observer;
+        downloader.addObserver(&observer);
+
+        const fs::path out = tempDir_ / ("async" + std::to_string(segments) + ".bin");
+        ASSERT_TRUE(downloader.startDownload(url, out.string()));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+        const auto content = readFile(out);
+        ASSERT_EQ(content.size(), SIZE);
+        for (size_t i = 0; i < content.size(); ++i) {
+            ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+        }
+    }
+}
+
+/// 帯域制限で止めた転送はスケジューラーの割り当てで再開されること
+/// （mock の WRITE_PAUSE と、停止できない file:// の取り直しの両方）
+TEST_F(DownloadManagerTest, BandwidthLimit_WithholdsAndResumesTransfers) {
+    DownloadManager    manager(1);
+    BandwidthScheduler scheduler;
+
+    DownloaderConfig config;
+    config.maxBytesPerSec     = 256 * 1024;
+    config.bandwidthScheduler = &scheduler;
+
+    MockConfig cfg;
+    cfg.totalSize  = 96 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    constexpr size_t FILE_SIZE = 96 * 1024 + 7;
+    const std::string fileUrl = makeSourceFile("bandwidth_src", FILE_SIZE);
+
+    for (const bool native : {false, true}) {
+        auto downloader = native
+            ? std::make_unique<Downloader::Downloader>(config, manager)
+            : std::make_unique<Downloader::Downloader>(config, manager, [cfg]() {
+                  return std::unique_ptr<ICurlHandle>(std::make_unique<MockCurlHandle>(cfg));
+              });
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        const fs::path out = tempDir_ / (native ? "bandwidth_native.bin" : "bandwidth_mock.bin");
+        const auto begin = std::chrono::steady_clock::now();
+        ASSERT_TRUE(downloader->startDownload(native ? fileUrl : "http://example.com/f.bin",
+                                              out.string()));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+        // 32 KiB のバケットを除く 64 KiB に 0.25 秒かかる
+        EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(200))
+            << "native=" << native;
+
+        const auto content = readFile(out);
+        ASSERT_EQ(content.size(), native ? FILE_SIZE : cfg.totalSize);
+        for (size_t i = 0; i < content.size(); ++i) {
+            ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+        }
+    }
+}
+
+/// 展開待ちが上限に達した転送は WRITE_PAUSE で止め、展開が追いついたら再開すること
+TEST_F(DownloadManagerTest, ContentDecoding_Pipelined_WithholdsUntilDecoded) {
+    if (ContentDecoder::supportedEncodings().find("gzip") == std::string::npos) {
+        GTEST_SKIP() << "gzip is not supported in this build";
+    }
+    // "abc" を gzip で圧縮したもの
+    const std::string member("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x4b\x4c\x4a"
+                             "\x06\x00\xc2\x41\x24\x35\x03\x00\x00\x00", 23);
+    MockConfig cfg;
+    for (int i = 0; i < 2000; ++i) {
+        cfg.body += member;
+    }
+    cfg.contentEncoding = "gzip";
+    cfg.chunkSize       = 512;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.contentDecoding = ContentDecoding::PIPELINED;
+    config.diskQueueLimit  = 2 * 1024;
+
+    DownloadManager manager(1);
+    auto downloader = makeDownloader(manager, cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const fs::path out = tempDir_ / "decoded.txt";
+    ASSERT_TRUE(downloader->startDownload("http://example.com/log.txt", out.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const auto content = readFile(out);
+    ASSERT_EQ(content.size(), 2000u * 3);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], "abc"[i % 3]) << "offset " << i;
+    }
+    EXPECT_EQ(downloader->getStats().wireBytes, static_cast<int64_t>(cfg.body.size()));
+}
+
+// =============================================================================
+// 複数ミラー
+// =============================================================================
+
+/// イベントループ上でも、切断したミラーの区間を別のミラーで取り直して完了すること
+TEST_F(DownloadManagerTest, Mirrors_FailedSegment_ResubmittedOnAnotherMirror) {
+    MockConfig cfg;
+    cfg.totalSize       = 128 * 1024;
+    cfg.chunkSize       = 4 * 1024;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("mirror2") != std::string::npos) {
+            config.failAfterBytes = 8 * 1024;
+        }
+    };
+
+    DownloaderConfig config;
+    config.minSegmentSize = 8 * 1024;
+    config.minStealSize   = 8 * 1024;
+
+    DownloadManager manager(1);
+    auto downloader = makeDownloader(manager, cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const fs::path out = tempDir_ / "mirrored.bin";
+    const std::vector<std::string> mirrors = {"http://mirror1.example.com/file.bin",
+                                              "http://mirror2.example.com/file.bin"};
+    ASSERT_TRUE(downloader->startDownload(mirrors, out.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const auto content = readFile(out);
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), 2u);
+    EXPECT_TRUE(stats.mirrors[1].failed);
+}
+
+// =============================================================================
+// 再試行
+// =============================================================================
+
+/// 再試行の待機中もループスレッドを塞がず、待ち時間が過ぎたら続きから取り直すこと
+TEST_F(DownloadManagerTest, Retry_DelaysResubmission_WithoutBlockingLoop) {
+    MockConfig failing;
+    failing.totalSize      = 64 * 1024;
+    failing.chunkSize      = 4 * 1024;
+    failing.chunkDelay     = std::chrono::milliseconds(0);
+    failing.failAfterBytes = 16 * 1024;
+
+    DownloaderConfig config;
+    config.maxRetries       = 1;
+    config.retryBaseDelayMs = 100;
+    config.retryMaxDelayMs  = 100;
+
+    DownloadManager manager(1);
+    auto flaky = makeDownloader(manager, failing, config);
+    auto other = makeDownloader(manager);
+    MockObserver flakyObserver;
+    MockObserver otherObserver;
+    flaky->addObserver(&flakyObserver);
+    other->addObserver(&otherObserver);
+
+    const fs::path flakyOut = tempDir_ / "flaky.bin";
+    const fs::path otherOut = tempDir_ / "other.bin";
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(flaky->startDownload("http://example.com/flaky.bin", flakyOut.string()));
+    ASSERT_TRUE(other->startDownload("http://example.com/other.bin", otherOut.string()));
+
+    // 同じループの別の転送は再試行の待ち時間に関係なく終わる
+    ASSERT_TRUE(otherObserver.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(otherObserver.isCompleted()) << otherObserver.getLastError();
+    EXPECT_FALSE(flakyObserver.isFinished());
+
+    ASSERT_TRUE(flakyObserver.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(flakyObserver.isCompleted()) << flakyObserver.getLastError();
+    // 待ち時間は 50〜100ms。3 回の再試行で少なくとも 150ms かかる
+    EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(150));
+    const auto content = readFile(flakyOut);
+    ASSERT_EQ(content.size(), failing.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+    EXPECT_EQ(flaky->getStats().retryCount, 3);
+}
+
+/// 再試行の待機中にキャンセルすると、待ち時間を待たずに onCancelled を通知すること
+TEST_F(DownloadManagerTest, Retry_CancelDuringBackoff_NotifiesCancelled) {
+    MockConfig cfg;
+    cfg.returnResult = CurlResult::NETWORK_ERROR;
+
+    DownloaderConfig config;
+    config.maxRetries       = 5;
+    config.retryBaseDelayMs = 60 * 1000;
+    config.retryMaxDelayMs  = 60 * 1000;
+
+    DownloadManager manager(1);
+    auto downloader = makeDownloader(manager, cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/down.bin",
+                                          (tempDir_ / "down.bin").string()));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (downloader->getStats().retryCount == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(downloader->getStats().retryCount, 1);
+
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(2)));
+    EXPECT_TRUE(observer.isCancelled());
+}
+
+// =============================================================================
+// 接続の多重化
+// =============================================================================
+
+/// 多重化する本番 CurlHandle は、同じホストへの転送が同じループで駆動されること
+TEST_F(DownloadManagerTest, Multiplexing_SameHostTransfersShareLoop) {
+    DownloadManager manager(4, ConnectionLimits{10, 2, 0});
+
+    /// 進捗を通知したスレッドを記録する
+    class ThreadRecorder final : public IDownloaderObserver {
+    public:
+        void onProgress(int64_t, int64_t, double) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.insert(std::this_thread::get_id());
+        }
+        void onCompleted() override {}
+        void onError(const std::string&) override {}
+        void onPaused() override {}
+        void onResumed() override {}
+        void onCancelled() override {}
+
+        std::set<std::thread::id> threads() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return threads_;
+        }
+
+    private:
+        std::mutex                mutex_;
+        std::set<std::thread::id> threads_;
+    };
+
+    constexpr int COUNT = 6;
+    constexpr size_t SIZE = 256 * 1024;
+    std::vector<MockObserver> observers(COUNT);
+    ThreadRecorder recorder;
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    for (int i = 0; i < COUNT; ++i) {
+        downloaders.push_back(std::make_unique<Downloader::Downloader>(DownloaderConfig{}, manager));
+        downloaders.back()->addObserver(&observers[i]);
+        downloaders.back()->addObserver(&recorder);
+    }
+    // 転送が重なるよう、ソースファイルを先に作ってから続けて開始する
+    std::vector<std::string> urls;
+    for (int i = 0; i < COUNT; ++i) {
+        urls.push_back(makeSourceFile("mux" + std::to_string(i), SIZE));
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        ASSERT_TRUE(downloaders[i]->startDownload(urls[i], (tempDir_ / ("mux" + std::to_string(i))).string()));
+    }
+
+    for (auto& observer : observers) {
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    }
+    EXPECT_EQ(recorder.threads().size(), 1u);
+    EXPECT_EQ(manager.getActiveTransferCount(), 0u);
+}
+
+// =============================================================================
+// 非同期 API
+// =============================================================================
+
+namespace {
+
+/// co_await を試すための最小のコルーチン（呼び出し時に実行を始め、終了を待たない）
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/// 1 件を co_await し、再開したスレッドと結果を promise に設定する
+DetachedTask fetchOne(Downloader::Downloader& downloader, std::string output,
+                      std::promise<std::pair<std::thread::id, DownloadResult>>& promise) {
+    DownloadResult result = co_await downloader.fetch("http://example.com/file.bin", output);
+    promise.set_value({std::this_thread::get_id(), std::move(result)});
+}
+
+} // namespace
+
+/// 多数の co_await がループスレッド上で再開し、待つためのスレッドを増やさないこと
+TEST_F(DownloadManagerTest, Fetch_CoAwait_ResumesOnLoopThreads) {
+    DownloadManager manager(2);
+
+    MockConfig cfg;
+    cfg.totalSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    constexpr int COUNT = 32;
+    std::vector<std::unique_ptr<Downloader::Downloader>> downloaders;
+    std::vector<std::promise<std::pair<std::thread::id, DownloadResult>>> promises(COUNT);
+    std::vector<std::future<std::pair<std::thread::id, DownloadResult>>> futures;
+    for (int i = 0; i < COUNT; ++i) {
+        downloaders.push_back(makeDownloader(manager, cfg));
+        futures.push_back(promises[i].get_future());
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        fetchOne(*downloaders[i], (tempDir_ / ("co" + std::to_string(i))).string(), promises[i]);
+    }
+
+    std::set<std::thread::id> resumedOn;
+    for (auto& future : futures) {
+        ASSERT_EQ(future.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+        auto [thread, result] = future.get();
+        EXPECT_TRUE(result.ok()) << result.error;
+        EXPECT_EQ(result.stats.downloadedBytes, 4 * 1024);
+        resumedOn.insert(thread);
+    }
+    // 中断が済む前に終わったものは、co_await したこのスレッドでそのまま続ける
+    resumedOn.erase(std::this_thread::get_id());
+    EXPECT_LE(resumedOn.size(), manager.getThreadCount());
+}
+
+/// fetchAsync の完了の中で Downloader を破棄しても、ループと次の転送が止まらないこと
+TEST_F(DownloadManagerTest, OnDone_MayDestroyDownloaderOnLoop) {
+    DownloadManager manager(1);
+
+    MockConfig cfg;
+    cfg.totalSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    Downloader::Downloader* downloader = makeDownloader(manager, cfg).release();
+    std::promise<DownloadState> promise;
+    auto finished = promise.get_future();
+    ASSERT_TRUE(downloader->startDownload(
+        "http://example.com/file.bin", (tempDir_ / "destroyed").string(),
+        [downloader, &promise](DownloadResult result) {
+            delete downloader;
+            promise.set_value(result.state);
+        }));
+    ASSERT_EQ(finished.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(finished.get(), DownloadState::COMPLETED);
+
+    auto next = makeDownloader(manager, cfg);
+    EXPECT_TRUE(next->fetchAsync("http://example.com/file.bin", (tempDir_ / "next").string()).get().ok());
+}
@@ -0,0 +1,111 @@
+// =============================================================================
+// DownloadMetricsTest.cpp
+// DownloadMetrics（カウンター・ヒストグラムと Prometheus / OTLP 出力）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 区画への加算は複数スレッドから行い、合計が失われないことを確かめる
+//  - 出力は文字列の一部を照合し、書式の細部（行の順序など）には依存しない
+// =============================================================================
+
+#include "DownloadMetrics.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+
+/// 複数スレッドからの加算がすべて合計に残ること
+TEST(DownloadMetricsTest, Counter_SumsAcrossThreads) {
+    MetricCounter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add(2);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.value(), 8u * 10000 * 2);
+}
+
+/// 値は上限（2 のべき乗）がその値以上になる最初の区間に入ること
+TEST(DownloadMetricsTest, Histogram_BucketsByPowerOfTwo) {
+    MetricHistogram histogram;
+    for (const uint64_t value : {0u, 1u, 2u, 3u, 4u, 5u, 1000u}) {
+        histogram.record(value);
+    }
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 7u);
+    EXPECT_EQ(snapshot.sum, 1015u);
+    EXPECT_EQ(snapshot.counts[0], 2u);  // 0, 1
+    EXPECT_EQ(snapshot.counts[1], 1u);  // 2
+    EXPECT_EQ(snapshot.counts[2], 2u);  // 3, 4
+    EXPECT_EQ(snapshot.counts[3], 1u);  // 5
+    EXPECT_EQ(snapshot.counts[10], 1u); // 1000 <= 1024
+
+    // 最も大きい区間には上限がない
+    histogram.record(UINT64_MAX / 2);
+    EXPECT_EQ(histogram.snapshot().counts[MetricHistogram::BUCKETS - 1], 1u);
+}
+
+/// 分位点は該当する区間の上限で近似すること
+TEST(DownloadMetricsTest, Histogram_PercentileUsesBucketUpperBound) {
+    MetricHistogram histogram;
+    EXPECT_EQ(histogram.snapshot().percentile(0.5), 0u);
+
+    for (int i = 0; i < 90; ++i) {
+        histogram.record(100); // <= 128
+    }
+    for (int i = 0; i < 10; ++i) {
+        histogram.record(5000); // <= 8192
+    }
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.percentile(0.5), 128u);
+    EXPECT_EQ(snapshot.percentile(0.9), 128u);
+    EXPECT_EQ(snapshot.percentile(0.99), 8192u);
+}
+
+/// Prometheus のテキスト形式で、時間は秒に換算し、区間の件数は累積で出力すること
+TEST(DownloadMetricsTest, Prometheus_ExportsCountersAndCumulativeBuckets) {
+    DownloadMetrics metrics;
+    metrics.bytesReceived.add(4096);
+    metrics.pausedUs.add(1500000);
+    metrics.diskWriteUs.record(1);
+    metrics.diskWriteUs.record(3);
+
+    const std::string text = metrics.toPrometheus("dl");
+    EXPECT_NE(text.find("# TYPE dl_received_bytes_total counter\ndl_received_bytes_total 4096\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("dl_paused_seconds_total 1.5\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE dl_disk_write_duration_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("dl_disk_write_duration_seconds_bucket{le=\"1e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("dl_disk_write_duration_seconds_bucket{le=\"4e-06\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("dl_disk_write_duration_seconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("dl_disk_write_duration_seconds_sum 4e-06\n"), std::string::npos);
+    EXPECT_NE(text.find("dl_disk_write_duration_seconds_count 2\n"), std::string::npos);
+}
+
+/// OTLP/JSON では単調な累積 Sum と explicitBounds 付きの Histogram として出力すること
+TEST(DownloadMetricsTest, OpenTelemetry_ExportsSumsAndHistograms) {
+    DownloadMetrics metrics;
+    metrics.retries.add(3);
+    metrics.connectUs.record(2);
+
+    const std::string json = metrics.toOpenTelemetryJson("downloader");
+    EXPECT_EQ(json.rfind("{\"resourceMetrics\":[", 0), 0u);
+    EXPECT_NE(json.find("\"scope\":{\"name\":\"downloader\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"downloader.retries\""), std::string::npos);
+    EXPECT_NE(json.find("\"isMonotonic\":true"), std::string::npos);
+    EXPECT_NE(json.find("\"asInt\":\"3\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"downloader.connect_duration\""), std::string::npos);
+    EXPECT_NE(json.find("\"unit\":\"s\""), std::string::npos);
+    EXPECT_NE(json.find("\"bucketCounts\":[\"0\",\"1\",\"0\""), std::string::npos);
+    EXPECT_NE(json.find("\"explicitBounds\":[1e-06,2e-06,4e-06"), std::string::npos);
+}
@@ -0,0 +1,350 @@
+// =============================================================================
+// DownloadQueueTest.cpp
+// DownloadQueue（同時実行数・ホスト単位の制限・優先度・取り消し）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 転送は MockCurlHandle で行い、ジョブの長さは受信を止めるシンク (GateSink) や転送サイズで調整する
+//  - ジョブの実行中は onProgress → 終了通知の間を「実行中」とみなして同時実行数を数える
+// =============================================================================
+
+#include "DownloadQueue.h"
+#include "DownloadSinks.h"
+#include "MockCurlHandle.h"
+#include "MockObserver.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+using namespace Downloader::Test;
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+/// pred が true になるまで最大 timeout 待つ
+template <typename Pred>
+bool waitUntil(Pred pred, std::chrono::milliseconds timeout = 5s) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+/// 同時に実行中のジョブ数とその最大値を数えるオブザーバー
+class ConcurrencyObserver final : public IDownloaderObserver {
+public:
+    explicit ConcurrencyObserver(std::atomic<int>& active, std::atomic<int>& peak)
+        : active_(active), peak_(peak) {}
+
+    void onProgress(int64_t, int64_t, double) override {
+        if (started_.exchange(true)) return;
+        const int now = active_.fetch_add(1) + 1;
+        int prev = peak_.load();
+        while (now > prev && !peak_.compare_exchange_weak(prev, now)) {}
+    }
+    void onPaused() override {}
+    void onResumed() override {}
+    void onCompleted() override { finish(); }
+    void onError(const std::string&) override { finish(); }
+    void onCancelled() override { finish(); }
+
+private:
+    void finish() {
+        if (started_.exchange(false)) active_.fetch_sub(1);
+    }
+
+    std::atomic<int>& active_;
+    std::atomic<int>& peak_;
+    std::atomic<bool> started_{false};
+};
+
+/// release() されるまで最初の受信を止めておくシンク
+class GateSink final : public IDownloadSink {
+public:
+    bool open(int64_t) override { return true; }
+    bool write(int64_t, std::span<const char>) override {
+        while (!open_.load()) {
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+    void release() { open_.store(true); }
+
+private:
+    std::atomic<bool> open_{false};
+};
+
+} // namespace
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class DownloadQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "download_queue_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    /// @brief MockCurlHandle を使い、終了したジョブを results_ に記録する設定
+    DownloadQueueConfig makeConfig(size_t maxConcurrent, MockConfig mockConfig = {}) {
+        DownloadQueueConfig config;
+        config.maxConcurrent = maxConcurrent;
+        config.curlFactory   = [mockConfig]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(mockConfig);
+        };
+        config.onJobFinished = [this](const DownloadJobResult& result) {
+            std::lock_guard<std::mutex> lock(resultsMutex_);
+            results_.push_back(result);
+        };
+        return config;
+    }
+
+    std::vector<DownloadJobResult> results() {
+        std::lock_guard<std::mutex> lock(resultsMutex_);
+        return results_;
+    }
+
+    /// 終了した順のジョブ ID
+    std::vector<JobId> finishedOrder() {
+        std::vector<JobId> ids;
+        for (const auto& result : results()) {
+            ids.push_back(result.id);
+        }
+        return ids;
+    }
+
+    fs::path                       tempDir_;
+    std::mutex                     resultsMutex_;
+    std::vector<DownloadJobResult> results_;
+};
+
+// =============================================================================
+// 実行
+// =============================================================================
+
+/// 多数のジョブが maxConcurrent を超えずにすべて完了すること
+TEST_F(DownloadQueueTest, ManyJobs_CompleteWithBoundedConcurrency) {
+    constexpr size_t JOB_COUNT = 30;
+    DownloadQueue queue(makeConfig(3));
+
+    std::atomic<int> active{0}, peak{0};
+    std::vector<std::unique_ptr<MemorySink>>          sinks;
+    std::vector<std::unique_ptr<ConcurrencyObserver>> observers;
+    std::vector<DownloadJob>                          jobs;
+    for (size_t i = 0; i < JOB_COUNT; ++i) {
+        sinks.push_back(std::make_unique<MemorySink>());
+        observers.push_back(std::make_unique<ConcurrencyObserver>(active, peak));
+        jobs.push_back({"https://example.com/" + std::to_string(i), "", sinks.back().get(),
+                        TransferPriority::NORMAL, observers.back().get()});
+    }
+    const auto ids = queue.enqueue(std::move(jobs));
+    ASSERT_EQ(ids.size(), JOB_COUNT);
+
+    ASSERT_TRUE(queue.waitForIdle(10s));
+    EXPECT_LE(peak.load(), 3);
+    EXPECT_GE(peak.load(), 1);
+
+    const auto stats = queue.getStats();
+    EXPECT_EQ(stats.queued, 0u);
+    EXPECT_EQ(stats.running, 0u);
+    EXPECT_EQ(stats.completed, JOB_COUNT);
+    EXPECT_EQ(stats.failed, 0u);
+    EXPECT_EQ(stats.downloadedBytes, static_cast<int64_t>(JOB_COUNT * 10 * 1024));
+    for (const auto& sink : sinks) {
+        EXPECT_EQ(sink->data().size(), 10u * 1024);
+    }
+    EXPECT_EQ(results().size(), JOB_COUNT);
+}
+
+/// 出力パスを指定したジョブはファイルに書き込まれること
+TEST_F(DownloadQueueTest, OutputPath_WritesFile) {
+    DownloadQueue queue(makeConfig(2));
+    const fs::path first  = tempDir_ / "a.bin";
+    const fs::path second = tempDir_ / "b.bin";
+    queue.enqueue({"https://example.com/a.bin", first.string()});
+    queue.enqueue({"https://example.com/b.bin", second.string()});
+
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    EXPECT_EQ(queue.getStats().completed, 2u);
+    EXPECT_EQ(fs::file_size(first), 10u * 1024);
+    EXPECT_EQ(fs::file_size(second), 10u * 1024);
+}
+
+/// 失敗したジョブは ERROR として理由とともに報告されること
+TEST_F(DownloadQueueTest, FailedJob_ReportsError) {
+    MockConfig mockConfig;
+    mockConfig.httpCode = 404;
+    DownloadQueue queue(makeConfig(1, mockConfig));
+    MockObserver observer;
+    MemorySink   sink;
+    queue.enqueue({"https://example.com/missing", "", &sink, TransferPriority::NORMAL, &observer});
+
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    EXPECT_TRUE(observer.isError());
+    EXPECT_EQ(queue.getStats().failed, 1u);
+    const auto finished = results();
+    ASSERT_EQ(finished.size(), 1u);
+    EXPECT_EQ(finished[0].state, DownloadState::ERROR);
+    EXPECT_FALSE(finished[0].error.empty());
+}
+
+// =============================================================================
+// スケジューリング
+// =============================================================================
+
+/// 同じホストへの同時実行は maxPerHost までに抑えられること
+TEST_F(DownloadQueueTest, MaxPerHost_LimitsSameHost) {
+    auto config       = makeConfig(4);
+    config.maxPerHost = 1;
+    DownloadQueue queue(config);
+
+    std::atomic<int> activeA{0}, peakA{0}, activeB{0}, peakB{0};
+    std::vector<std::unique_ptr<MemorySink>>          sinks;
+    std::vector<std::unique_ptr<ConcurrencyObserver>> observers;
+    for (int i = 0; i < 6; ++i) {
+        const bool hostA = i % 2 == 0;
+        sinks.push_back(std::make_unique<MemorySink>());
+        observers.push_back(hostA ? std::make_unique<ConcurrencyObserver>(activeA, peakA)
+                                  : std::make_unique<ConcurrencyObserver>(activeB, peakB));
+        queue.enqueue({std::string(hostA ? "https://a.example.com/" : "https://B.example.com:8443/") +
+                           std::to_string(i),
+                       "", sinks.back().get(), TransferPriority::NORMAL, observers.back().get()});
+    }
+
+    ASSERT_TRUE(queue.waitForIdle(10s));
+    EXPECT_EQ(queue.getStats().completed, 6u);
+    EXPECT_EQ(peakA.load(), 1);
+    EXPECT_EQ(peakB.load(), 1);
+}
+
+/// 実行待ちのジョブは優先度の高い順に実行されること
+TEST_F(DownloadQueueTest, Priority_HigherRunsFirst) {
+    DownloadQueue queue(makeConfig(1));
+    GateSink   gate;
+    MemorySink background, normal, high;
+
+    const JobId blocker = queue.enqueue({"https://example.com/blocker", "", &gate});
+    ASSERT_TRUE(waitUntil([&] { return queue.getStats().running == 1; }));
+
+    const JobId b = queue.enqueue({"https://example.com/b", "", &background, TransferPriority::BACKGROUND});
+    const JobId n = queue.enqueue({"https://example.com/n", "", &normal, TransferPriority::NORMAL});
+    const JobId h = queue.enqueue({"https://example.com/h", "", &high, TransferPriority::HIGH});
+    EXPECT_EQ(queue.getStats().queued, 3u);
+    gate.release();
+
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    EXPECT_EQ(finishedOrder(), (std::vector<JobId>{blocker, h, n, b}));
+}
+
+/// 実行中のワーカーのキューに残ったジョブは、空いているワーカーが奪って実行すること
+TEST_F(DownloadQueueTest, IdleWorker_StealsQueuedJobs) {
+    DownloadQueue queue(makeConfig(2));
+    GateSink gate;
+    std::vector<std::unique_ptr<MemorySink>> sinks;
+    queue.enqueue({"https://example.com/blocker", "", &gate});
+    for (int i = 0; i < 5; ++i) {
+        sinks.push_back(std::make_unique<MemorySink>());
+        queue.enqueue({"https://example.com/" + std::to_string(i), "", sinks.back().get()});
+    }
+
+    // ラウンドロビンでブロック中のワーカーにも振り分けられたジョブが、もう一方で終わる
+    EXPECT_TRUE(waitUntil([&] { return queue.getStats().completed == 5; }));
+    EXPECT_EQ(queue.getStats().running, 1u);
+    gate.release();
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    EXPECT_EQ(queue.getStats().completed, 6u);
+}
+
+// =============================================================================
+// 取り消し
+// =============================================================================
+
+/// 実行待ちのジョブを取り消すと、実行されずに CANCELLED で終了すること
+TEST_F(DownloadQueueTest, Cancel_QueuedJob_RemovedWithoutRunning) {
+    DownloadQueue queue(makeConfig(1));
+    GateSink     gate;
+    MemorySink   sink;
+    MockObserver observer;
+    queue.enqueue({"https://example.com/blocker", "", &gate});
+    ASSERT_TRUE(waitUntil([&] { return queue.getStats().running == 1; }));
+
+    const JobId id = queue.enqueue({"https://example.com/queued", "", &sink,
+                                    TransferPriority::NORMAL, &observer});
+    EXPECT_TRUE(queue.cancel(id));
+    EXPECT_TRUE(observer.isCancelled());
+    EXPECT_FALSE(queue.cancel(id));
+    gate.release();
+
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    const auto stats = queue.getStats();
+    EXPECT_EQ(stats.completed, 1u);
+    EXPECT_EQ(stats.cancelled, 1u);
+    EXPECT_EQ(observer.getProgressCallCount(), 0);
+    EXPECT_TRUE(sink.data().empty());
+}
+
+/// 実行中のジョブを取り消すとダウンロードがキャンセルされること
+TEST_F(DownloadQueueTest, Cancel_RunningJob_CancelsDownload) {
+    MockConfig mockConfig;
+    mockConfig.totalSize = 10 * 1024 * 1024; // 1 ms × 10240 チャンク
+    DownloadQueue queue(makeConfig(1, mockConfig));
+    MemorySink   sink;
+    MockObserver observer;
+    const JobId id = queue.enqueue({"https://example.com/large", "", &sink,
+                                    TransferPriority::NORMAL, &observer});
+    ASSERT_TRUE(observer.waitForProgress(1, 5s));
+
+    EXPECT_TRUE(queue.cancel(id));
+    ASSERT_TRUE(queue.waitForIdle(5s));
+    EXPECT_TRUE(observer.isCancelled());
+    const auto finished = results();
+    ASSERT_EQ(finished.size(), 1u);
+    EXPECT_EQ(finished[0].state, DownloadState::CANCELLED);
+    EXPECT_EQ(queue.getStats().cancelled, 1u);
+}
+
+/// 破棄すると実行待ち・実行中のジョブがすべて取り消されること
+TEST_F(DownloadQueueTest, Destructor_CancelsAllJobs) {
+    MockConfig mockConfig;
+    mockConfig.totalSize = 10 * 1024 * 1024;
+    std::vector<std::unique_ptr<MemorySink>> sinks;
+    const auto begin = std::chrono::steady_clock::now();
+    {
+        DownloadQueue queue(makeConfig(2, mockConfig));
+        for (int i = 0; i < 6; ++i) {
+            sinks.push_back(std::make_unique<MemorySink>());
+            queue.enqueue({"https://example.com/" + std::to_string(i), "", sinks.back().get()});
+        }
+        ASSERT_TRUE(waitUntil([&] { return queue.getStats().running == 2; }));
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, 5s);
+
+    const auto finished = results();
+    ASSERT_EQ(finished.size(), 6u);
+    for (const auto& result : finished) {
+        EXPECT_EQ(result.state, DownloadState::CANCELLED);
+    }
+}
@@ -0,0 +1,179 @@
+// =============================================================================
+// DownloadSinksTest.cpp
+// IDownloadSink 標準実装（MemorySink / PooledMemorySink / CallbackSink / StreamSink）の
+// GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - Downloader を介さず、open → write → close の呼び出し順で直接検証する
+// =============================================================================
+
+#include "DownloadSinks.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+
+namespace {
+
+std::span<const char> bytes(const std::string& text) {
+    return {text.data(), text.size()};
+}
+
+std::string toString(std::span<const char> data) {
+    return {data.begin(), data.end()};
+}
+
+} // namespace
+
+// =============================================================================
+// MemorySink
+// =============================================================================
+
+/// サイズ不明のダウンロードは末尾へ追記されていくこと
+TEST(MemorySinkTest, UnknownSize_AppendsSequentially) {
+    MemorySink sink;
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_TRUE(sink.write(0, bytes("hello ")));
+    EXPECT_TRUE(sink.write(6, bytes("world")));
+    ASSERT_TRUE(sink.close());
+    EXPECT_EQ(toString(sink.data()), "hello world");
+}
+
+/// サイズが分かっていれば事前確保され、順不同の区間書き込みで埋まること
+TEST(MemorySinkTest, KnownSize_AcceptsOutOfOrderRanges) {
+    MemorySink sink;
+    EXPECT_TRUE(sink.supportsRandomAccess());
+    ASSERT_TRUE(sink.open(10));
+    EXPECT_EQ(sink.data().size(), 10u);
+
+    EXPECT_TRUE(sink.write(5, bytes("56789")));
+    EXPECT_TRUE(sink.write(0, bytes("01234")));
+    EXPECT_EQ(toString(sink.data()), "0123456789");
+}
+
+/// take() で取り出したバッファを recycle() で戻すと容量が再利用されること
+TEST(MemorySinkTest, Recycle_KeepsCapacityForNextDownload) {
+    MemorySink sink;
+    ASSERT_TRUE(sink.open(4096));
+    std::vector<char> result = sink.take();
+    EXPECT_EQ(result.size(), 4096u);
+    EXPECT_TRUE(sink.data().empty());
+
+    const char* storage = result.data();
+    sink.recycle(std::move(result));
+    ASSERT_TRUE(sink.open(1024));
+    EXPECT_EQ(sink.data().data(), storage);
+    EXPECT_EQ(sink.data().size(), 1024u);
+}
+
+/// 2 回目のダウンロードでは前回の内容が残らないこと
+TEST(MemorySinkTest, Open_DiscardsPreviousContent) {
+    MemorySink sink(std::vector<char>{'x', 'y', 'z'});
+    EXPECT_TRUE(sink.data().empty());
+
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_TRUE(sink.write(0, bytes("abc")));
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_TRUE(sink.write(0, bytes("d")));
+    EXPECT_EQ(toString(sink.data()), "d");
+}
+
+// =============================================================================
+// PooledMemorySink
+// =============================================================================
+
+/// スラブの境界をまたぐ順不同の書き込みが、連続した内容として読み出せること
+TEST(PooledMemorySinkTest, WritesAcrossSlabs_AreReadBackInOrder) {
+    BufferPool       pool({.slabSize = 4});
+    PooledMemorySink sink(pool);
+    EXPECT_TRUE(sink.supportsRandomAccess());
+    ASSERT_TRUE(sink.open(10));
+
+    EXPECT_TRUE(sink.write(6, bytes("6789")));
+    EXPECT_TRUE(sink.write(0, bytes("012345")));
+    ASSERT_TRUE(sink.close());
+
+    EXPECT_EQ(sink.size(), 10u);
+    const auto chunks = sink.chunks();
+    ASSERT_EQ(chunks.size(), 3u);
+    EXPECT_EQ(toString(chunks[2]), "89");
+
+    std::string copy(10, '\0');
+    EXPECT_EQ(sink.copyTo({copy.data(), copy.size()}), 10u);
+    EXPECT_EQ(copy, "0123456789");
+}
+
+/// プールの上限を超える書き込みは失敗し、clear() でスラブが返ること
+TEST(PooledMemorySinkTest, Ceiling_FailsWrite_AndClearReturnsSlabs) {
+    BufferPool       pool({.slabSize = 4, .maxBytes = 8});
+    PooledMemorySink sink(pool);
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_TRUE(sink.write(0, bytes("01234567")));
+    EXPECT_FALSE(sink.write(8, bytes("8")));
+    EXPECT_EQ(pool.inUseBytes(), 8u);
+
+    sink.clear();
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+    EXPECT_EQ(sink.size(), 0u);
+}
+
+// =============================================================================
+// CallbackSink
+// =============================================================================
+
+/// open / write / close がそれぞれのコールバックへ渡ること
+TEST(CallbackSinkTest, ForwardsEachCall) {
+    int64_t     expected = 0;
+    std::string received;
+    bool        closed   = false;
+
+    CallbackSink sink(
+        [&](std::span<const char> data) { received += toString(data); return true; },
+        [&](int64_t size) { expected = size; return true; },
+        [&] { closed = true; return true; });
+
+    EXPECT_FALSE(sink.supportsRandomAccess());
+    ASSERT_TRUE(sink.open(7));
+    EXPECT_TRUE(sink.write(0, bytes("abc")));
+    EXPECT_TRUE(sink.write(3, bytes("defg")));
+    ASSERT_TRUE(sink.close());
+
+    EXPECT_EQ(expected, 7);
+    EXPECT_EQ(received, "abcdefg");
+    EXPECT_TRUE(closed);
+}
+
+/// コールバックが false を返した場合は write も false になること
+TEST(CallbackSinkTest, RejectingCallback_FailsWrite) {
+    CallbackSink sink([](std::span<const char>) { return false; });
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_FALSE(sink.write(0, bytes("abc")));
+    EXPECT_TRUE(sink.close());
+}
+
+// =============================================================================
+// StreamSink
+// =============================================================================
+
+/// ostream へ順に書き込まれること
+TEST(StreamSinkTest, WritesToStream) {
+    std::ostringstream out;
+    StreamSink sink(out);
+    ASSERT_TRUE(sink.open(-1));
+    EXPECT_TRUE(sink.write(0, bytes("line1\n")));
+    EXPECT_TRUE(sink.write(6, bytes("line2\n")));
+    ASSERT_TRUE(sink.close());
+    EXPECT_EQ(out.str(), "line1\nline2\n");
+}
+
+/// 書き込めないストリームは open で拒否されること
+TEST(StreamSinkTest, BadStream_RejectsOpen) {
+    std::ostringstream out;
+    out.setstate(std::ios::badbit);
+    StreamSink sink(out);
+    EXPECT_FALSE(sink.open(-1));
+}
@@ -9,14 +9,29 @@
 //  - スレッドリークを防ぐため Downloader のデストラクタを確実に呼ぶ
 // =============================================================================
 
+#include "BufferPool.h"
+#include "ContentDecoder.h"
 #include "Downloader.h"
+#include "DownloadMetrics.h"
+#include "DownloadSinks.h"
 #include "MockCurlHandle.h"
 #include "MockObserver.h"
+#include "PeerServer.h"
+#include "PeerTracker.h"
+#include "ResumeJournal.h"
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <coroutine>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <iterator>
 #include <string>
 #include <thread>
 #include <chrono>
@@ -36,26 +51,56 @@ protected:
         tempOutputPath_ = fs::temp_directory_path() / "downloader_test_output.bin";
         // 前回のテストファイルを削除
         fs::remove(tempOutputPath_);
+        fs::remove(journalPath());
     }
 
     void TearDown() override {
         // テスト後のファイルを削除
         fs::remove(tempOutputPath_);
+        fs::remove(journalPath());
+    }
+
+    /// @brief 出力ファイルに対応する再開用ジャーナルのパス
+    std::string journalPath() const {
+        return ResumeJournal::pathFor(tempOutputPath_.string());
     }
 
     /// @brief MockCurlHandle を使う Downloader を生成するヘルパー
     /// @param mockConfig モックの動作設定
-    std::unique_ptr<Downloader> makeDownloader(MockConfig mockConfig = {}) {
+    std::unique_ptr<Downloader::Downloader> makeDownloader(MockConfig mockConfig = {}) {
         DownloaderConfig config;
         config.chunkSize = 1024;
 
-        return std::make_unique<Downloader>(
+        return std::make_unique<Downloader::Downloader>(
+            config,
+            [mockConfig]() -> std::unique_ptr<ICurlHandle> {
+                return std::make_unique<MockCurlHandle>(mockConfig);
+            });
+    }
+
+    /// @brief 設定を指定して MockCurlHandle を使う Downloader を生成するヘルパー
+    std::unique_ptr<Downloader::Downloader> makeDownloader(MockConfig mockConfig,
+                                                           DownloaderConfig config) {
+        return std::make_unique<Downloader::Downloader>(
             config,
             [mockConfig]() -> std::unique_ptr<ICurlHandle> {
                 return std::make_unique<MockCurlHandle>(mockConfig);
             });
     }
 
+    /// @brief 内容がモックのパターンデータと一致するか検証する
+    static void expectPattern(const std::vector<char>& content, size_t size) {
+        ASSERT_EQ(content.size(), size);
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+        }
+    }
+
+    static std::vector<char> readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
     fs::path tempOutputPath_;
 };
 
@@ -74,6 +119,8 @@ TEST_F(DownloaderTest, StartDownload_ReturnsTrue) {
         tempOutputPath_.string());
 
     EXPECT_TRUE(started);
+    // observer がダウンローダーより先に破棄されないよう完了を待つ
+    observer.waitForFinish();
 }
 
 /// 初期状態が IDLE であること
@@ -170,6 +217,59 @@ TEST_F(DownloaderTest, Progress_Reaches100Percent_OnCompletion) {
     EXPECT_DOUBLE_EQ(last.percent, 100.0);
 }
 
+/// 受信量が変わらない進捗は通知されず、増分が progressMinBytes 未満なら間引かれること
+TEST_F(DownloaderTest, Progress_MinBytes_ThrottlesNotifications) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.progressMinBytes = 8 * 1024;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted());
+
+    // 最後の 1 件は完了時の 100% 通知（間引きの対象外）
+    const auto records = observer.getProgressRecords();
+    ASSERT_GE(records.size(), 2u);
+    EXPECT_LE(records.size(), 64u / 8u + 2u);
+    for (size_t i = 1; i + 1 < records.size(); ++i) {
+        EXPECT_GE(records[i].downloadedBytes - records[i - 1].downloadedBytes, 8 * 1024)
+            << "record " << i;
+    }
+    EXPECT_DOUBLE_EQ(records.back().percent, 100.0);
+}
+
+/// progressIntervalMs より短い間隔では進捗が通知されないこと
+TEST_F(DownloaderTest, Progress_Interval_ThrottlesNotifications) {
+    MockConfig cfg;
+    cfg.totalSize  = 100 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    DownloaderConfig config;
+    config.progressIntervalMs = 50;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const auto begin = std::chrono::steady_clock::now();
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+    EXPECT_TRUE(observer.isCompleted());
+
+    // 通知は 50ms に 1 回まで（最初の通知と完了時の 100% 通知を除く）
+    EXPECT_LE(observer.getProgressCallCount(), elapsedMs / 50 + 2);
+    EXPECT_DOUBLE_EQ(observer.getLastProgress().percent, 100.0);
+}
+
 /// =============================================================================
 /// pause / resume テスト
 /// =============================================================================
@@ -227,6 +327,100 @@ TEST_F(DownloaderTest, Resume_WhenIdle_IsNoop) {
     EXPECT_EQ(downloader->getState(), DownloadState::IDLE);
 }
 
+/// 長い一時停止では接続を切断し、再開時に続きから取り直すこと
+TEST_F(DownloaderTest, LongPause_ReleasesConnection_AndResumesWithRange) {
+    MockConfig cfg;
+    cfg.totalSize  = 50 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    std::atomic<int> performDone{0};
+    std::atomic<int> handleCount{0};
+    cfg.performDoneCounter = &performDone;
+
+    DownloaderConfig config;
+    config.pauseReleaseMs = 0; // 一時停止したら即座に切断する
+    Downloader::Downloader downloader(
+        config,
+        [cfg, &handleCount]() -> std::unique_ptr<ICurlHandle> {
+            ++handleCount;
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader.addObserver(&observer);
+
+    downloader.startDownload("http://example.com/large.bin",
+                             tempOutputPath_.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+
+    downloader.pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+
+    // 最初の転送が切断されて perform() から戻るまで待つ
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (performDone.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(performDone.load(), 1);
+    EXPECT_EQ(handleCount.load(), 1);
+
+    downloader.resume();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(observer.getPausedCallCount(), 1);
+    EXPECT_EQ(observer.getResumedCallCount(), 1);
+    EXPECT_EQ(handleCount.load(), 2);
+
+    // 続きの Range で取り直したデータが途切れなくつながっていること
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    const std::vector<char> content{std::istreambuf_iterator<char>(in),
+                                    std::istreambuf_iterator<char>()};
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// 切断後に Range 非対応のサーバから再開しようとするとエラーになること
+TEST_F(DownloaderTest, LongPause_ResumeWithoutRangeSupport_CallsOnError) {
+    MockConfig cfg;
+    cfg.totalSize     = 50 * 1024;
+    cfg.chunkDelay    = std::chrono::milliseconds(2);
+    cfg.supportsRange = false;
+
+    std::atomic<int> performDone{0};
+    cfg.performDoneCounter = &performDone;
+
+    DownloaderConfig config;
+    config.pauseReleaseMs = 0;
+    Downloader::Downloader downloader(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader.addObserver(&observer);
+
+    downloader.startDownload("http://example.com/large.bin",
+                             tempOutputPath_.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+    downloader.pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (performDone.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(performDone.load(), 1);
+
+    downloader.resume();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isError());
+    EXPECT_NE(observer.getLastError().find("resume"), std::string::npos)
+        << observer.getLastError();
+    EXPECT_EQ(observer.getCompletedCallCount(), 0);
+}
+
 /// =============================================================================
 /// cancel テスト
 /// =============================================================================
@@ -287,7 +481,7 @@ TEST_F(DownloaderTest, AfterCancel_CanRestartDownload) {
     cfg2.httpCode     = 200;
 
     // 2回目は完了するダウンローダー
-    auto downloader2 = std::make_unique<Downloader>(
+    auto downloader2 = std::make_unique<Downloader::Downloader>(
         DownloaderConfig{},
         [cfg2]() -> std::unique_ptr<ICurlHandle> {
             return std::make_unique<MockCurlHandle>(cfg2);
@@ -402,7 +596,7 @@ TEST_F(DownloaderTest, Resume_SetsRangeHeader_WhenFileExists) {
     mockCfg.chunkDelay  = std::chrono::milliseconds(0);
     mockCfg.httpCode    = 206; // Partial Content
 
-    auto downloader = std::make_unique<Downloader>(
+    auto downloader = std::make_unique<Downloader::Downloader>(
         config,
         [&, mockCfg]() -> std::unique_ptr<ICurlHandle> {
             auto mock = std::make_unique<MockCurlHandle>(mockCfg);
@@ -513,8 +707,9 @@ TEST_F(DownloaderTest, Destructor_SafelyStopsRunningDownload) {
 
     {
         // スコープを抜けるとデストラクタが呼ばれる
-        auto downloader = makeDownloader(cfg);
+        // observer はダウンローダーより後に破棄されるよう先に宣言する
         MockObserver observer;
+        auto downloader = makeDownloader(cfg);
         downloader->addObserver(&observer);
 
         downloader->startDownload("http://example.com/file.bin",
@@ -578,6 +773,132 @@ TEST_F(DownloaderTest, AddObserver_Duplicate_NotAddedTwice) {
     EXPECT_EQ(obs.getCompletedCallCount(), 1);
 }
 
+/// コールバック内で時間のかかるオブザーバー（スレッド ID を記録する）
+class SlowThreadObserver final : public IDownloaderObserver {
+public:
+    void onProgress(int64_t, int64_t, double) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        record();
+        progressCount_.fetch_add(1);
+    }
+    void onCompleted() override { record(); completed_.store(true); }
+    void onError(const std::string&) override { record(); }
+    void onPaused() override { record(); }
+    void onResumed() override { record(); }
+    void onCancelled() override { record(); }
+
+    std::vector<std::thread::id> threads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return threads_;
+    }
+    int  progressCount() const { return progressCount_.load(); }
+    bool completed() const { return completed_.load(); }
+
+private:
+    void record() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::this_thread::get_id());
+    }
+
+    std::mutex                   mutex_;
+    std::vector<std::thread::id> threads_;
+    std::atomic<int>             progressCount_{0};
+    std::atomic<bool>            completed_{false};
+};
+
+/// asyncObserverDispatch では 1 本のディスパッチスレッドから通知され、
+/// 遅いオブザーバーへの未配信の進捗通知はまとめられること
+TEST_F(DownloaderTest, AsyncObserverDispatch_CoalescesForSlowObserver) {
+    MockConfig cfg;
+    cfg.totalSize  = 100 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    DownloaderConfig config;
+    config.asyncObserverDispatch = true;
+    SlowThreadObserver slow;
+    {
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&slow);
+        downloader->addObserver(&observer);
+
+        downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(20)));
+        EXPECT_TRUE(observer.isCompleted());
+        EXPECT_DOUBLE_EQ(observer.getLastProgress().percent, 100.0);
+        downloader->removeObserver(&observer);
+    }
+
+    EXPECT_TRUE(slow.completed());
+    EXPECT_GT(slow.progressCount(), 0);
+    EXPECT_LT(slow.progressCount(), 50); // 100 回の受信が 20ms ごとの配信にまとまる
+    const auto threads = slow.threads();
+    ASSERT_FALSE(threads.empty());
+    for (const auto& id : threads) {
+        EXPECT_EQ(id, threads.front());
+    }
+    EXPECT_NE(threads.front(), std::this_thread::get_id());
+}
+
+/// removeObserver() から戻った後は、ダウンロード中でも通知されないこと
+TEST_F(DownloaderTest, RemoveObserver_DuringDownload_StopsCallbacks) {
+    MockConfig cfg;
+    cfg.totalSize  = 200 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    for (const bool async : {false, true}) {
+        fs::remove(tempOutputPath_); // 前回の出力からレジュームさせない
+        DownloaderConfig config;
+        config.asyncObserverDispatch = async;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver removed, remaining;
+        downloader->addObserver(&removed);
+        downloader->addObserver(&remaining);
+
+        downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+        ASSERT_TRUE(removed.waitForProgress(3, std::chrono::seconds(2)));
+        downloader->removeObserver(&removed);
+        const int count = removed.getProgressCallCount();
+
+        ASSERT_TRUE(remaining.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(remaining.isCompleted());
+        EXPECT_EQ(removed.getProgressCallCount(), count) << "async=" << async;
+        EXPECT_EQ(removed.getCompletedCallCount(), 0);
+        downloader->removeObserver(&remaining);
+    }
+}
+
+/// asyncObserverDispatch で遅いオブザーバーを外すと、配信中・配信待ちの通知が終わるまで待ち、
+/// 戻った後は通知されないこと
+TEST_F(DownloaderTest, RemoveObserver_AsyncSlowObserver_WaitsForPendingDeliveries) {
+    MockConfig cfg;
+    cfg.totalSize  = 200 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    DownloaderConfig config;
+    config.asyncObserverDispatch = true;
+    auto downloader = makeDownloader(cfg, config);
+    SlowThreadObserver slow;
+    MockObserver       observer;
+    downloader->addObserver(&slow);
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForProgress(3, std::chrono::seconds(2)));
+    downloader->removeObserver(&slow);
+    const int count = slow.progressCount();
+    EXPECT_GT(count, 0);
+
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted());
+    EXPECT_EQ(slow.progressCount(), count);
+    EXPECT_FALSE(slow.completed());
+    downloader->removeObserver(&observer);
+}
+
 /// =============================================================================
 /// getStats テスト
 /// =============================================================================
@@ -603,6 +924,2247 @@ TEST_F(DownloaderTest, GetStats_ReturnsCorrectInfo) {
     EXPECT_GE(stats.downloadedBytes, 0LL);
 }
 
+/// getProgress はダウンロード中も単調に進み、完了後は getStats と同じ値を返すこと
+TEST_F(DownloaderTest, GetProgress_MatchesStats) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(1);
+
+    auto downloader = makeDownloader(cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    EXPECT_EQ(downloader->getProgress().state, DownloadState::IDLE);
+
+    downloader->startDownload("http://example.com/progress.bin", tempOutputPath_.string());
+    int64_t previous = 0;
+    for (int i = 0; i < 5000 && !observer.waitForFinish(std::chrono::milliseconds(1)); ++i) {
+        const DownloadProgress progress = downloader->getProgress();
+        EXPECT_GE(progress.downloadedBytes, previous);
+        EXPECT_LE(progress.downloadedBytes, cfg.totalSize);
+        previous = progress.downloadedBytes;
+    }
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const DownloadProgress progress = downloader->getProgress();
+    const DownloadStats    stats    = downloader->getStats();
+    EXPECT_EQ(progress.state, DownloadState::COMPLETED);
+    EXPECT_EQ(progress.downloadedBytes, stats.downloadedBytes);
+    EXPECT_EQ(progress.totalBytes, cfg.totalSize);
+    EXPECT_DOUBLE_EQ(progress.percent, stats.percent);
+    EXPECT_EQ(progress.retryCount, 0);
+}
+
+/// =============================================================================
+/// セグメント分割ダウンロードテスト
+/// =============================================================================
+
+/// ファイル全体を端数込みで隙間なく分割すること
+TEST(PlanSegmentsTest, SplitsWholeFileWithoutGaps) {
+    auto segments = planSegments(10 * 1024 + 3, 4, 1024);
+
+    ASSERT_EQ(segments.size(), 4u);
+    EXPECT_EQ(segments.front().first, 0);
+    EXPECT_EQ(segments.back().last, 10 * 1024 + 2);
+    for (size_t i = 1; i < segments.size(); ++i) {
+        EXPECT_EQ(segments[i].first, segments[i - 1].last + 1);
+    }
+}
+
+/// 最小セグメントサイズを下回る分割はしないこと
+TEST(PlanSegmentsTest, RespectsMinSegmentSize) {
+    EXPECT_EQ(planSegments(3 * 1024, 8, 1024).size(), 3u);
+    EXPECT_EQ(planSegments(512, 8, 1024).size(), 1u);
+    EXPECT_TRUE(planSegments(0, 8, 1024).empty());
+}
+
+/// 各セグメントが正しいオフセットに書き込まれること
+TEST_F(DownloaderTest, Segmented_WritesSegmentsAtTheirOffsets) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 1000;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+
+    std::atomic<int> handleCount{0};
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg, &handleCount]() -> std::unique_ptr<ICurlHandle> {
+            ++handleCount;
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    // HEAD 1 回 + セグメント 4 本
+    EXPECT_EQ(handleCount.load(), 5);
+    EXPECT_DOUBLE_EQ(observer.getLastProgress().percent, 100.0);
+
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// Range 非対応サーバでは単一ストリームにフォールバックすること
+TEST_F(DownloaderTest, Segmented_FallsBackToSingleStream_WhenRangeUnsupported) {
+    MockConfig cfg;
+    cfg.totalSize     = 16 * 1024;
+    cfg.chunkDelay    = std::chrono::milliseconds(0);
+    cfg.supportsRange = false;
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+
+    std::atomic<int> handleCount{0};
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg, &handleCount]() -> std::unique_ptr<ICurlHandle> {
+            ++handleCount;
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/norange.bin",
+                              tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+
+    EXPECT_TRUE(observer.isCompleted());
+    // HEAD 1 回 + 通常ダウンロード 1 回
+    EXPECT_EQ(handleCount.load(), 2);
+    EXPECT_EQ(fs::file_size(tempOutputPath_), cfg.totalSize);
+}
+
+/// 書き込みバッファ（2 面バッファ）経由でもセグメントが正しい位置に書かれること
+TEST_F(DownloaderTest, Segmented_DoubleBufferedWrites_ProduceSameFile) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount       = 3;
+    config.minSegmentSize     = 1024;
+    config.writeBufferSize    = 4096;
+    config.doubleBufferWrites = true;
+
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// 非同期書き込みで上限に達しても、全セグメントが欠けなく書かれること
+TEST_F(DownloaderTest, Segmented_AsyncDiskWrites_WaitForQueueSpace) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount    = 3;
+    config.minSegmentSize  = 1024;
+    config.writeBufferSize = 2048;
+    config.asyncDiskWrites = true;
+    config.diskQueueLimit  = 4096;
+
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// 上限の小さなプールを共有しても、全セグメントが欠けなく書かれてスラブがすべて返ること
+TEST_F(DownloaderTest, Segmented_AsyncDiskWrites_WithBufferPoolCeiling) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    // セグメント数より少ないスラブしかない（まとめ書きは直接書き出しに、キューは返却待ちになる）
+    BufferPool pool({.slabSize = 2048, .maxBytes = 2 * 2048});
+    DownloaderConfig config;
+    config.segmentCount    = 3;
+    config.minSegmentSize  = 1024;
+    config.writeBufferSize = 2048;
+    config.asyncDiskWrites = true;
+    config.bufferPool      = &pool;
+
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_LE(pool.allocatedBytes(), pool.maxBytes());
+    EXPECT_EQ(pool.inUseBytes(), 0u);
+
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    ASSERT_EQ(content.size(), cfg.totalSize);
+    for (size_t i = 0; i < content.size(); ++i) {
+        ASSERT_EQ(content[i], MockCurlHandle::patternByte(i)) << "offset " << i;
+    }
+}
+
+/// セグメント取得中の pause / resume で通知が 1 回ずつ出ること
+TEST_F(DownloaderTest, Segmented_PauseResume_NotifiesOnce) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+
+    downloader->pause();
+    ASSERT_TRUE(observer.waitForPaused(std::chrono::seconds(5)));
+    // 全セグメントが待機に入るまで少し待つ
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    downloader->resume();
+
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted());
+    EXPECT_EQ(observer.getPausedCallCount(), 1);
+    EXPECT_EQ(observer.getResumedCallCount(), 1);
+    EXPECT_EQ(fs::file_size(tempOutputPath_), cfg.totalSize);
+}
+
+/// セグメント取得中の cancel で全セグメントが停止すること
+TEST_F(DownloaderTest, Segmented_Cancel_StopsAllSegments) {
+    MockConfig cfg;
+    cfg.totalSize  = 256 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config,
+        [cfg]() -> std::unique_ptr<ICurlHandle> {
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/segmented.bin",
+                              tempOutputPath_.string());
+    observer.waitForProgress(3, std::chrono::seconds(2));
+    downloader->cancel();
+
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCancelled());
+    EXPECT_EQ(observer.getCompletedCallCount(), 0);
+}
+
+/// ジャーナルなしのセグメント取得をキャンセルすると出力を消し、次回は最初から取り直すこと
+/// （最終サイズの穴のあるファイルが残ると、サイズから末尾以降を要求して 416 になる）
+TEST_F(DownloaderTest, Segmented_CancelThenRestart_DownloadsWholeFile) {
+    MockConfig cfg;
+    cfg.totalSize  = 256 * 1024;
+    cfg.chunkSize  = 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+    auto downloader = makeDownloader(cfg, config);
+
+    {
+        MockObserver observer;
+        downloader->addObserver(&observer);
+        ASSERT_TRUE(downloader->startDownload("http://example.com/segmented.bin",
+                                              tempOutputPath_.string()));
+        observer.waitForProgress(3, std::chrono::seconds(2));
+        downloader->cancel();
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        EXPECT_TRUE(observer.isCancelled());
+        downloader->removeObserver(&observer);
+    }
+    EXPECT_FALSE(fs::exists(tempOutputPath_));
+
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    ASSERT_TRUE(downloader->startDownload("http://example.com/segmented.bin",
+                                          tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    downloader->removeObserver(&observer);
+}
+
+// =============================================================================
+// 出力先テスト（mmap 出力・メモリ領域への直接書き込み・シンク）
+// =============================================================================
+
+/// mmap 出力では Content-Length のサイズでファイルが作られ、内容が一致すること
+TEST_F(DownloaderTest, MemoryMappedOutput_SingleStream_WritesFile) {
+    MockConfig cfg;
+    cfg.totalSize  = 40 * 1024 + 3;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.memoryMappedOutput = true;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// mmap 出力のセグメント取得で各オフセットに書き込まれること
+TEST_F(DownloaderTest, MemoryMappedOutput_Segmented_WritesEachOffset) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount       = 4;
+    config.minSegmentSize     = 1024;
+    config.memoryMappedOutput = true;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// direct I/O・ページキャッシュの破棄・定期的な書き出しでもセグメントの内容が一致すること
+TEST_F(DownloaderTest, FileOutput_DirectIoAndPeriodicSync_WritesEachOffset) {
+    MockConfig cfg;
+    cfg.totalSize  = 96 * 1024 + 11;
+    cfg.chunkSize  = 3000;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount     = 3;
+    config.minSegmentSize   = 1024;
+    config.writeBufferSize  = 16 * 1024;
+    config.directIo         = true;
+    config.dropWrittenPages = true;
+    config.fileSync         = FileSyncPolicy::PERIODIC;
+    config.fileSyncInterval = 20 * 1024;
+    auto downloader = makeDownloader(cfg, config);
+
+    const DownloadResult result =
+        downloader->fetchAsync("http://example.com/file.bin", tempOutputPath_.string()).get();
+    ASSERT_TRUE(result.ok()) << result.error;
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// atomicOutput では一時ファイルに書き込み、完了時だけ出力を置き換えること
+TEST_F(DownloaderTest, AtomicOutput_ReplacesOnlyOnCompletion) {
+    const fs::path part = tempOutputPath_.string() + ".part";
+    fs::remove(part);
+    std::ofstream(tempOutputPath_, std::ios::binary) << "previous";
+
+    DownloaderConfig config;
+    config.atomicOutput = true;
+    config.fileSync     = FileSyncPolicy::AT_END;
+
+    // 失敗した場合は既存の出力を残し、受信済みの部分は一時ファイルに残す
+    MockConfig failing;
+    failing.totalSize      = 16 * 1024;
+    failing.chunkDelay     = std::chrono::milliseconds(0);
+    failing.failAfterBytes = 4 * 1024;
+    auto broken = makeDownloader(failing, config);
+    const DownloadResult failed =
+        broken->fetchAsync("http://example.com/file.bin", tempOutputPath_.string()).get();
+    EXPECT_FALSE(failed.ok());
+    EXPECT_EQ(readFile(tempOutputPath_), std::vector<char>({'p', 'r', 'e', 'v', 'i', 'o', 'u', 's'}));
+    EXPECT_TRUE(fs::exists(part));
+
+    // 完了したら一時ファイルの続きから受信して出力を置き換える
+    MockConfig cfg;
+    cfg.totalSize  = 16 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    auto downloader = makeDownloader(cfg, config);
+    const DownloadResult result =
+        downloader->fetchAsync("http://example.com/file.bin", tempOutputPath_.string()).get();
+    ASSERT_TRUE(result.ok()) << result.error;
+    EXPECT_EQ(result.stats.outputPath, tempOutputPath_.string());
+    EXPECT_FALSE(fs::exists(part));
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// 呼び出し側のメモリ領域へダウンロードでき、ファイルは作られないこと
+TEST_F(DownloaderTest, MemoryDestination_SingleStream_CopiesIntoSpan) {
+    MockConfig cfg;
+    cfg.totalSize  = 20 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    auto downloader = makeDownloader(cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::vector<char> buffer(32 * 1024, '\0');
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin",
+                                          std::span<char>(buffer)));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.downloadedBytes, static_cast<int64_t>(cfg.totalSize));
+    buffer.resize(static_cast<size_t>(stats.downloadedBytes));
+    expectPattern(buffer, cfg.totalSize);
+    EXPECT_TRUE(stats.outputPath.empty());
+    EXPECT_FALSE(fs::exists(tempOutputPath_));
+}
+
+/// セグメント取得でもメモリ領域の各オフセットへ書き込まれること
+TEST_F(DownloaderTest, MemoryDestination_Segmented_WritesEachOffset) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 100;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount   = 3;
+    config.minSegmentSize = 1024;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::vector<char> buffer(cfg.totalSize, '\0');
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin",
+                                          std::span<char>(buffer)));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(buffer, cfg.totalSize);
+}
+
+/// メモリ領域が足りない場合は onError が呼ばれ、領域外に書き込まないこと
+TEST_F(DownloaderTest, MemoryDestination_TooSmall_CallsOnError) {
+    MockConfig cfg;
+    cfg.totalSize  = 8 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    for (const size_t segments : {size_t{1}, size_t{2}}) {
+        DownloaderConfig config;
+        config.segmentCount   = segments;
+        config.minSegmentSize = 1024;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        // 末尾の番兵が書き換えられないことを確認する
+        std::vector<char> buffer(4 * 1024 + 1, '\x7f');
+        ASSERT_TRUE(downloader->startDownload(
+            "http://example.com/file.bin",
+            std::span<char>(buffer.data(), buffer.size() - 1)));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isError());
+        EXPECT_THAT(observer.getLastError(), ::testing::HasSubstr("too small"));
+        EXPECT_EQ(buffer.back(), '\x7f');
+    }
+}
+
+/// MemorySink へダウンロードでき、ファイルは作られないこと（単一・セグメント）
+TEST_F(DownloaderTest, MemorySink_ReceivesWholeDownload) {
+    MockConfig cfg;
+    cfg.totalSize  = 48 * 1024 + 5;
+    cfg.chunkSize  = 700;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    for (const size_t segments : {size_t{1}, size_t{4}}) {
+        DownloaderConfig config;
+        config.segmentCount   = segments;
+        config.minSegmentSize = 1024;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        MemorySink sink;
+        ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin", sink));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+        expectPattern(sink.take(), cfg.totalSize);
+        EXPECT_FALSE(fs::exists(tempOutputPath_));
+    }
+}
+
+/// 任意位置へ書き込めないシンクは分割されず、先頭から順に 1 回ずつ呼ばれること
+TEST_F(DownloaderTest, CallbackSink_NotSegmented_ReceivesInOrder) {
+    MockConfig cfg;
+    cfg.totalSize  = 32 * 1024 + 17;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 1024;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::vector<char> received;
+    int64_t           expectedSize = 0;
+    int               opens  = 0;
+    int               closes = 0;
+    CallbackSink sink(
+        [&](std::span<const char> data) {
+            received.insert(received.end(), data.begin(), data.end());
+            return true;
+        },
+        [&](int64_t size) { expectedSize = size; ++opens; return true; },
+        [&] { ++closes; return true; });
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin", sink));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(received, cfg.totalSize);
+    EXPECT_EQ(expectedSize, static_cast<int64_t>(cfg.totalSize));
+    EXPECT_EQ(opens, 1);
+    EXPECT_EQ(closes, 1);
+}
+
+/// シンクが書き込みを拒否した場合は onError が呼ばれ、close も呼ばれること
+TEST_F(DownloaderTest, Sink_RejectsWrite_CallsOnError) {
+    MockConfig cfg;
+    cfg.totalSize  = 16 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    auto downloader = makeDownloader(cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    int          closes = 0;
+    CallbackSink sink([](std::span<const char>) { return false; }, nullptr,
+                      [&] { ++closes; return true; });
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin", sink));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isError());
+    EXPECT_THAT(observer.getLastError(), ::testing::HasSubstr("sink"));
+    EXPECT_EQ(closes, 1);
+}
+
+/// シンクの close() が失敗した場合は完了ではなくエラーになること
+TEST_F(DownloaderTest, Sink_CloseFails_CallsOnError) {
+    MockConfig cfg;
+    cfg.totalSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    auto downloader = makeDownloader(cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    CallbackSink sink([](std::span<const char>) { return true; }, nullptr,
+                      [] { return false; });
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin", sink));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(observer.isError());
+    EXPECT_FALSE(observer.isCompleted());
+}
+
+/// 有効な区間がない区間の読み出しは開始せず、オブジェクト全体のダウンロードにもならないこと
+TEST_F(DownloaderTest, RangeDownload_NoValidRange_ReturnsFalse) {
+    RequestLog log;
+    MockConfig cfg;
+    cfg.totalSize  = 16 * 1024;
+    cfg.requestLog = &log;
+    auto downloader = makeDownloader(cfg);
+
+    const std::string url = "http://example.com/file.bin";
+    EXPECT_FALSE(downloader->startRangeDownload(url, {}, tempOutputPath_.string()));
+    EXPECT_FALSE(downloader->startRangeDownload(url, {{-1, 10}, {20, 5}}, tempOutputPath_.string()));
+
+    MemorySink sink;
+    EXPECT_FALSE(downloader->startRangeDownload(url, {}, sink));
+    EXPECT_FALSE(downloader->startRangeDownload(url, {{100, 99}}, sink));
+
+    EXPECT_EQ(downloader->getState(), DownloadState::IDLE);
+    EXPECT_TRUE(log.snapshot().empty());
+    EXPECT_FALSE(fs::exists(tempOutputPath_));
+    EXPECT_TRUE(sink.data().empty());
+}
+
+// =============================================================================
+// 帯域制限テスト
+// =============================================================================
+
+/// maxBytesPerSec を超える速度では受信せず、内容は正しいこと（単一・セグメント）
+TEST_F(DownloaderTest, MaxBytesPerSec_PacesDownload) {
+    MockConfig cfg;
+    cfg.totalSize  = 96 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    BandwidthScheduler scheduler;
+    for (const size_t segments : {size_t{1}, size_t{3}}) {
+        fs::remove(tempOutputPath_);
+        DownloaderConfig config;
+        config.segmentCount       = segments;
+        config.minSegmentSize     = 1024;
+        config.maxBytesPerSec     = 128 * 1024;
+        config.bandwidthScheduler = &scheduler;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        // 満タンのバケット (16 KiB) を除く 80 KiB に 0.625 秒かかる
+        const auto begin = std::chrono::steady_clock::now();
+        downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(550))
+            << "segments=" << segments;
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+        expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    }
+}
+
+/// 実行中に上限を外すと、転送をやり直さずにすぐ速度が戻ること
+TEST_F(DownloaderTest, SetMaxBytesPerSec_WhileRunning_TakesEffect) {
+    MockConfig cfg;
+    cfg.totalSize  = 512 * 1024; // 16 KiB/s では 30 秒以上かかる
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    BandwidthScheduler scheduler;
+    DownloaderConfig config;
+    config.maxBytesPerSec     = 16 * 1024;
+    config.bandwidthScheduler = &scheduler;
+    std::atomic<int> performs{0};
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config, [cfg, &performs]() -> std::unique_ptr<ICurlHandle> {
+            performs.fetch_add(1);
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForProgress(3, std::chrono::seconds(2)));
+    EXPECT_FALSE(observer.waitForFinish(std::chrono::milliseconds(200)));
+
+    downloader->setMaxBytesPerSec(0);
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(performs.load(), 1);
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// 帯域待ちの間も cancel() できること
+TEST_F(DownloaderTest, Cancel_WhileWaitingForBandwidth_NotifiesCancelled) {
+    MockConfig cfg;
+    cfg.totalSize  = 256 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    BandwidthScheduler scheduler;
+    scheduler.setGlobalLimit(8 * 1024);
+    DownloaderConfig config;
+    config.bandwidthScheduler = &scheduler;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForProgress(2, std::chrono::seconds(2)));
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(2)));
+    EXPECT_TRUE(observer.isCancelled());
+}
+
+// =============================================================================
+// 再開用ジャーナルテスト
+// =============================================================================
+
+namespace {
+
+/// 再開用ジャーナルを使う設定
+DownloaderConfig journalConfig(size_t segments = 1) {
+    DownloaderConfig config;
+    config.resumeJournal    = true;
+    config.journalChunkSize = 16 * 1024;
+    config.segmentCount     = segments;
+    config.minSegmentSize   = 1024;
+    return config;
+}
+
+/// offset から size バイトの、モックのパターンデータ
+std::string patternOf(size_t offset, size_t size) {
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = MockCurlHandle::patternByte(offset + i);
+    }
+    return data;
+}
+
+} // namespace
+
+/// 完了するとジャーナルは削除されること
+TEST_F(DownloaderTest, Journal_Completed_RemovesJournal) {
+    MockConfig cfg;
+    cfg.totalSize = 64 * 1024;
+    cfg.etag      = "\"v1\"";
+    auto downloader = makeDownloader(cfg, journalConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_FALSE(fs::exists(journalPath()));
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// 中断したダウンロードは、ジャーナルに記録された区間を除いて取り直すこと（単一・セグメント）
+TEST_F(DownloaderTest, Journal_Interrupted_ResumesOnlyMissingRanges) {
+    MockConfig cfg;
+    cfg.totalSize  = 1024 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+    cfg.etag       = "\"v1\"";
+
+    for (const size_t segments : {size_t{1}, size_t{3}}) {
+        fs::remove(tempOutputPath_);
+        fs::remove(journalPath());
+        {
+            auto downloader = makeDownloader(cfg, journalConfig(segments));
+            MockObserver observer;
+            downloader->addObserver(&observer);
+            downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+            ASSERT_TRUE(observer.waitForProgress(10, std::chrono::seconds(5)));
+            downloader->cancel();
+            ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+            ASSERT_TRUE(observer.isCancelled()) << "segments=" << segments;
+        }
+
+        ResumeJournal journal;
+        ASSERT_TRUE(journal.load(journalPath())) << "segments=" << segments;
+        ASSERT_FALSE(journal.ranges().empty());
+        int64_t recorded = 0;
+        for (const auto& range : journal.ranges()) {
+            recorded += range.size();
+        }
+
+        auto downloader = makeDownloader(cfg, journalConfig(segments));
+        MockObserver observer;
+        downloader->addObserver(&observer);
+        downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+        EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+        ASSERT_FALSE(observer.getProgressRecords().empty());
+        EXPECT_GE(observer.getProgressRecords().front().downloadedBytes, recorded)
+            << "segments=" << segments;
+        EXPECT_FALSE(fs::exists(journalPath()));
+        expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    }
+}
+
+/// チェックサムが一致しない区間（書き込み途中で落ちた部分）は取り直すこと
+TEST_F(DownloaderTest, Journal_CorruptedRange_IsRefetched) {
+    MockConfig cfg;
+    cfg.totalSize  = 128 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    cfg.etag       = "\"v1\"";
+
+    // 前半 64 KiB を 16 KiB ずつ記録し、2 つ目の区間の内容を壊しておく
+    const size_t half = cfg.totalSize / 2;
+    std::string  data = patternOf(0, half);
+    data[20 * 1024] ^= 0x5a;
+    {
+        std::ofstream out(tempOutputPath_, std::ios::binary);
+        out << data;
+    }
+    ResumeJournal journal;
+    std::vector<JournalRange> ranges;
+    for (size_t first = 0; first < half; first += 16 * 1024) {
+        const std::string expected = patternOf(first, 16 * 1024);
+        ranges.push_back({static_cast<int64_t>(first),
+                          static_cast<int64_t>(first + 16 * 1024 - 1),
+                          crc32Update(0, expected.data(), expected.size())});
+    }
+    ASSERT_TRUE(journal.create(journalPath(),
+                               {static_cast<int64_t>(cfg.totalSize), cfg.etag, ""}, ranges));
+
+    auto downloader = makeDownloader(cfg, journalConfig(2));
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    // 壊れた 16 KiB と後半だけを取り直す
+    ASSERT_FALSE(observer.getProgressRecords().empty());
+    EXPECT_GE(observer.getProgressRecords().front().downloadedBytes,
+              static_cast<int64_t>(half - 16 * 1024));
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// ETag が変わっていれば If-Range が一致せず、最初から取り直すこと
+TEST_F(DownloaderTest, Journal_ValidatorChanged_RestartsFromScratch) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    cfg.etag       = "\"v2\"";
+
+    // 古い版の内容（ゼロ）として前半を記録しておく
+    const std::string stale(cfg.totalSize / 2, '\0');
+    {
+        std::ofstream out(tempOutputPath_, std::ios::binary);
+        out << stale;
+    }
+    ResumeJournal journal;
+    ASSERT_TRUE(journal.create(
+        journalPath(), {static_cast<int64_t>(cfg.totalSize), "\"v1\"", ""},
+        {{0, static_cast<int64_t>(stale.size()) - 1, crc32Update(0, stale.data(), stale.size())}}));
+
+    auto downloader = makeDownloader(cfg, journalConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_FALSE(fs::exists(journalPath()));
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// ETag / Last-Modified のない応答は、再開時に検証できないので記録しないこと
+TEST_F(DownloaderTest, Journal_WithoutValidator_NotRecorded) {
+    MockConfig cfg;
+    cfg.totalSize  = 512 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(2);
+    auto downloader = makeDownloader(cfg, journalConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForProgress(5, std::chrono::seconds(5)));
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_FALSE(fs::exists(journalPath()));
+}
+
+// =============================================================================
+// ダイジェスト検証テスト
+// =============================================================================
+
+namespace {
+
+/// モックのパターンデータ全体のダイジェスト
+std::string patternDigest(ChecksumAlgorithm algorithm, size_t size) {
+    const std::string data = patternOf(0, size);
+    StreamingChecksum checksum(algorithm);
+    checksum.update(data.data(), data.size());
+    return checksum.hexDigest();
+}
+
+std::string toUpper(std::string text) {
+    for (auto& c : text) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+} // namespace
+
+/// 単一ストリーム・セグメント分割のどちらでも、受信しながら計算した値が
+/// 期待値（大文字でもよい）と一致して完了し、getStats() から取得できること
+TEST_F(DownloaderTest, Checksum_MatchesExpectedDigest) {
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024 + 123;
+    cfg.chunkSize  = 1000;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    for (const auto algorithm : {ChecksumAlgorithm::CRC32C, ChecksumAlgorithm::SHA256}) {
+        for (const size_t segments : {size_t{1}, size_t{4}}) {
+            fs::remove(tempOutputPath_);
+            const std::string expected = patternDigest(algorithm, cfg.totalSize);
+
+            DownloaderConfig config;
+            config.segmentCount      = segments;
+            config.minSegmentSize    = 1024;
+            config.checksumAlgorithm = algorithm;
+            config.expectedChecksum  = toUpper(expected);
+            auto downloader = makeDownloader(cfg, config);
+            MockObserver observer;
+            downloader->addObserver(&observer);
+
+            downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+            ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+            EXPECT_TRUE(observer.isCompleted())
+                << observer.getLastError() << " segments=" << segments;
+            EXPECT_EQ(downloader->getStats().checksum, expected) << "segments=" << segments;
+        }
+    }
+}
+
+/// 呼び出し側のメモリへの分割ダウンロードでも SHA-256 を計算できること
+TEST_F(DownloaderTest, Checksum_Sha256_SegmentedToMemory) {
+    MockConfig cfg;
+    cfg.totalSize  = 32 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.segmentCount      = 4;
+    config.minSegmentSize    = 1024;
+    config.checksumAlgorithm = ChecksumAlgorithm::SHA256;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::vector<char> buffer(cfg.totalSize, '\0');
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin",
+                                          std::span<char>(buffer)));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(downloader->getStats().checksum,
+              patternDigest(ChecksumAlgorithm::SHA256, cfg.totalSize));
+}
+
+/// 既存ファイルの続きから取得した場合も、ファイル全体のダイジェストになること
+TEST_F(DownloaderTest, Checksum_Resume_IncludesExistingPart) {
+    MockConfig cfg;
+    cfg.totalSize  = 16 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    {
+        std::ofstream out(tempOutputPath_, std::ios::binary);
+        out << patternOf(0, 5000);
+    }
+
+    DownloaderConfig config;
+    config.checksumAlgorithm = ChecksumAlgorithm::SHA256;
+    config.expectedChecksum  = patternDigest(ChecksumAlgorithm::SHA256, cfg.totalSize);
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// 期待値と一致しなければ onError で通知し、壊れた出力ファイルを残さないこと
+TEST_F(DownloaderTest, Checksum_Mismatch_ReportsError) {
+    MockConfig cfg;
+    cfg.totalSize  = 16 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.checksumAlgorithm = ChecksumAlgorithm::CRC32C;
+    config.expectedChecksum  = "00000000";
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isError());
+    EXPECT_NE(observer.getLastError().find("Checksum mismatch"), std::string::npos)
+        << observer.getLastError();
+    EXPECT_EQ(downloader->getStats().checksum,
+              patternDigest(ChecksumAlgorithm::CRC32C, cfg.totalSize));
+    EXPECT_FALSE(fs::exists(tempOutputPath_));
+}
+
+// =============================================================================
+// 圧縮転送
+// =============================================================================
+
+namespace {
+
+constexpr char GZIP_TEXT[] =
+    "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.";
+
+/// GZIP_TEXT を gzip で圧縮したもの
+const std::string GZIP_SAMPLE(
+    "\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x0b\xc9\x48\x55\x28\x2c"
+    "\xcd\x4c\xce\x56\x48\x2a\xca\x2f\xcf\x53\x48\xcb\xaf\x50\xc8\x2a"
+    "\xcd\x2d\x28\x56\xc8\x2f\x4b\x2d\x52\x28\x01\x4a\xe7\x24\x56\x55"
+    "\x2a\xa4\xe4\xa7\xeb\x29\x84\x90\xa0\x18\x00\xa7\x0a\xe9\x9a\x59"
+    "\x00\x00\x00", 67);
+
+/// gzip のメンバーを count 個連結したボディ（展開すると GZIP_TEXT の count 回の繰り返し）
+std::string gzipBody(int count) {
+    std::string body;
+    for (int i = 0; i < count; ++i) {
+        body += GZIP_SAMPLE;
+    }
+    return body;
+}
+
+bool gzipSupported() {
+    return ContentDecoder::supportedEncodings().find("gzip") != std::string::npos;
+}
+
+} // namespace
+
+/// PIPELINED では圧縮されたまま受信して展開し、受信量と展開後の量を別々に返すこと
+TEST_F(DownloaderTest, ContentDecoding_Pipelined_DecodesGzip) {
+    if (!gzipSupported()) {
+        GTEST_SKIP() << "gzip is not supported in this build";
+    }
+    AcceptEncodingRecord record;
+    MockConfig cfg;
+    cfg.body                 = gzipBody(200);
+    cfg.contentEncoding      = "gzip";
+    cfg.chunkSize            = 100; // gzip メンバーの途中で区切る
+    cfg.chunkDelay           = std::chrono::milliseconds(0);
+    cfg.acceptEncodingRecord = &record;
+
+    DownloaderConfig config;
+    config.contentDecoding = ContentDecoding::PIPELINED;
+    config.diskQueueLimit  = 1024; // 展開待ちの上限で受信が止まる
+    config.segmentCount    = 4;    // 圧縮転送は分割しない
+    config.minSegmentSize  = 1024;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/log.txt", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    std::string expected;
+    for (int i = 0; i < 200; ++i) {
+        expected += GZIP_TEXT;
+    }
+    const auto content = readFile(tempOutputPath_);
+    EXPECT_EQ(std::string(content.begin(), content.end()), expected);
+
+    const auto stats = downloader->getStats();
+    EXPECT_EQ(stats.downloadedBytes, static_cast<int64_t>(expected.size()));
+    EXPECT_EQ(stats.wireBytes, static_cast<int64_t>(cfg.body.size()));
+    EXPECT_EQ(record.calls, 1); // HEAD による分割の確認をしない
+    EXPECT_EQ(record.encodings, ContentDecoder::supportedEncodings());
+    EXPECT_FALSE(record.decode);
+}
+
+/// INLINE では curl に展開させること（展開はライブラリを介さない）
+TEST_F(DownloaderTest, ContentDecoding_Inline_LetsCurlDecode) {
+    AcceptEncodingRecord record;
+    MockConfig cfg;
+    cfg.chunkDelay           = std::chrono::milliseconds(0);
+    cfg.acceptEncodingRecord = &record;
+
+    DownloaderConfig config;
+    config.contentDecoding = ContentDecoding::INLINE;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    EXPECT_EQ(record.calls, 1);
+    EXPECT_TRUE(record.encodings.empty());
+    EXPECT_TRUE(record.decode);
+    EXPECT_EQ(downloader->getStats().wireBytes, static_cast<int64_t>(cfg.totalSize));
+}
+
+/// 圧縮を求めなければ Accept-Encoding を設定せず、受信量は書き込んだ量と等しいこと
+TEST_F(DownloaderTest, ContentDecoding_None_DoesNotNegotiate) {
+    AcceptEncodingRecord record;
+    MockConfig cfg;
+    cfg.chunkDelay           = std::chrono::milliseconds(0);
+    cfg.acceptEncodingRecord = &record;
+    auto downloader = makeDownloader(cfg);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(record.calls, 0);
+    const auto stats = downloader->getStats();
+    EXPECT_EQ(stats.wireBytes, stats.downloadedBytes);
+}
+
+/// 壊れた圧縮データ・途中で切れた圧縮データは onError で通知すること
+TEST_F(DownloaderTest, ContentDecoding_CorruptOrTruncated_ReportsError) {
+    if (!gzipSupported()) {
+        GTEST_SKIP() << "gzip is not supported in this build";
+    }
+    const std::string corrupt = GZIP_SAMPLE.substr(0, 10) + std::string(64, '\xff');
+    const std::string truncated = gzipBody(3).substr(0, 150);
+    for (const auto& body : {corrupt, truncated}) {
+        MockConfig cfg;
+        cfg.body            = body;
+        cfg.contentEncoding = "gzip";
+        cfg.chunkSize       = 16;
+        cfg.chunkDelay      = std::chrono::milliseconds(0);
+
+        DownloaderConfig config;
+        config.contentDecoding = ContentDecoding::PIPELINED;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        downloader->startDownload("http://example.com/log.txt", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isError());
+        EXPECT_NE(observer.getLastError().find("Failed to decode content"), std::string::npos)
+            << observer.getLastError();
+    }
+}
+
+/// 展開できない方式で返された応答は onError で通知すること
+TEST_F(DownloaderTest, ContentDecoding_UnsupportedEncoding_ReportsError) {
+    MockConfig cfg;
+    cfg.contentEncoding = "compress";
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+
+    DownloaderConfig config;
+    config.contentDecoding = ContentDecoding::PIPELINED;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isError());
+    EXPECT_NE(observer.getLastError().find("Unsupported Content-Encoding: compress"),
+              std::string::npos)
+        << observer.getLastError();
+}
+
+// =============================================================================
+// 接続のチューニング
+// =============================================================================
+
+/// 受信バッファと TCP の設定がすべての接続に渡されること
+TEST_F(DownloaderTest, Tuning_OptionsAppliedToHandles) {
+    TuningRecord record;
+    MockConfig cfg;
+    cfg.chunkDelay   = std::chrono::milliseconds(0);
+    cfg.tuningRecord = &record;
+
+    DownloaderConfig config;
+    config.chunkSize           = 64 * 1024;
+    config.tcpNoDelay          = true;
+    config.tcpKeepIdleSec      = 20;
+    config.tcpKeepIntervalSec  = 5;
+    config.socketReceiveBuffer = 512 * 1024;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(record.bufferSize, 64u * 1024);
+    EXPECT_TRUE(record.tcpNoDelay);
+    EXPECT_TRUE(record.tcpKeepAlive);
+    EXPECT_EQ(record.keepIdle, 20);
+    EXPECT_EQ(record.keepInterval, 5);
+    ASSERT_FALSE(record.receiveBufferSizes.empty());
+    EXPECT_EQ(record.receiveBufferSizes.front(), 512 * 1024);
+    // 自動調整しなければ転送中に変えない
+    for (const int size : record.receiveBufferSizes) {
+        EXPECT_EQ(size, 512 * 1024);
+    }
+}
+
+/// 自動調整では転送中の接続の SO_RCVBUF を広げ、次のジョブは広げた curl のバッファで始めること
+TEST_F(DownloaderTest, Tuning_Adaptive_GrowsBuffersFromMeasuredBdp) {
+    TuningRecord record;
+    MockConfig cfg;
+    cfg.totalSize       = 4 * 1024 * 1024;
+    cfg.chunkSize       = 16 * 1024;
+    cfg.roundTripTimeUs = 50000;
+    cfg.tuningRecord    = &record;
+
+    DownloaderConfig config;
+    config.chunkSize             = 16 * 1024;
+    config.adaptiveReceiveBuffer = true;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    ASSERT_FALSE(record.receiveBufferSizes.empty());
+    EXPECT_GE(record.receiveBufferSizes.back(), 128 * 1024);
+    EXPECT_TRUE(std::is_sorted(record.receiveBufferSizes.begin(), record.receiveBufferSizes.end()));
+
+    fs::remove(tempOutputPath_);
+    MockObserver second;
+    downloader->removeObserver(&observer);
+    downloader->addObserver(&second);
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(second.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(second.isCompleted()) << second.getLastError();
+    EXPECT_GT(record.bufferSize, config.chunkSize);
+}
+
+// =============================================================================
+// 複数ミラー
+// =============================================================================
+
+namespace {
+
+const std::vector<std::string> MIRRORS = {
+    "http://fast.example.com/file.bin",
+    "http://slow.example.com/file.bin",
+};
+
+/// 区間が小さくても分割・引き取りを行う設定
+DownloaderConfig mirrorConfig() {
+    DownloaderConfig config;
+    config.minSegmentSize = 8 * 1024;
+    config.minStealSize   = 8 * 1024;
+    return config;
+}
+
+} // namespace
+
+/// 区間を各ミラーに振り分け、すべてのミラーから受信すること
+TEST_F(DownloaderTest, Mirrors_SplitsSegmentsAcrossMirrors) {
+    MockConfig cfg;
+    cfg.totalSize = 256 * 1024;
+    cfg.chunkSize = 4 * 1024;
+
+    auto downloader = makeDownloader(cfg, mirrorConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    EXPECT_EQ(stats.url, MIRRORS.front());
+    ASSERT_EQ(stats.mirrors.size(), MIRRORS.size());
+    int64_t total = 0;
+    for (const auto& mirror : stats.mirrors) {
+        EXPECT_GT(mirror.downloadedBytes, 0) << mirror.url;
+        EXPECT_FALSE(mirror.failed) << mirror.url;
+        total += mirror.downloadedBytes;
+    }
+    EXPECT_EQ(total, static_cast<int64_t>(cfg.totalSize));
+}
+
+/// 遅いミラーの残りを速いミラーが引き取り、区間ごとの CRC-32C を連結して検証できること
+TEST_F(DownloaderTest, Mirrors_SlowMirror_WorkIsStolen) {
+    MockConfig cfg;
+    cfg.totalSize       = 512 * 1024;
+    cfg.chunkSize       = 4 * 1024;
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("slow") != std::string::npos) {
+            config.chunkDelay = std::chrono::milliseconds(20);
+        }
+    };
+
+    DownloaderConfig config  = mirrorConfig();
+    config.checksumAlgorithm = ChecksumAlgorithm::CRC32C;
+    config.expectedChecksum  = patternDigest(ChecksumAlgorithm::CRC32C, cfg.totalSize);
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    // 遅いミラーが半分を受け持てば 64 チャンク × 20ms かかる
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(1000));
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), MIRRORS.size());
+    EXPECT_GT(stats.mirrors[0].downloadedBytes, static_cast<int64_t>(cfg.totalSize * 3 / 4));
+    EXPECT_GT(stats.mirrors[0].bytesPerSec, stats.mirrors[1].bytesPerSec);
+}
+
+/// 途中で切断したミラーの区間は、別のミラーで続きから取り直すこと
+TEST_F(DownloaderTest, Mirrors_FailedSegment_RetriedOnAnotherMirror) {
+    MockConfig cfg;
+    cfg.totalSize       = 128 * 1024;
+    cfg.chunkSize       = 4 * 1024;
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("slow") != std::string::npos) {
+            config.failAfterBytes = 12 * 1024;
+        }
+    };
+
+    auto downloader = makeDownloader(cfg, mirrorConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::vector<char> buffer(cfg.totalSize);
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, std::span<char>(buffer)));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(buffer, cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    EXPECT_EQ(stats.downloadedBytes, static_cast<int64_t>(cfg.totalSize));
+    ASSERT_EQ(stats.mirrors.size(), MIRRORS.size());
+    EXPECT_FALSE(stats.mirrors[0].failed);
+    EXPECT_TRUE(stats.mirrors[1].failed);
+    EXPECT_EQ(stats.mirrors[1].downloadedBytes, 12 * 1024);
+}
+
+/// HEAD に失敗したミラーは外し、次のミラーで調べて取得すること
+TEST_F(DownloaderTest, Mirrors_ProbeFailure_FallsBackToNextMirror) {
+    MockConfig cfg;
+    cfg.totalSize       = 64 * 1024;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("fast") != std::string::npos) {
+            config.httpCode = 503;
+        }
+    };
+
+    auto downloader = makeDownloader(cfg, mirrorConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), MIRRORS.size());
+    EXPECT_TRUE(stats.mirrors[0].failed);
+    EXPECT_EQ(stats.mirrors[1].downloadedBytes, static_cast<int64_t>(cfg.totalSize));
+}
+
+/// Range に対応しない単一ストリームでも、エラーを返したミラーから次のミラーへ切り替えること
+TEST_F(DownloaderTest, Mirrors_SingleStream_FailsOverOnHttpError) {
+    MockConfig cfg;
+    cfg.supportsRange   = false;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("fast") != std::string::npos) {
+            config.httpCode = 404;
+        }
+    };
+
+    auto downloader = makeDownloader(cfg, mirrorConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    // 404 のボディは書き込まれていないこと
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+}
+
+/// すべてのミラーが失敗した場合だけ onError を通知すること
+TEST_F(DownloaderTest, Mirrors_AllMirrorsFail_ReportsError) {
+    MockConfig cfg;
+    cfg.totalSize      = 64 * 1024;
+    cfg.chunkDelay     = std::chrono::milliseconds(0);
+    cfg.failAfterBytes = 4 * 1024;
+
+    auto downloader = makeDownloader(cfg, mirrorConfig());
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload(MIRRORS, tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isError());
+    for (const auto& mirror : downloader->getStats().mirrors) {
+        EXPECT_TRUE(mirror.failed) << mirror.url;
+    }
+
+    EXPECT_FALSE(downloader->startDownload(std::vector<std::string>{}, tempOutputPath_.string()));
+}
+
+// =============================================================================
+// 再試行
+// =============================================================================
+
+namespace {
+
+/// 待ち時間を短くした再試行の設定
+DownloaderConfig retryConfig(int maxRetries) {
+    DownloaderConfig config;
+    config.maxRetries       = maxRetries;
+    config.retryBaseDelayMs = 1;
+    config.retryMaxDelayMs  = 50;
+    return config;
+}
+
+/// 最初の count 回の perform() だけ mutate で設定を書き換える
+template <typename Mutate>
+std::function<void(const std::string&, MockConfig&)> firstAttempts(int count, Mutate mutate) {
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    return [calls, count, mutate](const std::string&, MockConfig& config) {
+        if (calls->fetch_add(1) < count) {
+            mutate(config);
+        }
+    };
+}
+
+} // namespace
+
+/// 切断されても受信済みの位置から続きを取り直し、同じデータを受信し直さないこと
+TEST_F(DownloaderTest, Retry_NetworkError_ResumesFromReceivedBytes) {
+    MockConfig cfg;
+    cfg.totalSize      = 64 * 1024;
+    cfg.chunkSize      = 4 * 1024;
+    cfg.chunkDelay     = std::chrono::milliseconds(0);
+    cfg.failAfterBytes = 16 * 1024; // 接続ごとに 16KB で切れる
+
+    // 受信が進むたびに数え直すため、1 回までの再試行でも最後まで取得できる
+    auto downloader = makeDownloader(cfg, retryConfig(1));
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/flaky.bin", tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    EXPECT_EQ(stats.retryCount, 3);
+    EXPECT_EQ(stats.wireBytes, static_cast<int64_t>(cfg.totalSize));
+    EXPECT_EQ(stats.totalBytes, static_cast<int64_t>(cfg.totalSize));
+}
+
+/// 503 のボディは書かずに、Retry-After（上限で打ち切る）だけ待ってから取り直すこと
+TEST_F(DownloaderTest, Retry_ServiceUnavailable_HonorsRetryAfter) {
+    MockConfig cfg;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+    cfg.configureForUrl = firstAttempts(2, [](MockConfig& config) {
+        config.httpCode   = 503;
+        config.retryAfter = "120";
+    });
+
+    auto downloader = makeDownloader(cfg, retryConfig(3));
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(downloader->startDownload("http://example.com/busy.bin", tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(100));
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    EXPECT_EQ(downloader->getStats().retryCount, 2);
+}
+
+/// 再試行の上限に達したら onError を通知し、対象外のエラーは再試行しないこと
+TEST_F(DownloaderTest, Retry_ExhaustedOrNotRetryable_ReportsError) {
+    {
+        MockConfig cfg;
+        cfg.returnResult = CurlResult::NETWORK_ERROR;
+        auto downloader  = makeDownloader(cfg, retryConfig(3));
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        ASSERT_TRUE(downloader->startDownload("http://example.com/down.bin", tempOutputPath_.string()));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isError());
+        EXPECT_THAT(observer.getLastError(), ::testing::HasSubstr("Network error"));
+        EXPECT_EQ(downloader->getStats().retryCount, 3);
+    }
+    {
+        MockConfig cfg;
+        cfg.httpCode    = 404;
+        auto downloader = makeDownloader(cfg, retryConfig(3));
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        ASSERT_TRUE(downloader->startDownload("http://example.com/missing.bin", tempOutputPath_.string()));
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isError());
+        EXPECT_THAT(observer.getLastError(), ::testing::HasSubstr("404"));
+        EXPECT_EQ(downloader->getStats().retryCount, 0);
+    }
+}
+
+/// 区間ごとに続きから取り直し、連結した CRC-32C が一致すること
+TEST_F(DownloaderTest, Retry_Segments_ResumeEachRange) {
+    MockConfig cfg;
+    cfg.totalSize      = 128 * 1024;
+    cfg.chunkSize      = 4 * 1024;
+    cfg.chunkDelay     = std::chrono::milliseconds(0);
+    cfg.failAfterBytes = 12 * 1024;
+
+    DownloaderConfig config  = retryConfig(1);
+    config.segmentCount      = 4;
+    config.minSegmentSize    = 16 * 1024;
+    config.checksumAlgorithm = ChecksumAlgorithm::CRC32C;
+    config.expectedChecksum  = patternDigest(ChecksumAlgorithm::CRC32C, cfg.totalSize);
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/flaky.bin", tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    EXPECT_EQ(downloader->getStats().retryCount, 4 * 2); // 32KB の区間ごとに 12KB, 24KB で切れる
+}
+
+/// HEAD が失敗しても再試行し、分割ダウンロードを続けること
+TEST_F(DownloaderTest, Retry_ProbeFailure_StillSplits) {
+    MockConfig cfg;
+    cfg.totalSize       = 64 * 1024;
+    cfg.chunkDelay      = std::chrono::milliseconds(0);
+    cfg.configureForUrl = firstAttempts(1, [](MockConfig& config) {
+        config.returnResult = CurlResult::NETWORK_ERROR;
+    });
+
+    auto handles             = std::make_shared<std::atomic<int>>(0);
+    DownloaderConfig config  = retryConfig(2);
+    config.segmentCount      = 4;
+    config.minSegmentSize    = 16 * 1024;
+    auto downloader = std::make_unique<Downloader::Downloader>(
+        config, [cfg, handles]() -> std::unique_ptr<ICurlHandle> {
+            ++*handles;
+            return std::make_unique<MockCurlHandle>(cfg);
+        });
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string()));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    EXPECT_EQ(downloader->getStats().retryCount, 1);
+    EXPECT_EQ(handles->load(), 2 + 4); // HEAD 2 回 + 4 区間
+}
+
+/// 再試行を待っている間にキャンセルすると、待ち時間を待たずに onCancelled を通知すること
+TEST_F(DownloaderTest, Retry_CancelDuringBackoff_NotifiesCancelled) {
+    MockConfig cfg;
+    cfg.returnResult = CurlResult::NETWORK_ERROR;
+
+    DownloaderConfig config = retryConfig(5);
+    config.retryBaseDelayMs = 60 * 1000;
+    config.retryMaxDelayMs  = 60 * 1000;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    ASSERT_TRUE(downloader->startDownload("http://example.com/down.bin", tempOutputPath_.string()));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (downloader->getStats().retryCount == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(downloader->getStats().retryCount, 1);
+
+    downloader->cancel();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(2)));
+    EXPECT_TRUE(observer.isCancelled());
+}
+
+// =============================================================================
+// 最初のバイトまでの時間
+// =============================================================================
+
+/// warmUp() は接続元ごとに 1 本だけ HEAD を送り、接続できた数を返すこと
+TEST_F(DownloaderTest, WarmUp_SendsOneHeadPerOrigin) {
+    RequestLog log;
+    MockConfig cfg;
+    cfg.requestLog      = &log;
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url.find("down.example.com") != std::string::npos) {
+            config.returnResult = CurlResult::NETWORK_ERROR;
+        }
+    };
+    auto downloader = makeDownloader(cfg, DownloaderConfig{});
+
+    const size_t connected = downloader->warmUp({
+        "https://cdn.example.com/a.bin",
+        "HTTPS://CDN.example.com/b.bin", // 同じ接続元
+        "https://cdn.example.com:8443/c.bin",
+        "https://down.example.com/d.bin",
+    });
+    EXPECT_EQ(connected, 2u);
+
+    auto requests = log.snapshot();
+    std::sort(requests.begin(), requests.end());
+    EXPECT_EQ(requests, (std::vector<std::string>{
+                            "HEAD https://cdn.example.com/a.bin",
+                            "HEAD https://cdn.example.com:8443/c.bin",
+                            "HEAD https://down.example.com/d.bin",
+                        }));
+}
+
+/// 接続の確立を短くする設定がすべてのハンドルに渡されること
+TEST_F(DownloaderTest, ConnectOptions_AppliedToHandles) {
+    TuningRecord record;
+    MockConfig cfg;
+    cfg.tuningRecord = &record;
+
+    DownloaderConfig config;
+    config.happyEyeballsTimeoutMs = 50;
+    config.tcpFastOpen            = true;
+    config.tlsEarlyData           = true;
+    config.resolveOverrides       = {"example.com:80:127.0.0.1"};
+    auto downloader = makeDownloader(cfg, config);
+
+    EXPECT_EQ(downloader->warmUp({"http://example.com/file.bin"}), 1u);
+    EXPECT_EQ(record.happyEyeballsMs, 50);
+    EXPECT_TRUE(record.tcpFastOpen);
+    EXPECT_TRUE(record.tlsEarlyData);
+    EXPECT_EQ(record.resolveOverrides, config.resolveOverrides);
+}
+
+/// 統計には最初に応答を受けた転送の時間の内訳が残ること
+TEST_F(DownloaderTest, Stats_ReportsPhaseTimings) {
+    MockConfig cfg;
+    cfg.timings = {1000, 2000, 3000, 8000, 500};
+    auto downloader = makeDownloader(cfg);
+    EXPECT_EQ(downloader->getStats().timings.firstByteUs, -1);
+
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    const PhaseTimings timings = downloader->getStats().timings;
+    EXPECT_EQ(timings.dnsUs, 1000);
+    EXPECT_EQ(timings.connectUs, 2000);
+    EXPECT_EQ(timings.tlsUs, 3000);
+    EXPECT_EQ(timings.firstByteUs, 8000);
+    EXPECT_EQ(timings.transferUs, 500);
+}
+
+/// 計測値にダウンロード・転送の件数、受信量、時間の内訳とコールバックの時間が残ること
+TEST_F(DownloaderTest, Metrics_RecordsDownloadAndTransfers) {
+    MockConfig cfg;
+    cfg.timings = {1000, 2000, 3000, 8000, 500};
+    DownloadMetrics  metrics;
+    DownloaderConfig config;
+    config.metrics = &metrics;
+    auto downloader = makeDownloader(cfg, config);
+
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    downloader->startDownload("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    EXPECT_EQ(metrics.downloadsStarted.value(), 1u);
+    EXPECT_EQ(metrics.downloadsCompleted.value(), 1u);
+    EXPECT_EQ(metrics.downloadsFailed.value(), 0u);
+    EXPECT_EQ(metrics.transfers.value(), 1u);
+    EXPECT_EQ(metrics.bytesReceived.value(), cfg.totalSize);
+    EXPECT_EQ(metrics.bytesWritten.value(), cfg.totalSize);
+    EXPECT_EQ(metrics.writeCallbackUs.snapshot().count, cfg.totalSize / cfg.chunkSize);
+    EXPECT_GT(metrics.diskWriteUs.snapshot().count, 0u);
+    EXPECT_GT(metrics.observerCallbackUs.snapshot().count, 0u);
+    EXPECT_EQ(metrics.firstByteUs.snapshot().sum, 8000u);
+    EXPECT_EQ(metrics.throughputBytesPerSec.snapshot().count, 1u);
+}
+
+/// pause() から resume() までの時間と、失敗した再試行が計測値に残ること
+TEST_F(DownloaderTest, Metrics_RecordsPausedTimeAndRetries) {
+    MockConfig cfg;
+    cfg.totalSize      = 64 * 1024;
+    cfg.chunkSize      = 4 * 1024;
+    cfg.failAfterBytes = 16 * 1024;
+    DownloadMetrics  metrics;
+    DownloaderConfig config = retryConfig(1);
+    config.metrics = &metrics;
+    auto downloader = makeDownloader(cfg, config);
+
+    MockObserver observer;
+    downloader->addObserver(&observer);
+    downloader->startDownload("http://example.com/flaky.bin", tempOutputPath_.string());
+    downloader->pause();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    downloader->resume();
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    EXPECT_GE(metrics.pausedUs.value(), 50000u);
+    EXPECT_EQ(metrics.retries.value(), 3u);
+    EXPECT_EQ(metrics.transfers.value(), 4u);
+    EXPECT_EQ(metrics.bytesReceived.value(), cfg.totalSize);
+}
+
+// =============================================================================
+// 接続の多重化
+// =============================================================================
+
+/// HTTP/3 は curl が対応していれば優先し、対応していなければ HTTP/2 にすること
+TEST_F(DownloaderTest, Http3_FallsBackToHttp2WhenUnsupported) {
+    for (const bool supported : {false, true}) {
+        TuningRecord record;
+        MockConfig cfg;
+        cfg.tuningRecord  = &record;
+        cfg.supportsHttp3 = supported;
+
+        DownloaderConfig config;
+        config.useHttp3 = true;
+        auto downloader = makeDownloader(cfg, config);
+        EXPECT_EQ(downloader->warmUp({"https://example.com/file.bin"}), 1u);
+        EXPECT_EQ(record.http3, supported);
+        EXPECT_EQ(record.http2, !supported);
+        // ワーカースレッド駆動では多重化の設定をしない
+        EXPECT_EQ(record.multiplexing, -1);
+    }
+}
+
+/// SEPARATE は HTTP/2 を使わず、転送ごとの接続にすること
+TEST_F(DownloaderTest, SeparateConnections_DisablesMultiplexing) {
+    TuningRecord record;
+    MockConfig cfg;
+    cfg.tuningRecord = &record;
+
+    DownloaderConfig config;
+    config.connectionSharing = ConnectionSharing::SEPARATE;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload("https://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(record.multiplexing, 0);
+    EXPECT_FALSE(record.http2);
+}
+
+// =============================================================================
+// キャッシュ
+// =============================================================================
+
+namespace {
+
+/// テストごとに空のキャッシュディレクトリを用意する
+fs::path freshCacheDirectory() {
+    const fs::path directory = fs::temp_directory_path() / "downloader_test_cache";
+    fs::remove_all(directory);
+    return directory;
+}
+
+} // namespace
+
+/// 2 回目は条件付きリクエストの 304 で受信せずに完了し、内容がキャッシュから複製されること
+TEST_F(DownloaderTest, Cache_NotModified_CompletesWithoutBody) {
+    const fs::path directory = freshCacheDirectory();
+    DownloadCache  cache({.directory = directory.string()});
+
+    MockConfig cfg;
+    cfg.totalSize  = 32 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    cfg.etag       = "\"v1\"";
+
+    DownloadMetrics  metrics;
+    DownloaderConfig config;
+    config.cache   = &cache;
+    config.metrics = &metrics;
+    for (const size_t segments : {size_t{1}, size_t{4}}) {
+        config.segmentCount   = segments;
+        config.minSegmentSize = 1024;
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        downloader->startDownload("http://example.com/tool.tar", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+        expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+        fs::remove(tempOutputPath_);
+    }
+
+    // 1 回目で記録し、2 回目（HEAD の 304）はキャッシュから完了する
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(metrics.cacheHits.value(), 1u);
+    EXPECT_EQ(metrics.bytesReceived.value(), cfg.totalSize);
+    fs::remove_all(directory);
+}
+
+/// 内容が変わっていれば受信し直し、キャッシュの記録も新しい内容に置き換わること
+TEST_F(DownloaderTest, Cache_Modified_DownloadsAndReplacesEntry) {
+    const fs::path directory = freshCacheDirectory();
+    DownloadCache  cache({.directory = directory.string()});
+
+    MockConfig cfg;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    DownloaderConfig config;
+    config.cache = &cache;
+    for (const std::string& version : {std::string("old body"), std::string("new body!")}) {
+        cfg.body = version;
+        cfg.etag = "\"" + version + "\"";
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        downloader->startDownload("http://example.com/file.txt", tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+        const auto content = readFile(tempOutputPath_);
+        EXPECT_EQ(std::string(content.begin(), content.end()), version);
+    }
+
+    const auto entry = cache.lookup("http://example.com/file.txt");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->etag, "\"new body!\"");
+    EXPECT_EQ(entry->size, 9);
+    fs::remove_all(directory);
+}
+
+/// SHA-256 の期待値と同じ内容がキャッシュにあれば、別の URL でもリクエストせずに完了すること
+TEST_F(DownloaderTest, Cache_ExpectedSha256_SkipsRequest) {
+    const fs::path directory = freshCacheDirectory();
+    DownloadCache  cache({.directory = directory.string()});
+
+    RequestLog log;
+    MockConfig cfg;
+    cfg.totalSize  = 8 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    cfg.requestLog = &log;
+
+    DownloaderConfig config;
+    config.cache             = &cache;
+    config.checksumAlgorithm = ChecksumAlgorithm::SHA256;
+    config.expectedChecksum  = patternDigest(ChecksumAlgorithm::SHA256, cfg.totalSize);
+    for (const char* url : {"http://a.example.com/x.bin", "http://b.example.com/y.bin"}) {
+        auto downloader = makeDownloader(cfg, config);
+        MockObserver observer;
+        downloader->addObserver(&observer);
+
+        downloader->startDownload(url, tempOutputPath_.string());
+        ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+        ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+        expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+        fs::remove(tempOutputPath_);
+    }
+    EXPECT_EQ(log.snapshot(), (std::vector<std::string>{"GET http://a.example.com/x.bin"}));
+    fs::remove_all(directory);
+}
+
+// =============================================================================
+// ピア配布
+// =============================================================================
+
+namespace {
+
+const std::string ORIGIN_URL = "http://origin.example.com/image.bin";
+const std::string PEER_URL   = "http://peer.example.com:7070/peer/image";
+
+/// ピアを使う設定（ピアの内容は SHA-256 で照合する）
+DownloaderConfig peerConfig(size_t totalSize, PeerTracker& tracker) {
+    DownloaderConfig config = mirrorConfig();
+    config.segmentCount      = 4;
+    config.peerTracker       = &tracker;
+    config.checksumAlgorithm = ChecksumAlgorithm::SHA256;
+    config.expectedChecksum  = patternDigest(ChecksumAlgorithm::SHA256, totalSize);
+    return config;
+}
+
+} // namespace
+
+/// ピアにまだない区間 (404) は配布元から取り直し、ダウンロードは完了すること
+TEST_F(DownloaderTest, Peers_MissingRange_FallsBackToOrigin) {
+    PeerTracker tracker;
+    tracker.announce(ORIGIN_URL, PEER_URL);
+
+    MockConfig cfg;
+    cfg.totalSize       = 128 * 1024;
+    cfg.chunkSize       = 4 * 1024;
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        if (url == PEER_URL) {
+            config.httpCode = 404;
+        }
+    };
+
+    auto downloader = makeDownloader(cfg, peerConfig(cfg.totalSize, tracker));
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), 2u);
+    EXPECT_FALSE(stats.mirrors[0].peer);
+    EXPECT_TRUE(stats.mirrors[1].peer);
+    EXPECT_TRUE(stats.mirrors[1].failed);
+    EXPECT_EQ(stats.mirrors[0].downloadedBytes, static_cast<int64_t>(cfg.totalSize));
+}
+
+/// ピアが持っている区間はピアから受信し、配布元から受信する量が減ること
+TEST_F(DownloaderTest, Peers_ServeSegments_OffloadOrigin) {
+    PeerTracker tracker;
+    tracker.announce(ORIGIN_URL, PEER_URL);
+    DownloadMetrics metrics;
+
+    MockConfig cfg;
+    cfg.totalSize  = 128 * 1024;
+    cfg.chunkSize  = 4 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config = peerConfig(cfg.totalSize, tracker);
+    config.metrics = &metrics;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), 2u);
+    EXPECT_GT(stats.mirrors[1].downloadedBytes, 0);
+    EXPECT_LT(stats.mirrors[0].downloadedBytes, static_cast<int64_t>(cfg.totalSize));
+    EXPECT_EQ(metrics.peerBytes.value(), static_cast<uint64_t>(stats.mirrors[1].downloadedBytes));
+}
+
+/// 期待値がなく内容を照合できないダウンロードではピアを使わないこと
+TEST_F(DownloaderTest, Peers_WithoutExpectedChecksum_NotUsed) {
+    PeerTracker tracker;
+    tracker.announce(ORIGIN_URL, PEER_URL);
+
+    RequestLog log;
+    MockConfig cfg;
+    cfg.totalSize  = 64 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+    cfg.requestLog = &log;
+
+    DownloaderConfig config = peerConfig(cfg.totalSize, tracker);
+    config.expectedChecksum.clear();
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_TRUE(downloader->getStats().mirrors.empty());
+    for (const auto& request : log.snapshot()) {
+        EXPECT_EQ(request.find(PEER_URL), std::string::npos) << request;
+    }
+}
+
+/// PeerServer を指定すると、受信した内容を配布して追跡サービスに登録し、
+/// 内容が一致しなければ配布をやめること
+TEST_F(DownloaderTest, Peers_PeerServer_SharesVerifiedOutput) {
+    PeerTracker tracker;
+    PeerServer  server({.tracker = &tracker});
+
+    MockConfig cfg;
+    cfg.totalSize  = 128 * 1024;
+    cfg.chunkDelay = std::chrono::milliseconds(0);
+
+    DownloaderConfig config = peerConfig(cfg.totalSize, tracker);
+    config.peerServer = &server;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    downloader->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(5)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+
+    // 自分自身はピアとして使わない
+    EXPECT_TRUE(downloader->getStats().mirrors.empty());
+    const auto ranges = server.availableRanges(ORIGIN_URL);
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].first, 0);
+    EXPECT_EQ(ranges[0].last, static_cast<int64_t>(cfg.totalSize) - 1);
+    EXPECT_EQ(tracker.peersFor(ORIGIN_URL), (std::vector<std::string>{server.peerUrl(ORIGIN_URL)}));
+
+    // 同じ内容を取り直して期待値と一致しなければ、配布も登録もやめる
+    // （取り直す側が区間の配布を始めた時点で、前の配布は置き換わる）
+    fs::remove(tempOutputPath_);
+    config.expectedChecksum = std::string(64, '0');
+    auto failing = makeDownloader(cfg, config);
+    MockObserver second;
+    failing->addObserver(&second);
+    failing->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(second.waitForFinish(std::chrono::seconds(5)));
+    EXPECT_TRUE(second.isError());
+    EXPECT_TRUE(server.availableRanges(ORIGIN_URL).empty());
+    EXPECT_TRUE(tracker.peersFor(ORIGIN_URL).empty());
+}
+
+namespace {
+
+/// 進捗通知のたびに、PeerServer が配布している区間の内容がパターンデータと一致するか確かめる
+class PublishedRangeChecker final : public IDownloaderObserver {
+public:
+    PublishedRangeChecker(const PeerServer& server, fs::path path) : server_(server), path_(std::move(path)) {}
+
+    void onProgress(int64_t, int64_t, double) override {
+        for (const auto& range : server_.availableRanges(ORIGIN_URL)) {
+            std::ifstream in(path_, std::ios::binary);
+            in.seekg(range.first);
+            std::vector<char> content(static_cast<size_t>(range.size()));
+            in.read(content.data(), static_cast<std::streamsize>(content.size()));
+            for (size_t i = 0; i < content.size(); ++i) {
+                if (content[i] != MockCurlHandle::patternByte(static_cast<size_t>(range.first) + i)) {
+                    corrupt_.fetch_add(1);
+                    break;
+                }
+            }
+        }
+    }
+    void onCompleted() override {}
+    void onError(const std::string&) override {}
+    void onPaused() override {}
+    void onResumed() override {}
+    void onCancelled() override {}
+
+    int corrupt() const { return corrupt_.load(); }
+
+private:
+    const PeerServer& server_;
+    fs::path          path_;
+    std::atomic<int>  corrupt_{0};
+};
+
+} // namespace
+
+/// 壊れた内容を返すピアがいると、ピアを外して配布元から一度だけ取り直し、
+/// ピアから受信した区間は照合が済むまでほかのノードへ配布しないこと
+TEST_F(DownloaderTest, Peers_CorruptPeer_RetriesFromOriginOnly) {
+    PeerTracker tracker;
+    tracker.announce(ORIGIN_URL, PEER_URL);
+    PeerServer server({.tracker = &tracker});
+
+    RequestLog log;
+    MockConfig cfg;
+    cfg.totalSize       = 128 * 1024;
+    cfg.chunkSize       = 4 * 1024;
+    cfg.requestLog      = &log;
+    cfg.configureForUrl = [](const std::string& url, MockConfig& config) {
+        // ピアの区間が先に終わり、配布元の受信中に配布している区間を確かめられるようにする
+        if (url == PEER_URL) {
+            config.body       = std::string(config.totalSize, 'X');
+            config.chunkDelay = std::chrono::milliseconds(0);
+        } else {
+            config.chunkDelay = std::chrono::milliseconds(2);
+        }
+    };
+
+    DownloaderConfig config = peerConfig(cfg.totalSize, tracker);
+    config.peerServer = &server;
+    auto downloader = makeDownloader(cfg, config);
+    MockObserver          observer;
+    PublishedRangeChecker checker(server, tempOutputPath_);
+    downloader->addObserver(&observer);
+    downloader->addObserver(&checker);
+
+    downloader->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    expectPattern(readFile(tempOutputPath_), cfg.totalSize);
+    EXPECT_EQ(checker.corrupt(), 0);
+
+    const auto stats = downloader->getStats();
+    ASSERT_EQ(stats.mirrors.size(), 2u);
+    EXPECT_TRUE(stats.mirrors[1].failed);
+    EXPECT_GT(stats.mirrors[1].downloadedBytes, 0);
+    // 取り直しは配布元だけから受信する
+    EXPECT_EQ(stats.mirrors[0].downloadedBytes - static_cast<int64_t>(cfg.totalSize),
+              static_cast<int64_t>(cfg.totalSize) - stats.mirrors[1].downloadedBytes);
+    const auto ranges = server.availableRanges(ORIGIN_URL);
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].last, static_cast<int64_t>(cfg.totalSize) - 1);
+    downloader->removeObserver(&checker);
+    downloader->removeObserver(&observer);
+
+    // 配布元から取り直しても一致しなければ、それ以上は取り直さずに失敗する
+    fs::remove(tempOutputPath_);
+    config.expectedChecksum = std::string(64, '0');
+    auto failing = makeDownloader(cfg, config);
+    MockObserver second;
+    failing->addObserver(&second);
+    failing->startDownload(ORIGIN_URL, tempOutputPath_.string());
+    ASSERT_TRUE(second.waitForFinish(std::chrono::seconds(10)));
+    EXPECT_TRUE(second.isError());
+    EXPECT_NE(second.getLastError().find("Checksum mismatch"), std::string::npos);
+    EXPECT_FALSE(fs::exists(tempOutputPath_));
+    failing->removeObserver(&second);
+}
+
+// =============================================================================
+// 非同期 API（onDone / fetchAsync / fetch）
+// =============================================================================
+
+namespace {
+
+/// co_await を試すための最小のコルーチン（呼び出し時に実行を始め、終了を待たない）
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/// 同じ Downloader で 2 件を順に co_await し、結果を results に設定する
+DetachedTask fetchTwice(Downloader::Downloader& downloader, std::string first, std::string second,
+                        std::promise<std::vector<DownloadResult>>& results) {
+    std::vector<DownloadResult> finished;
+    finished.push_back(co_await downloader.fetch("http://example.com/a.bin", first));
+    finished.push_back(co_await downloader.fetch("http://example.com/b.bin", second));
+    results.set_value(std::move(finished));
+}
+
+} // namespace
+
+/// fetchAsync の future に終了時の状態と統計が設定されること
+TEST_F(DownloaderTest, FetchAsync_Completed_ReturnsStats) {
+    MockConfig cfg;
+    cfg.totalSize = 8 * 1024;
+    auto downloader = makeDownloader(cfg);
+
+    auto finished = downloader->fetchAsync("http://example.com/file.bin", tempOutputPath_.string());
+    ASSERT_EQ(finished.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    const DownloadResult result = finished.get();
+    EXPECT_TRUE(result.ok());
+    EXPECT_TRUE(result.error.empty());
+    EXPECT_EQ(result.stats.downloadedBytes, 8 * 1024);
+    EXPECT_EQ(result.stats.state, DownloadState::COMPLETED);
+    expectPattern(readFile(tempOutputPath_), 8 * 1024);
+}
+
+/// 失敗は ERROR と理由、実行中の開始は rejected() の結果として返ること
+TEST_F(DownloaderTest, FetchAsync_ErrorAndRejected) {
+    MockConfig failing;
+    failing.returnResult = CurlResult::NETWORK_ERROR;
+    failing.errorMessage = "connection refused";
+    auto downloader = makeDownloader(failing);
+    const DownloadResult failed =
+        downloader->fetchAsync("http://example.com/file.bin", tempOutputPath_.string()).get();
+    EXPECT_EQ(failed.state, DownloadState::ERROR);
+    EXPECT_NE(failed.error.find("connection refused"), std::string::npos) << failed.error;
+
+    MockConfig slow;
+    slow.totalSize  = 64 * 1024;
+    slow.chunkDelay = std::chrono::milliseconds(5);
+    auto busy = makeDownloader(slow);
+    auto running = busy->fetchAsync("http://example.com/file.bin", tempOutputPath_.string());
+    const DownloadResult rejected =
+        busy->fetchAsync("http://example.com/other.bin", tempOutputPath_.string() + ".other").get();
+    EXPECT_EQ(rejected.state, DownloadState::IDLE);
+    EXPECT_FALSE(rejected.error.empty());
+    busy->cancel();
+    EXPECT_EQ(running.get().state, DownloadState::CANCELLED);
+}
+
+/// co_await で順に取得でき、再開後の次の開始がワーカースレッドの終了待ちで詰まらないこと
+TEST_F(DownloaderTest, Fetch_CoAwait_ChainsOnWorkerThread) {
+    MockConfig cfg;
+    cfg.totalSize = 4 * 1024;
+    auto downloader = makeDownloader(cfg);
+    const std::string second = tempOutputPath_.string() + ".second";
+
+    std::promise<std::vector<DownloadResult>> promise;
+    auto finished = promise.get_future();
+    fetchTwice(*downloader, tempOutputPath_.string(), second, promise);
+
+    ASSERT_EQ(finished.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    const auto results = finished.get();
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_TRUE(results[0].ok()) << results[0].error;
+    EXPECT_TRUE(results[1].ok()) << results[1].error;
+    EXPECT_EQ(results[1].stats.url, "http://example.com/b.bin");
+    expectPattern(readFile(second), 4 * 1024);
+    fs::remove(second);
+}
+
+/// onDone の中で Downloader を破棄してよいこと
+TEST_F(DownloaderTest, OnDone_MayDestroyDownloader) {
+    Downloader::Downloader* downloader = makeDownloader().release();
+    MockObserver observer;
+    downloader->addObserver(&observer);
+
+    std::promise<DownloadState> promise;
+    auto finished = promise.get_future();
+    ASSERT_TRUE(downloader->startDownload(
+        "http://example.com/file.bin", tempOutputPath_.string(),
+        [downloader, &promise](DownloadResult result) {
+            delete downloader;
+            promise.set_value(result.state);
+        }));
+
+    ASSERT_EQ(finished.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(finished.get(), DownloadState::COMPLETED);
+    EXPECT_TRUE(observer.isCompleted()); // オブザーバーへの通知が先に届いている
+}
+
 // =============================================================================
 // main
 // =============================================================================
@@ -0,0 +1,161 @@
+// =============================================================================
+// FileWriterTest.cpp
+// FileWriter（位置指定の書き込み・領域の確保・direct I/O・置き換え）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 一時ディレクトリに実ファイルを作り、書き込んだ内容を読み戻して検証する
+//  - direct I/O は一時ディレクトリのファイルシステムが対応しなくても通常の書き込みになるため、
+//    どちらの場合も内容が同じになることだけを確かめる
+// =============================================================================
+
+#include "FileWriter.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class FileWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "file_writer_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    static std::string readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    fs::path tempDir_;
+};
+
+// =============================================================================
+// 書き込みテスト
+// =============================================================================
+
+/// 現在位置への書き込みと位置指定の書き込みが反映され、開き方ごとに既存の内容を扱うこと
+TEST_F(FileWriterTest, Write_ModesAndPositions) {
+    const fs::path path = tempDir_ / "out.bin";
+    FileWriter file;
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::TRUNCATE)) << file.getLastError();
+    ASSERT_TRUE(file.write("hello", 5));
+    ASSERT_TRUE(file.writeAt(8, "XY", 2));
+    EXPECT_EQ(file.position(), 5);
+    ASSERT_TRUE(file.close());
+    EXPECT_EQ(readFile(path), std::string("hello\0\0\0XY", 10));
+
+    // APPEND は末尾から続ける
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::APPEND));
+    EXPECT_EQ(file.position(), 10);
+    ASSERT_TRUE(file.write("!", 1));
+    file.close();
+
+    // UPDATE は既存の内容を残して指定した位置に書く
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::UPDATE));
+    file.seek(5);
+    ASSERT_TRUE(file.write("abc", 3));
+    file.close();
+    EXPECT_EQ(readFile(path), "helloabcXY!");
+
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::TRUNCATE));
+    file.close();
+    EXPECT_EQ(fs::file_size(path), 0u);
+}
+
+/// allocate は伸ばすだけで短くせず、reserve はサイズを変えないこと
+TEST_F(FileWriterTest, Allocate_GrowsOnly) {
+    const fs::path path = tempDir_ / "alloc.bin";
+    FileWriter file;
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::TRUNCATE));
+    ASSERT_TRUE(file.write("data", 4));
+
+    ASSERT_TRUE(file.allocate(1024 * 1024)) << file.getLastError();
+    EXPECT_EQ(fs::file_size(path), 1024u * 1024);
+    ASSERT_TRUE(file.allocate(16));
+    EXPECT_EQ(fs::file_size(path), 1024u * 1024);
+
+    ASSERT_TRUE(file.truncate(4));
+    file.reserve(4 * 1024 * 1024);
+    EXPECT_EQ(fs::file_size(path), 4u);
+    file.close();
+    EXPECT_EQ(readFile(path), "data");
+}
+
+/// direct I/O・ページキャッシュの破棄・定期的な書き出しでも、境界に揃わない書き込みが正しく反映されること
+TEST_F(FileWriterTest, DirectIo_UnalignedWrites_RoundTrip) {
+    const fs::path path = tempDir_ / "direct.bin";
+    std::vector<char> pattern(3 * 1024 * 1024 + 123);
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        pattern[i] = static_cast<char>((i * 131 + 7) % 251);
+    }
+
+    FileWriter file;
+    ASSERT_TRUE(file.open(path.string(), FileWriter::Mode::TRUNCATE,
+                          {.directIo = true, .dropCache = true, .syncInterval = 512 * 1024}))
+        << file.getLastError();
+    // 先頭を境界からずらし、大きさも揃わない書き込みを混ぜる
+    ASSERT_TRUE(file.allocate(static_cast<int64_t>(pattern.size())));
+    file.seek(1);
+    size_t written = 1;
+    const size_t sizes[] = {7, 100000, 4096 * 3 + 5, 1024 * 1024, 4096};
+    for (size_t i = 0; written < pattern.size(); ++i) {
+        const size_t size = std::min(sizes[i % std::size(sizes)], pattern.size() - written);
+        ASSERT_TRUE(file.write(pattern.data() + written, size)) << file.getLastError();
+        written += size;
+    }
+    ASSERT_TRUE(file.writeAt(0, pattern.data(), 1));
+    ASSERT_TRUE(file.sync()) << file.getLastError();
+    ASSERT_TRUE(file.close()) << file.getLastError();
+
+    const std::string content = readFile(path);
+    ASSERT_EQ(content.size(), pattern.size());
+    EXPECT_TRUE(std::equal(content.begin(), content.end(), pattern.begin()));
+}
+
+/// 開けないパスではエラーメッセージを返し、閉じたファイルには書き込めないこと
+TEST_F(FileWriterTest, Open_InvalidPath_ReportsError) {
+    FileWriter file;
+    EXPECT_FALSE(file.open((tempDir_ / "missing" / "out.bin").string(), FileWriter::Mode::TRUNCATE));
+    EXPECT_FALSE(file.isOpen());
+    EXPECT_FALSE(file.getLastError().empty());
+    EXPECT_FALSE(file.write("x", 1));
+}
+
+// =============================================================================
+// 置き換えテスト
+// =============================================================================
+
+/// replace は既存の出力を置き換え、syncFile は存在しないファイルで失敗すること
+TEST_F(FileWriterTest, Replace_OverwritesTarget) {
+    const fs::path part   = tempDir_ / "out.bin.part";
+    const fs::path target = tempDir_ / "out.bin";
+    std::ofstream(part, std::ios::binary) << "new";
+    std::ofstream(target, std::ios::binary) << "previous";
+
+    std::string error;
+    ASSERT_TRUE(FileWriter::syncFile(part.string(), error)) << error;
+    ASSERT_TRUE(FileWriter::replace(part.string(), target.string(), true, error)) << error;
+    EXPECT_FALSE(fs::exists(part));
+    EXPECT_EQ(readFile(target), "new");
+
+    EXPECT_FALSE(FileWriter::syncFile(part.string(), error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(FileWriter::replace(part.string(), target.string(), false, error));
+}
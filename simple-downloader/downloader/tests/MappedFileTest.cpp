@@ -0,0 +1,106 @@
+// =============================================================================
+// MappedFileTest.cpp
+// MappedFile（出力ファイルの事前確保とメモリマップ）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 一時ディレクトリに実ファイルを作り、マップ経由の書き込みを読み戻して検証する
+// =============================================================================
+
+#include "MappedFile.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class MappedFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "mapped_file_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    static std::string readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    fs::path tempDir_;
+};
+
+// =============================================================================
+// マップテスト
+// =============================================================================
+
+/// 指定サイズで作成され、マップ経由の書き込みがファイルに反映されること
+TEST_F(MappedFileTest, Open_PreallocatesAndMapsFile) {
+    const fs::path path = tempDir_ / "out.bin";
+    constexpr int64_t SIZE = 256 * 1024 + 7;
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(path.string(), SIZE)) << file.getLastError();
+    ASSERT_NE(file.data(), nullptr);
+    EXPECT_EQ(file.size(), SIZE);
+    EXPECT_EQ(fs::file_size(path), static_cast<std::uintmax_t>(SIZE));
+
+    std::memcpy(file.data(), "head", 4);
+    std::memcpy(file.data() + SIZE - 4, "tail", 4);
+    ASSERT_TRUE(file.close()) << file.getLastError();
+    EXPECT_FALSE(file.isOpen());
+
+    const std::string content = readFile(path);
+    ASSERT_EQ(content.size(), static_cast<size_t>(SIZE));
+    EXPECT_EQ(content.substr(0, 4), "head");
+    EXPECT_EQ(content.substr(SIZE - 4), "tail");
+}
+
+/// 既存のファイルは切り詰めてから確保されること
+TEST_F(MappedFileTest, Open_TruncatesExistingFile) {
+    const fs::path path = tempDir_ / "existing.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << std::string(10000, 'x');
+    }
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(path.string(), 100)) << file.getLastError();
+    file.close();
+    EXPECT_EQ(readFile(path), std::string(100, '\0'));
+}
+
+/// サイズ 0 では空ファイルだけが作られること
+TEST_F(MappedFileTest, Open_ZeroSize_CreatesEmptyFile) {
+    const fs::path path = tempDir_ / "empty.bin";
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(path.string(), 0)) << file.getLastError();
+    EXPECT_TRUE(file.isOpen());
+    EXPECT_EQ(file.data(), nullptr);
+    file.close();
+    ASSERT_TRUE(fs::exists(path));
+    EXPECT_EQ(fs::file_size(path), 0u);
+}
+
+/// 作成できないパスではエラーメッセージを返すこと
+TEST_F(MappedFileTest, Open_InvalidPath_ReportsError) {
+    MappedFile file;
+    EXPECT_FALSE(file.open((tempDir_ / "missing" / "out.bin").string(), 16));
+    EXPECT_FALSE(file.isOpen());
+    EXPECT_FALSE(file.getLastError().empty());
+}
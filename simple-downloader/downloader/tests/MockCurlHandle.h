@@ -6,6 +6,13 @@
 // 設計方針:
 //  - curl ネットワーク呼び出しを一切行わずに動作をシミュレートする
 //  - perform() が呼ばれると「仮想データ」を writeCallback に送信する
+//    データはオフセットから決まるパターン値なので書き込み位置を検証できる
+//  - setRange / setNoBody により Range リクエストと HEAD を再現する
+//  - If-None-Match が etag と一致すれば 304 を返してボディを送らない
+//  - body を設定すると、パターン値の代わりにその内容（圧縮データなど）を送る
+//  - configureForUrl で URL ごとに動作を変えられる（複数ミラーの再現）
+//  - requestLog に実行したリクエスト（GET / HEAD と URL）を記録できる
+//  - WRITE_PAUSE が返されると unpause() まで同じチャンクを保留する（curl と同様）
 //  - progressCallback を適切なタイミングで呼び出す
 //  - pause/cancel によるコールバックからの中断を再現する
 //  - 完全に制御可能なため、再現性のあるテストが書ける
@@ -13,10 +20,12 @@
 
 #include "ICurlHandle.h"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstring>
 #include <functional>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -24,6 +33,46 @@
 namespace Downloader {
 namespace Test {
 
+/// @brief setAcceptEncoding() の呼び出しの記録
+struct AcceptEncodingRecord {
+    int         calls  = 0;
+    std::string encodings;
+    bool        decode = false;
+};
+
+/// @brief 接続のチューニング設定の記録
+struct TuningRecord {
+    size_t           bufferSize   = 0;     ///< 最後に設定した CURLOPT_BUFFERSIZE（0: 未設定）
+    bool             tcpNoDelay   = false;
+    bool             tcpKeepAlive = false;
+    long             keepIdle     = 0;
+    long             keepInterval = 0;
+    std::vector<int> receiveBufferSizes;   ///< setReceiveBufferSize() の呼び出し順
+    std::vector<std::string> resolveOverrides;
+    long             happyEyeballsMs = 0;
+    bool             tcpFastOpen  = false;
+    bool             tlsEarlyData = false;
+    bool             http2        = false;
+    bool             http3        = false;
+    int              multiplexing = -1;    ///< setMultiplexing() の値（-1: 未設定）
+};
+
+/// @brief perform() したリクエストの記録（"GET url" / "HEAD url"、複数スレッドから追加される）
+struct RequestLog {
+    std::mutex               mutex;
+    std::vector<std::string> requests;
+
+    void add(std::string request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(std::move(request));
+    }
+
+    std::vector<std::string> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requests;
+    }
+};
+
 /// @brief モック設定 - テストケースごとに動作を変える
 struct MockConfig {
     size_t      totalSize     = 10 * 1024;  ///< 仮想ファイルサイズ (バイト)
@@ -34,6 +83,33 @@ struct MockConfig {
     bool        supportsRange = true;       ///< Range ヘッダーをサポートするか
     /// perform 中にスリープする間隔（テストを遅くしすぎないため小さくする）
     std::chrono::milliseconds chunkDelay{1};
+    /// perform() から戻るたびに加算するカウンタ（接続の切断を検出するため）
+    std::atomic<int>* performDoneCounter = nullptr;
+    /// 空でなければ ETag ヘッダーを返し、一致しない If-Range の Range 指定は無視する
+    /// （一致する If-None-Match には 304 を返す）
+    std::string etag = "";
+    /// 空でなければパターン値の代わりに送るボディ（totalSize は無視する）
+    std::string body = "";
+    /// 空でなければ Content-Encoding ヘッダーを返す
+    std::string contentEncoding = "";
+    /// 空でなければ Retry-After ヘッダーを返す
+    std::string retryAfter = "";
+    /// setAcceptEncoding() の記録先（ハンドルは転送の終了時に破棄されるため外に残す）
+    AcceptEncodingRecord* acceptEncodingRecord = nullptr;
+    /// チューニング設定の記録先（acceptEncodingRecord と同じ理由で外に残す）
+    TuningRecord* tuningRecord = nullptr;
+    /// getRoundTripTimeUs() が返す値
+    int64_t roundTripTimeUs = -1;
+    /// enableHttp3() が成功するか（curl が HTTP/3 に対応しているか）
+    bool supportsHttp3 = false;
+    /// getTimings() が返す値
+    PhaseTimings timings;
+    /// perform() したリクエストの記録先
+    RequestLog* requestLog = nullptr;
+    /// 0 以上なら、この転送でこのバイト数を送った後に NETWORK_ERROR で切断する
+    int64_t failAfterBytes = -1;
+    /// perform() の開始時に URL を渡して設定を書き換える（ミラーごとに速度・失敗を変える）
+    std::function<void(const std::string& url, MockConfig& config)> configureForUrl;
 };
 
 /// @brief ICurlHandle のモック実装
@@ -57,8 +133,96 @@ public:
         ++resumeFromCallCount_;
     }
 
+    void setRange(int64_t first, int64_t last) override {
+        rangeFirst_ = first;
+        rangeLast_  = last;
+        rangeSet_   = true;
+    }
+
+    void setRequestHeaders(const std::vector<std::string>& headers) override {
+        requestHeaders_ = headers;
+    }
+
+    void setAcceptEncoding(const std::string& encodings, bool decode) override {
+        if (auto* record = mockConfig_.acceptEncodingRecord) {
+            ++record->calls;
+            record->encodings = encodings;
+            record->decode    = decode;
+        }
+    }
+
+    void setNoBody(bool noBody) override {
+        noBody_ = noBody;
+    }
+
+    void setBufferSize(size_t bytes) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->bufferSize = bytes;
+        }
+    }
+
+    void setTcpNoDelay(bool enable) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->tcpNoDelay = enable;
+        }
+    }
+
+    void setTcpKeepAlive(bool enable, long idleSec, long intervalSec) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->tcpKeepAlive = enable;
+            record->keepIdle     = idleSec;
+            record->keepInterval = intervalSec;
+        }
+    }
+
+    void setReceiveBufferSize(int bytes) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->receiveBufferSizes.push_back(bytes);
+        }
+    }
+
     void enableHttp2() override {
         http2Enabled_ = true;
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->http2 = true;
+        }
+    }
+
+    bool enableHttp3() override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->http3 = mockConfig_.supportsHttp3;
+        }
+        return mockConfig_.supportsHttp3;
+    }
+
+    void setMultiplexing(bool enable) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->multiplexing = enable ? 1 : 0;
+        }
+    }
+
+    void setResolveOverrides(const std::vector<std::string>& entries) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->resolveOverrides = entries;
+        }
+    }
+
+    void setHappyEyeballsTimeout(long ms) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->happyEyeballsMs = ms;
+        }
+    }
+
+    void setTcpFastOpen(bool enable) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->tcpFastOpen = enable;
+        }
+    }
+
+    void setTlsEarlyData(bool enable) override {
+        if (auto* record = mockConfig_.tuningRecord) {
+            record->tlsEarlyData = enable;
+        }
     }
 
     void setWriteCallback(WriteCallback cb) override {
@@ -69,6 +233,29 @@ public:
         progressCallback_ = std::move(cb);
     }
 
+    void setHeaderCallback(HeaderCallback cb) override {
+        headerCallback_ = std::move(cb);
+    }
+
+    // 受け取り先は個別のコールバックに包んで、同じ経路で呼び出す
+    void setReceiver(Receiver* receiver) override {
+        if (!receiver) {
+            writeCallback_    = nullptr;
+            progressCallback_ = nullptr;
+            headerCallback_   = nullptr;
+            return;
+        }
+        writeCallback_ = [receiver](const char* data, size_t size) {
+            return receiver->onWrite(data, size);
+        };
+        progressCallback_ = [receiver](int64_t dltotal, int64_t dlnow) {
+            return receiver->onProgress(dltotal, dlnow);
+        };
+        headerCallback_ = [receiver](const char* data, size_t size) {
+            receiver->onHeader(data, size);
+        };
+    }
+
     void setConnectTimeout(long seconds) override {
         connectTimeout_ = seconds;
     }
@@ -85,10 +272,23 @@ public:
         sslVerify_ = verify;
     }
 
+    /// @brief オフセットに対応する仮想データの値
+    static char patternByte(size_t offset) {
+        return static_cast<char>(offset % 251);
+    }
+
     /// @brief 仮想ダウンロードを実行する
-    /// totalSize バイトのゼロデータを chunkSize 単位で writeCallback に送る
+    /// totalSize バイトのパターンデータを chunkSize 単位で writeCallback に送る
     CurlResult perform() override {
         ++performCallCount_;
+        PerformDoneGuard done{mockConfig_.performDoneCounter};
+        if (mockConfig_.configureForUrl) {
+            const auto configure = mockConfig_.configureForUrl;
+            configure(url_, mockConfig_);
+        }
+        if (auto* log = mockConfig_.requestLog) {
+            log->add((noBody_ ? "HEAD " : "GET ") + url_);
+        }
 
         // エラー即時返却の設定
         if (mockConfig_.returnResult != CurlResult::OK &&
@@ -102,24 +302,84 @@ public:
             return CurlResult::RANGE_NOT_SATISFIED;
         }
 
+        // 条件付きリクエストで内容が変わっていなければ 304 を返す
+        if (notModified()) {
+            mockConfig_.httpCode = 304;
+            contentLength_       = 0;
+            sendHeader("HTTP/1.1 304 Mock\r\n");
+            sendHeader("ETag: " + mockConfig_.etag + "\r\n");
+            sendHeader("\r\n");
+            return CurlResult::OK;
+        }
+
+        // 送信するボディの区間 [start, end) を決める
+        // Range 非対応サーバは Range 指定を無視して全体を返す
+        const std::string& body = mockConfig_.body;
+        const size_t totalSize  = body.empty() ? mockConfig_.totalSize : body.size();
+        size_t start = static_cast<size_t>(resumeFrom_);
+        size_t end   = totalSize;
+        const bool ranged = rangeSet_ && mockConfig_.supportsRange && ifRangeMatches();
+        if (ranged) {
+            start = static_cast<size_t>(rangeFirst_);
+            end   = std::min(totalSize, static_cast<size_t>(rangeLast_) + 1);
+            if (start >= totalSize) {
+                // 末尾より後ろから始まる区間は 416
+                mockConfig_.httpCode = 416;
+                sendHeader("HTTP/1.1 416 Mock\r\n");
+                sendHeader("Content-Range: bytes */" + std::to_string(totalSize) + "\r\n");
+                sendHeader("\r\n");
+                return CurlResult::RANGE_NOT_SATISFIED;
+            }
+        }
+        contentLength_ = static_cast<int64_t>(end - start);
+
+        // ヘッダーを通知する（Range に応じた場合は 206 と Content-Range）
+        const long status = ranged && mockConfig_.httpCode == 200 ? 206 : mockConfig_.httpCode;
+        sendHeader("HTTP/1.1 " + std::to_string(status) + " Mock\r\n");
+        sendHeader("Content-Length: " + std::to_string(contentLength_) + "\r\n");
+        if (status == 206) {
+            sendHeader("Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end - 1) +
+                       "/" + std::to_string(totalSize) + "\r\n");
+        }
+        if (mockConfig_.supportsRange) {
+            sendHeader("Accept-Ranges: bytes\r\n");
+        }
+        if (!mockConfig_.etag.empty()) {
+            sendHeader("ETag: " + mockConfig_.etag + "\r\n");
+        }
+        if (!mockConfig_.contentEncoding.empty()) {
+            sendHeader("Content-Encoding: " + mockConfig_.contentEncoding + "\r\n");
+        }
+        if (!mockConfig_.retryAfter.empty()) {
+            sendHeader("Retry-After: " + mockConfig_.retryAfter + "\r\n");
+        }
+        sendHeader("\r\n");
+
+        // HEAD リクエストはボディを送らない
+        if (noBody_) {
+            return mockConfig_.returnResult;
+        }
+
         // 仮想データを生成してチャンク単位で送信
-        const size_t totalSize  = mockConfig_.totalSize;
-        const size_t chunkSize  = mockConfig_.chunkSize;
-        size_t       sent       = static_cast<size_t>(resumeFrom_);
-        const int64_t totalForProgress = static_cast<int64_t>(totalSize);
+        const size_t chunkSize = mockConfig_.chunkSize;
+        size_t       sent      = start;
+        const int64_t dltotal  = contentLength_;
 
-        // チャンクデータバッファ（ゼロ埋め）
         std::vector<char> buffer(chunkSize, '\0');
 
-        while (sent < totalSize) {
+        while (sent < end) {
+            if (mockConfig_.failAfterBytes >= 0 &&
+                static_cast<int64_t>(sent - start) >= mockConfig_.failAfterBytes) {
+                return CurlResult::NETWORK_ERROR;
+            }
+
             // 残りサイズを計算
-            const size_t remaining  = totalSize - sent;
+            const size_t remaining  = end - sent;
             const size_t toSend     = std::min(chunkSize, remaining);
 
             // 進捗コールバックを呼び出す
             if (progressCallback_) {
-                int64_t dlnow  = static_cast<int64_t>(sent - static_cast<size_t>(resumeFrom_));
-                int64_t dltotal = static_cast<int64_t>(totalSize - static_cast<size_t>(resumeFrom_));
+                int64_t dlnow = static_cast<int64_t>(sent - start);
                 int ret = progressCallback_(dltotal, dlnow);
                 if (ret != 0) {
                     // キャンセルされた
@@ -129,7 +389,27 @@ public:
 
             // 書き込みコールバックを呼び出す
             if (writeCallback_) {
+                if (!body.empty()) {
+                    std::memcpy(buffer.data(), body.data() + sent, toSend);
+                } else {
+                    for (size_t i = 0; i < toSend; ++i) {
+                        buffer[i] = patternByte(sent + i);
+                    }
+                }
+                // WRITE_PAUSE を返すコールバック内から unpause() されても
+                // 取りこぼさないよう、呼び出し前の再開回数を記録しておく
+                int unpauseSeen = unpauseCount_.load(std::memory_order_acquire);
                 size_t written = writeCallback_(buffer.data(), toSend);
+                while (written == WRITE_PAUSE) {
+                    // 一時停止中も curl と同様に進捗コールバックは呼ばれ続ける
+                    ++pauseCount_;
+                    if (!waitWhilePaused(unpauseSeen, dltotal,
+                                         static_cast<int64_t>(sent - start))) {
+                        return CurlResult::ABORTED_BY_CALLBACK;
+                    }
+                    unpauseSeen = unpauseCount_.load(std::memory_order_acquire);
+                    written = writeCallback_(buffer.data(), toSend);
+                }
                 if (written != toSend) {
                     // 書き込み失敗 = pause/cancel
                     return CurlResult::ABORTED_BY_CALLBACK;
@@ -146,17 +426,32 @@ public:
 
         // 最終進捗通知 (100%)
         if (progressCallback_) {
-            progressCallback_(totalForProgress,
-                              static_cast<int64_t>(totalSize - static_cast<size_t>(resumeFrom_)));
+            progressCallback_(dltotal, dltotal);
         }
 
         return mockConfig_.returnResult;
     }
 
+    void unpause() override {
+        unpauseCount_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
     long getHttpResponseCode() const override {
         return mockConfig_.httpCode;
     }
 
+    int64_t getContentLength() const override {
+        return contentLength_;
+    }
+
+    int64_t getRoundTripTimeUs() const override {
+        return mockConfig_.roundTripTimeUs;
+    }
+
+    PhaseTimings getTimings() const override {
+        return mockConfig_.timings;
+    }
+
     std::string getLastError() const override {
         return mockConfig_.errorMessage.empty()
                    ? "Mock error"
@@ -169,32 +464,95 @@ public:
 
     const std::string& getUrl()       const { return url_; }
     int64_t  getResumeFrom()          const { return resumeFrom_; }
+    bool     isRangeSet()             const { return rangeSet_; }
+    bool     isNoBody()               const { return noBody_; }
+    int      getPauseCount()          const { return pauseCount_; }
     int      getPerformCallCount()    const { return performCallCount_; }
     int      getResumeFromCallCount() const { return resumeFromCallCount_; }
     bool     isHttp2Enabled()         const { return http2Enabled_; }
     bool     isSslVerify()            const { return sslVerify_; }
     long     getConnectTimeout()      const { return connectTimeout_; }
     const std::string& getUserAgent() const { return userAgent_; }
+    const std::vector<std::string>& getRequestHeaders() const { return requestHeaders_; }
 
 private:
+    /// perform() のすべての戻り口でカウンタを加算する
+    struct PerformDoneGuard {
+        std::atomic<int>* counter;
+        ~PerformDoneGuard() {
+            if (counter) counter->fetch_add(1, std::memory_order_acq_rel);
+        }
+    };
+
+    /// unpauseSeen 以降に unpause() が呼ばれるまで待機する
+    /// @return false: 待機中に進捗コールバックが中断を要求した
+    bool waitWhilePaused(int unpauseSeen, int64_t dltotal, int64_t dlnow) {
+        while (unpauseCount_.load(std::memory_order_acquire) == unpauseSeen) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (progressCallback_ && progressCallback_(dltotal, dlnow) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// If-Range がない、または ETag と一致する
+    bool ifRangeMatches() const {
+        const std::string prefix = "If-Range: ";
+        for (const auto& header : requestHeaders_) {
+            if (header.rfind(prefix, 0) == 0) {
+                return header.substr(prefix.size()) == mockConfig_.etag;
+            }
+        }
+        return true;
+    }
+
+    /// If-None-Match が ETag と一致する
+    bool notModified() const {
+        const std::string prefix = "If-None-Match: ";
+        for (const auto& header : requestHeaders_) {
+            if (header.rfind(prefix, 0) == 0) {
+                return !mockConfig_.etag.empty() && header.substr(prefix.size()) == mockConfig_.etag;
+            }
+        }
+        return false;
+    }
+
+    void sendHeader(const std::string& line) {
+        if (headerCallback_) {
+            headerCallback_(line.data(), line.size());
+        }
+    }
+
     MockConfig       mockConfig_;
 
     // 設定値記録（検証用）
     std::string      url_;
     int64_t          resumeFrom_{0};
+    int64_t          rangeFirst_{0};
+    int64_t          rangeLast_{0};
+    bool             rangeSet_{false};
+    bool             noBody_{false};
+    int64_t          contentLength_{-1};
     bool             http2Enabled_{false};
     bool             sslVerify_{true};
     bool             followLocation_{true};
     long             connectTimeout_{30};
     std::string      userAgent_;
+    std::vector<std::string> requestHeaders_;
 
     // コールバック
     WriteCallback    writeCallback_;
     ProgressCallback progressCallback_;
+    HeaderCallback   headerCallback_;
 
     // 呼び出し回数カウンタ（検証用）
     int              performCallCount_{0};
     int              resumeFromCallCount_{0};
+    std::atomic<int> pauseCount_{0};
+
+    // 再開回数（unpause() は別スレッドから呼ばれる）
+    std::atomic<int> unpauseCount_{0};
 };
 
 } // namespace Test
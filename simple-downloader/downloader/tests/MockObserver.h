@@ -48,27 +48,22 @@ public:
     }
 
     void onCompleted() override {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            completedCallCount_++;
-        }
+        // 待機側がオブザーバーを破棄しても安全なようにロック内で通知する
+        std::lock_guard<std::mutex> lock(mutex_);
+        completedCallCount_++;
         cv_.notify_all();
     }
 
     void onError(const std::string& errorMessage) override {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            lastErrorMessage_ = errorMessage;
-            errorCallCount_++;
-        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        lastErrorMessage_ = errorMessage;
+        errorCallCount_++;
         cv_.notify_all();
     }
 
     void onPaused() override {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            pausedCallCount_++;
-        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        pausedCallCount_++;
         pausedCv_.notify_all();
     }
 
@@ -78,10 +73,8 @@ public:
     }
 
     void onCancelled() override {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            cancelledCallCount_++;
-        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelledCallCount_++;
         cv_.notify_all();
     }
 
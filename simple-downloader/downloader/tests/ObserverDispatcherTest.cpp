@@ -0,0 +1,154 @@
+// =============================================================================
+// ObserverDispatcherTest.cpp
+// ObserverDispatcher（オブザーバー通知スレッド・進捗通知のまとめ）の
+// GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 最初のイベントで実行を止め、その間に積んだイベントの順序・まとめ方を検証する
+//  - 実行完了は flush() で待ってから検証する
+// =============================================================================
+
+#include "ObserverDispatcher.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class ObserverDispatcherTest : public ::testing::Test {
+protected:
+    /// @brief release() されるまでディスパッチスレッドを止めるイベントを積む
+    void blockDispatcher(ObserverDispatcher& dispatcher) {
+        dispatcher.post([this]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            blocked_ = true;
+            cv_.notify_all();
+            cv_.wait(lock, [this]() { return released_; });
+        });
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return blocked_; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+    /// @brief 実行されたイベントを記録する
+    ObserverDispatcher::Event record(std::string name) {
+        return [this, name = std::move(name)]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            log_.push_back(name);
+        };
+    }
+
+    std::vector<std::string> log() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return log_;
+    }
+
+    std::mutex               mutex_;
+    std::condition_variable  cv_;
+    bool                     blocked_{false};
+    bool                     released_{false};
+    std::vector<std::string> log_;
+};
+
+// =============================================================================
+// テストケース
+// =============================================================================
+
+/// イベントは積んだ順に、呼び出し元とは別のスレッドで実行されること
+TEST_F(ObserverDispatcherTest, Post_RunsInOrderOnDispatchThread) {
+    ObserverDispatcher dispatcher;
+    std::thread::id    runner;
+    dispatcher.post([&]() { runner = std::this_thread::get_id(); });
+    dispatcher.post(record("a"));
+    dispatcher.post(record("b"));
+    dispatcher.post(record("c"));
+    dispatcher.flush();
+
+    EXPECT_NE(runner, std::this_thread::get_id());
+    EXPECT_EQ(log(), (std::vector<std::string>{"a", "b", "c"}));
+}
+
+/// 未実行の postLatest() は最新のものに置き換わり、最初の位置で 1 回だけ実行されること
+TEST_F(ObserverDispatcherTest, PostLatest_CoalescesPendingEvents) {
+    ObserverDispatcher dispatcher;
+    blockDispatcher(dispatcher);
+
+    dispatcher.post(record("start"));
+    for (int i = 0; i < 100; ++i) {
+        dispatcher.postLatest(record("progress" + std::to_string(i)));
+    }
+    dispatcher.post(record("completed"));
+    release();
+    dispatcher.flush();
+
+    EXPECT_EQ(log(), (std::vector<std::string>{"start", "progress99", "completed"}));
+}
+
+/// 実行後に積んだ postLatest() は新しいイベントとして実行されること
+TEST_F(ObserverDispatcherTest, PostLatest_AfterDispatch_RunsAgain) {
+    ObserverDispatcher dispatcher;
+    dispatcher.postLatest(record("p1"));
+    dispatcher.flush();
+    dispatcher.postLatest(record("p2"));
+    dispatcher.flush();
+
+    EXPECT_EQ(log(), (std::vector<std::string>{"p1", "p2"}));
+}
+
+/// デストラクタは積まれたイベントをすべて実行してから戻ること
+TEST_F(ObserverDispatcherTest, Destructor_RunsPendingEvents) {
+    std::atomic<int> count{0};
+    {
+        ObserverDispatcher dispatcher;
+        for (int i = 0; i < 50; ++i) {
+            dispatcher.post([&]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                count.fetch_add(1);
+            });
+        }
+    }
+    EXPECT_EQ(count.load(), 50);
+}
+
+/// イベントが例外を投げてもディスパッチスレッドは続き、flush() も戻ること
+TEST_F(ObserverDispatcherTest, ThrowingEvent_KeepsDispatching) {
+    ObserverDispatcher dispatcher;
+    dispatcher.post([]() { throw std::runtime_error("observer failed"); });
+    dispatcher.flush();
+    dispatcher.postLatest([]() { throw 42; });
+    dispatcher.post(record("after"));
+    dispatcher.flush();
+
+    EXPECT_EQ(log(), (std::vector<std::string>{"after"}));
+}
+
+/// イベントの中から flush() / post() を呼んでもデッドロックしないこと
+TEST_F(ObserverDispatcherTest, FlushFromDispatchThread_DoesNotBlock) {
+    ObserverDispatcher dispatcher;
+    dispatcher.post([&]() {
+        EXPECT_TRUE(dispatcher.isDispatchThread());
+        dispatcher.flush();
+        dispatcher.post(record("nested"));
+    });
+    dispatcher.flush();
+    dispatcher.flush(); // nested が積まれた後にもう一度待つ
+    EXPECT_EQ(log(), (std::vector<std::string>{"nested"}));
+    EXPECT_FALSE(dispatcher.isDispatchThread());
+}
@@ -0,0 +1,145 @@
+// =============================================================================
+// PeerServerTest.cpp
+// PeerServer（受信済みの区間だけの配布・追跡サービスへの登録）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 127.0.0.1 で待ち受けるサーバに、本物の curl で要求して検証する
+//  - 配布する内容は一時ファイルに書いた既知のバイト列
+// =============================================================================
+
+#include "CurlHandle.h"
+#include "Downloader.h"
+#include "MockObserver.h"
+#include "PeerServer.h"
+#include "PeerTracker.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+using namespace Downloader::Test;
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string URL = "http://origin.example.com/image.bin";
+
+/// 1 回の要求の結果
+struct Response {
+    long        status = 0;
+    std::string body;
+};
+
+/// url の [first, last] を要求する（last が負なら Range を付けない）
+Response fetch(const std::string& url, int64_t first = 0, int64_t last = -1) {
+    CurlHandle curl;
+    Response   response;
+    curl.setUrl(url);
+    if (last >= 0) {
+        curl.setRange(first, last);
+    }
+    curl.setWriteCallback([&response](const char* data, size_t size) {
+        response.body.append(data, size);
+        return size;
+    });
+    curl.setProgressCallback([](int64_t, int64_t) { return 0; });
+    curl.setHeaderCallback([](const char*, size_t) {});
+    curl.perform();
+    response.status = curl.getHttpResponseCode();
+    return response;
+}
+
+} // namespace
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class PeerServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = fs::temp_directory_path() / "peer_server_test.bin";
+        content_.resize(64 * 1024);
+        for (size_t i = 0; i < content_.size(); ++i) {
+            content_[i] = static_cast<char>((i * 7 + i / 251) & 0xFF);
+        }
+        std::ofstream(path_, std::ios::binary).write(content_.data(),
+                                                     static_cast<std::streamsize>(content_.size()));
+    }
+
+    void TearDown() override {
+        fs::remove(path_);
+    }
+
+    int64_t size() const { return static_cast<int64_t>(content_.size()); }
+
+    fs::path    path_;
+    std::string content_;
+};
+
+// =============================================================================
+// 配布テスト
+// =============================================================================
+
+/// 受信済みの区間は 206 で返し、まだない区間・配布していない内容は 404 になること
+TEST_F(PeerServerTest, ServesOnlyAvailableRanges) {
+    PeerServer server;
+    const std::string url = server.share(URL, path_.string(), size());
+    EXPECT_EQ(url, server.peerUrl(URL));
+    server.markAvailable(URL, 0, 16 * 1024 - 1);
+    server.markAvailable(URL, 16 * 1024, 32 * 1024 - 1); // 隣接する区間はまとめる
+    ASSERT_EQ(server.availableRanges(URL).size(), 1u);
+
+    const Response hit = fetch(url, 1000, 20000);
+    EXPECT_EQ(hit.status, 206);
+    EXPECT_EQ(hit.body, content_.substr(1000, 19001));
+
+    EXPECT_EQ(fetch(url, 30 * 1024, 40 * 1024).status, 404);
+    EXPECT_EQ(fetch(url).status, 404); // 全体はまだ揃っていない
+    EXPECT_EQ(fetch(server.peerUrl("http://other.example.com/x"), 0, 10).status, 404);
+    EXPECT_EQ(server.servedBytes(), 19001u);
+}
+
+/// 全体が揃えば Range なしでも返し、Downloader で分割して取得できること
+TEST_F(PeerServerTest, CompleteShare_DownloadsWithSegments) {
+    PeerServer server;
+    server.share(URL, path_.string(), size());
+    server.markComplete(URL);
+    EXPECT_EQ(fetch(server.peerUrl(URL)).body, content_);
+
+    DownloaderConfig config;
+    config.segmentCount   = 4;
+    config.minSegmentSize = 8 * 1024;
+    Downloader::Downloader downloader(config);
+    MockObserver observer;
+    downloader.addObserver(&observer);
+
+    std::vector<char> buffer(content_.size());
+    ASSERT_TRUE(downloader.startDownload(server.peerUrl(URL), std::span<char>(buffer)));
+    ASSERT_TRUE(observer.waitForFinish(std::chrono::seconds(10)));
+    ASSERT_TRUE(observer.isCompleted()) << observer.getLastError();
+    EXPECT_EQ(std::string(buffer.begin(), buffer.end()), content_);
+}
+
+/// share() / unshare() で追跡サービスへの登録・削除を行うこと
+TEST_F(PeerServerTest, Share_AnnouncesToTracker) {
+    PeerTracker tracker;
+    {
+        PeerServer server({.tracker = &tracker});
+        server.share(URL, path_.string(), size());
+        EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{server.peerUrl(URL)}));
+
+        server.unshare(URL);
+        EXPECT_TRUE(tracker.peersFor(URL).empty());
+        EXPECT_EQ(fetch(server.peerUrl(URL), 0, 10).status, 404);
+
+        server.share(URL, path_.string(), size());
+    }
+    // 破棄したサーバの登録は残らない
+    EXPECT_TRUE(tracker.peersFor(URL).empty());
+}
@@ -0,0 +1,54 @@
+// =============================================================================
+// PeerTrackerTest.cpp
+// PeerTracker（ピアの登録・削除・問い合わせごとの順序の入れ替え）の GoogleTest ユニットテスト
+// =============================================================================
+
+#include "PeerTracker.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+
+namespace {
+
+const std::string URL = "http://origin.example.com/image.bin";
+
+} // namespace
+
+/// 登録したピアが返され、同じピアを重ねて登録しても 1 つだけであること
+TEST(PeerTrackerTest, Announce_ListsPeersOnce) {
+    PeerTracker tracker;
+    EXPECT_TRUE(tracker.peersFor(URL).empty());
+
+    tracker.announce(URL, "http://a:1/p");
+    tracker.announce(URL, "http://a:1/p");
+    tracker.announce("http://other.example.com/x", "http://b:1/p");
+    EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{"http://a:1/p"}));
+}
+
+/// 問い合わせのたびに先頭のピアが入れ替わること
+TEST(PeerTrackerTest, PeersFor_RotatesFirstPeer) {
+    PeerTracker tracker;
+    tracker.announce(URL, "http://a:1/p");
+    tracker.announce(URL, "http://b:1/p");
+    tracker.announce(URL, "http://c:1/p");
+
+    EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{"http://a:1/p", "http://b:1/p", "http://c:1/p"}));
+    EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{"http://b:1/p", "http://c:1/p", "http://a:1/p"}));
+    EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{"http://c:1/p", "http://a:1/p", "http://b:1/p"}));
+}
+
+/// 削除したピアは返されないこと
+TEST(PeerTrackerTest, Withdraw_RemovesPeer) {
+    PeerTracker tracker;
+    tracker.announce(URL, "http://a:1/p");
+    tracker.announce(URL, "http://b:1/p");
+
+    tracker.withdraw(URL, "http://a:1/p");
+    EXPECT_EQ(tracker.peersFor(URL), (std::vector<std::string>{"http://b:1/p"}));
+    tracker.withdraw(URL, "http://b:1/p");
+    EXPECT_TRUE(tracker.peersFor(URL).empty());
+}
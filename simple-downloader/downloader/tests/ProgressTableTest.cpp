@@ -0,0 +1,120 @@
+// =============================================================================
+// ProgressTableTest.cpp
+// ProgressTable（進捗の表）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - スロットの再利用とブロックの追加を、使用中の件数と読み出した所有者で確かめる
+//  - 書き込みと読み出しは複数スレッドから同時に行い、値が壊れないことを確かめる
+// =============================================================================
+
+#include "ProgressTable.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace Downloader;
+
+/// 借りたスロットは IDLE・0 から始まり、書いた値が読み出せること
+TEST(ProgressTableTest, PublishedValuesAreCollected) {
+    ProgressTable table;
+    int owner = 0;
+    auto slot = table.acquire(&owner);
+    ASSERT_TRUE(slot);
+
+    std::vector<ProgressTable::Entry> entries;
+    ASSERT_EQ(table.collect(entries), 1u);
+    EXPECT_EQ(entries[0].owner, &owner);
+    EXPECT_EQ(entries[0].state, DownloadState::IDLE);
+    EXPECT_EQ(entries[0].downloadedBytes, 0);
+
+    table.publish(slot, DownloadState::DOWNLOADING, 300, 1000);
+    ASSERT_EQ(table.collect(entries), 1u);
+    EXPECT_EQ(entries[0].state, DownloadState::DOWNLOADING);
+    EXPECT_EQ(entries[0].downloadedBytes, 300);
+    EXPECT_EQ(entries[0].totalBytes, 1000);
+
+    table.release(slot);
+    EXPECT_FALSE(slot);
+    EXPECT_EQ(table.collect(entries), 0u);
+    EXPECT_EQ(table.size(), 0u);
+}
+
+/// ブロックを超えて借りられ、返したスロットは値を消して再利用されること
+TEST(ProgressTableTest, GrowsByBlocksAndReusesSlots) {
+    ProgressTable table;
+    const size_t count = ProgressTable::BLOCK_SIZE + 3;
+    std::vector<int> owners(count);
+    std::vector<ProgressTable::Slot> slots;
+    for (size_t i = 0; i < count; ++i) {
+        slots.push_back(table.acquire(&owners[i]));
+        table.publish(slots.back(), DownloadState::DOWNLOADING, static_cast<int64_t>(i), 0);
+    }
+    EXPECT_EQ(table.size(), count);
+
+    std::vector<ProgressTable::Entry> entries;
+    ASSERT_EQ(table.collect(entries), count);
+    std::set<const void*> seen;
+    for (const auto& entry : entries) {
+        seen.insert(entry.owner);
+        EXPECT_EQ(entry.owner, &owners[static_cast<size_t>(entry.downloadedBytes)]);
+    }
+    EXPECT_EQ(seen.size(), count);
+
+    table.release(slots[5]);
+    int newcomer = 0;
+    auto reused = table.acquire(&newcomer);
+    ASSERT_EQ(table.collect(entries), count);
+    size_t found = 0;
+    for (const auto& entry : entries) {
+        if (entry.owner == &newcomer) {
+            ++found;
+            EXPECT_EQ(entry.state, DownloadState::IDLE);
+            EXPECT_EQ(entry.downloadedBytes, 0);
+        }
+    }
+    EXPECT_EQ(found, 1u);
+    table.release(reused);
+}
+
+/// 各スレッドが自分のスロットへ書く間も、読み出す値は単調に増えること
+TEST(ProgressTableTest, ConcurrentPublishAndCollect) {
+    ProgressTable table;
+    constexpr int WRITERS = 4;
+    std::vector<int> owners(WRITERS);
+    std::vector<ProgressTable::Slot> slots;
+    for (auto& owner : owners) {
+        slots.push_back(table.acquire(&owner));
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; ++w) {
+        writers.emplace_back([&table, &slots, &stop, w]() {
+            for (int64_t bytes = 1; !stop.load(std::memory_order_relaxed); ++bytes) {
+                table.publish(slots[w], DownloadState::DOWNLOADING, bytes, 0);
+            }
+        });
+    }
+
+    std::vector<int64_t> last(WRITERS, 0);
+    std::vector<ProgressTable::Entry> entries;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(table.collect(entries), static_cast<size_t>(WRITERS));
+        for (const auto& entry : entries) {
+            const auto w = static_cast<size_t>(static_cast<const int*>(entry.owner) - owners.data());
+            EXPECT_GE(entry.downloadedBytes, last[w]);
+            last[w] = entry.downloadedBytes;
+        }
+    }
+    stop = true;
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    for (auto& slot : slots) {
+        table.release(slot);
+    }
+}
@@ -0,0 +1,239 @@
+// =============================================================================
+// RangeReaderTest.cpp
+// 区間の読み出し（coalesceRanges・Downloader::startRangeDownload・RangeReader・BlockCache）の
+// GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - curl 依存を MockCurlHandle で代替し、リクエストの回数は RequestLog で数える
+//  - 内容はモックのパターンデータ (MockCurlHandle::patternByte) と照合する
+// =============================================================================
+
+#include "BlockCache.h"
+#include "Downloader.h"
+#include "MockCurlHandle.h"
+#include "RangeReader.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <string>
+
+using namespace Downloader;
+using namespace Downloader::Test;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class RangeReaderTest : public ::testing::Test {
+protected:
+    static constexpr const char* kUrl = "http://example.com/archive.zip";
+
+    void SetUp() override {
+        tempOutputPath_ = fs::temp_directory_path() / "range_reader_test_output.bin";
+        fs::remove(tempOutputPath_);
+    }
+
+    void TearDown() override {
+        fs::remove(tempOutputPath_);
+    }
+
+    /// @brief リクエストを log に記録する MockCurlHandle を使う Downloader を生成する
+    std::unique_ptr<Downloader::Downloader> makeDownloader(size_t totalSize, DownloaderConfig config = {}) {
+        MockConfig mockConfig;
+        mockConfig.totalSize  = totalSize;
+        mockConfig.chunkDelay = std::chrono::milliseconds(0);
+        mockConfig.requestLog = &log_;
+        config.chunkSize      = 1024;
+        return std::make_unique<Downloader::Downloader>(
+            config,
+            [mockConfig]() -> std::unique_ptr<ICurlHandle> {
+                return std::make_unique<MockCurlHandle>(mockConfig);
+            });
+    }
+
+    size_t getCount() {
+        const auto requests = log_.snapshot();
+        return static_cast<size_t>(std::count_if(requests.begin(), requests.end(),
+                                                 [](const std::string& r) { return r.rfind("GET ", 0) == 0; }));
+    }
+
+    /// @brief 内容がモックのパターンデータの [first, first + size) と一致するか検証する
+    static void expectPattern(const std::vector<char>& content, int64_t first, size_t size) {
+        ASSERT_EQ(content.size(), size);
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(content[i], MockCurlHandle::patternByte(static_cast<size_t>(first) + i))
+                << "offset " << first + static_cast<int64_t>(i);
+        }
+    }
+
+    RequestLog log_;
+    fs::path   tempOutputPath_;
+};
+
+// =============================================================================
+// 区間の整理テスト
+// =============================================================================
+
+/// 間隔が maxGap 以下の区間はまとめ、重なりと順序の乱れを整理すること
+TEST_F(RangeReaderTest, CoalesceRanges_MergesNearbyRanges) {
+    const auto merged = coalesceRanges({{5000, 5099}, {0, 99}, {150, 199}, {50, 120}, {-1, 3}, {9, 8}}, 100);
+    EXPECT_EQ(merged, (std::vector<SegmentRange>{{0, 199}, {5000, 5099}}));
+
+    // 隣接する区間は maxGap = 0 でもまとめる
+    EXPECT_EQ(coalesceRanges({{0, 9}, {10, 19}, {21, 29}}, 0),
+              (std::vector<SegmentRange>{{0, 19}, {21, 29}}));
+}
+
+// =============================================================================
+// RangeReader テスト
+// =============================================================================
+
+/// 近い区間は 1 回のリクエストにまとめ、結果は要求の順で返すこと
+TEST_F(RangeReaderTest, Read_CoalescesAndKeepsRequestOrder) {
+    DownloaderConfig config;
+    config.segmentCount     = 4;
+    config.rangeCoalesceGap = 1024;
+    auto downloader = makeDownloader(100 * 1024, config);
+    RangeReader reader(*downloader);
+
+    const auto result = reader.read(kUrl, {{60000, 60099}, {0, 99}, {500, 599}});
+    ASSERT_TRUE(result.ok()) << result.download.error;
+    ASSERT_EQ(result.data.size(), 3u);
+    expectPattern(result.data[0], 60000, 100);
+    expectPattern(result.data[1], 0, 100);
+    expectPattern(result.data[2], 500, 100);
+    EXPECT_EQ(getCount(), 2u);
+    EXPECT_EQ(result.cachedBlocks, 0u);
+    // 合計はまとめた区間のバイト数
+    EXPECT_EQ(result.download.stats.totalBytes, 100 + 600);
+}
+
+/// segmentCount より多い区間は、区間を終えた転送が順に引き取ること
+TEST_F(RangeReaderTest, Read_ManyRanges_SharesTransfers) {
+    DownloaderConfig config;
+    config.segmentCount     = 3;
+    config.rangeCoalesceGap = 0;
+    auto downloader = makeDownloader(256 * 1024, config);
+    RangeReader reader(*downloader);
+
+    std::vector<SegmentRange> ranges;
+    for (int64_t i = 0; i < 20; ++i) {
+        ranges.push_back({i * 10000, i * 10000 + 2047});
+    }
+    const auto result = reader.read(kUrl, ranges);
+    ASSERT_TRUE(result.ok()) << result.download.error;
+    ASSERT_EQ(result.data.size(), ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        expectPattern(result.data[i], ranges[i].first, 2048);
+    }
+    EXPECT_EQ(getCount(), 20u);
+}
+
+/// 末尾を越える区間は短く返り、末尾より後ろから始まる区間は失敗すること
+TEST_F(RangeReaderTest, Read_PastEnd) {
+    auto downloader = makeDownloader(10 * 1024);
+    RangeReader reader(*downloader);
+
+    const auto tail = reader.read(kUrl, {{10 * 1024 - 10, 20 * 1024}});
+    ASSERT_TRUE(tail.ok()) << tail.download.error;
+    ASSERT_EQ(tail.data.size(), 1u);
+    expectPattern(tail.data[0], 10 * 1024 - 10, 10);
+
+    const auto beyond = reader.read(kUrl, {{20 * 1024, 20 * 1024 + 9}});
+    EXPECT_FALSE(beyond.ok());
+    EXPECT_TRUE(beyond.data.empty());
+
+    const auto invalid = reader.read(kUrl, {{10, 5}});
+    EXPECT_FALSE(invalid.ok());
+    EXPECT_FALSE(invalid.download.error.empty());
+}
+
+/// キャッシュにあるブロックはリクエストせず、足りないブロックだけを取得すること
+TEST_F(RangeReaderTest, Read_WithCache_ReusesBlocks) {
+    DownloaderConfig config;
+    config.segmentCount = 2;
+    auto downloader = makeDownloader(64 * 1024, config);
+    BlockCache  cache({.maxBytes = 1024 * 1024, .blockSize = 4096});
+    RangeReader reader(*downloader, &cache);
+
+    const auto first = reader.read(kUrl, {{100, 5000}});
+    ASSERT_TRUE(first.ok()) << first.download.error;
+    expectPattern(first.data[0], 100, 4901);
+    EXPECT_EQ(first.cachedBlocks, 0u);
+    EXPECT_EQ(cache.sizeBytes(), 2u * 4096);
+    const size_t requests = getCount();
+
+    // すべてキャッシュにあれば転送しない
+    const auto again = reader.read(kUrl, {{4000, 4199}, {0, 9}});
+    ASSERT_TRUE(again.ok());
+    expectPattern(again.data[0], 4000, 200);
+    expectPattern(again.data[1], 0, 10);
+    EXPECT_EQ(again.cachedBlocks, 2u);
+    EXPECT_EQ(getCount(), requests);
+
+    // 一部だけキャッシュにあれば、ないブロックだけを取得する（末尾のブロックは短い）
+    const auto tail = reader.readAsync(kUrl, {{8000, 64 * 1024 + 100}}).get();
+    ASSERT_TRUE(tail.ok()) << tail.download.error;
+    expectPattern(tail.data[0], 8000, 64 * 1024 - 8000);
+    EXPECT_EQ(tail.cachedBlocks, 1u);
+
+    cache.invalidate(kUrl);
+    EXPECT_EQ(cache.sizeBytes(), 0u);
+}
+
+// =============================================================================
+// startRangeDownload テスト
+// =============================================================================
+
+/// ファイルへの区間の読み出しは、区間の位置に書き込んだ疎なファイルを作ること
+TEST_F(RangeReaderTest, StartRangeDownload_WritesSparseFile) {
+    DownloaderConfig config;
+    config.segmentCount     = 2;
+    config.rangeCoalesceGap = 1024;
+    auto downloader = makeDownloader(32 * 1024, config);
+
+    std::promise<DownloadResult> done;
+    ASSERT_TRUE(downloader->startRangeDownload(kUrl, {{20000, 20999}, {100, 199}}, tempOutputPath_.string(),
+                                               [&done](DownloadResult r) { done.set_value(std::move(r)); }));
+    const DownloadResult result = done.get_future().get();
+    ASSERT_TRUE(result.ok()) << result.error;
+
+    std::ifstream in(tempOutputPath_, std::ios::binary);
+    const std::vector<char> content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    ASSERT_EQ(content.size(), 21000u);
+    expectPattern({content.begin() + 100, content.begin() + 200}, 100, 100);
+    expectPattern({content.begin() + 20000, content.end()}, 20000, 1000);
+    EXPECT_EQ(getCount(), 2u);
+}
+
+// =============================================================================
+// BlockCache テスト
+// =============================================================================
+
+/// 上限を超えると最も長く使われていないブロックから捨てること
+TEST_F(RangeReaderTest, BlockCache_EvictsLeastRecentlyUsed) {
+    BlockCache cache({.maxBytes = 8, .blockSize = 4});
+    cache.put("a", 0, {'0', '0', '0', '0'});
+    const auto kept = cache.put("a", 1, {'1', '1', '1', '1'});
+    ASSERT_NE(cache.get("a", 0), nullptr); // 0 を新しくする
+
+    cache.put("b", 0, {'b', 'b', 'b', 'b'});
+    EXPECT_NE(cache.get("a", 0), nullptr);
+    EXPECT_EQ(cache.get("a", 1), nullptr);
+    EXPECT_NE(cache.get("b", 0), nullptr);
+    EXPECT_EQ(cache.sizeBytes(), 8u);
+    EXPECT_EQ(cache.hits(), 3u);
+    EXPECT_EQ(cache.misses(), 1u);
+    // 捨てられたブロックも使い終わるまで有効
+    EXPECT_EQ(*kept, std::vector<char>({'1', '1', '1', '1'}));
+
+    cache.invalidate("a");
+    EXPECT_EQ(cache.get("a", 0), nullptr);
+    EXPECT_EQ(cache.sizeBytes(), 4u);
+}
@@ -0,0 +1,91 @@
+// =============================================================================
+// ReceiveTunerTest.cpp
+// ReceiveTuner（BDP に基づく受信バッファの推奨値）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - 時刻は引数で渡すため、実時間を待たずに任意の受信速度を再現する
+// =============================================================================
+
+#include "ReceiveTuner.h"
+
+#include <gtest/gtest.h>
+
+using namespace Downloader;
+using namespace std::chrono_literals;
+
+namespace {
+
+const ReceiveTuner::Clock::time_point T0{};
+
+} // namespace
+
+/// 帯域遅延積から curl のバッファは BDP/4、SO_RCVBUF は 2×BDP を 2 のべき乗に切り上げること
+TEST(ReceiveTunerTest, Sample_GrowsFromBandwidthDelayProduct) {
+    ReceiveTuner tuner({});
+    EXPECT_FALSE(tuner.sample(0, T0, 50000)); // 基準点
+
+    // 100ms で 1MB = 10MB/s、RTT 50ms → BDP 500KB
+    EXPECT_TRUE(tuner.sample(1000000, T0 + 100ms, 50000));
+    EXPECT_EQ(tuner.throughput(), 10000000);
+    EXPECT_EQ(tuner.bandwidthDelayProduct(), 500000);
+    EXPECT_EQ(tuner.bufferSize(), 128u * 1024);
+    EXPECT_EQ(tuner.receiveBufferSize(), 1024 * 1024);
+}
+
+/// RTT が分からない間は受信速度だけを測り、推奨値は変えないこと
+TEST(ReceiveTunerTest, Sample_UnknownRtt_KeepsDefaults) {
+    ReceiveTuner tuner({});
+    tuner.sample(0, T0, -1);
+    EXPECT_FALSE(tuner.sample(1000000, T0 + 100ms, -1));
+    EXPECT_EQ(tuner.throughput(), 10000000);
+    EXPECT_EQ(tuner.bandwidthDelayProduct(), 0);
+    EXPECT_EQ(tuner.bufferSize(), 16u * 1024);
+    EXPECT_EQ(tuner.receiveBufferSize(), 0);
+}
+
+/// 推奨値は上限で頭打ちになり、小さな BDP では SO_RCVBUF を推奨しないこと
+TEST(ReceiveTunerTest, Sample_ClampsToLimits) {
+    ReceiveTuner::Limits limits;
+    limits.maxBufferSize    = 256 * 1024;
+    limits.maxReceiveBuffer = 4 * 1024 * 1024;
+
+    ReceiveTuner fast(limits);
+    fast.sample(0, T0, 200000);
+    fast.sample(100000000, T0 + 100ms, 200000); // 1GB/s × 200ms
+    EXPECT_EQ(fast.bufferSize(), 256u * 1024);
+    EXPECT_EQ(fast.receiveBufferSize(), 4 * 1024 * 1024);
+
+    ReceiveTuner slow(limits);
+    slow.sample(0, T0, 1000);
+    EXPECT_FALSE(slow.sample(10000, T0 + 100ms, 1000)); // 100KB/s × 1ms
+    EXPECT_EQ(slow.bufferSize(), 16u * 1024);
+    EXPECT_EQ(slow.receiveBufferSize(), 0);
+}
+
+/// 遅い区間・接続の張り直しがあっても推奨値は減らないこと
+TEST(ReceiveTunerTest, Sample_NeverShrinks) {
+    ReceiveTuner tuner({});
+    tuner.sample(0, T0, 50000);
+    tuner.sample(1000000, T0 + 100ms, 50000);
+    const size_t buffer  = tuner.bufferSize();
+    const int    receive = tuner.receiveBufferSize();
+
+    EXPECT_FALSE(tuner.sample(1001000, T0 + 200ms, 50000)); // 10KB/s
+    EXPECT_FALSE(tuner.sample(0, T0 + 300ms, 50000));       // 累計が減った（再接続）
+    EXPECT_FALSE(tuner.sample(1000, T0 + 400ms, 50000));
+    EXPECT_EQ(tuner.throughput(), 10000000);
+    EXPECT_EQ(tuner.bufferSize(), buffer);
+    EXPECT_EQ(tuner.receiveBufferSize(), receive);
+}
+
+/// 測定の間隔が interval に満たない間は due() が false になること
+TEST(ReceiveTunerTest, Due_RespectsInterval) {
+    ReceiveTuner::Limits limits;
+    limits.interval = 50ms;
+    ReceiveTuner tuner(limits);
+
+    EXPECT_TRUE(tuner.due(T0)); // 未測定
+    tuner.sample(0, T0, -1);
+    EXPECT_FALSE(tuner.due(T0 + 49ms));
+    EXPECT_TRUE(tuner.due(T0 + 50ms));
+}
@@ -0,0 +1,165 @@
+// =============================================================================
+// ResumeJournalTest.cpp
+// ResumeJournal（再開用ジャーナル）の GoogleTest ユニットテスト
+//
+// 設計原則:
+//  - Downloader を介さず、ジャーナルファイルの読み書きと区間の検証を直接確かめる
+//  - 書き込み途中で落ちた状態は、ジャーナルファイルに不完全な行を書き足して再現する
+// =============================================================================
+
+#include "ResumeJournal.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Downloader;
+namespace fs = std::filesystem;
+
+// =============================================================================
+// テストフィクスチャ
+// =============================================================================
+
+class ResumeJournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "resume_journal_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+        journalPath_ = (tempDir_ / "output.bin.meta").string();
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    /// 内容 content のファイルを作る
+    std::string writeData(const std::string& content) {
+        const std::string path = (tempDir_ / "output.bin").string();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+        return path;
+    }
+
+    static JournalRange rangeOf(const std::string& content, int64_t first, int64_t last) {
+        return {first, last,
+                crc32Update(0, content.data() + first, static_cast<size_t>(last - first + 1))};
+    }
+
+    fs::path    tempDir_;
+    std::string journalPath_;
+};
+
+// =============================================================================
+// 読み書き
+// =============================================================================
+
+/// 作成・追記した内容をそのまま読み戻せること
+TEST_F(ResumeJournalTest, CreateAppendLoad_RoundTrip) {
+    {
+        ResumeJournal journal;
+        ASSERT_TRUE(journal.create(journalPath_, {4096, "\"abc\"", "Wed, 21 Oct 2015 07:28:00 GMT"},
+                                   {{0, 1023, 0x12345678u}}));
+        EXPECT_TRUE(journal.append({1024, 2047, 0xdeadbeefu}));
+        EXPECT_FALSE(fs::exists(journalPath_ + ".tmp"));
+    }
+
+    ResumeJournal loaded;
+    ASSERT_TRUE(loaded.load(journalPath_));
+    EXPECT_EQ(loaded.header().contentLength, 4096);
+    EXPECT_EQ(loaded.header().etag, "\"abc\"");
+    EXPECT_EQ(loaded.header().lastModified, "Wed, 21 Oct 2015 07:28:00 GMT");
+    EXPECT_EQ(loaded.header().validator(), "\"abc\"");
+
+    const auto ranges = loaded.ranges();
+    ASSERT_EQ(ranges.size(), 2u);
+    EXPECT_EQ(ranges[0].first, 0);
+    EXPECT_EQ(ranges[0].last, 1023);
+    EXPECT_EQ(ranges[0].crc, 0x12345678u);
+    EXPECT_EQ(ranges[1].first, 1024);
+    EXPECT_EQ(ranges[1].crc, 0xdeadbeefu);
+}
+
+/// 改行で終わらない末尾の行（書き込み途中で落ちた行）は読まないこと
+TEST_F(ResumeJournalTest, Load_IgnoresTornLastLine) {
+    {
+        ResumeJournal journal;
+        ASSERT_TRUE(journal.create(journalPath_, {4096, "\"abc\"", ""}));
+        ASSERT_TRUE(journal.append({0, 1023, 1}));
+    }
+    {
+        std::ofstream out(journalPath_, std::ios::binary | std::ios::app);
+        out << "range 1024 20";
+    }
+
+    ResumeJournal loaded;
+    ASSERT_TRUE(loaded.load(journalPath_));
+    ASSERT_EQ(loaded.ranges().size(), 1u);
+    EXPECT_EQ(loaded.ranges()[0].last, 1023);
+}
+
+/// 形式が違う・サイズのないファイルはジャーナルとして読まないこと
+TEST_F(ResumeJournalTest, Load_RejectsForeignFile) {
+    {
+        std::ofstream out(journalPath_, std::ios::binary);
+        out << "not a journal\nlength 10\n";
+    }
+    ResumeJournal journal;
+    EXPECT_FALSE(journal.load(journalPath_));
+    EXPECT_FALSE(journal.load((tempDir_ / "missing.meta").string()));
+}
+
+/// remove() でジャーナルファイルが消えること
+TEST_F(ResumeJournalTest, Remove_DeletesFile) {
+    ResumeJournal journal;
+    ASSERT_TRUE(journal.create(journalPath_, {10, "\"abc\"", ""}));
+    ASSERT_TRUE(fs::exists(journalPath_));
+    journal.remove();
+    EXPECT_FALSE(fs::exists(journalPath_));
+    EXPECT_FALSE(journal.append({0, 9, 0}));
+}
+
+// =============================================================================
+// 検証
+// =============================================================================
+
+/// ファイルの内容とチェックサムが一致する区間だけが残ること
+TEST_F(ResumeJournalTest, Verify_KeepsOnlyMatchingRanges) {
+    const std::string content = "0123456789abcdefghij";
+    const std::string path    = writeData(content);
+
+    JournalRange corrupt = rangeOf(content, 10, 14);
+    corrupt.crc ^= 1;
+    const std::vector<JournalRange> ranges = {
+        rangeOf(content, 0, 9),
+        corrupt,
+        rangeOf(content, 15, 19),
+        {18, 40, 0}, // ファイルの末尾を越える
+    };
+
+    const auto valid = ResumeJournal::verify(path, ranges);
+    ASSERT_EQ(valid.size(), 2u);
+    EXPECT_EQ(valid[0].first, 0);
+    EXPECT_EQ(valid[1].first, 15);
+}
+
+/// 受信済み区間の補集合が先頭から順に返ること（順不同・重なりも扱う）
+TEST_F(ResumeJournalTest, MissingRanges_ReturnsGapsInOrder) {
+    const auto missing = ResumeJournal::missingRanges(
+        100, {{50, 59, 0}, {10, 19, 0}, {15, 29, 0}, {90, 120, 0}});
+    ASSERT_EQ(missing.size(), 3u);
+    EXPECT_EQ(missing[0].first, 0);
+    EXPECT_EQ(missing[0].last, 9);
+    EXPECT_EQ(missing[1].first, 30);
+    EXPECT_EQ(missing[1].last, 49);
+    EXPECT_EQ(missing[2].first, 60);
+    EXPECT_EQ(missing[2].last, 89);
+
+    EXPECT_TRUE(ResumeJournal::missingRanges(10, {{0, 9, 0}}).empty());
+    const auto all = ResumeJournal::missingRanges(10, {});
+    ASSERT_EQ(all.size(), 1u);
+    EXPECT_EQ(all[0].size(), 10);
+}